@@ -0,0 +1,115 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// many logical coroutine tasks share one bus: each task loops over reads of
+// its servo. reports the throughput and the coroutine frame memory per task.
+//
+// > ./AwaitBench [maxTasks] [reads per task]
+//
+// needs -DDX_COROUTINES=1 (c++20)
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+#include <unistd.h>
+
+#include "MemorySerial.h"
+#include "DxAwait.h"
+#include "DxTime.h"
+
+#define  BENCH_SERVO_COUNT          (8)
+
+static DxTask<int> readPosition(DxAwaitBus& bus,int id)
+{
+    DxResult result = co_await bus.read(id,DX_CMD_PRESENT_POS,2);
+    co_return result.word();
+}
+
+static DxTask<int> client(DxAwaitBus& bus,int id,int reads)
+{
+    int errors = 0;
+    for(int i=0;i < reads;i++)
+    {
+        if(co_await readPosition(bus,id) < 0)
+            errors++;
+    }
+    co_return errors;
+}
+
+static DxTask<void> runAll(std::vector<DxTask<int> > tasks,int& errorCount,std::atomic<bool>& done)
+{
+    std::vector<int> errors = co_await dxWhenAll(std::move(tasks));
+    for(size_t i=0;i < errors.size();i++)
+        errorCount += errors[i];
+    done = true;
+}
+
+int main(int argc,char* argv[])
+{
+    int maxTasks = argc > 1 ? atoi(argv[1]) : 1000;
+    int reads    = argc > 2 ? atoi(argv[2]) : 100;
+
+    MemorySerial serial;
+    for(int id=1;id <= BENCH_SERVO_COUNT;id++)
+        serial.addServo(id);
+
+    DxBus      bus(&serial);
+    DxAsyncBus asyncBus(&bus,maxTasks);    // every task has one request in flight
+    DxAwaitBus awaitBus(asyncBus);
+
+    std::cout << std::setprecision(1) << std::fixed;
+    for(int taskCount = 1;taskCount <= maxTasks;taskCount *= 10)
+    {
+        long frameStart = dxTaskFrameBytes();
+
+        std::vector<DxTask<int> > tasks;
+        for(int i=0;i < taskCount;i++)
+            tasks.push_back(client(awaitBus,1 + i % BENCH_SERVO_COUNT,reads));
+
+        int               errorCount = 0;
+        std::atomic<bool> done(false);
+        long              framePeak = 0;
+
+        dx::uint64_t startTime = dxMicros();
+        dxSpawn(runAll(std::move(tasks),errorCount,done));
+
+        // all tasks are suspended most of the time, sample their frames
+        while(!done)
+        {
+            framePeak = std::max(framePeak,dxTaskFrameBytes() - frameStart);
+            usleep(100);
+        }
+        dx::uint64_t time = dxMicros() - startTime;
+
+        long ops = (long)taskCount * reads;
+        std::cout << "tasks " << std::setw(5) << taskCount
+                  << "  ops/s " << std::setw(10) << ops * 1000000.0 / time
+                  << "  errors " << errorCount
+                  << "  frame bytes/task " << (double)framePeak / taskCount
+                  << std::endl;
+    }
+
+    return 0;
+}
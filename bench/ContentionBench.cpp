@@ -0,0 +1,215 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// contention stress test: 1-16 client threads share one DxBus/MemorySerial
+// and run a mix of transactions, like a control, a telemetry and an ui
+// thread would do. reports the throughput, the latency percentiles and the
+// time spent waiting for the bus lock of every thread.
+// the bus lock is the one the clients queue on: every transaction holds it,
+// the SerialBase _readMutex/_writeMutex are only taken under it (so clients
+// never wait for each other there, only for the io thread filling the
+// buffer) and the java Servo._lock can't be reached from here, java
+// transactions take the same bus lock in beginTransaction().
+// the bytes take the time of the line at baudRate and the servos answer
+// after a 20us return delay, so the lock is held as long as on real hardware.
+// baudRate 0 answers at once and only measures the handover of the lock.
+//
+// > ./ContentionBench [maxThreads] [duration ms] [baudRate]
+//
+// build with -DDX_SANITIZER=thread to run it under tsan
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <boost/atomic.hpp>
+
+#include "MemorySerial.h"
+#include "DxBus.h"
+#include "DxTime.h"
+
+#define  BENCH_SERVO_COUNT          (8)
+
+struct ClientStats
+{
+    ClientStats():
+        ops(0),
+        errors(0),
+        lockWait(0)
+    {
+        latency.reserve(1 << 20);
+    }
+
+    int                         ops;
+    int                         errors;
+    boost::uint64_t             lockWait;   // us
+    std::vector<unsigned int>   latency;    // us
+};
+
+static boost::uint64_t percentile(std::vector<unsigned int>& sorted,double p)
+{
+    if(sorted.empty())
+        return 0;
+    return sorted[std::min(sorted.size() - 1,(size_t)(p * sorted.size()))];
+}
+
+static void client(DxBus* bus,int index,ClientStats* stats,boost::atomic<bool>* run)
+{
+    int idList[BENCH_SERVO_COUNT];
+    unsigned char dataList[BENCH_SERVO_COUNT * 2];
+    unsigned char buffer[8];
+    for(int i=0;i < BENCH_SERVO_COUNT;i++)
+        idList[i] = i + 1;
+
+    unsigned int seed = index + 1;
+    while(*run)
+    {
+        seed = seed * 1103515245 + 12345;
+        int id = 1 + (seed >> 16) % BENCH_SERVO_COUNT;
+        int op = (seed >> 8) % 10;
+
+        // the bus lock is recursive, taken here its wait is per thread
+        boost::uint64_t start = dxMicros();
+        bus->lock();
+        stats->lockWait += dxMicros() - start;
+
+        bool ret;
+        switch(op)
+        {
+        case 0:
+        case 1:
+        case 2:
+        case 3:     // telemetry
+            ret = bus->readData(id,DX_CMD_PRESENT_POS,sizeof(buffer),buffer);
+            break;
+        case 4:
+        case 5:     // control
+            ret = bus->writeWord(id,DX_CMD_GOAL_POS,seed & 0x3FF);
+            break;
+        case 6:
+        case 7:
+            for(int i=0;i < BENCH_SERVO_COUNT;i++)
+            {
+                dataList[i*2]   = seed & 0xFF;
+                dataList[i*2+1] = 0x01;
+            }
+            ret = bus->syncWrite(DX_CMD_GOAL_POS,2,idList,BENCH_SERVO_COUNT,dataList);
+            break;
+        case 8:     // ui
+            ret = bus->readWord(id,DX_CMD_PRESENT_TEMP) >= 0;
+            break;
+        default:
+            ret = bus->ping(id);
+            break;
+        }
+        bus->unlock();
+
+        stats->latency.push_back(dxMicros() - start);
+        stats->ops++;
+        if(!ret)
+            stats->errors++;
+    }
+}
+
+static void runStep(DxBus& bus,int threadCount,int duration,double& singleRate)
+{
+    std::vector<ClientStats>    stats(threadCount);
+    boost::thread_group         threads;
+    boost::atomic<bool>         run(true);
+
+    boost::uint64_t start = dxMicros();
+    for(int i=0;i < threadCount;i++)
+        threads.create_thread(boost::bind(&client,&bus,i,&stats[i],&run));
+
+    boost::this_thread::sleep(boost::posix_time::milliseconds(duration));
+    run = false;
+    threads.join_all();
+    double elapsed = (dxMicros() - start) / 1000000.0;
+
+    int ops = 0;
+    int errors = 0;
+    boost::uint64_t lockWait = 0;
+    for(int i=0;i < threadCount;i++)
+    {
+        ops      += stats[i].ops;
+        errors   += stats[i].errors;
+        lockWait += stats[i].lockWait;
+    }
+
+    double rate = ops / elapsed;
+    if(threadCount == 1)
+        singleRate = rate;
+
+    std::cout << "threads " << std::setw(2) << threadCount
+              << "  ops/s " << std::setw(9) << (int)rate
+              << "  scaling " << std::setw(5) << (singleRate > 0 ? rate / singleRate : 0)
+              << "  errors " << errors
+              << "  lock wait avg " << (ops ? lockWait / ops : 0) << "us"
+              << " (" << (int)(100.0 * lockWait / (elapsed * 1000000.0 * threadCount)) << "% of thread time)"
+              << std::endl;
+
+    for(int i=0;i < threadCount;i++)
+    {
+        std::vector<unsigned int>& latency = stats[i].latency;
+        std::sort(latency.begin(),latency.end());
+        std::cout << "    thread " << std::setw(2) << i
+                  << "  ops " << std::setw(8) << stats[i].ops
+                  << "  p50 " << std::setw(5) << percentile(latency,0.5) << "us"
+                  << "  p99 " << std::setw(5) << percentile(latency,0.99) << "us"
+                  << "  p99.9 " << std::setw(6) << percentile(latency,0.999) << "us"
+                  << "  max " << std::setw(6) << (latency.empty() ? 0 : latency.back()) << "us"
+                  << "  lock wait avg " << std::setw(5) << (stats[i].ops ? stats[i].lockWait / stats[i].ops : 0) << "us"
+                  << " (" << (int)(100.0 * stats[i].lockWait / (elapsed * 1000000.0)) << "%)"
+                  << std::endl;
+    }
+}
+
+int main(int argc,char* argv[])
+{
+    int maxThreads = argc > 1 ? atoi(argv[1]) : 16;
+    int duration   = argc > 2 ? atoi(argv[2]) : 1000;
+    int baudRate   = argc > 3 ? atoi(argv[3]) : 1000000;
+
+    MemorySerial serial;
+    for(int i=1;i <= BENCH_SERVO_COUNT;i++)
+    {
+        serial.addServo(i);
+        serial.setReg(i,DX_CMD_BAUDRATE,baudRate > 0 ? dxBaudRegister(baudRate) : 1);
+        serial.setReg(i,DX_CMD_DELAYTIME,10);
+    }
+    serial.setBaudRate(baudRate);
+    serial.setWireTime(baudRate > 0);
+
+    DxBus bus(&serial);
+
+    std::cout << std::setprecision(2) << std::fixed;
+    double singleRate = 0;
+    for(int threadCount = 1;threadCount <= maxThreads;threadCount *= 2)
+        runStep(bus,threadCount,duration,singleRate);
+
+    return 0;
+}
@@ -0,0 +1,323 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// microbenchmarks for the native hot paths, see Readme.txt
+//
+// > cmake -DUSE_ASIO=1 -DBUILD_BENCHMARKS=1 ..
+// > make DxBench && ./DxBench
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+#include <cstring>
+#include <pty.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+
+#include <boost/thread.hpp>
+#include <boost/atomic.hpp>
+
+#include "AsyncSerial.h"
+#include "MemorySerial.h"
+#include "SimSerial.h"
+#include "DxBus.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// receive ring
+
+// only feeds the circular buffer, no servos attached
+class RingSerial: public MemorySerial
+{
+public:
+    void feed(const char* data,unsigned int len) { received(data,len); }
+};
+
+static void BM_ReceiveRing(benchmark::State& state)
+{
+    RingSerial serial;
+    std::vector<char>           data(state.range(0),0x55);
+    std::vector<unsigned char>  out(state.range(0));
+
+    for(auto _ : state)
+    {
+        serial.feed(&data[0],data.size());
+        benchmark::DoNotOptimize(serial.read(&out[0],out.size(),0));
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_ReceiveRing)->Arg(1)->Arg(8)->Arg(64)->Arg(256);
+
+// the old bytewise access the java wrapper uses
+static void BM_ReceiveRingBytewise(benchmark::State& state)
+{
+    RingSerial serial;
+    std::vector<char> data(state.range(0),0x55);
+
+    for(auto _ : state)
+    {
+        serial.feed(&data[0],data.size());
+        while(serial.available() > 0)
+            benchmark::DoNotOptimize(serial.read());
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_ReceiveRingBytewise)->Arg(1)->Arg(8)->Arg(64)->Arg(256);
+
+///////////////////////////////////////////////////////////////////////////////
+// encoding
+
+static void BM_EncodePing(benchmark::State& state)
+{
+    unsigned char packet[DX_MAX_PACKET_SIZE];
+    for(auto _ : state)
+        benchmark::DoNotOptimize(DxBus::encodePacket(1,DX_INST_PING,NULL,0,packet));
+}
+BENCHMARK(BM_EncodePing);
+
+static void BM_EncodeRead(benchmark::State& state)
+{
+    unsigned char packet[DX_MAX_PACKET_SIZE];
+    unsigned char param[2] = { DX_CMD_PRESENT_POS, 2 };
+    for(auto _ : state)
+        benchmark::DoNotOptimize(DxBus::encodePacket(1,DX_INST_READ_DATA,param,sizeof(param),packet));
+}
+BENCHMARK(BM_EncodeRead);
+
+static void BM_EncodeWrite(benchmark::State& state)
+{
+    unsigned char packet[DX_MAX_PACKET_SIZE];
+    unsigned char param[3] = { DX_CMD_GOAL_POS, 0x00, 0x02 };
+    for(auto _ : state)
+        benchmark::DoNotOptimize(DxBus::encodePacket(1,DX_INST_WRITE_DATA,param,sizeof(param),packet));
+}
+BENCHMARK(BM_EncodeWrite);
+
+static void BM_EncodeSyncWrite(benchmark::State& state)
+{
+    int count = state.range(0);
+    unsigned char packet[DX_MAX_PACKET_SIZE];
+    std::vector<int>            idList(count);
+    std::vector<unsigned char>  dataList(count * 2);
+    for(int i=0;i < count;i++)
+    {
+        idList[i] = i + 1;
+        dataList[i*2]   = i & 0xFF;
+        dataList[i*2+1] = 0x02;
+    }
+
+    int size = 0;
+    for(auto _ : state)
+        benchmark::DoNotOptimize(size = DxBus::encodeSyncWrite(DX_CMD_GOAL_POS,2,&idList[0],count,&dataList[0],packet));
+    state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_EncodeSyncWrite)->Arg(1)->Arg(4)->Arg(10)->Arg(25)->Arg(50);
+
+static void BM_Checksum(benchmark::State& state)
+{
+    std::vector<unsigned char> data(state.range(0));
+    for(size_t i=0;i < data.size();i++)
+        data[i] = i * 7;
+
+    for(auto _ : state)
+        benchmark::DoNotOptimize(DxBus::calcChecksum(&data[0],data.size()));
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_Checksum)->Arg(6)->Arg(32)->Arg(DX_MAX_PACKET_SIZE);
+
+///////////////////////////////////////////////////////////////////////////////
+// decoding
+
+static int makeStatus(std::vector<unsigned char>& stream,int noise,int paramLength)
+{
+    unsigned int seed = 1;
+    for(int i=0;i < noise;i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        stream.push_back((seed >> 16) % 0xFF);
+    }
+
+    size_t start = stream.size();
+    stream.push_back(DX_BEGIN);
+    stream.push_back(DX_BEGIN);
+    stream.push_back(1);
+    stream.push_back(paramLength + 2);
+    stream.push_back(0);
+    for(int i=0;i < paramLength;i++)
+        stream.push_back(i);
+    stream.push_back(DxBus::calcChecksum(&stream[start + 2],paramLength + 3));
+    return stream.size();
+}
+
+static void BM_DecodeStatus(benchmark::State& state)
+{
+    std::vector<unsigned char> stream;
+    makeStatus(stream,0,state.range(0));
+
+    DxStatusPacket status;
+    for(auto _ : state)
+        benchmark::DoNotOptimize(DxBus::decodeStatus(&stream[0],stream.size(),status));
+    state.SetBytesProcessed(state.iterations() * stream.size());
+}
+BENCHMARK(BM_DecodeStatus)->Arg(0)->Arg(2)->Arg(6)->Arg(50);
+
+// resynchronisation on junk in front of the packet
+static void BM_DecodeStatusNoise(benchmark::State& state)
+{
+    std::vector<unsigned char> stream;
+    makeStatus(stream,state.range(0),2);
+
+    DxStatusPacket status;
+    for(auto _ : state)
+    {
+        const unsigned char* p = &stream[0];
+        int size = stream.size();
+        int used;
+        while((used = DxBus::decodeStatus(p,size,status)) > 0)
+        {
+            p    += used;
+            size -= used;
+        }
+        benchmark::DoNotOptimize(status);
+    }
+    state.SetBytesProcessed(state.iterations() * stream.size());
+}
+BENCHMARK(BM_DecodeStatusNoise)->Arg(1)->Arg(16)->Arg(128);
+
+///////////////////////////////////////////////////////////////////////////////
+// full transactions over the in memory transport
+
+static void BM_BusPing(benchmark::State& state)
+{
+    MemorySerial serial;
+    serial.addServo(1);
+    DxBus bus(&serial);
+
+    for(auto _ : state)
+        benchmark::DoNotOptimize(bus.ping(1));
+}
+BENCHMARK(BM_BusPing);
+
+static void BM_BusReadWord(benchmark::State& state)
+{
+    MemorySerial serial;
+    serial.addServo(1);
+    serial.setNoise(state.range(0));
+    DxBus bus(&serial);
+
+    for(auto _ : state)
+        benchmark::DoNotOptimize(bus.readWord(1,DX_CMD_PRESENT_POS));
+}
+BENCHMARK(BM_BusReadWord)->Arg(0)->Arg(16);
+
+static void BM_BusSyncWrite(benchmark::State& state)
+{
+    int count = state.range(0);
+    MemorySerial serial;
+    std::vector<int>            idList(count);
+    std::vector<unsigned char>  dataList(count * 2,0x01);
+    for(int i=0;i < count;i++)
+    {
+        idList[i] = i + 1;
+        serial.addServo(i + 1);
+    }
+    DxBus bus(&serial);
+
+    for(auto _ : state)
+        benchmark::DoNotOptimize(bus.syncWrite(DX_CMD_GOAL_POS,2,&idList[0],count,&dataList[0]));
+}
+BENCHMARK(BM_BusSyncWrite)->Arg(1)->Arg(10)->Arg(50);
+
+// closed loop over the simulated servos: move to a goal and poll the moving
+// flag, the simulation advances 1ms per poll
+static void BM_SimMoveAndPoll(benchmark::State& state)
+{
+    SimSerial serial(0);
+    serial.addServo(1);
+    DxBus bus(&serial);
+
+    int goal  = 1024;
+    int polls = 0;
+    for(auto _ : state)
+    {
+        goal = goal == 1024 ? 3072 : 1024;
+        bus.writeWord(1,DX_CMD_GOAL_POS,goal);
+        do
+        {
+            serial.step(0.001);
+            polls++;
+        }
+        while(bus.readByte(1,DX_CMD_MOVING) == 1);
+    }
+    state.counters["polls"] = benchmark::Counter(polls,benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_SimMoveAndPoll);
+
+///////////////////////////////////////////////////////////////////////////////
+// AsyncSerial write queue, the other side of a pty gets drained by a thread
+
+static void BM_AsyncSerialWrite(benchmark::State& state)
+{
+    int master,slave;
+    char name[256];
+    if(openpty(&master,&slave,name,NULL,NULL) != 0)
+    {
+        state.SkipWithError("openpty failed");
+        return;
+    }
+
+    struct termios tio;
+    tcgetattr(slave,&tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave,TCSANOW,&tio);
+
+    boost::atomic<bool> run(true);
+    boost::thread drain([&]()
+    {
+        char buf[4096];
+        fcntl(master,F_SETFL,O_NONBLOCK);
+        while(run)
+        {
+            if(read(master,buf,sizeof(buf)) <= 0)
+                boost::this_thread::sleep(boost::posix_time::microseconds(50));
+        }
+    });
+
+    {
+        CallbackAsyncSerial serial(name,1000000);
+        std::vector<char> data(state.range(0),0x55);
+
+        for(auto _ : state)
+            serial.write(&data[0],data.size());
+        state.SetBytesProcessed(state.iterations() * data.size());
+        // the destructor closes the port, aborting queued writes is no error here
+    }
+
+    run = false;
+    drain.join();
+    close(slave);
+    close(master);
+}
+BENCHMARK(BM_AsyncSerialWrite)->Arg(8)->Arg(64)->Arg(256);
+
+BENCHMARK_MAIN();
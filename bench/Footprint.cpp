@@ -0,0 +1,109 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// footprint of the native core: startup time, resident memory and threads.
+// built by the lite profile and with -DBUILD_BENCHMARKS, to compare both.
+//
+// > ./DxFootprint                      in memory bus with 8 servos
+// > ./DxFootprint /dev/ttyUSB0 1000000 real port, pings the ids 1-8
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+
+#include "MemorySerial.h"
+#include "DxBus.h"
+#include "DxTime.h"
+
+#define  FOOTPRINT_SERVO_COUNT      (8)
+#define  FOOTPRINT_LOOPS            (1000)
+
+// VmRSS, VmHWM (kB) and Threads of /proc/self/status, -1 if not available
+static long procStatus(const char* key)
+{
+    std::ifstream file("/proc/self/status");
+    std::string   line;
+    std::string   prefix = std::string(key) + ":";
+    while(std::getline(file,line))
+    {
+        if(line.compare(0,prefix.size(),prefix) == 0)
+            return atol(line.c_str() + prefix.size());
+    }
+    return -1;
+}
+
+int main(int argc,char* argv[])
+{
+    dx::uint64_t startTime = dxMicros();
+    long         rssStart  = procStatus("VmRSS");
+
+    SerialBase* serial;
+    if(argc > 1)
+    {
+        serial = new SerialBase();
+        if(serial->open(argv[1],argc > 2 ? atol(argv[2]) : 1000000) == false)
+        {
+            std::cout << "can't open " << argv[1] << std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        MemorySerial* memSerial = new MemorySerial();
+        for(int id=1;id <= FOOTPRINT_SERVO_COUNT;id++)
+            memSerial->addServo(id);
+        serial = memSerial;
+    }
+
+    DxBus* bus = new DxBus(serial);
+    int found = 0;
+    for(int id=1;id <= FOOTPRINT_SERVO_COUNT;id++)
+    {
+        if(bus->ping(id))
+            found++;
+    }
+    dx::uint64_t openTime = dxMicros() - startTime;
+
+    // steady state, reads like a control loop
+    dx::uint64_t loopStart = dxMicros();
+    for(int i=0;i < FOOTPRINT_LOOPS;i++)
+        bus->readWord(1 + i % FOOTPRINT_SERVO_COUNT,DX_CMD_PRESENT_POS);
+    dx::uint64_t loopTime = dxMicros() - loopStart;
+
+#ifdef DX_LITE
+    std::cout << "profile        lite (c++11, termios)" << std::endl;
+#else
+    std::cout << "profile        full (boost)" << std::endl;
+#endif
+    std::cout << "servos         " << found << "/" << FOOTPRINT_SERVO_COUNT << std::endl;
+    std::cout << "startup        " << openTime << " us (open + ping)" << std::endl;
+    std::cout << "readWord       " << (double)loopTime / FOOTPRINT_LOOPS << " us" << std::endl;
+    std::cout << "threads        " << procStatus("Threads") << std::endl;
+    std::cout << "rss            " << procStatus("VmRSS") << " kB (" << rssStart << " kB at start)" << std::endl;
+    std::cout << "rss peak       " << procStatus("VmHWM") << " kB" << std::endl;
+
+    delete bus;
+    delete serial;
+    return 0;
+}
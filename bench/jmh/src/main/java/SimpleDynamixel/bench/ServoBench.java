@@ -0,0 +1,137 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+package SimpleDynamixel.bench;
+
+import SimpleDynamixel.*;
+
+import java.util.concurrent.TimeUnit;
+
+import org.openjdk.jmh.annotations.*;
+import org.openjdk.jmh.profile.GCProfiler;
+import org.openjdk.jmh.runner.Runner;
+import org.openjdk.jmh.runner.RunnerException;
+import org.openjdk.jmh.runner.options.CommandLineOptionException;
+import org.openjdk.jmh.runner.options.CommandLineOptions;
+import org.openjdk.jmh.runner.options.Options;
+import org.openjdk.jmh.runner.options.OptionsBuilder;
+
+// Measures the java side of Servo against the in process MemorySerial, so
+// the numbers don't include any real serial line. path selects the route of
+// the hot ops: "fast" is the jni FastBus, which init() installs whenever the
+// native lib has it, "bytes" the byte wise SerialWrapper (synchronized,
+// ReturnPacket boxing, waitForData), e.g. -p path=bytes
+//
+// throughput gives ops/s, sample time the latency percentiles and the gc
+// profiler the allocation per op (gc.alloc.rate.norm)
+@State(Scope.Benchmark)
+@BenchmarkMode({Mode.Throughput, Mode.SampleTime})
+@OutputTimeUnit(TimeUnit.MICROSECONDS)
+@Warmup(iterations = 3, time = 1)
+@Measurement(iterations = 5, time = 2)
+@Fork(1)
+public class ServoBench
+{
+    @Param({"1", "10", "50"})
+    public int          servoCount;
+
+    @Param({"fast", "bytes"})
+    public String       path;
+
+    protected MemorySerial  _serial;
+    protected Servo         _servo;
+    protected int[]         _idList;
+    protected int[]         _posList;
+    protected int           _pos;
+
+    @Setup(Level.Trial)
+    public void setup()
+    {
+        Servo.loadExtLib();
+
+        _serial = new MemorySerial();
+        _idList = new int[servoCount];
+        _posList = new int[servoCount];
+        for(int i=0; i < servoCount; i++)
+        {
+            _idList[i] = i + 1;
+            _posList[i] = 512;
+            _serial.addServo(_idList[i], Servo.DX_TYPE_MX_28);
+        }
+
+        _servo = new Servo();
+        _servo.init(_serial);
+        _servo.setFastPath(path.equals("fast"));
+        if(path.equals("fast") && _servo.fastPath() == false)
+            throw new IllegalStateException("the native lib has no FastBus");
+
+        if(_servo.ping(1) == false)
+            throw new IllegalStateException("MemorySerial doesn't answer: " + Servo.errorStr(_servo.error()));
+    }
+
+    @TearDown(Level.Trial)
+    public void tearDown()
+    {
+        _serial.close();
+    }
+
+    @Benchmark
+    public int presentPosition()
+    {
+        return _servo.presentPosition(1);
+    }
+
+    @Benchmark
+    public boolean setGoalPosition()
+    {
+        _pos = (_pos + 1) & 0x3FF;
+        return _servo.setGoalPosition(1, _pos);
+    }
+
+    @Benchmark
+    public boolean syncWriteGoalPosition()
+    {
+        _pos = (_pos + 1) & 0x3FF;
+        for(int i=0; i < _posList.length; i++)
+            _posList[i] = _pos;
+        return _servo.syncWriteGoalPosition(_idList, _posList);
+    }
+
+    @Benchmark
+    public int[] pingRange()
+    {
+        return _servo.pingRange(1, servoCount);
+    }
+
+    // the usual jmh command line options work, the gc profiler is always on
+    public static void main(String[] args) throws RunnerException, CommandLineOptionException
+    {
+        Options opt = new OptionsBuilder()
+                .parent(new CommandLineOptions(args))
+                .include(ServoBench.class.getSimpleName())
+                .addProfiler(GCProfiler.class)
+                .build();
+
+        new Runner(opt).run();
+    }
+}
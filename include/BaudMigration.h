@@ -0,0 +1,83 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef BAUDMIGRATION_H
+#define	BAUDMIGRATION_H
+
+#include <vector>
+
+#include "DxBus.h"
+
+// results
+#define  DX_MIGRATION_OK            (0)
+#define  DX_MIGRATION_UNSUPPORTED   (1)     // no baudrate register value for the rate
+#define  DX_MIGRATION_MISSING       (2)     // not all servos answer before, nothing changed
+#define  DX_MIGRATION_ROLLED_BACK   (3)     // not all answered at the new rate, all back at the old one
+#define  DX_MIGRATION_FAILED        (4)     // the rollback lost servos, failedId() has them
+
+#define  DX_MIGRATION_SETTLE        (20)    // ms for the servos to switch
+#define  DX_MIGRATION_RETRIES       (3)     // pings per servo in the verify
+
+// moves a whole chain to another baudrate. all servos have to answer
+// first, then one sync write sets the new baudrate register, the port
+// reopens at the new rate and every servo has to answer again. if one
+// doesn't, the others are set back and the port returns to the old rate
+class BaudMigration
+{
+public:
+    BaudMigration(DxBus* bus);
+
+    DxBus* bus() { return _bus; }
+
+    // true if every servo answers at the new rate, see result()
+    bool migrate(const int* idList,int idCount,unsigned long baudRate);
+
+    int  result() { return _result; }
+    static const char* resultName(int result);
+
+    // the servos which didn't answer in the failing step
+    int  failedCount() { return _failed.size(); }
+    int  failedId(int index);
+
+    unsigned long oldBaudRate() { return _oldBaudRate; }
+    unsigned long newBaudRate() { return _newBaudRate; }
+
+    void setSettleTime(int settleTime) { _settleTime = settleTime; }
+    int  settleTime() { return _settleTime; }
+
+protected:
+
+    // ids which don't answer at the current rate
+    void verify(const std::vector<int>& idList,std::vector<int>& failed);
+    bool writeBaud(const std::vector<int>& idList,int reg);
+    bool switchRate(unsigned long baudRate);
+
+    DxBus*              _bus;
+    int                 _result;
+    int                 _settleTime;
+    unsigned long       _oldBaudRate;
+    unsigned long       _newBaudRate;
+    std::vector<int>    _failed;
+};
+
+#endif  // BAUDMIGRATION_H
@@ -0,0 +1,132 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef BUSDISCOVERY_H
+#define	BUSDISCOVERY_H
+
+#include <string>
+#include <vector>
+
+#include "DxCompat.h"
+
+#include "DxBus.h"
+
+#define  DX_DISCOVERY_TIMEOUT       (10)    // ms per pinged id
+
+// one servo of the merged topology
+struct DxDiscoveredServo
+{
+    int     port;               // index of the port
+    int     id;
+    int     modelNr;
+    int     firmware;
+    int     returnDelay;
+    int     statusReturnLevel;
+    bool    verified;           // matches the expected configuration
+};
+
+// startup of several ports at once. every port gets its own thread which
+// opens it through the BusRegistry, pings the id range and reads the
+// configuration of each servo it finds. the boot takes as long as the
+// slowest bus, not the sum of them
+class BusDiscovery
+{
+public:
+    BusDiscovery();
+    // releases the buses, unless they were taken with detach()
+    ~BusDiscovery();
+
+    int  addPort(const char* portName,unsigned long baudRate);
+    // already opened bus, e.g. on a MemorySerial. it stays with the caller
+    int  addBus(DxBus* bus);
+
+    void setIdRange(int first,int last);
+    void setTimeout(int timeout) { _timeout = timeout; }
+    int  timeout() { return _timeout; }
+
+    // -1 accepts any value
+    void setExpectedReturnDelay(int delay) { _returnDelay = delay; }
+    void setExpectedStatusReturnLevel(int level) { _statusReturnLevel = level; }
+
+    // hands the found ids to DxBus::setServoIds(), so uniform sync writes
+    // become broadcasts. off by default, and even then only for a complete
+    // scan: a broadcast reaches every servo, also those outside of the id
+    // range or those which missed their ping
+    void setAssignServoIds(bool enable) { _assignServoIds = enable; }
+    bool assignServoIds() { return _assignServoIds; }
+
+    // false if a port could not be opened
+    bool run();
+
+    // in ms, the whole run and per port
+    double duration() { return _duration; }
+
+    int         portCount() { return _ports.size(); }
+    const char* portName(int port);
+    bool        isOpen(int port);
+    DxBus*      bus(int port);
+    double      portDuration(int port);
+    int         portServoCount(int port);
+    // the whole id range got scanned and every id answered cleanly or not at all
+    bool        portComplete(int port);
+
+    // the merged topology, ordered by port and id
+    int  servoCount() { return _servos.size(); }
+    const DxDiscoveredServo* servo(int index);
+    // index of the first servo with the id on any port, -1 if there is none
+    int  find(int id);
+    // servos which don't match the expected configuration
+    int  unverifiedCount();
+
+    // the caller releases the buses with BusRegistry::release()
+    void detach();
+
+protected:
+
+    struct Port
+    {
+        std::string                     name;
+        unsigned long                   baudRate;
+        DxBus*                          bus;
+        bool                            registered;     // bus of the BusRegistry
+        bool                            complete;
+        double                          duration;
+        std::vector<DxDiscoveredServo>  servos;
+    };
+
+    void scan(int port);
+    void releaseBuses();
+
+    int                             _firstId;
+    int                             _lastId;
+    int                             _timeout;
+    int                             _returnDelay;
+    int                             _statusReturnLevel;
+    bool                            _assignServoIds;
+
+    double                          _duration;
+    std::vector<Port>               _ports;
+    std::vector<DxDiscoveredServo>  _servos;
+};
+
+#endif  // BUSDISCOVERY_H
@@ -0,0 +1,145 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef BUSHEALTH_H
+#define	BUSHEALTH_H
+
+#include <string>
+#include <vector>
+
+#include "DxCompat.h"
+
+#include "DxBus.h"
+#include "BusMetrics.h"
+
+#define  DX_HEALTH_DEFAULT_WINDOW   (10000)     // ms
+#define  DX_HEALTH_BUCKET_COUNT     (10)
+
+// likely cause of the errors in the window
+enum DxHealthCause
+{
+    DX_HEALTH_IDLE = 0,             // no transactions in the window
+    DX_HEALTH_OK,
+    DX_HEALTH_BUS,                  // line errors spread over many ids: cable, termination, baudrate, noise
+    DX_HEALTH_SERVO,                // line errors concentrated on one servo: its cable/connector or the servo
+    DX_HEALTH_SERVO_ALARM,          // a servo reports error bits (overload, overheat, ...)
+    DX_HEALTH_LATENCY_DRIFT         // no errors, but the replies get slower
+};
+
+// counters of one time bucket
+struct DxHealthCounters
+{
+    DxHealthCounters();
+    void reset();
+    void add(const DxHealthCounters& counters);
+
+    dx::uint32_t transactions;
+    dx::uint32_t retries;
+    dx::uint32_t errors;            // transactions with any error
+    dx::uint32_t lineErrors;        // DX_ERROR_USR_LINK or a wrong id
+    dx::uint32_t alarms;            // servo error bits
+    dx::uint32_t types[DX_ERRORTYPE_COUNT];
+};
+
+// windowed error, retry and latency analytics of one bus, fed by the DxBus
+// after every transaction which expects a status packet
+class BusHealth
+{
+public:
+    BusHealth(DxBus* bus,int window = DX_HEALTH_DEFAULT_WINDOW);
+    ~BusHealth();
+
+    DxBus* bus() { return _bus; }
+    int    window() { return _window; }
+
+    void addTransaction(int id,int error,int latency);
+    void addRetry(int id);
+
+    void reset();
+
+    // rates over the window, 0..1, id -1 is the whole bus
+    int    transactions(int id = -1);
+    double errorRate(int id = -1);
+    double lineErrorRate(int id = -1);
+    double retryRate(int id = -1);
+    double errorTypeRate(int type,int id = -1);
+
+    // last servo error bits of an id
+    int    alarm(int id);
+
+    // relative change of the short term latency against the long term
+    // average, 0.5 means 50% slower. id -1 is the whole bus
+    double latencyDrift(int id = -1);
+    double latency(int id = -1);       // us, short term average
+
+    // cause of the errors in the window, the id of the servo for
+    // DX_HEALTH_SERVO/DX_HEALTH_SERVO_ALARM
+    int    cause();
+    int    causeId();
+    static const char* causeName(int cause);
+
+    // one line summary, "ok: 1520 transactions, errors 0.0%, ..."
+    std::string summary();
+
+    // thresholds of the classification
+    void   setErrorThreshold(double rate) { _errorThreshold = rate; }
+    double errorThreshold() { return _errorThreshold; }
+    void   setDriftThreshold(double drift) { _driftThreshold = drift; }
+    double driftThreshold() { return _driftThreshold; }
+
+protected:
+
+    struct LatencyAverage
+    {
+        LatencyAverage();
+        void add(int latency);
+        double drift();
+
+        double          fast;
+        double          slow;
+        dx::uint32_t count;
+    };
+
+    void rotate();
+    void sum(int id,DxHealthCounters& counters);
+    int  classify(int& causeId);
+    DxHealthCounters& bucket(int id);
+
+    DxBus*          _bus;
+    int             _window;
+    int             _bucketTime;    // us
+    dx::mutex       _mutex;
+
+    // DX_BROADCAST_ID + 1 rows, the last one is the whole bus
+    std::vector<DxHealthCounters>   _buckets;
+    dx::uint64_t                    _bucketStart;
+    int                             _curBucket;
+
+    std::vector<LatencyAverage>     _latency;
+    std::vector<int>                _alarm;
+
+    double          _errorThreshold;
+    double          _driftThreshold;
+};
+
+#endif  // BUSHEALTH_H
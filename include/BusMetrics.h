@@ -0,0 +1,125 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef BUSMETRICS_H
+#define	BUSMETRICS_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include "DxCompat.h"
+
+#include "DxBus.h"
+
+#define  DX_METRICS_BUCKET_COUNT    (10)
+
+enum DxErrorType
+{
+    DX_ERRORTYPE_SERVO = 0,         // error bits of the status packet
+    DX_ERRORTYPE_ID,
+    DX_ERRORTYPE_STATUS,
+    DX_ERRORTYPE_NO_BEGIN,
+    DX_ERRORTYPE_DATA_TIMEOUT,
+    DX_ERRORTYPE_CHECKSUM,
+    DX_ERRORTYPE_COUNT
+};
+
+// lock free latency histogram, buckets in us
+class DxHistogram
+{
+public:
+    DxHistogram();
+
+    void add(int value);
+    void reset();
+
+    void write(std::ostream& out,const std::string& name,const std::string& labels);
+
+    static const int bucketLimits[DX_METRICS_BUCKET_COUNT];
+
+protected:
+    dx::atomic<dx::uint64_t>        _buckets[DX_METRICS_BUCKET_COUNT + 1];
+    dx::atomic<dx::uint64_t>        _sum;
+    dx::atomic<dx::uint64_t>        _count;
+};
+
+// bus and servo counters, updated by the DxBus after every transaction.
+// all values are atomics, writing the prometheus text never touches the bus
+class BusMetrics
+{
+public:
+    BusMetrics(DxBus* bus,const char* name = "");
+    ~BusMetrics();
+
+    DxBus* bus() { return _bus; }
+    std::string name() { return _name; }
+
+    void addTransaction(int id,int error,int latency,int txBytes,int rxBytes);
+    void setQueueDepth(int pending,int rxBuffered);
+
+    // control cycle timing, called by the application
+    void setCyclePeriod(int period);  // us, longer cycles count as overrun
+    int  cyclePeriod() { return _cyclePeriod; }
+    void beginCycle();
+    void endCycle();
+
+    void reset();
+
+    // prometheus text format
+    void write(std::ostream& out);
+    std::string text();
+
+    static void write(std::ostream& out,const std::vector<BusMetrics*>& list);
+
+    static int errorTypes(int error,bool types[DX_ERRORTYPE_COUNT]);
+    static const char* errorTypeName(int type);
+
+protected:
+
+    std::string labels();
+
+    DxBus*                          _bus;
+    std::string                     _name;
+
+    dx::atomic<dx::uint64_t>        _transactions;
+    dx::atomic<dx::uint64_t>        _errors[DX_ERRORTYPE_COUNT];
+    dx::atomic<dx::uint64_t>        _txBytes;
+    dx::atomic<dx::uint64_t>        _rxBytes;
+    DxHistogram                     _latency;
+
+    dx::atomic<int>                 _pending;
+    dx::atomic<int>                 _rxBuffered;
+
+    dx::atomic<int>                 _cyclePeriod;
+    dx::atomic<dx::uint64_t>        _cycleStart;
+    dx::atomic<int>                 _cycleLast;
+    dx::atomic<dx::uint64_t>        _cycleOverruns;
+    DxHistogram                     _cycle;
+
+    dx::atomic<dx::uint64_t>        _idTransactions[DX_BROADCAST_ID + 1];
+    dx::atomic<dx::uint64_t>        _idErrors[DX_BROADCAST_ID + 1];
+    dx::atomic<int>                 _idLatency[DX_BROADCAST_ID + 1];
+};
+
+#endif  // BUSMETRICS_H
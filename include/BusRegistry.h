@@ -0,0 +1,83 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef BUSREGISTRY_H
+#define	BUSREGISTRY_H
+
+#include <string>
+#include <map>
+#include <set>
+
+#include "DxCompat.h"
+
+#include "SerialBase.h"
+#include "DxBus.h"
+
+// results of acquire()
+#define  DX_REGISTRY_OK             (0)
+#define  DX_REGISTRY_OPEN_FAILED    (1)     // the port can't be opened
+#define  DX_REGISTRY_BAUDRATE       (2)     // already open with another baudrate
+
+// process wide registry of the open buses, refcounted by the port name.
+// every Servo (or module) on the same port shares one SerialBase, one io
+// thread and one DxBus, the DxBus serializes the transactions
+class BusRegistry
+{
+public:
+
+    // opens the port or returns the bus which is already open on it.
+    // returns NULL if the port can't be opened or is open with another
+    // baudrate, result tells which. different ports open in parallel, only
+    // a second acquire of a port which is still opening waits for it.
+    // symlinks of a device share its bus (see canonicalName())
+    static DxBus* acquire(const char* portName,unsigned long baudRate,int* result = NULL);
+
+    // the last release closes the port and deletes the bus, detach
+    // metrics/health/tracer before
+    static bool release(DxBus* bus);
+
+    static DxBus* find(const char* portName);
+    static int    refCount(const char* portName);
+    static int    count();
+
+    // the real path of the device, the name as it is if there is none
+    static std::string canonicalName(const char* portName);
+
+protected:
+
+    struct Entry
+    {
+        SerialBase*     serial;
+        DxBus*          bus;
+        int             refCount;
+    };
+
+    typedef std::map<std::string,Entry> EntryMap;
+
+    static dx::mutex                _mutex;
+    static dx::condition_variable   _opened;
+    static EntryMap                 _entries;
+    static std::set<std::string>    _opening;
+};
+
+#endif  // BUSREGISTRY_H
@@ -0,0 +1,106 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef BUSTRACER_H
+#define	BUSTRACER_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include "DxCompat.h"
+
+#define  DX_TRACE_NAME_SIZE         (32)
+#define  DX_TRACE_ARG_COUNT         (3)
+#define  DX_TRACE_DEFAULT_CAPACITY  (8192)  // events per thread
+
+struct DxTraceEvent
+{
+    char            phase;          // chrome trace phase, 'B','E','X','i','C'
+    char            name[DX_TRACE_NAME_SIZE];
+    dx::uint64_t time;              // us
+    dx::uint64_t duration;          // us, only 'X'
+    const char*     argName[DX_TRACE_ARG_COUNT];  // static strings, NULL = unused
+    int             argValue[DX_TRACE_ARG_COUNT];
+};
+
+// ring of the last events of one thread, written only by that thread
+class DxTraceBuffer
+{
+public:
+    DxTraceBuffer(int tid,int capacity);
+
+    DxTraceEvent& next() { return _events[_head % _events.size()]; }
+    void commit() { _head.fetch_add(1,dx::memory_order_release); }
+
+    // copies the events which are not overwritten while copying
+    void snapshot(std::vector<DxTraceEvent>& events);
+    void clear();
+
+    int tid() { return _tid; }
+
+protected:
+    int                             _tid;
+    std::vector<DxTraceEvent>       _events;
+    dx::atomic<dx::uint64_t>        _head;
+    dx::atomic<dx::uint64_t>        _first;     // first event after clear()
+};
+
+// records bus activity into per thread lock free rings and exports it
+// as chrome/perfetto trace json (chrome://tracing, ui.perfetto.dev)
+class BusTracer
+{
+public:
+    BusTracer(int capacity = DX_TRACE_DEFAULT_CAPACITY);
+    ~BusTracer();
+
+    void setEnabled(bool enable) { _enabled = enable; }
+    bool isEnabled() { return _enabled; }
+
+    void begin(const char* name,const char* arg0 = NULL,int value0 = 0,const char* arg1 = NULL,int value1 = 0);
+    void end(const char* name,const char* arg0 = NULL,int value0 = 0,const char* arg1 = NULL,int value1 = 0,const char* arg2 = NULL,int value2 = 0);
+    void complete(const char* name,dx::uint64_t startTime,dx::uint64_t duration,const char* arg0 = NULL,int value0 = 0);
+    void instant(const char* name,const char* arg0 = NULL,int value0 = 0,const char* arg1 = NULL,int value1 = 0);
+    void counter(const char* name,const char* arg0,int value0,const char* arg1 = NULL,int value1 = 0);
+
+    void clear();
+
+    void write(std::ostream& out);
+    std::string json();
+    bool exportJson(const char* path);
+
+protected:
+
+    DxTraceBuffer* buffer();
+    void add(char phase,const char* name,dx::uint64_t time,dx::uint64_t duration,
+             const char* arg0,int value0,const char* arg1,int value1,const char* arg2,int value2);
+
+    dx::atomic<bool>                            _enabled;
+    int                                         _capacity;
+
+    dx::thread_specific_ptr<DxTraceBuffer>      _threadBuffer;
+    dx::mutex                                   _bufferMutex;
+    std::vector<DxTraceBuffer*>                 _bufferList;
+};
+
+#endif  // BUSTRACER_H
@@ -0,0 +1,160 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef DXASYNCBUS_H
+#define	DXASYNCBUS_H
+
+#include "DxCompat.h"
+#include "DxBus.h"
+
+#define  DX_ERROR_USR_CANCELED      (1 << 15)   // removed from the queue by cancel()/stop()
+#define  DX_ERROR_USR_EXPIRED       (1 << 16)   // the timeout ran out before the bus was free
+#define  DX_ERROR_USR_BUSY          (1 << 17)   // not queued, the pool was full (DX_ASYNC_BUSY)
+
+#define  DX_ASYNC_STOPPED           (0)         // returned instead of a handle
+#define  DX_ASYNC_BUSY              (-1)        // all requests of the pool are in use
+
+#define  DX_ASYNC_DEFAULT_CAPACITY  (64)        // requests per bus
+#define  DX_ASYNC_SYNC_DATA         (DX_BROADCAST_ID * 4)  // sync write bytes per request
+
+struct DxResult
+{
+    int             handle;
+    int             id;
+    int             addr;
+    bool            ok;
+    int             error;
+    int             length;                     // read data
+    unsigned char   data[DX_MAX_PARAM_LENGTH];
+
+    int byte() const { return ok && length >= 1 ? data[0] : -1; }
+    int word() const { return ok && length >= 2 ? (data[1] << 8) + data[0] : -1; }
+};
+
+// the result is only valid during the call
+typedef void (*DxCompletion)(void* context,const DxResult& result);
+
+// queues transactions for one io thread, which runs them on the DxBus and
+// calls the completions. the synchronous DxBus calls can still be used, the
+// transactions get serialized by the bus lock.
+// all requests come from a pool allocated in the constructor, the queues
+// are lock free with a fixed capacity. nothing gets allocated per request,
+// a full pool is reported as DX_ASYNC_BUSY
+class DxAsyncBus
+{
+public:
+    DxAsyncBus(DxBus* bus,int capacity = DX_ASYNC_DEFAULT_CAPACITY);
+    // cancels the queued requests and joins the io thread
+    ~DxAsyncBus();
+
+    DxBus* bus() { return _bus; }
+
+    // return the handle for cancel(), DX_ASYNC_STOPPED or DX_ASYNC_BUSY
+    // (no completion then). completion can be NULL.
+    // timeout in ms till the request has to be on the bus, 0 = no limit
+    int ping(int id,DxCompletion completion,void* context,int timeout = 0);
+    int read(int id,int addr,int length,DxCompletion completion,void* context,int timeout = 0);
+    int write(int id,int addr,const unsigned char* data,int length,DxCompletion completion,void* context,int timeout = 0,bool regWrite = false);
+    // DxBus splits it into several packets, up to DX_ASYNC_SYNC_DATA bytes
+    // of data. a larger one completes with DX_ERROR_RANGE
+    int syncWrite(int addr,int length,const int* idList,int idCount,const unsigned char* dataList,DxCompletion completion,void* context,int timeout = 0);
+
+    // a queued request completes with DX_ERROR_USR_CANCELED on the calling
+    // thread, false if it is already on the bus or done
+    bool cancel(int handle);
+
+    void stop();
+    bool isRunning() { return _running; }
+
+    int  capacity() { return _capacity; }
+    int  queued() { return _queued; }
+    int  available() { return _capacity - _used; }
+    // requests refused with DX_ASYNC_BUSY
+    dx::uint64_t rejected() { return _rejected; }
+
+protected:
+
+    enum Op
+    {
+        OP_PING,
+        OP_READ,
+        OP_WRITE,
+        OP_SYNC_WRITE
+    };
+
+    // the low bits of the tag, the rest is the handle
+    enum State
+    {
+        STATE_FREE,
+        STATE_QUEUED,
+        STATE_RUNNING,
+        STATE_CANCELING
+    };
+
+    struct Request
+    {
+        dx::atomic<dx::uint64_t>    tag;
+        int                         generation;
+        Op                          op;
+        int                         length;
+        bool                        regWrite;
+        bool                        hasDeadline;
+        dx::system_time             deadline;
+        int                         idCount;            // sync write only, -1 if refused
+        unsigned char               idList[DX_BROADCAST_ID];
+        unsigned char               syncData[DX_ASYNC_SYNC_DATA];
+        DxCompletion                completion;
+        void*                       context;
+        DxResult                    result;             // data is also the write buffer
+    };
+
+    static dx::uint64_t tag(int handle,State state) { return ((dx::uint64_t)handle << 2) | state; }
+
+    Request* acquire(Op op,int id,int addr,int length,DxCompletion completion,void* context,int timeout);
+    int  submit(Request* request);
+    void release(Request* request);
+    void execute(Request* request);
+    void complete(Request* request);
+    void cancelPending();
+
+    void run();
+    void wait();
+
+    DxBus*                      _bus;
+    int                         _capacity;
+    Request*                    _requests;
+    dx::bounded_queue<int>      _free;
+    dx::bounded_queue<int>      _pending;
+
+    dx::atomic<bool>            _running;
+    dx::atomic<int>             _queued;
+    dx::atomic<int>             _used;
+    dx::atomic<dx::uint64_t>    _rejected;
+
+    dx::atomic<bool>            _sleeping;
+    dx::mutex                   _wakeMutex;
+    dx::condition_variable      _wakeCond;
+    dx::thread                  _thread;
+};
+
+#endif  // DXASYNCBUS_H
@@ -0,0 +1,610 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef DXAWAIT_H
+#define	DXAWAIT_H
+
+// c++20 coroutines on top of DxAsyncBus, bus logic as straight line code:
+//
+//   DxTask<int> position(DxAwaitBus& bus,int id)
+//   {
+//       DxResult r = co_await bus.read(id,DX_CMD_PRESENT_POS,2);
+//       co_return r.word();
+//   }
+//
+// a suspended task holds no thread, only its frame (see dxTaskFrameBytes()).
+// the coroutines resume on the io thread of the DxAsyncBus or through the
+// executor of the DxAwaitBus. errors come back in the DxResult, there are
+// no exceptions. awaits beyond the capacity of the DxAsyncBus pool return
+// DX_ERROR_USR_BUSY right away. header only, needs -std=c++20 (cmake -DDX_COROUTINES=1)
+
+#if !defined(__cpp_impl_coroutine)
+#error "DxAwait.h needs c++20 coroutines"
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "DxAsyncBus.h"
+
+// resumes a coroutine, for example posts the handle into an event loop
+typedef std::function<void (std::coroutine_handle<>)> DxExecutor;
+
+// bytes of all coroutine frames of DxTask, dxSpawn and dxWhenAll
+inline std::atomic<long>& dxTaskFrameBytes()
+{
+    static std::atomic<long> bytes(0);
+    return bytes;
+}
+
+template<class T = void>
+class DxTask;
+
+namespace dx_detail {
+
+struct FrameAlloc
+{
+    static void* operator new(size_t size)
+    {
+        dxTaskFrameBytes() += size;
+        return ::operator new(size);
+    }
+
+    static void operator delete(void* p,size_t size)
+    {
+        dxTaskFrameBytes() -= size;
+        ::operator delete(p,size);
+    }
+};
+
+// g++ 11 and 12 inline the FrameAlloc new into the ramp of a Detached
+// coroutine but not the sized delete on its cleanup path, and then see a
+// delete that doesn't pair with ::operator new. both come from FrameAlloc
+// (dxTaskFrameBytes() returns to 0), so the warning is off around the two
+// Detached coroutines only
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11 && __GNUC__ <= 12
+#define  DX_DETACHED_BEGIN  _Pragma("GCC diagnostic push") \
+                            _Pragma("GCC diagnostic ignored \"-Wmismatched-new-delete\"")
+#define  DX_DETACHED_END    _Pragma("GCC diagnostic pop")
+#else
+#define  DX_DETACHED_BEGIN
+#define  DX_DETACHED_END
+#endif
+
+struct PromiseBase : FrameAlloc
+{
+    std::coroutine_handle<> continuation;
+
+    // lazy, runs when awaited
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    struct FinalAwaiter
+    {
+        bool await_ready() noexcept { return false; }
+
+        template<class P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept
+        {
+            std::coroutine_handle<> c = h.promise().continuation;
+            return c ? c : std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() { std::terminate(); }
+};
+
+template<class T>
+struct Promise : PromiseBase
+{
+    T value;
+
+    DxTask<T> get_return_object();
+    void return_value(T v) { value = std::move(v); }
+    T result() { return std::move(value); }
+};
+
+template<>
+struct Promise<void> : PromiseBase
+{
+    DxTask<void> get_return_object();
+    void return_void() {}
+    void result() {}
+};
+
+// fire and forget, the frame deletes itself at the end
+struct Detached
+{
+    struct promise_type : FrameAlloc
+    {
+        Detached get_return_object() { return Detached(); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+} // namespace dx_detail
+
+// lazy coroutine, starts when it gets awaited or spawned. T has to be default constructible
+template<class T>
+class DxTask
+{
+public:
+    typedef dx_detail::Promise<T>                   promise_type;
+    typedef std::coroutine_handle<promise_type>     Handle;
+
+    explicit DxTask(Handle h = Handle()):
+        _h(h)
+    {}
+
+    DxTask(DxTask&& other) noexcept:
+        _h(std::exchange(other._h,Handle()))
+    {}
+
+    DxTask& operator=(DxTask&& other) noexcept
+    {
+        if(this != &other)
+        {
+            if(_h)
+                _h.destroy();
+            _h = std::exchange(other._h,Handle());
+        }
+        return *this;
+    }
+
+    DxTask(const DxTask&) = delete;
+    DxTask& operator=(const DxTask&) = delete;
+
+    ~DxTask()
+    {
+        if(_h)
+            _h.destroy();
+    }
+
+    bool await_ready() const noexcept { return !_h || _h.done(); }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept
+    {
+        _h.promise().continuation = continuation;
+        return _h;
+    }
+
+    T await_resume() { return _h.promise().result(); }
+
+protected:
+    Handle _h;
+};
+
+namespace dx_detail {
+
+template<class T>
+inline DxTask<T> Promise<T>::get_return_object()
+{
+    return DxTask<T>(std::coroutine_handle<Promise<T> >::from_promise(*this));
+}
+
+inline DxTask<void> Promise<void>::get_return_object()
+{
+    return DxTask<void>(std::coroutine_handle<Promise<void> >::from_promise(*this));
+}
+
+} // namespace dx_detail
+
+///////////////////////////////////////////////////////////////////////////////
+// cancellation
+
+// cancel() removes the queued transactions of all awaits which use the token,
+// later awaits complete at once. it has to live as long as these awaits
+class DxCancelToken
+{
+public:
+    DxCancelToken():
+        _canceled(false)
+    {}
+
+    void cancel()
+    {
+        RequestList requests;
+        {
+            std::lock_guard<std::mutex> l(_mutex);
+            _canceled = true;
+            requests = _requests;
+        }
+
+        // the callbacks call remove()
+        for(size_t i=0;i < requests.size();i++)
+            requests[i].first->cancel(requests[i].second);
+    }
+
+    bool isCanceled() const { return _canceled; }
+
+    // the io thread can complete a request before the await adds it, its
+    // remove() leaves a mark which drops the late add()
+    void add(DxAsyncBus* bus,int handle)
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        if(!erase(_completed,bus,handle))
+            _requests.push_back(std::make_pair(bus,handle));
+    }
+
+    void remove(DxAsyncBus* bus,int handle)
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        if(!erase(_requests,bus,handle))
+            _completed.push_back(std::make_pair(bus,handle));
+    }
+
+    // requests cancel() would still reach
+    int requestCount()
+    {
+        std::lock_guard<std::mutex> l(_mutex);
+        return _requests.size();
+    }
+
+protected:
+    typedef std::vector<std::pair<DxAsyncBus*,int> > RequestList;
+
+    static bool erase(RequestList& list,DxAsyncBus* bus,int handle)
+    {
+        for(size_t i=0;i < list.size();i++)
+        {
+            if(list[i].first == bus && list[i].second == handle)
+            {
+                list[i] = list.back();
+                list.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::mutex          _mutex;
+    std::atomic<bool>   _canceled;
+    RequestList         _requests;
+    RequestList         _completed;     // removed before they got added
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// transactions
+
+// awaitable of one DxAsyncBus request, co_await returns the DxResult
+class DxTransaction
+{
+public:
+    enum Op
+    {
+        OP_PING,
+        OP_READ,
+        OP_WRITE,
+        OP_SYNC_WRITE
+    };
+
+    DxTransaction(DxAsyncBus* bus,Op op,int id,int addr,int length,int timeout,
+                  const DxExecutor* executor,DxCancelToken* token):
+        _bus(bus),
+        _op(op),
+        _id(id),
+        _addr(addr),
+        _length(length),
+        _timeout(timeout),
+        _data(NULL),
+        _idList(NULL),
+        _idCount(0),
+        _executor(executor),
+        _token(token)
+    {
+        _result.handle = 0;
+        _result.id     = id;
+        _result.addr   = addr;
+        _result.ok     = false;
+        _result.error  = DX_ERROR_NO;
+        _result.length = 0;
+    }
+
+    // only used while the request gets queued, DxAsyncBus copies them
+    DxTransaction& data(const unsigned char* data,const int* idList = NULL,int idCount = 0)
+    {
+        _data    = data;
+        _idList  = idList;
+        _idCount = idCount;
+        return *this;
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> h)
+    {
+        _handle = h;
+
+        if(_token && _token->isCanceled())
+        {
+            _result.error = DX_ERROR_USR_CANCELED;
+            return false;
+        }
+
+        // the completion can resume before submit returns, afterwards only locals
+        DxAsyncBus*    bus = _bus;
+        DxCancelToken* token = _token;
+
+        int request = DX_ASYNC_STOPPED;
+        switch(_op)
+        {
+        case OP_PING:
+            request = bus->ping(_id,&DxTransaction::completed,this,_timeout);
+            break;
+        case OP_READ:
+            request = bus->read(_id,_addr,_length,&DxTransaction::completed,this,_timeout);
+            break;
+        case OP_WRITE:
+            request = bus->write(_id,_addr,_data,_length,&DxTransaction::completed,this,_timeout);
+            break;
+        case OP_SYNC_WRITE:
+            request = bus->syncWrite(_addr,_length,_idList,_idCount,_data,&DxTransaction::completed,this,_timeout);
+            break;
+        }
+
+        // no completion in both cases
+        if(request == DX_ASYNC_STOPPED)
+        {
+            _result.error = DX_ERROR_USR_CANCELED;
+            return false;
+        }
+        if(request == DX_ASYNC_BUSY)
+        {
+            _result.error = DX_ERROR_USR_BUSY;
+            return false;
+        }
+
+        if(token)
+        {
+            token->add(bus,request);
+            // canceled meanwhile
+            if(token->isCanceled())
+                bus->cancel(request);
+        }
+        return true;
+    }
+
+    DxResult await_resume() { return _result; }
+
+protected:
+
+    static void completed(void* context,const DxResult& result)
+    {
+        DxTransaction* self = static_cast<DxTransaction*>(context);
+        if(self->_token)
+            self->_token->remove(self->_bus,result.handle);
+
+        // only valid during the call
+        self->_result = result;
+        if(self->_executor && *self->_executor)
+            (*self->_executor)(self->_handle);
+        else
+            self->_handle.resume();
+    }
+
+    DxAsyncBus*             _bus;
+    Op                      _op;
+    int                     _id;
+    int                     _addr;
+    int                     _length;
+    int                     _timeout;
+    const unsigned char*    _data;
+    const int*              _idList;
+    int                     _idCount;
+    const DxExecutor*       _executor;
+    DxCancelToken*          _token;
+    std::coroutine_handle<> _handle;
+    DxResult                _result;
+};
+
+// the coroutine view of a DxAsyncBus, timeout in ms till the request is on
+// the bus (0 = none). executor and token are optional and have to outlive the awaits
+class DxAwaitBus
+{
+public:
+    DxAwaitBus(DxAsyncBus& bus,const DxExecutor& executor = DxExecutor(),DxCancelToken* token = NULL):
+        _bus(&bus),
+        _executor(executor),
+        _token(token)
+    {}
+
+    DxAsyncBus* asyncBus() { return _bus; }
+    DxCancelToken* token() { return _token; }
+
+    DxTransaction ping(int id,int timeout = 0)
+    {
+        return DxTransaction(_bus,DxTransaction::OP_PING,id,0,0,timeout,&_executor,_token);
+    }
+
+    DxTransaction read(int id,int addr,int length,int timeout = 0)
+    {
+        return DxTransaction(_bus,DxTransaction::OP_READ,id,addr,length,timeout,&_executor,_token);
+    }
+
+    DxTransaction write(int id,int addr,const unsigned char* data,int length,int timeout = 0)
+    {
+        return DxTransaction(_bus,DxTransaction::OP_WRITE,id,addr,length,timeout,&_executor,_token).data(data);
+    }
+
+    DxTransaction syncWrite(int addr,int length,const int* idList,int idCount,const unsigned char* dataList,int timeout = 0)
+    {
+        return DxTransaction(_bus,DxTransaction::OP_SYNC_WRITE,DX_BROADCAST_ID,addr,length,timeout,&_executor,_token).data(dataList,idList,idCount);
+    }
+
+protected:
+    DxAsyncBus*     _bus;
+    DxExecutor      _executor;
+    DxCancelToken*  _token;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// composition
+
+namespace dx_detail {
+
+template<class T>
+struct WhenAllState
+{
+    std::atomic<int>        count;
+    std::coroutine_handle<> parent;
+};
+
+DX_DETACHED_BEGIN
+template<class T,class R>
+Detached whenAllItem(DxTask<T>& task,R* result,WhenAllState<T>& state)
+{
+    if constexpr (std::is_void<T>::value)
+        co_await task;
+    else
+        *result = co_await task;
+
+    if(--state.count == 0)
+        state.parent.resume();
+}
+DX_DETACHED_END
+
+// starts all tasks at once, resumes when the last one is done
+template<class T,class R>
+struct WhenAllAwaiter
+{
+    std::vector<DxTask<T> >&    tasks;
+    R*                          results;
+    WhenAllState<T>             state;
+
+    WhenAllAwaiter(std::vector<DxTask<T> >& t,R* r):
+        tasks(t),
+        results(r)
+    {}
+
+    bool await_ready() const noexcept { return tasks.empty(); }
+
+    bool await_suspend(std::coroutine_handle<> h)
+    {
+        state.parent = h;
+        state.count = tasks.size() + 1;
+        for(size_t i=0;i < tasks.size();i++)
+            whenAllItem(tasks[i],results ? results + i : NULL,state);
+        return --state.count != 0;
+    }
+
+    void await_resume() noexcept {}
+};
+
+} // namespace dx_detail
+
+// awaits all tasks concurrently, the results in the order of the tasks
+template<class T>
+DxTask<std::vector<T> > dxWhenAll(std::vector<DxTask<T> > tasks)
+{
+    std::vector<T> results(tasks.size());
+    co_await dx_detail::WhenAllAwaiter<T,T>(tasks,results.empty() ? NULL : &results[0]);
+    co_return results;
+}
+
+inline DxTask<void> dxWhenAll(std::vector<DxTask<void> > tasks)
+{
+    co_await dx_detail::WhenAllAwaiter<void,int>(tasks,NULL);
+}
+
+// one transaction as a task, for dxWhenAll
+inline DxTask<DxResult> dxRead(DxAwaitBus& bus,int id,int addr,int length,int timeout = 0)
+{
+    co_return co_await bus.read(id,addr,length,timeout);
+}
+
+// reads the same registers of all ids, all requests get queued at once
+inline DxTask<std::vector<DxResult> > dxReadAll(DxAwaitBus& bus,std::vector<int> idList,int addr,int length,int timeout = 0)
+{
+    std::vector<DxTask<DxResult> > tasks;
+    tasks.reserve(idList.size());
+    for(size_t i=0;i < idList.size();i++)
+        tasks.push_back(dxRead(bus,idList[i],addr,length,timeout));
+    co_return co_await dxWhenAll(std::move(tasks));
+}
+
+// runs the task detached, it deletes itself at the end
+DX_DETACHED_BEGIN
+template<class T>
+dx_detail::Detached dxSpawn(DxTask<T> task)
+{
+    co_await task;
+}
+DX_DETACHED_END
+
+namespace dx_detail {
+
+template<class T>
+struct SyncWaitState
+{
+    std::mutex              mutex;
+    std::condition_variable cond;
+    bool                    done = false;
+    typename std::conditional<std::is_void<T>::value,int,T>::type value{};
+};
+
+template<class T>
+Detached syncWaitRunner(DxTask<T>& task,SyncWaitState<T>& state)
+{
+    if constexpr (std::is_void<T>::value)
+        co_await task;
+    else
+        state.value = co_await task;
+
+    // notify under the lock, the waiter returns and destroys the state
+    std::lock_guard<std::mutex> l(state.mutex);
+    state.done = true;
+    state.cond.notify_one();
+}
+
+} // namespace dx_detail
+
+// blocks the calling thread till the task is done, not from the io thread
+template<class T>
+T dxSyncWait(DxTask<T> task)
+{
+    dx_detail::SyncWaitState<T> state;
+    dx_detail::syncWaitRunner(task,state);
+
+    std::unique_lock<std::mutex> l(state.mutex);
+    while(!state.done)
+        state.cond.wait(l);
+
+    if constexpr (std::is_void<T>::value)
+        return;
+    else
+        return std::move(state.value);
+}
+
+#endif  // DXAWAIT_H
@@ -0,0 +1,313 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef DXBUS_H
+#define	DXBUS_H
+
+#include <map>
+#include <vector>
+
+#include "DxCompat.h"
+
+#include "SerialBase.h"
+
+class BusMetrics;
+class BusTracer;
+class BusHealth;
+class TelemetryHistory;
+
+// protocol, the same values as in Servo.java
+#define  DX_BEGIN                   (0xFF)
+#define  DX_BROADCAST_ID            (0xFE)
+#define  DX_LAST_ID                 (0xFD)
+
+#define  DX_MAX_PARAM_LENGTH        (253)   // length byte = param + 2
+#define  DX_MAX_PACKET_SIZE         (DX_MAX_PARAM_LENGTH + 6)
+
+// errors
+#define  DX_ERROR_NO                (0)
+#define  DX_ERROR_INVOLT            (1 << 0)
+#define  DX_ERROR_ANGLELIMIT        (1 << 1)
+#define  DX_ERROR_OVERHEAT          (1 << 2)
+#define  DX_ERROR_RANGE             (1 << 3)
+#define  DX_ERROR_CHECKSUM          (1 << 4)
+#define  DX_ERROR_OVERLOAD          (1 << 5)
+#define  DX_ERROR_INST              (1 << 6)
+
+#define  DX_ERROR_USR_ID            (1 << 10)
+#define  DX_ERROR_USR_READSTATUS    (1 << 11)
+#define  DX_ERROR_USR_NO_BEGIN      (1 << 12)
+#define  DX_ERROR_USR_DATA_TIMEOUT  (1 << 13)
+#define  DX_ERROR_USR_CHECKSUM      (1 << 14)   // always together with DX_ERROR_USR_READSTATUS
+
+// errors of the line, not of the servo, these can be retried
+#define  DX_ERROR_USR_LINK          (DX_ERROR_USR_READSTATUS | DX_ERROR_USR_NO_BEGIN | \
+                                     DX_ERROR_USR_DATA_TIMEOUT | DX_ERROR_USR_CHECKSUM)
+
+// instructions
+#define  DX_INST_PING               (0x01)
+#define  DX_INST_READ_DATA          (0x02)
+#define  DX_INST_WRITE_DATA         (0x03)
+#define  DX_INST_REG_WRITE          (0x04)
+#define  DX_INST_ACTION             (0x05)
+#define  DX_INST_RESET              (0x06)
+#define  DX_INST_SYNC_WRITE         (0x83)
+#define  DX_INST_BULK_READ          (0x92)  // mx series only
+
+// commands
+#define  DX_CMD_MODELNR             (0x00)
+#define  DX_CMD_FIRMWARE            (0x02)
+#define  DX_CMD_ID                  (0x03)
+#define  DX_CMD_BAUDRATE            (0x04)
+#define  DX_CMD_DELAYTIME           (0x05)
+#define  DX_CMD_CW_ANGLE_LIMIT      (0x06)
+#define  DX_CMD_CCW_ANGLE_LIMIT     (0x08)
+#define  DX_CMD_HIGH_LIMIT_TEMP     (0x0B)
+#define  DX_CMD_LOW_LIMIT_VOLT      (0x0C)
+#define  DX_CMD_HIGH_LIMIT_VOLT     (0x0D)
+#define  DX_CMD_MAX_TORQUE          (0x0E)
+#define  DX_CMD_STATUSRETURNLEVEL   (0x10)
+#define  DX_CMD_ALARM_LED           (0x11)
+#define  DX_CMD_ALARM_SHUTDOWN      (0x12)
+#define  DX_CMD_TORQUE_ENABLE       (0x18)
+#define  DX_CMD_LED_ENABLE          (0x19)
+#define  DX_CMD_GOAL_POS            (0x1E)
+#define  DX_CMD_MOV_SPEED           (0x20)
+#define  DX_CMD_LIMIT_TORQUE        (0x22)
+#define  DX_CMD_PRESENT_POS         (0x24)
+#define  DX_CMD_PRESENT_SPEED       (0x26)
+#define  DX_CMD_PRESENT_LOAD        (0x28)
+#define  DX_CMD_PRESENT_VOLT        (0x2A)
+#define  DX_CMD_PRESENT_TEMP        (0x2B)
+#define  DX_CMD_REGISTER            (0x2C)
+#define  DX_CMD_MOVING              (0x2E)
+#define  DX_CMD_LOCK                (0x2F)
+#define  DX_CMD_PUNCH               (0x30)
+
+#define  DX_DIR_CCW                 (0)
+#define  DX_DIR_CW                  (1)
+
+// models
+#define  DX_TYPE_DX_113             (0x0071)
+#define  DX_TYPE_DX_116             (0x0074)
+#define  DX_TYPE_DX_117             (0x0075)
+#define  DX_TYPE_AX_12W             (0x012C)
+#define  DX_TYPE_AX_12              (0x000C)
+#define  DX_TYPE_AX_18              (0x0012)
+#define  DX_TYPE_RX_10              (0x000A)
+#define  DX_TYPE_RX_24F             (0x0018)
+#define  DX_TYPE_RX_28              (0x001C)
+#define  DX_TYPE_RX_64              (0x0040)
+#define  DX_TYPE_EX_104             (0x006B)
+#define  DX_TYPE_MX_28              (0x001D)
+#define  DX_TYPE_MX_64              (0x0136)
+#define  DX_TYPE_MX_106             (0x0140)
+
+#define  DX_DEFAULT_TIMEOUT         (100)   // ms
+
+// baudrate of a DX_CMD_BAUDRATE value and back, 0/-1 if there is none
+// within 3%
+unsigned long dxBaudRate(int reg);
+int           dxBaudRegister(unsigned long baudRate);
+
+// last telemetry values seen in a read, -1 if unknown
+struct DxServoState
+{
+    DxServoState();
+
+    dx::atomic<int>                 pos;
+    dx::atomic<int>                 speed;
+    dx::atomic<int>                 load;
+    dx::atomic<int>                 volt;
+    dx::atomic<int>                 temp;
+    dx::atomic<dx::uint64_t>        time;   // dxMicros() of the last update
+};
+
+struct DxStatusPacket
+{
+    int                     id;
+    int                     error;
+    int                     paramLength;
+    const unsigned char*    param;
+    bool                    checksumOk;
+};
+
+// native packet layer, one transaction (request + status packet) at a time
+class DxBus
+{
+public:
+    DxBus(SerialBase* serial);
+    ~DxBus();
+
+    SerialBase* serial() { return _serial; }
+
+    void setTimeout(int timeout);
+    int  timeout();
+
+    // reopens the serial port between two transactions, the servos have
+    // to be switched before (see BaudMigration)
+    bool setBaudRate(unsigned long baudRate);
+    unsigned long baudRate();
+
+    // error of the last transaction of the calling thread, the transactions
+    // of other threads on the bus don't change it
+    int  error();
+
+    // the observers get (de)attached between two transactions, so they can
+    // be deleted after the call
+    void setMetrics(BusMetrics* metrics);
+    BusMetrics* metrics() { return _metrics; }
+
+    void setTracer(BusTracer* tracer);
+    BusTracer* tracer() { return _tracer; }
+
+    void setHealth(BusHealth* health);
+    BusHealth* health() { return _health; }
+
+    // gets every telemetry value the reads see
+    void setHistory(TelemetryHistory* history);
+    TelemetryHistory* history() { return _history; }
+
+    // reads and writes get repeated this often on line errors
+    void setRetries(int retries) { _retries = retries; }
+    int  retries() { return _retries; }
+
+    // the status return level the servos are set to (2 by default). below 2
+    // the writes and ACTION don't wait for a status packet
+    void setStatusReturnLevel(int level) { _statusReturnLevel = level; }
+    int  statusReturnLevel() { return _statusReturnLevel; }
+
+    // the ids of all servos on the bus. a sync write which gives all of
+    // them the same value goes out as one broadcast WRITE_DATA. without a
+    // list (default) there are no broadcasts
+    void setServoIds(const int* idList,int idCount);
+    int  servoIdCount() { return _servoIdCount; }
+
+    // holds the bus over several calls, for callers which write the bytes
+    // of a transaction themselves (the java serial path of Servo). the
+    // calls of the same thread still go through, all others wait
+    void lock();
+    void unlock();
+
+    // threads in or waiting for a transaction
+    int  pending() { return _pending; }
+
+    // time spent waiting for the bus lock, in us, summed over all transactions
+    dx::uint64_t lockWaitTime() { return _lockWaitTime; }
+    dx::uint64_t lockCount() { return _lockCount; }
+    void resetLockWait();
+
+    // telemetry cache, filled by every read which covers the present registers
+    int  lastPosition(int id);
+    int  lastSpeed(int id);
+    int  lastLoad(int id);
+    int  lastVolt(int id);
+    int  lastTemp(int id);
+    dx::uint64_t lastUpdate(int id);
+
+    bool ping(int id);
+    bool action(int id);
+
+    bool readData(int id,int addr,int length,unsigned char* data);
+    bool writeData(int id,int addr,const unsigned char* data,int length,bool regWrite = false);
+
+    // dataList holds length bytes for each id. more ids than fit into one
+    // packet go out in the fewest sync writes, in the order of the list
+    bool syncWrite(int addr,int length,const int* idList,int idCount,const unsigned char* dataList);
+
+    // a split sync write becomes one REG_WRITE per servo and a broadcast
+    // ACTION, so all servos still start at once
+    void setSyncSplitAction(bool enable) { _syncSplitAction = enable; }
+    bool syncSplitAction() { return _syncSplitAction; }
+
+    // servos with length bytes each which fit into one sync write
+    static int syncWriteCapacity(int length) { return length > 0 ? (DX_MAX_PARAM_LENGTH - 2) / (length + 1) : 0; }
+
+    // one request, the servos answer in the order of the list, each id once.
+    // data gets the lengths of all entries one after another. returns the
+    // count of servos read, the chain stops at the first missing reply
+    int  bulkRead(const int* idList,const int* addrList,const int* lengthList,int count,unsigned char* data);
+
+    int  readByte(int id,int addr);
+    int  readWord(int id,int addr);
+    bool writeByte(int id,int addr,int data);
+    bool writeWord(int id,int addr,int data);
+
+    static int calcChecksum(int checksumVal);
+    static int calcChecksum(const unsigned char* data,int length);
+
+    // returns the packet size, 0 if it doesn't fit into one packet
+    static int encodePacket(int id,int inst,const unsigned char* param,int paramLength,unsigned char* packet);
+    static int encodeSyncWrite(int addr,int length,const int* idList,int idCount,const unsigned char* dataList,unsigned char* packet);
+
+    // searches the next status packet, returns the used bytes (including
+    // leading noise) or 0 if more data is needed
+    static int decodeStatus(const unsigned char* data,int size,DxStatusPacket& status);
+
+protected:
+
+    bool sendPacket(int id,int inst,const unsigned char* param,int paramLength);
+    bool sendEncoded(int id,int inst,int size);    // packet in _packet
+    bool readStatus(int id,unsigned char* param,int paramLength);
+    bool endTransaction(int id,bool ret);
+    bool retry(int id,int attempt);
+    void saveError();
+    void updateState(int id,int addr,int length,const unsigned char* data);
+    bool reachesAll(int length,const int* idList,int idCount,const unsigned char* dataList);
+    bool regWriteAction(int addr,int length,const int* idList,int idCount,const unsigned char* dataList);
+
+    SerialBase*     _serial;
+    dx::recursive_mutex _busMutex;
+    BusMetrics*     _metrics;
+    BusTracer*      _tracer;
+    BusHealth*      _health;
+    TelemetryHistory* _history;
+    dx::atomic<int> _pending;
+    dx::atomic<dx::uint64_t> _lockWaitTime;
+    dx::atomic<dx::uint64_t> _lockCount;
+
+    int             _timeout;
+    int             _retries;
+    int             _statusReturnLevel;
+    bool            _syncSplitAction;
+    int             _error;     // of the current transaction, under the bus lock
+
+    // last error of each thread, error() doesn't wait for the bus lock
+    dx::mutex                       _errorMutex;
+    std::map<dx::thread::id,int>    _threadErrors;
+
+    // current transaction
+    dx::uint64_t    _startTime;
+    int             _txBytes;
+    int             _rxBytes;
+
+    DxServoState    _state[DX_BROADCAST_ID];
+
+    bool            _servoId[DX_BROADCAST_ID];
+    int             _servoIdCount;
+
+    unsigned char   _packet[DX_MAX_PACKET_SIZE];
+    unsigned char   _param[DX_MAX_PACKET_SIZE];
+};
+
+#endif  // DXBUS_H
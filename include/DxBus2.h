@@ -0,0 +1,143 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef DXBUS2_H
+#define	DXBUS2_H
+
+#include "DxCompat.h"
+#include "DxBus.h"
+
+// protocol 2.0 (x series, mx with 2.0 firmware). the user error bits are
+// the same as in DxBus. the error of the status packet is a number, not
+// the bits of protocol 1.0, it sets DX2_ERROR_USR_SERVO and is kept in
+// servoError()
+#define  DX2_HEADER                 (0xFD)
+#define  DX2_MAX_PARAM_LENGTH       (512)
+#define  DX2_MAX_PACKET_SIZE        (DX2_MAX_PARAM_LENGTH * 2 + 10)    // with byte stuffing
+
+#define  DX2_ERROR_ALERT            (0x80)  // see DX2_CMD_HARDWARE_ERROR
+#define  DX2_ERROR_RESULT           (0x01)
+#define  DX2_ERROR_INST             (0x02)
+#define  DX2_ERROR_CRC              (0x03)
+#define  DX2_ERROR_RANGE            (0x04)
+#define  DX2_ERROR_LENGTH           (0x05)
+#define  DX2_ERROR_LIMIT            (0x06)
+#define  DX2_ERROR_ACCESS           (0x07)
+#define  DX2_ERROR_NUMBER_MASK      (0x7F)
+
+#define  DX2_ERROR_USR_SERVO        (1 << 15)   // the servo answered with an error number
+
+// instructions
+#define  DX2_INST_PING              (0x01)
+#define  DX2_INST_READ              (0x02)
+#define  DX2_INST_WRITE             (0x03)
+#define  DX2_INST_REG_WRITE         (0x04)
+#define  DX2_INST_ACTION            (0x05)
+#define  DX2_INST_STATUS            (0x55)
+#define  DX2_INST_SYNC_READ         (0x82)
+#define  DX2_INST_SYNC_WRITE        (0x83)
+
+// x series control table
+#define  DX2_CMD_MODELNR            (0)     // 2 bytes
+#define  DX2_CMD_ID                 (7)
+#define  DX2_CMD_BAUDRATE           (8)
+#define  DX2_CMD_DELAYTIME          (9)
+#define  DX2_CMD_TORQUE_ENABLE      (64)
+#define  DX2_CMD_LED                (65)
+#define  DX2_CMD_STATUSRETURNLEVEL  (68)
+#define  DX2_CMD_HARDWARE_ERROR     (70)
+#define  DX2_CMD_GOAL_POS           (116)   // 4 bytes
+#define  DX2_CMD_PRESENT_CURRENT    (126)   // 2 bytes, signed
+#define  DX2_CMD_PRESENT_VELOCITY   (128)   // 4 bytes, signed
+#define  DX2_CMD_PRESENT_POS        (132)   // 4 bytes, signed
+#define  DX2_CMD_PRESENT_INPUT_VOLT (144)   // 2 bytes
+#define  DX2_CMD_PRESENT_TEMP       (146)
+#define  DX2_CMD_INDIRECT_ADDR      (168)   // 28 entries of 2 bytes
+#define  DX2_CMD_INDIRECT_DATA      (224)   // 28 entries of 1 byte
+
+#define  DX2_INDIRECT_COUNT         (28)
+
+// native protocol 2.0 packet layer, one transaction at a time. only the
+// instructions the telemetry needs, the servo classes use protocol 1.0
+class DxBus2
+{
+public:
+    DxBus2(SerialBase* serial);
+    ~DxBus2();
+
+    SerialBase* serial() { return _serial; }
+
+    void setTimeout(int timeout) { _timeout = timeout; }
+    int  timeout() { return _timeout; }
+
+    int  error() { return _error; }
+    // error byte of the last status packet, DX2_ERROR_ALERT and one of the
+    // DX2_ERROR_* numbers
+    int  servoError() { return _servoError; }
+
+    // bytes on the wire since the start
+    dx::uint64_t txBytes() { return _txBytes; }
+    dx::uint64_t rxBytes() { return _rxBytes; }
+
+    // modelNr can be NULL
+    bool ping(int id,int* modelNr = NULL);
+
+    bool readData(int id,int addr,int length,unsigned char* data);
+    bool writeData(int id,int addr,const unsigned char* data,int length);
+
+    // every servo answers with length bytes, dataList gets them in the
+    // order of idList. okList (can be NULL) tells who answered, returns the count
+    int  syncRead(int addr,int length,const int* idList,int idCount,unsigned char* dataList,bool* okList = NULL);
+    bool syncWrite(int addr,int length,const int* idList,int idCount,const unsigned char* dataList);
+
+    int  readByte(int id,int addr);
+    int  readWord(int id,int addr);
+    bool writeByte(int id,int addr,int data);
+    bool writeWord(int id,int addr,int data);
+
+    static unsigned short crc16(const unsigned char* data,int length,unsigned short crc = 0);
+
+    // returns the packet size with byte stuffing, 0 if the param is too long
+    static int encodePacket(int id,int inst,const unsigned char* param,int paramLength,unsigned char* packet);
+
+protected:
+
+    bool sendPacket(int id,int inst,const unsigned char* param,int paramLength);
+    // status of any id, param gets at most paramLength bytes
+    bool readStatus(int& id,unsigned char* param,int paramLength);
+
+    SerialBase*     _serial;
+    dx::mutex       _busMutex;
+
+    int             _timeout;
+    int             _error;
+    int             _servoError;
+
+    dx::uint64_t    _txBytes;
+    dx::uint64_t    _rxBytes;
+
+    unsigned char   _packet[DX2_MAX_PACKET_SIZE];
+    unsigned char   _param[DX2_MAX_PARAM_LENGTH];
+};
+
+#endif  // DXBUS2_H
@@ -0,0 +1,394 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+
+#ifndef DXCOMPAT_H
+#define	DXCOMPAT_H
+
+// threads, atomics and time of the native core. boost by default, the c++11
+// std lib in the lite profile (-DDX_LITE=1), which needs no boost at all
+
+#ifdef DX_LITE
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <chrono>
+#include <map>
+#include <vector>
+
+namespace dx {
+
+using std::int32_t;
+using std::uint32_t;
+using std::int64_t;
+using std::uint64_t;
+
+typedef std::mutex                      mutex;
+typedef std::unique_lock<std::mutex>    scoped_lock;
+typedef std::recursive_mutex            recursive_mutex;
+typedef std::unique_lock<std::recursive_mutex>  recursive_lock;
+typedef std::condition_variable         condition_variable;
+typedef std::thread                     thread;
+
+using std::function;
+using std::atomic;
+using std::memory_order_relaxed;
+using std::memory_order_acquire;
+using std::memory_order_release;
+using std::memory_order_seq_cst;
+using std::atomic_thread_fence;
+
+typedef std::chrono::steady_clock::time_point   system_time;
+
+inline system_time deadline(int ms)
+{
+    return std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+}
+
+inline bool expired(const system_time& time)
+{
+    return std::chrono::steady_clock::now() >= time;
+}
+
+// false on timeout
+inline bool timed_wait(condition_variable& cond,scoped_lock& l,const system_time& time)
+{
+    return cond.wait_until(l,time) == std::cv_status::no_timeout;
+}
+
+inline void sleep(int ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+inline thread::id this_thread_id()
+{
+    return std::this_thread::get_id();
+}
+
+// per thread pointer, the owner keeps the objects, nothing gets deleted at thread exit
+template<class T>
+class thread_specific_ptr
+{
+public:
+    explicit thread_specific_ptr(void (*)(T*)):
+        _key(nextKey())
+    {}
+
+    T* get() const
+    {
+        Map& m = map();
+        Map::iterator it = m.find(_key);
+        return it == m.end() ? NULL : static_cast<T*>(it->second);
+    }
+
+    void reset(T* p) { map()[_key] = p; }
+
+protected:
+    typedef std::map<uint64_t,void*> Map;
+
+    // keys are never reused, a new owner at the same address can't see stale pointers
+    static uint64_t nextKey()
+    {
+        static std::atomic<uint64_t> key(0);
+        return ++key;
+    }
+
+    static Map& map()
+    {
+        static thread_local Map m;
+        return m;
+    }
+
+    uint64_t _key;
+};
+
+// replaces boost::circular_buffer, overwrites the oldest element when full
+template<class T>
+class circular_buffer
+{
+public:
+    explicit circular_buffer(size_t capacity):
+        _data(capacity),
+        _head(0),
+        _size(0)
+    {}
+
+    bool   empty() const { return _size == 0; }
+    size_t size() const { return _size; }
+    size_t capacity() const { return _data.size(); }
+
+    const T& front() const { return _data[_head]; }
+
+    void push_back(const T& value)
+    {
+        _data[(_head + _size) % _data.size()] = value;
+        if(_size < _data.size())
+            _size++;
+        else
+            _head = (_head + 1) % _data.size();
+    }
+
+    void pop_front()
+    {
+        _head = (_head + 1) % _data.size();
+        _size--;
+    }
+
+    void clear() { _head = 0; _size = 0; }
+
+protected:
+    std::vector<T>  _data;
+    size_t          _head;
+    size_t          _size;
+};
+
+// fixed capacity lock free multi producer/consumer queue (dmitry vyukov's
+// bounded queue), push fails when full and never allocates
+template<class T>
+class bounded_queue
+{
+public:
+    explicit bounded_queue(size_t capacity):
+        _mask(roundUp(capacity) - 1),
+        _cells(new Cell[_mask + 1]),
+        _enqueue(0),
+        _dequeue(0)
+    {
+        for(size_t i=0;i <= _mask;i++)
+            _cells[i].sequence.store(i,std::memory_order_relaxed);
+    }
+
+    ~bounded_queue() { delete[] _cells; }
+
+    bool push(const T& value)
+    {
+        size_t pos = _enqueue.load(std::memory_order_relaxed);
+        for(;;)
+        {
+            Cell& cell = _cells[pos & _mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if(diff == 0)
+            {
+                if(_enqueue.compare_exchange_weak(pos,pos + 1,std::memory_order_relaxed))
+                {
+                    cell.value = value;
+                    cell.sequence.store(pos + 1,std::memory_order_release);
+                    return true;
+                }
+            }
+            else if(diff < 0)
+                return false;
+            else
+                pos = _enqueue.load(std::memory_order_relaxed);
+        }
+    }
+
+    bool pop(T& value)
+    {
+        size_t pos = _dequeue.load(std::memory_order_relaxed);
+        for(;;)
+        {
+            Cell& cell = _cells[pos & _mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if(diff == 0)
+            {
+                if(_dequeue.compare_exchange_weak(pos,pos + 1,std::memory_order_relaxed))
+                {
+                    value = cell.value;
+                    cell.sequence.store(pos + _mask + 1,std::memory_order_release);
+                    return true;
+                }
+            }
+            else if(diff < 0)
+                return false;
+            else
+                pos = _dequeue.load(std::memory_order_relaxed);
+        }
+    }
+
+    // only a hint while other threads push/pop
+    bool empty() const
+    {
+        return _enqueue.load(std::memory_order_acquire) == _dequeue.load(std::memory_order_acquire);
+    }
+
+protected:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T                   value;
+    };
+
+    static size_t roundUp(size_t capacity)
+    {
+        size_t size = 2;
+        while(size < capacity)
+            size <<= 1;
+        return size;
+    }
+
+    bounded_queue(const bounded_queue&);
+    bounded_queue& operator=(const bounded_queue&);
+
+    size_t              _mask;
+    Cell*               _cells;
+    std::atomic<size_t> _enqueue;
+    std::atomic<size_t> _dequeue;
+};
+
+} // namespace dx
+
+#else
+
+#include <boost/cstdint.hpp>
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/recursive_mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/thread_time.hpp>
+#include <boost/circular_buffer.hpp>
+#include <boost/lockfree/queue.hpp>
+
+#include <map>
+
+namespace dx {
+
+using boost::int32_t;
+using boost::uint32_t;
+using boost::int64_t;
+using boost::uint64_t;
+
+typedef boost::mutex                    mutex;
+typedef boost::mutex::scoped_lock       scoped_lock;
+typedef boost::recursive_mutex          recursive_mutex;
+typedef boost::recursive_mutex::scoped_lock recursive_lock;
+typedef boost::condition_variable       condition_variable;
+typedef boost::thread                   thread;
+
+using boost::function;
+using boost::atomic;
+using boost::memory_order_relaxed;
+using boost::memory_order_acquire;
+using boost::memory_order_release;
+using boost::memory_order_seq_cst;
+using boost::atomic_thread_fence;
+
+using boost::circular_buffer;
+
+typedef boost::system_time              system_time;
+
+inline system_time deadline(int ms)
+{
+    return boost::get_system_time() + boost::posix_time::milliseconds(ms);
+}
+
+inline bool expired(const system_time& time)
+{
+    return boost::get_system_time() >= time;
+}
+
+// false on timeout
+inline bool timed_wait(condition_variable& cond,scoped_lock& l,const system_time& time)
+{
+    return cond.timed_wait(l,time);
+}
+
+inline void sleep(int ms)
+{
+    boost::this_thread::sleep(boost::posix_time::milliseconds(ms));
+}
+
+inline thread::id this_thread_id()
+{
+    return boost::this_thread::get_id();
+}
+
+// per thread pointer, the owner keeps the objects, nothing gets deleted at
+// thread exit. boost::thread_specific_ptr keys by the address of the owner
+template<class T>
+class thread_specific_ptr
+{
+public:
+    explicit thread_specific_ptr(void (*)(T*)):
+        _key(nextKey())
+    {}
+
+    T* get() const
+    {
+        Map& m = map();
+        Map::iterator it = m.find(_key);
+        return it == m.end() ? NULL : static_cast<T*>(it->second);
+    }
+
+    void reset(T* p) { map()[_key] = p; }
+
+protected:
+    typedef std::map<uint64_t,void*> Map;
+
+    // keys are never reused, a new owner at the same address can't see stale pointers
+    static uint64_t nextKey()
+    {
+        static boost::atomic<uint64_t> key(0);
+        return ++key;
+    }
+
+    // the map of a thread goes with it
+    static Map& map()
+    {
+        static boost::thread_specific_ptr<Map> m;
+        if(m.get() == NULL)
+            m.reset(new Map);
+        return *m;
+    }
+
+    uint64_t _key;
+};
+
+// fixed capacity lock free queue, push fails when full and never allocates.
+// T has to be trivially copyable, at most 65534 elements
+template<class T>
+class bounded_queue : public boost::lockfree::queue<T,boost::lockfree::fixed_sized<true> >
+{
+public:
+    explicit bounded_queue(size_t capacity):
+        boost::lockfree::queue<T,boost::lockfree::fixed_sized<true> >(capacity)
+    {}
+};
+
+} // namespace dx
+
+#endif
+
+#endif  // DXCOMPAT_H
@@ -0,0 +1,145 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef DXPLANNER_H
+#define	DXPLANNER_H
+
+#include <vector>
+#include <string>
+
+#include "DxBus.h"
+
+#define  DX_PLAN_DEFAULT_BAUDRATE       (1000000)
+#define  DX_PLAN_DEFAULT_RETURN_DELAY   (500)   // us, factory setting of the servos
+
+struct DxPlanItem
+{
+    int     id;
+    int     addr;
+    int     length;
+    int     offset;                 // write data or the read block
+};
+
+struct DxPlanPacket
+{
+    int                     inst;   // DX_INST_WRITE_DATA, _SYNC_WRITE, _READ_DATA or _BULK_READ
+    std::vector<DxPlanItem> items;
+    int                     txBytes;
+    int                     rxBytes;
+    int                     replies;
+    int                     wireTime;   // us
+};
+
+// compiles the reads and writes of one control cycle into few packets:
+// adjacent registers of a servo get merged, writes with the same address
+// and length become SYNC_WRITEs and the reads go into BULK_READs if the
+// servos support it, otherwise one READ_DATA per merged block.
+// the wire time estimate assumes a status return level of 2
+class DxPlanner
+{
+public:
+    DxPlanner(int baudRate = DX_PLAN_DEFAULT_BAUDRATE,int returnDelay = DX_PLAN_DEFAULT_RETURN_DELAY);
+
+    void setBaudRate(int baudRate) { _baudRate = baudRate; }
+    int  baudRate() { return _baudRate; }
+
+    // us till a servo answers, 2 * DX_CMD_DELAYTIME
+    void setReturnDelay(int returnDelay) { _returnDelay = returnDelay; }
+    int  returnDelay() { return _returnDelay; }
+
+    // all servos on the bus understand BULK_READ (mx series)
+    void setBulkRead(bool enable) { _bulkRead = enable; }
+    bool bulkRead() { return _bulkRead; }
+
+    // the requests of the next cycle, in any order. a later write of the
+    // same register wins. read() returns the index for the results
+    void clear();
+    int  read(int id,int addr,int length);
+    void write(int id,int addr,const unsigned char* data,int length);
+    void writeByte(int id,int addr,int data);
+    void writeWord(int id,int addr,int data);
+
+    int  readCount() { return _reads.size(); }
+    int  writeCount() { return _writes.size(); }
+
+    // builds the schedule, writes go first. returns the packet count
+    int  compile();
+
+    int  packetCount() { return _packets.size(); }
+    const DxPlanPacket& packet(int i) { return _packets[i]; }
+
+    // expected us on the wire, of the schedule and of every request as its own packet
+    int  wireTime();
+    int  requestWireTime();
+
+    // one line per packet
+    std::string schedule();
+
+    // sends the schedule, false if a packet failed
+    bool execute(DxBus* bus);
+    int  errorCount() { return _errorCount; }
+
+    // results of read() after execute(), -1/NULL if it failed
+    bool readOk(int read);
+    int  readByte(int read);
+    int  readWord(int read);
+    const unsigned char* readData(int read);
+
+protected:
+
+    struct Block
+    {
+        int     id;
+        int     addr;
+        int     length;
+        int     offset;
+        bool    ok;
+    };
+
+    void compileWrites();
+    void compileReads();
+    void addPacket(DxPlanPacket& packet);
+    int  packetTime(int txBytes,int rxBytes,int replies);
+    int  readGap();
+
+    int                         _baudRate;
+    int                         _returnDelay;
+    bool                        _bulkRead;
+
+    std::vector<DxPlanItem>     _reads;         // offset = the merged block
+    std::vector<DxPlanItem>     _writes;        // offset = _writeData
+    std::vector<unsigned char>  _writeData;
+
+    std::vector<Block>          _blocks;        // merged reads
+    std::vector<unsigned char>  _readData;
+    std::vector<unsigned char>  _packetData;    // merged writes
+    std::vector<DxPlanPacket>   _packets;
+    int                         _errorCount;
+
+    // execute() scratch
+    std::vector<int>            _idList;
+    std::vector<int>            _addrList;
+    std::vector<int>            _lengthList;
+};
+
+#endif  // DXPLANNER_H
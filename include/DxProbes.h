@@ -0,0 +1,47 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef DXPROBES_H
+#define	DXPROBES_H
+
+// usdt static probes, provider "simpledynamixel", see Probes.txt
+// every probe is a single nop as long as no tracer is attached
+
+#ifdef USE_SDT_PROBES
+
+#include <sys/sdt.h>
+
+#define  DX_PROBE1(name,a1)                 DTRACE_PROBE1(simpledynamixel,name,a1)
+#define  DX_PROBE2(name,a1,a2)              DTRACE_PROBE2(simpledynamixel,name,a1,a2)
+#define  DX_PROBE3(name,a1,a2,a3)           DTRACE_PROBE3(simpledynamixel,name,a1,a2,a3)
+
+#else
+
+// the arguments are never evaluated, they only count as used
+#define  DX_PROBE1(name,a1)                 do { if(false) { (void)(a1); } } while(0)
+#define  DX_PROBE2(name,a1,a2)              do { if(false) { (void)(a1); (void)(a2); } } while(0)
+#define  DX_PROBE3(name,a1,a2,a3)           do { if(false) { (void)(a1); (void)(a2); (void)(a3); } } while(0)
+
+#endif
+
+#endif  // DXPROBES_H
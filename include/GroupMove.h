@@ -0,0 +1,87 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef GROUPMOVE_H
+#define	GROUPMOVE_H
+
+#include "DxCompat.h"
+
+#include "DxBus.h"
+
+// position and speed units of a model
+struct DxModelUnits
+{
+    int     range;          // highest position
+    double  degrees;        // angle of the position range
+    double  rpmPerUnit;     // moving speed unit
+};
+
+// false for unknown models
+bool dxModelUnits(int modelNr,DxModelUnits& units);
+
+// moves a group of servos so they all arrive after the same duration. the
+// moving speeds are computed from the freshest known positions, the last
+// reads on the bus or where the last group move put the servo, and goal
+// position plus moving speed of all servos go out in one SYNC_WRITE
+class GroupMove
+{
+public:
+    GroupMove(DxBus* bus);
+
+    DxBus* bus() { return _bus; }
+
+    // without it the model number is read from the servo once
+    void setModel(int id,int modelNr);
+    int  model(int id);
+
+    // duration in ms
+    bool move(const int* idList,int idCount,const int* goalList,int duration);
+
+    // from the last move, -1 if the servo was not in it
+    int  speed(int id);
+    int  startPosition(int id);
+
+    // reads the last move could not avoid, unknown models or positions
+    int  readCount() { return _readCount; }
+
+    // forgets the moves, after the servos were moved by other means
+    void reset();
+
+protected:
+
+    int  knownPosition(int id,dx::uint64_t now);
+
+    DxBus*          _bus;
+    int             _readCount;
+
+    int             _model[DX_BROADCAST_ID];
+
+    // the last move of each servo
+    int             _start[DX_BROADCAST_ID];
+    int             _goal[DX_BROADCAST_ID];
+    int             _speed[DX_BROADCAST_ID];
+    dx::uint64_t    _time[DX_BROADCAST_ID];
+    dx::uint64_t    _duration[DX_BROADCAST_ID];
+};
+
+#endif  // GROUPMOVE_H
@@ -0,0 +1,101 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef INDIRECTTELEMETRY_H
+#define	INDIRECTTELEMETRY_H
+
+#include <vector>
+
+#include "DxBus2.h"
+
+// telemetry fields, or'ed together
+#define  DX_TELEMETRY_POSITION      (1 << 0)
+#define  DX_TELEMETRY_VELOCITY      (1 << 1)
+#define  DX_TELEMETRY_CURRENT       (1 << 2)
+#define  DX_TELEMETRY_VOLTAGE       (1 << 3)
+#define  DX_TELEMETRY_TEMPERATURE   (1 << 4)
+#define  DX_TELEMETRY_HW_ERROR      (1 << 5)
+#define  DX_TELEMETRY_ALL           (0x3F)
+
+#define  DX_TELEMETRY_FIELD_COUNT   (6)
+
+// maps the scattered present registers of protocol 2.0 servos into the
+// indirect data window, so one sample of a servo is one short contiguous
+// read (or all servos in one SYNC_READ) instead of the whole range from
+// the hardware error to the temperature register
+class IndirectTelemetry
+{
+public:
+    // the window starts at the indirect entry firstEntry (0 based), the
+    // entries before it stay free for other mappings
+    IndirectTelemetry(DxBus2* bus,int fields = DX_TELEMETRY_ALL,int firstEntry = 0);
+
+    DxBus2* bus() { return _bus; }
+    int  fields() { return _fields; }
+
+    // bytes of one sample, with the window and with the spanning range
+    int  windowLength() { return _windowLength; }
+    int  spanLength() { return _spanLength; }
+    int  windowAddr() { return DX2_CMD_INDIRECT_DATA + _firstEntry; }
+
+    // programs the indirect address tables, false if a servo refused it
+    // or the count is negative.
+    // x series servos accept it only with the torque off (DX2_ERROR_ACCESS).
+    // the servos which failed are not in the id list
+    bool setup(const int* idList,int idCount);
+
+    int  idCount() { return _idList.size(); }
+    int  id(int index) { return _idList[index]; }
+
+    // one SYNC_READ of all servos, false if one didn't answer
+    bool update();
+    // one READ of a servo
+    bool update(int id);
+
+    // the values of the last update, valid() false if there is none
+    bool valid(int id);
+    int  position(int id);
+    int  velocity(int id);
+    int  current(int id);
+    int  voltage(int id);
+    int  temperature(int id);
+    int  hardwareError(int id);
+
+protected:
+
+    int  index(int id);
+    int  value(int id,int field);
+
+    DxBus2*                     _bus;
+    int                         _fields;
+    int                         _firstEntry;
+    int                         _windowLength;
+    int                         _spanLength;
+    int                         _offset[DX_TELEMETRY_FIELD_COUNT];    // in the window, -1 if not mapped
+
+    std::vector<int>            _idList;
+    std::vector<unsigned char>  _data;
+    bool                        _valid[DX_BROADCAST_ID];    // per index
+};
+
+#endif  // INDIRECTTELEMETRY_H
@@ -0,0 +1,109 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef MEMORYSERIAL_H
+#define	MEMORYSERIAL_H
+
+#include <vector>
+
+#include "SerialBase.h"
+#include "DxBus.h"
+
+#define  DX_CONTROL_TABLE_SIZE      (256)
+
+// in memory transport with fake servos, every written packet is answered
+// immediately from the control tables of the added servos.
+// used for benchmarks and to run the library without hardware
+class MemorySerial: public SerialBase
+{
+public:
+    MemorySerial();
+    virtual ~MemorySerial();
+
+    bool open();
+
+    // servos only hear packets at the rate of their baudrate register,
+    // until then (0) they hear everything
+    bool setBaudRate(unsigned long baudRate);
+
+    virtual void addServo(int id,int modelNr = DX_TYPE_MX_28);
+    virtual void removeServo(int id);
+    bool hasServo(int id);
+
+    // raw control table access
+    int  reg(int id,int addr);
+    void setReg(int id,int addr,int data);
+    int  regWord(int id,int addr);
+    void setRegWord(int id,int addr,int data);
+
+    // junk bytes in front of every status packet
+    void setNoise(int noise) { _noise = noise; }
+    int  noise() { return _noise; }
+
+    // fault injection, parts of the status packets which get lost or a
+    // broken checksum. id -1 sets all servos
+    void setFaultRate(int id,double dropRate,double corruptRate);
+
+    int  packetCount() { return _packetCount; }
+
+    // the bytes take the time of the line at the baudrate (10 bits each)
+    // and the servos wait their return delay before the reply. without it
+    // (default) every transaction is answered at once
+    void setWireTime(bool enable) { _wireTime = enable; }
+    bool wireTime() { return _wireTime; }
+
+protected:
+
+    virtual void send(const char* data,unsigned int len);
+
+    // called for every complete request, servos answer through reply()
+    virtual void handlePacket(int id,int inst,const unsigned char* param,int paramLength);
+    // called after the control table of a servo got written
+    virtual void written(int id,int addr,int length) {}
+    // error byte of the status packet
+    virtual int  servoError(int id) { return DX_ERROR_NO; }
+    // a servo got a new id, its control table moved already
+    virtual void idChanged(int id,int newId) {}
+    void handleServo(int id,int inst,const unsigned char* param,int paramLength);
+    bool listens(int id);
+    void reply(int id,int error,const unsigned char* param,int paramLength);
+    double random();
+    void wait(int bytes,int delay);
+
+    unsigned char*              _table[DX_BROADCAST_ID];
+    std::vector<unsigned char>  _regWrite[DX_BROADCAST_ID];
+
+    // request parser
+    unsigned char               _request[DX_MAX_PACKET_SIZE];
+    int                         _requestPos;
+
+    std::vector<unsigned char>  _reply;
+    int                         _noise;
+    unsigned int                _noiseSeed;
+    float                       _dropRate[DX_BROADCAST_ID];
+    float                       _corruptRate[DX_BROADCAST_ID];
+    int                         _packetCount;
+    bool                        _wireTime;
+};
+
+#endif  // MEMORYSERIAL_H
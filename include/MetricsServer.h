@@ -0,0 +1,75 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef METRICSSERVER_H
+#define	METRICSSERVER_H
+
+#include <vector>
+
+// boost
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "DxCompat.h"
+#include "BusMetrics.h"
+
+#define  DX_METRICS_DEFAULT_PORT    (9464)
+// a client gets this long to send its request, else it's dropped
+#define  DX_METRICS_READ_TIMEOUT    (2000)
+// larger request headers are dropped
+#define  DX_METRICS_MAX_REQUEST     (8192)
+
+// minimal http listener on localhost, answers every request with the
+// prometheus text of all added buses
+class MetricsServer
+{
+public:
+    MetricsServer();
+    ~MetricsServer();
+
+    void add(BusMetrics* metrics);
+    void remove(BusMetrics* metrics);
+
+    bool start(int port = DX_METRICS_DEFAULT_PORT);
+    void stop();
+
+    bool isRunning() { return _running; }
+    int  port() { return _port; }
+
+protected:
+
+    void run();
+    void serve(boost::asio::ip::tcp::socket& socket);
+
+    boost::asio::io_service         _io;
+    boost::asio::ip::tcp::acceptor  _acceptor;
+    boost::thread                   _thread;
+    dx::atomic<bool>                _running;
+    int                             _port;
+
+    boost::mutex                    _listMutex;
+    std::vector<BusMetrics*>        _list;
+};
+
+#endif  // METRICSSERVER_H
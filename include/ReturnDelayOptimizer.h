@@ -0,0 +1,95 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef RETURNDELAYOPTIMIZER_H
+#define	RETURNDELAYOPTIMIZER_H
+
+#include <vector>
+
+#include "DxBus.h"
+
+#define  DX_DELAY_DEFAULT_SAMPLES   (50)    // test reads per value
+#define  DX_DELAY_UNIT              (2)     // us per register unit
+
+// finds the smallest return delay each servo still answers reliably with
+// on this adapter. it tries decreasing values with a burst of reads each,
+// stops at the first one which loses replies and keeps the last good one.
+// a uniform chain gets the largest of the per servo values
+class ReturnDelayOptimizer
+{
+public:
+    ReturnDelayOptimizer(DxBus* bus);
+
+    DxBus* bus() { return _bus; }
+
+    void setSamples(int samples) { _samples = samples < 1 ? 1 : samples; }
+    int  samples() { return _samples; }
+
+    // part of the reads which may fail, 0 by default
+    void   setMaxErrorRate(double rate) { _maxErrorRate = rate; }
+    double maxErrorRate() { return _maxErrorRate; }
+
+    // values to try, largest first
+    void setCandidates(const int* valueList,int count);
+
+    // false if a servo didn't answer at its old value, it keeps that one
+    bool optimize(const int* idList,int idCount,bool uniform = false);
+
+    int    servoCount() { return _results.size(); }
+    int    id(int index);
+    int    oldDelay(int index);
+    int    newDelay(int index);
+    // mean round trip of a 2 byte read in us, before and after
+    double oldLatency(int index);
+    double newLatency(int index);
+
+    // over all servos, us per read
+    double oldLatency();
+    double newLatency();
+    double savedTime() { return oldLatency() - newLatency(); }
+    // from the register values alone, the part the adapter can't hide
+    double expectedSavedTime();
+
+protected:
+
+    struct Result
+    {
+        int     id;
+        int     oldDelay;
+        int     newDelay;
+        double  oldLatency;
+        double  newLatency;
+    };
+
+    // error rate of samples reads, mean latency of the good ones
+    double measure(int id,double& latency);
+    bool   setDelay(int id,int delay);
+
+    DxBus*              _bus;
+    int                 _samples;
+    double              _maxErrorRate;
+    std::vector<int>    _candidates;
+    std::vector<Result> _results;
+};
+
+#endif  // RETURNDELAYOPTIMIZER_H
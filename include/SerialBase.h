@@ -24,17 +24,16 @@
 #ifndef SERIALBASE_H
 #define	SERIALBASE_H
 
+#include <string>
 #include <vector>
 
-// boost
-#include <boost/thread.hpp>
-#include <boost/thread/mutex.hpp>
-#include <boost/thread/locks.hpp>
-#include <boost/circular_buffer.hpp>
+#include "DxCompat.h"
 
+// backends: DX_LITE raw termios, USE_ASIO_SERIAL_LIB asio, else the serial lib
+#if !defined(DX_LITE)
 #include "AsyncSerial.h"
-
-#ifndef USE_ASIO_SERIAL_LIB
+#endif
+#if !defined(DX_LITE) && !defined(USE_ASIO_SERIAL_LIB)
 #include <serial/serial.h>
 #endif
 
@@ -45,20 +44,29 @@ class SerialBase
 {
 public:
     SerialBase();
-    ~SerialBase();
+    virtual ~SerialBase();
 
     bool open(const char* serialPortName,unsigned long baudRate = 9600);
     void close();
 
     bool isOpen() { return _open; }
 
+    const char*   portName() { return _portName.c_str(); }
+    unsigned long baudRate() { return _baudRate; }
+
+    // reopens the port with another baudrate, false if that fails
+    virtual bool setBaudRate(unsigned long baudRate);
+
     int available();
 
     void write(unsigned char byte);
     void write(int byte);
     void write(const std::string& str);
+    void write(const unsigned char* data,int len);
 
     int read();
+    // blocking read, waits max. timeout(ms) till len bytes arrived, returns the read count
+    int read(unsigned char* data,int len,int timeout);
 
     void clear();
 
@@ -73,19 +81,32 @@ public:
 
 protected:
 
+    // writes the data to the port, called with the write lock,
+    // in memory transports replace this and answer through received()
+    virtual void send(const char* data,unsigned int len);
+    int readBuffered(unsigned char* data,int len,int timeout);
+
     bool            _open;
+    std::string     _portName;
+    unsigned long   _baudRate;
 
     unsigned char   _buffer[MAX_BUFFER_SIZE];
     unsigned char   _bufferPos;
     unsigned char   _bufferLength;
-    boost::circular_buffer<int>     _circularBuffer;
+    dx::circular_buffer<int>        _circularBuffer;
 
+#if defined(DX_LITE)
+    // no io thread, read() polls the fd
+    int                     _fd;
+#else
     CallbackAsyncSerial*    _serialPort;
-#ifndef USE_ASIO_SERIAL_LIB
+#endif
+#if !defined(DX_LITE) && !defined(USE_ASIO_SERIAL_LIB)
     serial::Serial*         _serial;
 #endif
-    boost::mutex            _readMutex;
-    boost::mutex            _writeMutex;
+    dx::mutex               _readMutex;
+    dx::mutex               _writeMutex;
+    dx::condition_variable  _readCond;
 
     bool                    _readBlock;
     int                     _readBlockCount;
@@ -0,0 +1,76 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef SERVOCAPTURE_H
+#define	SERVOCAPTURE_H
+
+#include <vector>
+
+#include "DxBus.h"
+
+// high rate step response capture
+// writes the goal positions with one sync write and reads then present
+// position/speed/load of all servos in turns as fast as the bus allows
+class ServoCapture
+{
+public:
+    ServoCapture(DxBus* bus,int maxSamples = 10000);
+    ~ServoCapture();
+
+    // false for a negative count, the old buffers stay
+    bool setMaxSamples(int maxSamples);
+    int  maxSamples() { return _maxSamples; }
+
+    // duration in ms, goalList can be NULL to capture without a step
+    bool capture(int* idList,int idCount,int* goalList,int duration);
+
+    int   sampleCount() { return _sampleCount; }
+    int   errorCount() { return _errorCount; }
+    float duration() { return _duration; }
+    float sampleRate();
+
+    // copy the results, every array needs sampleCount() entries
+    void getTime(float* time);         // ms since the step
+    void getId(int* id);
+    void getPosition(int* pos);
+    void getSpeed(int* speed);
+    void getLoad(int* load);
+
+protected:
+
+    DxBus*              _bus;
+
+    int                 _maxSamples;
+    int                 _sampleCount;
+    int                 _errorCount;
+    float               _duration;
+
+    // one entry per read
+    std::vector<float>  _time;
+    std::vector<int>    _id;
+    std::vector<int>    _pos;
+    std::vector<int>    _speed;
+    std::vector<int>    _load;
+};
+
+#endif  // SERVOCAPTURE_H
@@ -0,0 +1,114 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef SIMSERIAL_H
+#define	SIMSERIAL_H
+
+#include "MemorySerial.h"
+
+// simulated servo, in joint mode the position follows the goal with a
+// first order lag, limited by the moving speed and by the torque-speed line
+// of the motor. an external torque (in parts of the stall torque) loads
+// the servo, heats it up and can overload it.
+struct SimServoState
+{
+    SimServoState();
+
+    double  pos;            // ticks
+    double  vel;            // ticks/s
+    double  temp;           // celsius
+    double  extTorque;      // -1..1 of the stall torque, positive pushes ccw
+    double  load;           // -1..1 of the stall torque the motor applies
+    int     hwError;        // latched DX_ERROR_* bits
+    int     instError;      // error of the last instruction
+
+    // model
+    double  ticksPerRev;
+    double  noLoadRpm;
+    double  speedUnit;      // rpm per speed register unit
+    int     range;
+};
+
+// MemorySerial with simulated servos, the simulation time advances with
+// every packet. timeScale 1 is real time, > 1 runs faster than real time,
+// 0 stops the clock so the simulation only advances with step()
+class SimSerial: public MemorySerial
+{
+public:
+    SimSerial(double timeScale = 1.0);
+    virtual ~SimSerial();
+
+    void addServo(int id,int modelNr = DX_TYPE_MX_28);
+    void removeServo(int id);
+
+    void   setTimeScale(double timeScale);
+    double timeScale() { return _timeScale; }
+
+    // advances the simulation, in seconds of simulation time
+    void   step(double seconds);
+    double simTime() { return _simTime; }
+
+    void   setExternalTorque(int id,double torque);
+    double externalTorque(int id);
+
+    // supply voltage in volts
+    void   setVoltage(double voltage);
+    double voltage() { return _voltage; }
+
+    void   setAmbientTemp(double temp) { _ambientTemp = temp; }
+    double ambientTemp() { return _ambientTemp; }
+
+    // time constant of the position loop, in seconds
+    void   setTau(double tau) { _tau = tau; }
+    double tau() { return _tau; }
+
+    // state in physical units
+    double position(int id);
+    double velocity(int id);
+    double temperature(int id);
+    double load(int id);
+
+protected:
+
+    virtual void handlePacket(int id,int inst,const unsigned char* param,int paramLength);
+    virtual void written(int id,int addr,int length);
+    virtual int  servoError(int id);
+    virtual void idChanged(int id,int newId);
+
+    void update();
+    void simulate(double dt);
+    void simulate(int id,SimServoState& s,double dt);
+    void updateRegisters(int id,SimServoState& s);
+
+    SimServoState*  _sim[DX_BROADCAST_ID];
+
+    double          _timeScale;
+    double          _simTime;
+    dx::uint64_t    _lastUpdate;    // us, real time
+
+    double          _voltage;
+    double          _ambientTemp;
+    double          _tau;
+};
+
+#endif  // SIMSERIAL_H
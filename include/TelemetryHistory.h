@@ -0,0 +1,141 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef TELEMETRYHISTORY_H
+#define	TELEMETRYHISTORY_H
+
+#include <vector>
+
+#include "DxCompat.h"
+
+#include "DxBus.h"
+
+// channels
+#define  DX_HISTORY_POS                 (0)
+#define  DX_HISTORY_SPEED               (1)
+#define  DX_HISTORY_LOAD                (2)
+#define  DX_HISTORY_VOLT                (3)
+#define  DX_HISTORY_TEMP                (4)
+#define  DX_HISTORY_CHANNEL_COUNT       (5)
+
+#define  DX_HISTORY_DEFAULT_CAPACITY    (512)   // points per level
+#define  DX_HISTORY_DEFAULT_LEVELS      (4)
+#define  DX_HISTORY_DEFAULT_FACTOR      (8)     // samples of a level in one point of the next
+
+struct DxHistoryPoint
+{
+    float           min;
+    float           max;
+    float           mean;
+    dx::uint64_t    time;           // us, first sample
+    dx::uint64_t    end;            // us, last sample
+};
+
+// one channel of one servo. level 0 keeps the samples, every further level
+// keeps min/max/mean of factor points of the level below
+class DxHistoryRing
+{
+public:
+    DxHistoryRing(int capacity,int levels,int factor);
+
+    void add(dx::uint64_t time,float value);
+    void clear();
+
+    dx::uint64_t sampleCount() { return _levels[0].count; }
+
+    // see TelemetryHistory::get(), returns the count and the used level.
+    // a point counts if its last sample is in the window
+    int  get(dx::uint64_t now,dx::uint64_t window,int maxPoints,int& level,
+             float* time,float* minList,float* maxList,float* meanList);
+
+protected:
+
+    struct Level
+    {
+        std::vector<DxHistoryPoint> points;
+        dx::uint64_t                count;      // points written
+        DxHistoryPoint              partial;    // the point in the making
+        double                      sum;
+        int                         partialCount;
+    };
+
+    void commit(int level,const DxHistoryPoint& point);
+    const DxHistoryPoint& point(int level,dx::uint64_t index);
+
+    int                 _capacity;
+    int                 _factor;
+    std::vector<Level>  _levels;
+};
+
+// fixed size history of the telemetry of every servo, fed by the reads of
+// the DxBus (setHistory()). the rings of a servo are allocated with its
+// first sample, after that the memory stays the same. any time window comes
+// back with a bounded count of min/max/mean points
+class TelemetryHistory
+{
+public:
+    TelemetryHistory(int capacity = DX_HISTORY_DEFAULT_CAPACITY,
+                     int levels = DX_HISTORY_DEFAULT_LEVELS,
+                     int factor = DX_HISTORY_DEFAULT_FACTOR);
+    ~TelemetryHistory();
+
+    int  capacity() { return _capacity; }
+    int  levels() { return _levelCount; }
+    int  factor() { return _factor; }
+
+    // samples the last level reaches back
+    double span();
+
+    // time in us (dxMicros())
+    void add(int id,int channel,int value,dx::uint64_t time);
+    void add(int id,int channel,int value);
+
+    // id -1 clears all
+    void clear(int id = -1);
+
+    bool hasServo(int id);
+    double sampleCount(int id,int channel);
+
+    // the points of the last window ms, oldest first, at most maxPoints.
+    // it takes the finest level which fits. time gets the age of the
+    // points in ms, every array needs maxPoints entries. returns the count
+    int  get(int id,int channel,float window,int maxPoints,
+             float* time,float* minList,float* maxList,float* meanList);
+
+    // level of the last get()
+    int  lastLevel() { return _lastLevel; }
+
+protected:
+
+    DxHistoryRing* ring(int id,int channel,bool create);
+
+    int                 _capacity;
+    int                 _levelCount;
+    int                 _factor;
+    int                 _lastLevel;
+
+    dx::mutex           _mutex;
+    DxHistoryRing*      _rings[DX_BROADCAST_ID][DX_HISTORY_CHANNEL_COUNT];
+};
+
+#endif  // TELEMETRYHISTORY_H
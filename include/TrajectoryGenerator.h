@@ -0,0 +1,173 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef TRAJECTORYGENERATOR_H
+#define	TRAJECTORYGENERATOR_H
+
+#include <vector>
+
+#include "DxCompat.h"
+
+#include "DxBus.h"
+
+// limits in ticks, ticks/s, ticks/s^2, ticks/s^3
+#define  DX_TRAJ_DEFAULT_VELOCITY       (1000.0)
+#define  DX_TRAJ_DEFAULT_ACCELERATION   (4000.0)
+#define  DX_TRAJ_DEFAULT_JERK           (40000.0)
+
+#define  DX_TRAJ_DEFAULT_PERIOD         (10)        // ms
+#define  DX_TRAJ_DEFAULT_MIN_SPEED      (8)         // moving speed units
+
+// moving speed units per tick/s, 0.114 rpm and 4096 ticks per turn (MX),
+// 0.111 rpm and 1024 ticks per 300 degrees (AX/RX)
+#define  DX_TRAJ_SPEED_SCALE_MX         (60.0 / (0.114 * 4096.0))
+#define  DX_TRAJ_SPEED_SCALE_AX         (60.0 / (0.111 * 1024.0 * 360.0 / 300.0))
+
+// online jerk limited profile of one axis. the target can change at any
+// time, the next step() continues from the current position, velocity and
+// acceleration without a jump in any of them. every step takes the largest
+// jerk that still lets the axis stop at the target within the limits
+class DxTrajectory
+{
+public:
+    DxTrajectory(double velocity = DX_TRAJ_DEFAULT_VELOCITY,
+                 double acceleration = DX_TRAJ_DEFAULT_ACCELERATION,
+                 double jerk = DX_TRAJ_DEFAULT_JERK);
+
+    void setLimits(double velocity,double acceleration,double jerk);
+    double maxVelocity() { return _vMax; }
+    double maxAcceleration() { return _aMax; }
+    double maxJerk() { return _jMax; }
+
+    // stops at pos
+    void reset(double pos);
+
+    void setTarget(double target) { _target = target; }
+    double target() { return _target; }
+
+    // advances by dt seconds, true while it moves
+    bool step(double dt);
+
+    double position() { return _pos; }
+    double velocity() { return _vel; }
+    double acceleration() { return _acc; }
+
+    bool isDone() { return _pos == _target && _vel == 0 && _acc == 0; }
+
+protected:
+
+    // distance the braking profile travels along the direction of the
+    // target from velocity vel and acceleration acc
+    double stopDistance(double vel,double acc);
+    bool   feasible(double dist,double vel,double acc);
+
+    double  _vMax;
+    double  _aMax;
+    double  _jMax;
+
+    double  _target;
+    double  _pos;
+    double  _vel;
+    double  _acc;
+};
+
+// a DxTrajectory per servo, streamed as goal position and moving speed in
+// one SYNC_WRITE every period. the application only sets targets, at any
+// rate, the servos get a smooth profile at the bus rate
+class TrajectoryGenerator
+{
+public:
+    TrajectoryGenerator(DxBus* bus,int period = DX_TRAJ_DEFAULT_PERIOD);
+    ~TrajectoryGenerator();
+
+    DxBus* bus() { return _bus; }
+    int  period() { return _period; }
+
+    // starts at pos, at rest. speedScale converts ticks/s to moving speed units
+    bool add(int id,int pos,double speedScale = DX_TRAJ_SPEED_SCALE_MX);
+    // starts at the present position of the servo
+    bool add(int id,double speedScale = DX_TRAJ_SPEED_SCALE_MX);
+    void remove(int id);
+    bool hasServo(int id);
+
+    bool setLimits(int id,double velocity,double acceleration,double jerk);
+    bool setTarget(int id,int pos);
+
+    // moving speed sent while the goal is still ahead, a servo lagging
+    // behind the profile catches up with it
+    void setMinSpeed(int minSpeed) { _minSpeed = minSpeed; }
+    int  minSpeed() { return _minSpeed; }
+
+    // -1 if the id is unknown
+    int    target(int id);
+    double position(int id);
+    double velocity(int id);
+    bool   isDone(int id);
+    bool   isDone();
+
+    // one cycle by hand, dt in seconds. writes the moving servos, true if
+    // there was nothing to write or the write went through
+    bool step(double dt);
+
+    // streams every period ms in its own thread
+    void start();
+    void stop();
+    bool isRunning() { return _running; }
+
+    dx::uint64_t cycleCount() { return _cycleCount; }
+    dx::uint64_t errorCount() { return _errorCount; }
+    // late cycles, the step covered more than two periods
+    dx::uint64_t lateCount() { return _lateCount; }
+
+protected:
+
+    struct Axis
+    {
+        int             id;
+        double          speedScale;
+        bool            moving;
+        DxTrajectory    trajectory;
+    };
+
+    Axis* axis(int id);
+    void  run();
+
+    DxBus*                      _bus;
+    int                         _period;
+    int                         _minSpeed;
+
+    dx::mutex                   _mutex;
+    dx::condition_variable      _cond;
+    std::vector<Axis>           _axes;
+    std::vector<int>            _idList;
+    std::vector<unsigned char>  _data;
+
+    dx::atomic<bool>            _running;
+    dx::thread                  _thread;
+
+    dx::uint64_t                _cycleCount;
+    dx::uint64_t                _errorCount;
+    dx::uint64_t                _lateCount;
+};
+
+#endif  // TRAJECTORYGENERATOR_H
@@ -26,6 +26,7 @@
  */
 
 #include "AsyncSerial.h"
+#include "DxProbes.h"
 
 #include <string>
 #include <algorithm>
@@ -188,6 +189,7 @@ void AsyncSerial::doRead()
 void AsyncSerial::readEnd(const boost::system::error_code& error,
         size_t bytes_transferred)
 {
+    DX_PROBE2(serial_read_end,bytes_transferred,error.value());
     if(error)
     {
         #ifdef __APPLE__
@@ -232,6 +234,7 @@ void AsyncSerial::doWrite()
 
 void AsyncSerial::writeEnd(const boost::system::error_code& error)
 {
+    DX_PROBE2(serial_write_end,pimpl->writeBufferSize,error.value());
     if(!error)
     {
         lock_guard<mutex> l(pimpl->writeQueueMutex);
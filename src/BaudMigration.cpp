@@ -0,0 +1,168 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "BaudMigration.h"
+
+#include <algorithm>
+
+BaudMigration::BaudMigration(DxBus* bus):
+    _bus(bus),
+    _result(DX_MIGRATION_OK),
+    _settleTime(DX_MIGRATION_SETTLE),
+    _oldBaudRate(0),
+    _newBaudRate(0)
+{
+}
+
+const char* BaudMigration::resultName(int result)
+{
+    switch(result)
+    {
+    case DX_MIGRATION_OK:
+        return "ok";
+    case DX_MIGRATION_UNSUPPORTED:
+        return "unsupported";
+    case DX_MIGRATION_MISSING:
+        return "missing";
+    case DX_MIGRATION_ROLLED_BACK:
+        return "rolled back";
+    case DX_MIGRATION_FAILED:
+        return "failed";
+    default:
+        return "unknown";
+    }
+}
+
+int BaudMigration::failedId(int index)
+{
+    if(index < 0 || index >= (int)_failed.size())
+        return -1;
+    return _failed[index];
+}
+
+void BaudMigration::verify(const std::vector<int>& idList,std::vector<int>& failed)
+{
+    failed.clear();
+    for(size_t i=0;i < idList.size();i++)
+    {
+        int retry = 0;
+        while(retry < DX_MIGRATION_RETRIES && !_bus->ping(idList[i]))
+            retry++;
+        if(retry == DX_MIGRATION_RETRIES)
+            failed.push_back(idList[i]);
+    }
+}
+
+bool BaudMigration::writeBaud(const std::vector<int>& idList,int reg)
+{
+    if(idList.empty())
+        return true;
+
+    std::vector<unsigned char> data(idList.size(),(unsigned char)reg);
+    bool ret = _bus->syncWrite(DX_CMD_BAUDRATE,1,&idList[0],idList.size(),&data[0]);
+
+    // the last byte has to leave the adapter before the port closes
+    dx::sleep(_settleTime);
+    return ret;
+}
+
+bool BaudMigration::switchRate(unsigned long baudRate)
+{
+    bool ret = _bus->setBaudRate(baudRate);
+    dx::sleep(_settleTime);
+    return ret;
+}
+
+bool BaudMigration::migrate(const int* idList,int idCount,unsigned long baudRate)
+{
+    std::vector<int> ids(idList,idList + idCount);
+
+    _failed.clear();
+    _oldBaudRate = _bus->baudRate();
+    _newBaudRate = baudRate;
+
+    int newReg = dxBaudRegister(baudRate);
+    int oldReg = dxBaudRegister(_oldBaudRate);
+    if(newReg < 0 || oldReg < 0)
+    {
+        _result = DX_MIGRATION_UNSUPPORTED;
+        return false;
+    }
+    if(baudRate == _oldBaudRate)
+    {
+        _result = DX_MIGRATION_OK;
+        return true;
+    }
+
+    // everybody has to be there, otherwise someone stays behind
+    verify(ids,_failed);
+    if(!_failed.empty())
+    {
+        _result = DX_MIGRATION_MISSING;
+        return false;
+    }
+
+    writeBaud(ids,newReg);
+    if(switchRate(baudRate))
+    {
+        verify(ids,_failed);
+        if(_failed.empty())
+        {
+            _result = DX_MIGRATION_OK;
+            return true;
+        }
+    }
+    else
+        _failed = ids;
+
+    // rollback, the ones which made it go back first
+    std::vector<int> moved;
+    for(size_t i=0;i < ids.size();i++)
+    {
+        if(std::find(_failed.begin(),_failed.end(),ids[i]) == _failed.end())
+            moved.push_back(ids[i]);
+    }
+    writeBaud(moved,oldReg);
+    switchRate(_oldBaudRate);
+
+    // the missing ones could have switched without answering, one more
+    // try from the new rate for the ones which are not back
+    std::vector<int> lost;
+    verify(ids,lost);
+    if(!lost.empty() && switchRate(baudRate))
+    {
+        writeBaud(lost,oldReg);
+        switchRate(_oldBaudRate);
+        verify(ids,lost);
+    }
+
+    if(lost.empty())
+    {
+        _result = DX_MIGRATION_ROLLED_BACK;
+        return false;
+    }
+
+    _failed = lost;
+    _result = DX_MIGRATION_FAILED;
+    return false;
+}
@@ -0,0 +1,251 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "BusDiscovery.h"
+#include "BusRegistry.h"
+#include "DxTime.h"
+
+BusDiscovery::BusDiscovery():
+    _firstId(0),
+    _lastId(DX_LAST_ID),
+    _timeout(DX_DISCOVERY_TIMEOUT),
+    _returnDelay(-1),
+    _statusReturnLevel(-1),
+    _assignServoIds(false),
+    _duration(0)
+{
+}
+
+BusDiscovery::~BusDiscovery()
+{
+    releaseBuses();
+}
+
+void BusDiscovery::releaseBuses()
+{
+    for(size_t i=0;i < _ports.size();i++)
+    {
+        if(_ports[i].bus && _ports[i].registered)
+            BusRegistry::release(_ports[i].bus);
+        _ports[i].bus = NULL;
+    }
+}
+
+void BusDiscovery::detach()
+{
+    for(size_t i=0;i < _ports.size();i++)
+        _ports[i].bus = NULL;
+}
+
+int BusDiscovery::addPort(const char* portName,unsigned long baudRate)
+{
+    Port port;
+    port.name     = portName;
+    port.baudRate = baudRate;
+    port.bus        = NULL;
+    port.registered = true;
+    port.complete   = false;
+    port.duration   = 0;
+    _ports.push_back(port);
+    return _ports.size() - 1;
+}
+
+int BusDiscovery::addBus(DxBus* bus)
+{
+    Port port;
+    port.name       = bus->serial() ? bus->serial()->portName() : "";
+    port.baudRate   = bus->baudRate();
+    port.bus        = bus;
+    port.registered = false;
+    port.complete   = false;
+    port.duration   = 0;
+    _ports.push_back(port);
+    return _ports.size() - 1;
+}
+
+void BusDiscovery::setIdRange(int first,int last)
+{
+    _firstId = first < 0 ? 0 : first;
+    _lastId  = last > DX_LAST_ID ? DX_LAST_ID : last;
+}
+
+void BusDiscovery::scan(int index)
+{
+    Port&        port = _ports[index];
+    dx::uint64_t start = dxMicros();
+
+    port.servos.clear();
+    port.complete = false;
+    if(port.bus == NULL)
+        port.bus = BusRegistry::acquire(port.name.c_str(),port.baudRate);
+    if(port.bus == NULL)
+        return;
+
+    // missing ids only cost the short timeout
+    int timeout = port.bus->timeout();
+    port.bus->setTimeout(_timeout);
+
+    // a garbled reply or a failed read means a servo which could be there
+    bool complete = _firstId == 0 && _lastId == DX_LAST_ID;
+    std::vector<int> idList;
+    for(int id=_firstId;id <= _lastId;id++)
+    {
+        if(port.bus->ping(id))
+            idList.push_back(id);
+        else if(port.bus->error() != DX_ERROR_USR_NO_BEGIN)
+            complete = false;
+    }
+    port.bus->setTimeout(timeout);
+
+    // model, firmware, return delay and status return level in one read
+    unsigned char data[DX_CMD_STATUSRETURNLEVEL + 1];
+    for(size_t i=0;i < idList.size();i++)
+    {
+        DxDiscoveredServo servo;
+        servo.port     = index;
+        servo.id       = idList[i];
+        servo.verified = false;
+        if(port.bus->readData(servo.id,DX_CMD_MODELNR,sizeof(data),data))
+        {
+            servo.modelNr           = data[DX_CMD_MODELNR] + (data[DX_CMD_MODELNR + 1] << 8);
+            servo.firmware          = data[DX_CMD_FIRMWARE];
+            servo.returnDelay       = data[DX_CMD_DELAYTIME];
+            servo.statusReturnLevel = data[DX_CMD_STATUSRETURNLEVEL];
+            servo.verified = (_returnDelay < 0 || servo.returnDelay == _returnDelay) &&
+                             (_statusReturnLevel < 0 || servo.statusReturnLevel == _statusReturnLevel);
+        }
+        else
+        {
+            servo.modelNr           = -1;
+            servo.firmware          = -1;
+            servo.returnDelay       = -1;
+            servo.statusReturnLevel = -1;
+            complete = false;
+        }
+        port.servos.push_back(servo);
+    }
+
+    // the bus knows all of its servos, uniform sync writes become broadcasts
+    port.complete = complete;
+    if(_assignServoIds && complete && !idList.empty())
+        port.bus->setServoIds(&idList[0],idList.size());
+
+    port.duration = (dxMicros() - start) / 1000.0;
+}
+
+bool BusDiscovery::run()
+{
+    dx::uint64_t start = dxMicros();
+
+    // one thread per port, the first one runs here
+    std::vector<dx::thread*> threads;
+    for(size_t i=1;i < _ports.size();i++)
+        threads.push_back(new dx::thread(&BusDiscovery::scan,this,(int)i));
+    if(!_ports.empty())
+        scan(0);
+    for(size_t i=0;i < threads.size();i++)
+    {
+        threads[i]->join();
+        delete threads[i];
+    }
+
+    _servos.clear();
+    bool ret = true;
+    for(size_t i=0;i < _ports.size();i++)
+    {
+        if(_ports[i].bus == NULL)
+            ret = false;
+        _servos.insert(_servos.end(),_ports[i].servos.begin(),_ports[i].servos.end());
+    }
+
+    _duration = (dxMicros() - start) / 1000.0;
+    return ret;
+}
+
+const char* BusDiscovery::portName(int port)
+{
+    if(port < 0 || port >= (int)_ports.size())
+        return NULL;
+    return _ports[port].name.c_str();
+}
+
+bool BusDiscovery::isOpen(int port)
+{
+    return bus(port) != NULL;
+}
+
+DxBus* BusDiscovery::bus(int port)
+{
+    if(port < 0 || port >= (int)_ports.size())
+        return NULL;
+    return _ports[port].bus;
+}
+
+double BusDiscovery::portDuration(int port)
+{
+    if(port < 0 || port >= (int)_ports.size())
+        return 0;
+    return _ports[port].duration;
+}
+
+int BusDiscovery::portServoCount(int port)
+{
+    if(port < 0 || port >= (int)_ports.size())
+        return 0;
+    return _ports[port].servos.size();
+}
+
+bool BusDiscovery::portComplete(int port)
+{
+    if(port < 0 || port >= (int)_ports.size())
+        return false;
+    return _ports[port].complete;
+}
+
+const DxDiscoveredServo* BusDiscovery::servo(int index)
+{
+    if(index < 0 || index >= (int)_servos.size())
+        return NULL;
+    return &_servos[index];
+}
+
+int BusDiscovery::find(int id)
+{
+    for(size_t i=0;i < _servos.size();i++)
+    {
+        if(_servos[i].id == id)
+            return i;
+    }
+    return -1;
+}
+
+int BusDiscovery::unverifiedCount()
+{
+    int count = 0;
+    for(size_t i=0;i < _servos.size();i++)
+    {
+        if(!_servos[i].verified)
+            count++;
+    }
+    return count;
+}
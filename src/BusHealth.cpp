@@ -0,0 +1,474 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "BusHealth.h"
+#include "DxTime.h"
+
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+
+#define  DX_HEALTH_BUS_ROW          (DX_BROADCAST_ID)
+#define  DX_HEALTH_FAST_ALPHA       (1.0 / 16)
+#define  DX_HEALTH_SLOW_ALPHA       (1.0 / 256)
+#define  DX_HEALTH_MIN_SAMPLES      (64)
+#define  DX_HEALTH_SERVO_SHARE      (0.8)       // part of the line errors on one id
+
+///////////////////////////////////////////////////////////////////////////////
+// DxHealthCounters
+
+DxHealthCounters::DxHealthCounters()
+{
+    reset();
+}
+
+void DxHealthCounters::reset()
+{
+    transactions = 0;
+    retries      = 0;
+    errors       = 0;
+    lineErrors   = 0;
+    alarms       = 0;
+    memset(types,0,sizeof(types));
+}
+
+void DxHealthCounters::add(const DxHealthCounters& counters)
+{
+    transactions += counters.transactions;
+    retries      += counters.retries;
+    errors       += counters.errors;
+    lineErrors   += counters.lineErrors;
+    alarms       += counters.alarms;
+    for(int i=0;i < DX_ERRORTYPE_COUNT;i++)
+        types[i] += counters.types[i];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// LatencyAverage
+
+BusHealth::LatencyAverage::LatencyAverage():
+    fast(0),
+    slow(0),
+    count(0)
+{}
+
+void BusHealth::LatencyAverage::add(int latency)
+{
+    if(count++ == 0)
+    {
+        fast = latency;
+        slow = latency;
+        return;
+    }
+
+    fast += (latency - fast) * DX_HEALTH_FAST_ALPHA;
+    slow += (latency - slow) * DX_HEALTH_SLOW_ALPHA;
+}
+
+double BusHealth::LatencyAverage::drift()
+{
+    if(count < DX_HEALTH_MIN_SAMPLES || slow <= 0)
+        return 0;
+    return fast / slow - 1.0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// BusHealth
+
+BusHealth::BusHealth(DxBus* bus,int window):
+    _bus(bus),
+    _window(window),
+    _bucketTime(window * 1000 / DX_HEALTH_BUCKET_COUNT),
+    _buckets((DX_HEALTH_BUS_ROW + 1) * DX_HEALTH_BUCKET_COUNT),
+    _bucketStart(dxMicros()),
+    _curBucket(0),
+    _latency(DX_HEALTH_BUS_ROW + 1),
+    _alarm(DX_HEALTH_BUS_ROW + 1,-1),
+    _errorThreshold(0.01),
+    _driftThreshold(0.5)
+{
+    if(_bus)
+        _bus->setHealth(this);
+}
+
+BusHealth::~BusHealth()
+{
+    if(_bus && _bus->health() == this)
+        _bus->setHealth(NULL);
+}
+
+void BusHealth::reset()
+{
+    dx::scoped_lock l(_mutex);
+
+    for(size_t i=0;i < _buckets.size();i++)
+        _buckets[i].reset();
+    for(size_t i=0;i < _latency.size();i++)
+        _latency[i] = LatencyAverage();
+    for(size_t i=0;i < _alarm.size();i++)
+        _alarm[i] = -1;
+
+    _bucketStart = dxMicros();
+    _curBucket = 0;
+}
+
+DxHealthCounters& BusHealth::bucket(int id)
+{
+    return _buckets[id * DX_HEALTH_BUCKET_COUNT + _curBucket];
+}
+
+// drops the buckets which fell out of the window
+void BusHealth::rotate()
+{
+    dx::uint64_t now = dxMicros();
+    if(now - _bucketStart >= (dx::uint64_t)_window * 1000)
+    {
+        for(size_t i=0;i < _buckets.size();i++)
+            _buckets[i].reset();
+        _bucketStart = now;
+        return;
+    }
+
+    while(now - _bucketStart >= (dx::uint64_t)_bucketTime)
+    {
+        _curBucket = (_curBucket + 1) % DX_HEALTH_BUCKET_COUNT;
+        for(int id=0;id <= DX_HEALTH_BUS_ROW;id++)
+            bucket(id).reset();
+        _bucketStart += _bucketTime;
+    }
+}
+
+void BusHealth::addTransaction(int id,int error,int latency)
+{
+    if(id < 0 || id >= DX_BROADCAST_ID)
+        return;
+
+    dx::scoped_lock l(_mutex);
+
+    // ids which never answered are not on the bus, a scan of the
+    // free ids would look like a dead line otherwise
+    if(_alarm[id] < 0)
+    {
+        if(error & DX_ERROR_USR_LINK)
+            return;
+        _alarm[id] = 0;
+    }
+
+    rotate();
+
+    bool types[DX_ERRORTYPE_COUNT];
+    BusMetrics::errorTypes(error,types);
+
+    int  alarm = error & 0xFF;
+    bool line  = (error & DX_ERROR_USR_LINK) || (alarm == 0 && (error & DX_ERROR_USR_ID));
+
+    DxHealthCounters* rows[2] = { &bucket(id), &bucket(DX_HEALTH_BUS_ROW) };
+    for(int r=0;r < 2;r++)
+    {
+        DxHealthCounters& c = *rows[r];
+        c.transactions++;
+        if(error != DX_ERROR_NO)
+            c.errors++;
+        if(line)
+            c.lineErrors++;
+        if(alarm)
+            c.alarms++;
+        for(int i=0;i < DX_ERRORTYPE_COUNT;i++)
+        {
+            if(types[i])
+                c.types[i]++;
+        }
+    }
+
+    if(error == DX_ERROR_NO)
+    {
+        _latency[id].add(latency);
+        _latency[DX_HEALTH_BUS_ROW].add(latency);
+    }
+
+    if(line == false)
+        _alarm[id] = alarm;
+}
+
+void BusHealth::addRetry(int id)
+{
+    if(id < 0 || id >= DX_BROADCAST_ID)
+        return;
+
+    dx::scoped_lock l(_mutex);
+    rotate();
+
+    bucket(id).retries++;
+    bucket(DX_HEALTH_BUS_ROW).retries++;
+}
+
+void BusHealth::sum(int id,DxHealthCounters& counters)
+{
+    counters.reset();
+    if(id < 0 || id >= DX_BROADCAST_ID)
+        id = DX_HEALTH_BUS_ROW;
+
+    for(int i=0;i < DX_HEALTH_BUCKET_COUNT;i++)
+        counters.add(_buckets[id * DX_HEALTH_BUCKET_COUNT + i]);
+}
+
+static double rate(dx::uint32_t count,dx::uint32_t total)
+{
+    return total > 0 ? (double)count / total : 0;
+}
+
+int BusHealth::transactions(int id)
+{
+    dx::scoped_lock l(_mutex);
+    rotate();
+
+    DxHealthCounters c;
+    sum(id,c);
+    return c.transactions;
+}
+
+double BusHealth::errorRate(int id)
+{
+    dx::scoped_lock l(_mutex);
+    rotate();
+
+    DxHealthCounters c;
+    sum(id,c);
+    return rate(c.errors,c.transactions);
+}
+
+double BusHealth::lineErrorRate(int id)
+{
+    dx::scoped_lock l(_mutex);
+    rotate();
+
+    DxHealthCounters c;
+    sum(id,c);
+    return rate(c.lineErrors,c.transactions);
+}
+
+double BusHealth::retryRate(int id)
+{
+    dx::scoped_lock l(_mutex);
+    rotate();
+
+    DxHealthCounters c;
+    sum(id,c);
+    return rate(c.retries,c.transactions);
+}
+
+double BusHealth::errorTypeRate(int type,int id)
+{
+    if(type < 0 || type >= DX_ERRORTYPE_COUNT)
+        return 0;
+
+    dx::scoped_lock l(_mutex);
+    rotate();
+
+    DxHealthCounters c;
+    sum(id,c);
+    return rate(c.types[type],c.transactions);
+}
+
+int BusHealth::alarm(int id)
+{
+    if(id < 0 || id >= DX_BROADCAST_ID)
+        return -1;
+
+    dx::scoped_lock l(_mutex);
+    return _alarm[id];
+}
+
+double BusHealth::latencyDrift(int id)
+{
+    dx::scoped_lock l(_mutex);
+    return _latency[(id < 0 || id >= DX_BROADCAST_ID) ? DX_HEALTH_BUS_ROW : id].drift();
+}
+
+double BusHealth::latency(int id)
+{
+    dx::scoped_lock l(_mutex);
+    return _latency[(id < 0 || id >= DX_BROADCAST_ID) ? DX_HEALTH_BUS_ROW : id].fast;
+}
+
+int BusHealth::classify(int& causeId)
+{
+    causeId = -1;
+
+    DxHealthCounters bus;
+    sum(-1,bus);
+    if(bus.transactions == 0)
+        return DX_HEALTH_IDLE;
+
+    if(rate(bus.lineErrors,bus.transactions) >= _errorThreshold)
+    {
+        // how are the line errors spread over the ids
+        int badIds = 0;
+        dx::uint32_t maxErrors = 0;
+        for(int id=0;id < DX_BROADCAST_ID;id++)
+        {
+            DxHealthCounters c;
+            sum(id,c);
+            if(c.lineErrors == 0)
+                continue;
+
+            if(rate(c.lineErrors,c.transactions) >= _errorThreshold)
+                badIds++;
+            if(c.lineErrors > maxErrors)
+            {
+                maxErrors = c.lineErrors;
+                causeId = id;
+            }
+        }
+
+        if(badIds <= 1 || maxErrors >= DX_HEALTH_SERVO_SHARE * bus.lineErrors)
+            return DX_HEALTH_SERVO;
+
+        causeId = -1;
+        return DX_HEALTH_BUS;
+    }
+
+    if(bus.alarms > 0)
+    {
+        dx::uint32_t maxAlarms = 0;
+        for(int id=0;id < DX_BROADCAST_ID;id++)
+        {
+            DxHealthCounters c;
+            sum(id,c);
+            if(c.alarms > maxAlarms)
+            {
+                maxAlarms = c.alarms;
+                causeId = id;
+            }
+        }
+        return DX_HEALTH_SERVO_ALARM;
+    }
+
+    if(_latency[DX_HEALTH_BUS_ROW].drift() >= _driftThreshold)
+        return DX_HEALTH_LATENCY_DRIFT;
+
+    return DX_HEALTH_OK;
+}
+
+int BusHealth::cause()
+{
+    dx::scoped_lock l(_mutex);
+    rotate();
+
+    int id;
+    return classify(id);
+}
+
+int BusHealth::causeId()
+{
+    dx::scoped_lock l(_mutex);
+    rotate();
+
+    int id;
+    classify(id);
+    return id;
+}
+
+const char* BusHealth::causeName(int cause)
+{
+    switch(cause)
+    {
+    case DX_HEALTH_IDLE:
+        return "idle";
+    case DX_HEALTH_OK:
+        return "ok";
+    case DX_HEALTH_BUS:
+        return "bus";
+    case DX_HEALTH_SERVO:
+        return "servo";
+    case DX_HEALTH_SERVO_ALARM:
+        return "servo alarm";
+    case DX_HEALTH_LATENCY_DRIFT:
+        return "latency drift";
+    default:
+        return "unknown";
+    }
+}
+
+std::string BusHealth::summary()
+{
+    dx::scoped_lock l(_mutex);
+    rotate();
+
+    int id;
+    int cause = classify(id);
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    out << causeName(cause);
+    if(id >= 0)
+        out << " " << id;
+    out << ":";
+
+    if(cause == DX_HEALTH_IDLE)
+    {
+        out << " no transactions in the last " << _window / 1000.0 << "s";
+        return out.str();
+    }
+
+    DxHealthCounters c;
+    sum(cause == DX_HEALTH_SERVO || cause == DX_HEALTH_SERVO_ALARM ? id : -1,c);
+
+    out << " " << c.transactions << " transactions, errors " << 100.0 * rate(c.errors,c.transactions) << "%";
+
+    // error types of the reported row
+    bool first = true;
+    for(int i=0;i < DX_ERRORTYPE_COUNT;i++)
+    {
+        if(c.types[i] == 0)
+            continue;
+        out << (first ? " (" : ", ") << BusMetrics::errorTypeName(i) << " " << 100.0 * rate(c.types[i],c.transactions) << "%";
+        first = false;
+    }
+    if(!first)
+        out << ")";
+
+    if(cause == DX_HEALTH_BUS)
+    {
+        int badIds = 0;
+        for(int i=0;i < DX_BROADCAST_ID;i++)
+        {
+            DxHealthCounters idCounters;
+            sum(i,idCounters);
+            if(idCounters.lineErrors > 0)
+                badIds++;
+        }
+        out << " on " << badIds << " ids";
+    }
+    else if(cause == DX_HEALTH_SERVO_ALARM)
+        out << ", error bits 0x" << std::hex << _alarm[id] << std::dec;
+
+    out << ", retries " << 100.0 * rate(c.retries,c.transactions) << "%";
+
+    LatencyAverage& latency = _latency[(id >= 0) ? id : DX_HEALTH_BUS_ROW];
+    out << ", latency " << (int)latency.fast << "us";
+    if(latency.count >= DX_HEALTH_MIN_SAMPLES)
+        out << " (" << std::showpos << 100.0 * latency.drift() << std::noshowpos << "%)";
+
+    return out.str();
+}
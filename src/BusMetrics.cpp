@@ -0,0 +1,334 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "BusMetrics.h"
+#include "DxTime.h"
+
+#include <sstream>
+
+const int DxHistogram::bucketLimits[DX_METRICS_BUCKET_COUNT] =
+{ 250,500,1000,2000,5000,10000,20000,50000,100000,500000 };
+
+static std::string escapeLabel(const std::string& str)
+{
+    std::string ret;
+    for(size_t i=0;i < str.size();i++)
+    {
+        if(str[i] == '\\' || str[i] == '"')
+            ret += '\\';
+        if(str[i] == '\n')
+            ret += "\\n";
+        else
+            ret += str[i];
+    }
+    return ret;
+}
+
+static void writeHeader(std::ostream& out,const char* name,const char* type,const char* help)
+{
+    out << "# HELP " << name << " " << help << "\n";
+    out << "# TYPE " << name << " " << type << "\n";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// DxHistogram
+
+DxHistogram::DxHistogram()
+{
+    reset();
+}
+
+void DxHistogram::add(int value)
+{
+    int i=0;
+    while(i < DX_METRICS_BUCKET_COUNT && value > bucketLimits[i])
+        i++;
+
+    _buckets[i]++;
+    _sum += value;
+    _count++;
+}
+
+void DxHistogram::reset()
+{
+    for(int i=0;i <= DX_METRICS_BUCKET_COUNT;i++)
+        _buckets[i] = 0;
+    _sum = 0;
+    _count = 0;
+}
+
+void DxHistogram::write(std::ostream& out,const std::string& name,const std::string& labels)
+{
+    dx::uint64_t count = 0;
+    for(int i=0;i < DX_METRICS_BUCKET_COUNT;i++)
+    {
+        count += _buckets[i];
+        out << name << "_bucket{" << labels << ",le=\"" << bucketLimits[i] * 1e-6 << "\"} " << count << "\n";
+    }
+    count += _buckets[DX_METRICS_BUCKET_COUNT];
+    out << name << "_bucket{" << labels << ",le=\"+Inf\"} " << count << "\n";
+    out << name << "_sum{" << labels << "} " << _sum * 1e-6 << "\n";
+    out << name << "_count{" << labels << "} " << count << "\n";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// BusMetrics
+
+BusMetrics::BusMetrics(DxBus* bus,const char* name):
+    _bus(bus),
+    _name(name),
+    _cyclePeriod(0)
+{
+    reset();
+    if(_bus)
+        _bus->setMetrics(this);
+}
+
+BusMetrics::~BusMetrics()
+{
+    if(_bus && _bus->metrics() == this)
+        _bus->setMetrics(NULL);
+}
+
+int BusMetrics::errorTypes(int error,bool types[DX_ERRORTYPE_COUNT])
+{
+    types[DX_ERRORTYPE_SERVO]        = (error & 0x7F) != 0;
+    types[DX_ERRORTYPE_ID]           = (error & DX_ERROR_USR_ID) != 0;
+    types[DX_ERRORTYPE_STATUS]       = (error & DX_ERROR_USR_READSTATUS) != 0;
+    types[DX_ERRORTYPE_NO_BEGIN]     = (error & DX_ERROR_USR_NO_BEGIN) != 0;
+    types[DX_ERRORTYPE_DATA_TIMEOUT] = (error & DX_ERROR_USR_DATA_TIMEOUT) != 0;
+    types[DX_ERRORTYPE_CHECKSUM]     = (error & DX_ERROR_USR_CHECKSUM) != 0;
+
+    int count = 0;
+    for(int i=0;i < DX_ERRORTYPE_COUNT;i++)
+        count += types[i] ? 1 : 0;
+    return count;
+}
+
+const char* BusMetrics::errorTypeName(int type)
+{
+    switch(type)
+    {
+    case DX_ERRORTYPE_SERVO:
+        return "servo";
+    case DX_ERRORTYPE_ID:
+        return "id";
+    case DX_ERRORTYPE_STATUS:
+        return "status";
+    case DX_ERRORTYPE_NO_BEGIN:
+        return "no_begin";
+    case DX_ERRORTYPE_DATA_TIMEOUT:
+        return "data_timeout";
+    case DX_ERRORTYPE_CHECKSUM:
+        return "checksum";
+    default:
+        return "unknown";
+    }
+}
+
+void BusMetrics::addTransaction(int id,int error,int latency,int txBytes,int rxBytes)
+{
+    _transactions++;
+    _txBytes += txBytes;
+    _rxBytes += rxBytes;
+    _latency.add(latency);
+
+    bool types[DX_ERRORTYPE_COUNT];
+    errorTypes(error,types);
+    for(int i=0;i < DX_ERRORTYPE_COUNT;i++)
+    {
+        if(types[i])
+            _errors[i]++;
+    }
+
+    if(id >= 0 && id <= DX_BROADCAST_ID)
+    {
+        _idTransactions[id]++;
+        if(error != DX_ERROR_NO)
+            _idErrors[id]++;
+        _idLatency[id] = latency;
+    }
+}
+
+void BusMetrics::setQueueDepth(int pending,int rxBuffered)
+{
+    _pending = pending;
+    _rxBuffered = rxBuffered;
+}
+
+void BusMetrics::setCyclePeriod(int period)
+{
+    _cyclePeriod = period;
+}
+
+void BusMetrics::beginCycle()
+{
+    _cycleStart = dxMicros();
+}
+
+void BusMetrics::endCycle()
+{
+    if(_cycleStart == 0)
+        return;
+
+    int time = (int)(dxMicros() - _cycleStart);
+    _cycleLast = time;
+    _cycle.add(time);
+    if(_cyclePeriod > 0 && time > _cyclePeriod)
+        _cycleOverruns++;
+}
+
+void BusMetrics::reset()
+{
+    _transactions = 0;
+    for(int i=0;i < DX_ERRORTYPE_COUNT;i++)
+        _errors[i] = 0;
+    _txBytes = 0;
+    _rxBytes = 0;
+    _latency.reset();
+
+    _pending = 0;
+    _rxBuffered = 0;
+
+    _cycleStart = 0;
+    _cycleLast = 0;
+    _cycleOverruns = 0;
+    _cycle.reset();
+
+    for(int i=0;i <= DX_BROADCAST_ID;i++)
+    {
+        _idTransactions[i] = 0;
+        _idErrors[i] = 0;
+        _idLatency[i] = 0;
+    }
+}
+
+std::string BusMetrics::labels()
+{
+    return "bus=\"" + escapeLabel(_name) + "\"";
+}
+
+void BusMetrics::write(std::ostream& out)
+{
+    std::vector<BusMetrics*> list(1,this);
+    write(out,list);
+}
+
+// prometheus wants all samples of a metric in one group, so loop per metric over the buses
+void BusMetrics::write(std::ostream& out,const std::vector<BusMetrics*>& list)
+{
+    size_t i;
+
+    writeHeader(out,"dx_transactions_total","counter","Bus transactions.");
+    for(i=0;i < list.size();i++)
+        out << "dx_transactions_total{" << list[i]->labels() << "} " << list[i]->_transactions << "\n";
+
+    writeHeader(out,"dx_errors_total","counter","Failed transactions by error type.");
+    for(i=0;i < list.size();i++)
+    {
+        for(int type=0;type < DX_ERRORTYPE_COUNT;type++)
+            out << "dx_errors_total{" << list[i]->labels() << ",type=\"" << errorTypeName(type) << "\"} " << list[i]->_errors[type] << "\n";
+    }
+
+    writeHeader(out,"dx_tx_bytes_total","counter","Bytes written to the bus.");
+    for(i=0;i < list.size();i++)
+        out << "dx_tx_bytes_total{" << list[i]->labels() << "} " << list[i]->_txBytes << "\n";
+
+    writeHeader(out,"dx_rx_bytes_total","counter","Bytes read from the bus.");
+    for(i=0;i < list.size();i++)
+        out << "dx_rx_bytes_total{" << list[i]->labels() << "} " << list[i]->_rxBytes << "\n";
+
+    writeHeader(out,"dx_transaction_seconds","histogram","Transaction latency.");
+    for(i=0;i < list.size();i++)
+        list[i]->_latency.write(out,"dx_transaction_seconds",list[i]->labels());
+
+    writeHeader(out,"dx_pending_transactions","gauge","Threads waiting for the bus.");
+    for(i=0;i < list.size();i++)
+        out << "dx_pending_transactions{" << list[i]->labels() << "} " << list[i]->_pending << "\n";
+
+    writeHeader(out,"dx_rx_buffered_bytes","gauge","Unread bytes in the receive buffer.");
+    for(i=0;i < list.size();i++)
+        out << "dx_rx_buffered_bytes{" << list[i]->labels() << "} " << list[i]->_rxBuffered << "\n";
+
+    writeHeader(out,"dx_cycle_seconds","histogram","Control cycle time.");
+    for(i=0;i < list.size();i++)
+        list[i]->_cycle.write(out,"dx_cycle_seconds",list[i]->labels());
+
+    writeHeader(out,"dx_cycle_last_seconds","gauge","Last control cycle time.");
+    for(i=0;i < list.size();i++)
+        out << "dx_cycle_last_seconds{" << list[i]->labels() << "} " << list[i]->_cycleLast * 1e-6 << "\n";
+
+    writeHeader(out,"dx_cycle_overruns_total","counter","Control cycles longer than the cycle period.");
+    for(i=0;i < list.size();i++)
+        out << "dx_cycle_overruns_total{" << list[i]->labels() << "} " << list[i]->_cycleOverruns << "\n";
+
+    // servos
+    std::ostringstream transactions;
+    std::ostringstream errors;
+    std::ostringstream latency;
+    std::ostringstream telemetry;
+
+    for(i=0;i < list.size();i++)
+    {
+        BusMetrics* metrics = list[i];
+        DxBus*      bus = metrics->_bus;
+
+        for(int id=0;id <= DX_BROADCAST_ID;id++)
+        {
+            if(metrics->_idTransactions[id] == 0)
+                continue;
+
+            std::ostringstream labels;
+            labels << metrics->labels() << ",id=\"" << id << "\"";
+
+            transactions << "dx_servo_transactions_total{" << labels.str() << "} " << metrics->_idTransactions[id] << "\n";
+            errors << "dx_servo_errors_total{" << labels.str() << "} " << metrics->_idErrors[id] << "\n";
+            latency << "dx_servo_last_transaction_seconds{" << labels.str() << "} " << metrics->_idLatency[id] * 1e-6 << "\n";
+
+            if(bus == NULL || id == DX_BROADCAST_ID || bus->lastUpdate(id) == 0)
+                continue;
+
+            telemetry << "dx_servo_telemetry{" << labels.str() << ",register=\"position\"} " << bus->lastPosition(id) << "\n";
+            telemetry << "dx_servo_telemetry{" << labels.str() << ",register=\"speed\"} " << bus->lastSpeed(id) << "\n";
+            telemetry << "dx_servo_telemetry{" << labels.str() << ",register=\"load\"} " << bus->lastLoad(id) << "\n";
+            telemetry << "dx_servo_telemetry{" << labels.str() << ",register=\"voltage\"} " << bus->lastVolt(id) << "\n";
+            telemetry << "dx_servo_telemetry{" << labels.str() << ",register=\"temperature\"} " << bus->lastTemp(id) << "\n";
+        }
+    }
+
+    writeHeader(out,"dx_servo_transactions_total","counter","Transactions per servo id.");
+    out << transactions.str();
+    writeHeader(out,"dx_servo_errors_total","counter","Failed transactions per servo id.");
+    out << errors.str();
+    writeHeader(out,"dx_servo_last_transaction_seconds","gauge","Latency of the last transaction per servo id.");
+    out << latency.str();
+    writeHeader(out,"dx_servo_telemetry","gauge","Last read raw register values, -1 if never read.");
+    out << telemetry.str();
+}
+
+std::string BusMetrics::text()
+{
+    std::ostringstream out;
+    write(out);
+    return out.str();
+}
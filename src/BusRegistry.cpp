@@ -0,0 +1,146 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "BusRegistry.h"
+
+#include <iostream>
+#include <cstdlib>
+
+dx::mutex               BusRegistry::_mutex;
+dx::condition_variable  BusRegistry::_opened;
+BusRegistry::EntryMap   BusRegistry::_entries;
+std::set<std::string>   BusRegistry::_opening;
+
+std::string BusRegistry::canonicalName(const char* portName)
+{
+#if defined(_WIN32)
+    return portName;
+#else
+    char* path = realpath(portName,NULL);
+    if(path == NULL)
+        return portName;
+
+    std::string name = path;
+    free(path);
+    return name;
+#endif
+}
+
+DxBus* BusRegistry::acquire(const char* portNameArg,unsigned long baudRate,int* result)
+{
+    std::string portName = canonicalName(portNameArg);
+    if(result)
+        *result = DX_REGISTRY_OK;
+
+    dx::scoped_lock l(_mutex);
+
+    while(_opening.count(portName))
+        _opened.wait(l);
+
+    EntryMap::iterator it = _entries.find(portName);
+    if(it != _entries.end())
+    {
+        // a BaudMigration may have moved the port since
+        if(it->second.serial->baudRate() != baudRate)
+        {
+            std::cout << "BusRegistry Error: " << portName << " is already open with baudrate " << it->second.serial->baudRate() << std::endl;
+            if(result)
+                *result = DX_REGISTRY_BAUDRATE;
+            return NULL;
+        }
+
+        it->second.refCount++;
+        return it->second.bus;
+    }
+
+    // the open takes a while, the other ports don't wait for it
+    _opening.insert(portName);
+    l.unlock();
+
+    SerialBase* serial = new SerialBase();
+    bool        ret = serial->open(portName.c_str(),baudRate);
+
+    l.lock();
+    _opening.erase(portName);
+    _opened.notify_all();
+
+    if(ret == false)
+    {
+        delete serial;
+        if(result)
+            *result = DX_REGISTRY_OPEN_FAILED;
+        return NULL;
+    }
+
+    Entry entry;
+    entry.serial   = serial;
+    entry.bus      = new DxBus(serial);
+    entry.refCount = 1;
+    _entries[portName] = entry;
+
+    return entry.bus;
+}
+
+bool BusRegistry::release(DxBus* bus)
+{
+    dx::scoped_lock l(_mutex);
+
+    for(EntryMap::iterator it = _entries.begin();it != _entries.end();++it)
+    {
+        if(it->second.bus != bus)
+            continue;
+
+        if(--it->second.refCount == 0)
+        {
+            delete it->second.bus;
+            it->second.serial->close();
+            delete it->second.serial;
+            _entries.erase(it);
+        }
+        return true;
+    }
+
+    return false;
+}
+
+DxBus* BusRegistry::find(const char* portName)
+{
+    dx::scoped_lock l(_mutex);
+
+    EntryMap::iterator it = _entries.find(canonicalName(portName));
+    return it != _entries.end() ? it->second.bus : NULL;
+}
+
+int BusRegistry::refCount(const char* portName)
+{
+    dx::scoped_lock l(_mutex);
+
+    EntryMap::iterator it = _entries.find(canonicalName(portName));
+    return it != _entries.end() ? it->second.refCount : 0;
+}
+
+int BusRegistry::count()
+{
+    dx::scoped_lock l(_mutex);
+    return _entries.size();
+}
@@ -0,0 +1,235 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "BusTracer.h"
+#include "DxTime.h"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+// the tracer owns the buffers, they stay after the thread ended
+static void keepBuffer(DxTraceBuffer*)
+{}
+
+static bool compareTime(const DxTraceEvent& a,const DxTraceEvent& b)
+{
+    return a.time < b.time;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// DxTraceBuffer
+
+DxTraceBuffer::DxTraceBuffer(int tid,int capacity):
+    _tid(tid),
+    _events(capacity),
+    _head(0),
+    _first(0)
+{}
+
+void DxTraceBuffer::snapshot(std::vector<DxTraceEvent>& events)
+{
+    dx::uint64_t size  = _events.size();
+    dx::uint64_t first = _first.load(dx::memory_order_acquire);
+    dx::uint64_t head  = _head.load(dx::memory_order_acquire);
+    dx::uint64_t start = std::max(first,head > size ? head - size : 0);
+    if(start >= head)
+        return;
+
+    std::vector<DxTraceEvent> copy;
+    copy.reserve(head - start);
+    for(dx::uint64_t i=start;i < head;i++)
+        copy.push_back(_events[i % size]);
+
+    // the writer could have overwritten the oldest ones meanwhile, the one
+    // at headAfter - size included, it is the slot of the event in progress
+    dx::uint64_t headAfter = _head.load(dx::memory_order_acquire);
+    dx::uint64_t valid = headAfter >= size ? headAfter - size + 1 : 0;
+    for(dx::uint64_t i=start;i < head;i++)
+    {
+        if(i >= valid)
+            events.push_back(copy[i - start]);
+    }
+}
+
+// only the writer moves the head, clear() hides what is there so far
+void DxTraceBuffer::clear()
+{
+    _first.store(_head.load(dx::memory_order_acquire),dx::memory_order_release);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// BusTracer
+
+BusTracer::BusTracer(int capacity):
+    _enabled(false),
+    _capacity(capacity),
+    _threadBuffer(&keepBuffer)
+{}
+
+BusTracer::~BusTracer()
+{
+    _enabled = false;
+
+    dx::scoped_lock l(_bufferMutex);
+    for(size_t i=0;i < _bufferList.size();i++)
+        delete _bufferList[i];
+    _bufferList.clear();
+}
+
+DxTraceBuffer* BusTracer::buffer()
+{
+    DxTraceBuffer* buffer = _threadBuffer.get();
+    if(buffer == NULL)
+    {
+        // first event of this thread
+        dx::scoped_lock l(_bufferMutex);
+        buffer = new DxTraceBuffer(_bufferList.size() + 1,_capacity);
+        _bufferList.push_back(buffer);
+        _threadBuffer.reset(buffer);
+    }
+    return buffer;
+}
+
+void BusTracer::add(char phase,const char* name,dx::uint64_t time,dx::uint64_t duration,
+                    const char* arg0,int value0,const char* arg1,int value1,const char* arg2,int value2)
+{
+    DxTraceBuffer* b = buffer();
+    DxTraceEvent&  event = b->next();
+
+    event.phase = phase;
+    strncpy(event.name,name,DX_TRACE_NAME_SIZE - 1);
+    event.name[DX_TRACE_NAME_SIZE - 1] = 0;
+    event.time = time;
+    event.duration = duration;
+    event.argName[0] = arg0;
+    event.argValue[0] = value0;
+    event.argName[1] = arg1;
+    event.argValue[1] = value1;
+    event.argName[2] = arg2;
+    event.argValue[2] = value2;
+
+    b->commit();
+}
+
+void BusTracer::begin(const char* name,const char* arg0,int value0,const char* arg1,int value1)
+{
+    if(_enabled)
+        add('B',name,dxMicros(),0,arg0,value0,arg1,value1,NULL,0);
+}
+
+void BusTracer::end(const char* name,const char* arg0,int value0,const char* arg1,int value1,const char* arg2,int value2)
+{
+    if(_enabled)
+        add('E',name,dxMicros(),0,arg0,value0,arg1,value1,arg2,value2);
+}
+
+void BusTracer::complete(const char* name,dx::uint64_t startTime,dx::uint64_t duration,const char* arg0,int value0)
+{
+    if(_enabled)
+        add('X',name,startTime,duration,arg0,value0,NULL,0,NULL,0);
+}
+
+void BusTracer::instant(const char* name,const char* arg0,int value0,const char* arg1,int value1)
+{
+    if(_enabled)
+        add('i',name,dxMicros(),0,arg0,value0,arg1,value1,NULL,0);
+}
+
+void BusTracer::counter(const char* name,const char* arg0,int value0,const char* arg1,int value1)
+{
+    if(_enabled)
+        add('C',name,dxMicros(),0,arg0,value0,arg1,value1,NULL,0);
+}
+
+void BusTracer::clear()
+{
+    dx::scoped_lock l(_bufferMutex);
+    for(size_t i=0;i < _bufferList.size();i++)
+        _bufferList[i]->clear();
+}
+
+void BusTracer::write(std::ostream& out)
+{
+    dx::scoped_lock l(_bufferMutex);
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool first = true;
+    for(size_t i=0;i < _bufferList.size();i++)
+    {
+        int tid = _bufferList[i]->tid();
+
+        // thread name
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+            << ",\"args\":{\"name\":\"dx thread " << tid << "\"}}";
+        first = false;
+
+        std::vector<DxTraceEvent> events;
+        _bufferList[i]->snapshot(events);
+        std::stable_sort(events.begin(),events.end(),compareTime);
+
+        for(size_t j=0;j < events.size();j++)
+        {
+            const DxTraceEvent& event = events[j];
+
+            out << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"dx\",\"ph\":\"" << event.phase
+                << "\",\"ts\":" << event.time << ",\"pid\":1,\"tid\":" << tid;
+            if(event.phase == 'X')
+                out << ",\"dur\":" << event.duration;
+            if(event.phase == 'i')
+                out << ",\"s\":\"t\"";
+
+            out << ",\"args\":{";
+            bool firstArg = true;
+            for(int k=0;k < DX_TRACE_ARG_COUNT;k++)
+            {
+                if(event.argName[k] == NULL)
+                    continue;
+                out << (firstArg ? "" : ",") << "\"" << event.argName[k] << "\":" << event.argValue[k];
+                firstArg = false;
+            }
+            out << "}}";
+        }
+    }
+
+    out << "\n]}\n";
+}
+
+std::string BusTracer::json()
+{
+    std::ostringstream out;
+    write(out);
+    return out.str();
+}
+
+bool BusTracer::exportJson(const char* path)
+{
+    std::ofstream file(path);
+    if(!file.is_open())
+        return false;
+
+    write(file);
+    return file.good();
+}
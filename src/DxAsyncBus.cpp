@@ -0,0 +1,340 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "DxAsyncBus.h"
+
+#include <cstring>
+#include <climits>
+
+DxAsyncBus::DxAsyncBus(DxBus* bus,int capacity):
+    _bus(bus),
+    _capacity(capacity > 0 ? capacity : 1),
+    _requests(new Request[_capacity]),
+    _free(_capacity),
+    _pending(_capacity),
+    _running(true),
+    _queued(0),
+    _used(0),
+    _rejected(0),
+    _sleeping(false)
+{
+    for(int i=0;i < _capacity;i++)
+    {
+        _requests[i].tag        = tag(0,STATE_FREE);
+        _requests[i].generation = 0;
+        _free.push(i);
+    }
+
+    dx::thread t(&DxAsyncBus::run,this);
+    _thread.swap(t);
+}
+
+DxAsyncBus::~DxAsyncBus()
+{
+    stop();
+    delete[] _requests;
+}
+
+void DxAsyncBus::stop()
+{
+    {
+        dx::scoped_lock l(_wakeMutex);
+        if(!_running.exchange(false))
+            return;
+    }
+    _wakeCond.notify_all();
+    _thread.join();
+
+    // the io thread is gone, cancel whatever is left
+    cancelPending();
+}
+
+// after stop(), whoever pops a request from the queue frees it
+void DxAsyncBus::cancelPending()
+{
+    int index;
+    while(_pending.pop(index))
+    {
+        Request* request = &_requests[index];
+        dx::uint64_t queued = request->tag.load(dx::memory_order_acquire);
+        if((queued & 3) == STATE_QUEUED &&
+           request->tag.compare_exchange_strong(queued,tag(queued >> 2,STATE_RUNNING)))
+        {
+            _queued--;
+            request->result.error = DX_ERROR_USR_CANCELED;
+            complete(request);
+            continue;
+        }
+
+        // canceled, cancel() copies the request before it marks it free
+        while((request->tag.load(dx::memory_order_acquire) & 3) == STATE_CANCELING)
+            ;
+        release(request);
+    }
+}
+
+DxAsyncBus::Request* DxAsyncBus::acquire(Op op,int id,int addr,int length,DxCompletion completion,void* context,int timeout)
+{
+    int index;
+    if(!_running || !_free.pop(index))
+        return NULL;
+    _used++;
+
+    Request* request = &_requests[index];
+    request->op          = op;
+    request->length      = length;
+    request->regWrite    = false;
+    request->idCount     = 0;
+    request->completion  = completion;
+    request->context     = context;
+
+    request->hasDeadline = timeout > 0;
+    if(request->hasDeadline)
+        request->deadline = dx::deadline(timeout);
+
+    request->result.handle = 0;
+    request->result.id     = id;
+    request->result.addr   = addr;
+    request->result.ok     = false;
+    request->result.error  = DX_ERROR_NO;
+    request->result.length = 0;
+
+    return request;
+}
+
+void DxAsyncBus::release(Request* request)
+{
+    request->tag.store(tag(0,STATE_FREE),dx::memory_order_release);
+    _used--;
+    _free.push((int)(request - _requests));
+}
+
+int DxAsyncBus::submit(Request* request)
+{
+    if(request == NULL)
+    {
+        if(!_running)
+            return DX_ASYNC_STOPPED;
+        _rejected++;
+        return DX_ASYNC_BUSY;
+    }
+
+    // the handle tells the generation of the request, a stale handle can't cancel a reused one
+    int index = (int)(request - _requests);
+    if(++request->generation > (INT_MAX - _capacity) / _capacity)
+        request->generation = 0;
+    int handle = request->generation * _capacity + index + 1;
+    request->result.handle = handle;
+
+    // the io thread can complete the request as soon as it is queued
+    _queued++;
+    request->tag.store(tag(handle,STATE_QUEUED),dx::memory_order_release);
+    _pending.push(index);   // never full, it has room for the whole pool
+
+    dx::atomic_thread_fence(dx::memory_order_seq_cst);
+    if(_sleeping.load())
+    {
+        dx::scoped_lock l(_wakeMutex);
+        _wakeCond.notify_one();
+    }
+
+    // stopped meanwhile, stop() could have missed it
+    if(!_running)
+    {
+        dx::uint64_t queued = tag(handle,STATE_QUEUED);
+        if(request->tag.compare_exchange_strong(queued,tag(handle,STATE_CANCELING)))
+        {
+            _queued--;
+            request->tag.store(tag(handle,STATE_FREE),dx::memory_order_release);
+            // stop() could have emptied the queue already, nobody else frees it then
+            cancelPending();
+            return DX_ASYNC_STOPPED;
+        }
+    }
+    return handle;
+}
+
+int DxAsyncBus::ping(int id,DxCompletion completion,void* context,int timeout)
+{
+    return submit(acquire(OP_PING,id,0,0,completion,context,timeout));
+}
+
+int DxAsyncBus::read(int id,int addr,int length,DxCompletion completion,void* context,int timeout)
+{
+    if(length < 0 || length > DX_MAX_PARAM_LENGTH)
+        length = 0;
+    return submit(acquire(OP_READ,id,addr,length,completion,context,timeout));
+}
+
+int DxAsyncBus::write(int id,int addr,const unsigned char* data,int length,DxCompletion completion,void* context,int timeout,bool regWrite)
+{
+    if(length < 0 || length > DX_MAX_PARAM_LENGTH - 1)
+        length = 0;
+
+    Request* request = acquire(OP_WRITE,id,addr,length,completion,context,timeout);
+    if(request)
+    {
+        request->regWrite = regWrite;
+        memcpy(request->result.data,data,length);
+    }
+    return submit(request);
+}
+
+int DxAsyncBus::syncWrite(int addr,int length,const int* idList,int idCount,const unsigned char* dataList,DxCompletion completion,void* context,int timeout)
+{
+    // DxBus::syncWrite splits what doesn't fit into one packet
+    int dataLength = length * idCount;
+    bool refused = length <= 0 || idCount < 0 || idCount > DX_BROADCAST_ID || dataLength > DX_ASYNC_SYNC_DATA;
+
+    Request* request = acquire(OP_SYNC_WRITE,DX_BROADCAST_ID,addr,length,completion,context,timeout);
+    if(request)
+    {
+        if(refused)
+            request->idCount = -1;
+        else
+        {
+            request->idCount = idCount;
+            for(int i=0;i < idCount;i++)
+                request->idList[i] = idList[i];
+            memcpy(request->syncData,dataList,dataLength);
+        }
+    }
+    return submit(request);
+}
+
+bool DxAsyncBus::cancel(int handle)
+{
+    if(handle <= 0)
+        return false;
+
+    Request* request = &_requests[(handle - 1) % _capacity];
+    dx::uint64_t queued = tag(handle,STATE_QUEUED);
+    if(!request->tag.compare_exchange_strong(queued,tag(handle,STATE_CANCELING)))
+        return false;
+    _queued--;
+
+    // the io thread frees the request once it is out of the queue, it waits
+    // for the copy
+    DxResult     result       = request->result;
+    DxCompletion completion   = request->completion;
+    void*        context      = request->context;
+    request->tag.store(tag(handle,STATE_FREE),dx::memory_order_release);
+
+    result.error = DX_ERROR_USR_CANCELED;
+    if(completion)
+        completion(context,result);
+    return true;
+}
+
+// frees the request before the completion runs, which can queue the next one right away
+void DxAsyncBus::complete(Request* request)
+{
+    DxResult     result     = request->result;
+    DxCompletion completion = request->completion;
+    void*        context    = request->context;
+    release(request);
+
+    if(completion)
+        completion(context,result);
+}
+
+void DxAsyncBus::execute(Request* request)
+{
+    DxResult& result = request->result;
+    int       id     = result.id;
+    int       addr   = result.addr;
+
+    switch(request->op)
+    {
+    case OP_PING:
+        result.ok = _bus->ping(id);
+        break;
+    case OP_READ:
+        result.ok = _bus->readData(id,addr,request->length,result.data);
+        if(result.ok)
+            result.length = request->length;
+        break;
+    case OP_WRITE:
+        result.ok = _bus->writeData(id,addr,result.data,request->length,request->regWrite);
+        break;
+    case OP_SYNC_WRITE:
+        if(request->idCount < 0)
+        {
+            result.ok    = false;
+            result.error = DX_ERROR_RANGE;
+            return;
+        }
+        {
+            int idList[DX_BROADCAST_ID];
+            for(int i=0;i < request->idCount;i++)
+                idList[i] = request->idList[i];
+            result.ok = _bus->syncWrite(addr,request->length,idList,request->idCount,request->syncData);
+        }
+        break;
+    }
+    result.error = _bus->error();
+}
+
+// sleeps till submit() queues something or stop()
+void DxAsyncBus::wait()
+{
+    dx::scoped_lock l(_wakeMutex);
+    _sleeping = true;
+    dx::atomic_thread_fence(dx::memory_order_seq_cst);
+    // empty() is only a hint, the timeout covers a missed wake up
+    if(_running && _pending.empty())
+        dx::timed_wait(_wakeCond,l,dx::deadline(100));
+    _sleeping = false;
+}
+
+void DxAsyncBus::run()
+{
+    while(_running)
+    {
+        int index;
+        if(!_pending.pop(index))
+        {
+            wait();
+            continue;
+        }
+
+        Request* request = &_requests[index];
+        dx::uint64_t queued = request->tag.load(dx::memory_order_acquire);
+        if((queued & 3) != STATE_QUEUED ||
+           !request->tag.compare_exchange_strong(queued,tag(queued >> 2,STATE_RUNNING)))
+        {
+            // canceled, cancel() copies the request before it marks it free
+            while((request->tag.load(dx::memory_order_acquire) & 3) == STATE_CANCELING)
+                ;
+            release(request);
+            continue;
+        }
+        _queued--;
+
+        if(request->hasDeadline && dx::expired(request->deadline))
+            request->result.error = DX_ERROR_USR_EXPIRED;
+        else
+            execute(request);
+        complete(request);
+    }
+}
@@ -0,0 +1,843 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "DxBus.h"
+#include "BusMetrics.h"
+#include "BusTracer.h"
+#include "BusHealth.h"
+#include "TelemetryHistory.h"
+#include "DxTime.h"
+#include "DxProbes.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// locks the bus for one transaction
+class DxTransactionLock
+{
+public:
+    DxTransactionLock(DxBus& bus):
+        _bus(bus)
+    {
+        _bus.lock();
+    }
+
+    ~DxTransactionLock()
+    {
+        _bus.unlock();
+    }
+
+protected:
+    DxBus&  _bus;
+};
+
+// 2000000 / (reg + 1), the MX series has a few faster rates on top
+unsigned long dxBaudRate(int reg)
+{
+    switch(reg)
+    {
+    case 250:
+        return 2250000;
+    case 251:
+        return 2500000;
+    case 252:
+        return 3000000;
+    default:
+        return reg >= 0 && reg < 250 ? 2000000 / (reg + 1) : 0;
+    }
+}
+
+int dxBaudRegister(unsigned long baudRate)
+{
+    if(baudRate == 0)
+        return -1;
+
+    static const int fast[] = { 250,251,252 };
+    for(int i=0;i < 3;i++)
+    {
+        if(dxBaudRate(fast[i]) == baudRate)
+            return fast[i];
+    }
+
+    int    reg = (int)(2000000.0 / baudRate - 1.0 + .5);
+    double rate = dxBaudRate(reg);
+    if(reg < 0 || reg >= 250 || std::fabs(rate - baudRate) > baudRate * .03)
+        return -1;
+    return reg;
+}
+
+DxServoState::DxServoState():
+    pos(-1),
+    speed(-1),
+    load(-1),
+    volt(-1),
+    temp(-1),
+    time(0)
+{}
+
+DxBus::DxBus(SerialBase* serial):
+    _serial(serial),
+    _metrics(NULL),
+    _tracer(NULL),
+    _health(NULL),
+    _history(NULL),
+    _pending(0),
+    _lockWaitTime(0),
+    _lockCount(0),
+    _timeout(DX_DEFAULT_TIMEOUT),
+    _retries(0),
+    _statusReturnLevel(2),
+    _syncSplitAction(false),
+    _error(DX_ERROR_NO),
+    _startTime(0),
+    _txBytes(0),
+    _rxBytes(0),
+    _servoIdCount(0)
+{
+    memset(_servoId,0,sizeof(_servoId));
+}
+
+DxBus::~DxBus()
+{}
+
+int DxBus::error()
+{
+    dx::scoped_lock l(_errorMutex);
+    std::map<dx::thread::id,int>::iterator it = _threadErrors.find(dx::this_thread_id());
+    return it != _threadErrors.end() ? it->second : DX_ERROR_NO;
+}
+
+// called with the bus lock at the end of every transaction. keyed by the
+// thread id, a thread which ends leaves one entry its successor reuses
+void DxBus::saveError()
+{
+    dx::scoped_lock l(_errorMutex);
+    _threadErrors[dx::this_thread_id()] = _error;
+}
+
+// counts the threads in or waiting for a transaction and traces the wait
+void DxBus::lock()
+{
+    ++_pending;
+
+    dx::uint64_t waitStart = dxMicros();
+    _busMutex.lock();
+    dx::uint64_t wait = dxMicros() - waitStart;
+
+    _lockWaitTime += wait;
+    ++_lockCount;
+    if(_tracer)
+        _tracer->complete("bus wait",waitStart,wait,"pending",_pending);
+}
+
+void DxBus::unlock()
+{
+    saveError();
+    _busMutex.unlock();
+    --_pending;
+}
+
+void DxBus::setTimeout(int timeout)
+{
+    dx::recursive_lock l(_busMutex);
+    _timeout = timeout;
+}
+
+int DxBus::timeout()
+{
+    return _timeout;
+}
+
+void DxBus::setMetrics(BusMetrics* metrics)
+{
+    dx::recursive_lock l(_busMutex);
+    _metrics = metrics;
+}
+
+void DxBus::setTracer(BusTracer* tracer)
+{
+    dx::recursive_lock l(_busMutex);
+    _tracer = tracer;
+}
+
+void DxBus::setHealth(BusHealth* health)
+{
+    dx::recursive_lock l(_busMutex);
+    _health = health;
+}
+
+void DxBus::setHistory(TelemetryHistory* history)
+{
+    dx::recursive_lock l(_busMutex);
+    _history = history;
+}
+
+bool DxBus::setBaudRate(unsigned long baudRate)
+{
+    DxTransactionLock lock(*this);
+    return _serial->setBaudRate(baudRate);
+}
+
+unsigned long DxBus::baudRate()
+{
+    return _serial->baudRate();
+}
+
+void DxBus::setServoIds(const int* idList,int idCount)
+{
+    DxTransactionLock lock(*this);
+
+    memset(_servoId,0,sizeof(_servoId));
+    _servoIdCount = 0;
+    for(int i=0;i < idCount;i++)
+    {
+        int id = idList[i];
+        if(id >= 0 && id < DX_BROADCAST_ID && !_servoId[id])
+        {
+            _servoId[id] = true;
+            _servoIdCount++;
+        }
+    }
+}
+
+void DxBus::resetLockWait()
+{
+    _lockWaitTime = 0;
+    _lockCount = 0;
+}
+
+int DxBus::calcChecksum(int checksumVal)
+{
+    return(0xFF & ~checksumVal);
+}
+
+int DxBus::calcChecksum(const unsigned char* data,int length)
+{
+    int checksum = 0;
+    for(int i=0;i < length;i++)
+        checksum += data[i];
+    return calcChecksum(checksum);
+}
+
+int DxBus::encodePacket(int id,int inst,const unsigned char* param,int paramLength,unsigned char* packet)
+{
+    packet[0] = DX_BEGIN;
+    packet[1] = DX_BEGIN;
+    packet[2] = id;
+    packet[3] = paramLength + 2;
+    packet[4] = inst;
+    if(paramLength > 0)
+        memcpy(packet + 5,param,paramLength);
+
+    // checksum over id, length, instruction and param
+    packet[5 + paramLength] = calcChecksum(packet + 2,paramLength + 3);
+
+    return paramLength + 6;
+}
+
+int DxBus::encodeSyncWrite(int addr,int length,const int* idList,int idCount,const unsigned char* dataList,unsigned char* packet)
+{
+    int paramLength = 2 + (length + 1) * idCount;
+    if(paramLength > DX_MAX_PARAM_LENGTH)
+        return 0;
+
+    unsigned char* p = packet + 5;
+    *p++ = addr;
+    *p++ = length;
+    for(int i=0;i < idCount;i++)
+    {
+        *p++ = idList[i];
+        memcpy(p,dataList + i * length,length);
+        p += length;
+    }
+
+    packet[0] = DX_BEGIN;
+    packet[1] = DX_BEGIN;
+    packet[2] = DX_BROADCAST_ID;
+    packet[3] = paramLength + 2;
+    packet[4] = DX_INST_SYNC_WRITE;
+    packet[5 + paramLength] = calcChecksum(packet + 2,paramLength + 3);
+
+    return paramLength + 6;
+}
+
+bool DxBus::ping(int id)
+{
+    DxTransactionLock lock(*this);
+
+    if(sendPacket(id,DX_INST_PING,NULL,0) == false)
+        return false;
+
+    return endTransaction(id,readStatus(id,NULL,0));
+}
+
+bool DxBus::action(int id)
+{
+    DxTransactionLock lock(*this);
+
+    if(sendPacket(id,DX_INST_ACTION,NULL,0) == false)
+        return false;
+
+    if(id == DX_BROADCAST_ID || _statusReturnLevel < 2)
+        return endTransaction(id,true);
+    return endTransaction(id,readStatus(id,NULL,0));
+}
+
+bool DxBus::readData(int id,int addr,int length,unsigned char* data)
+{
+    DxTransactionLock lock(*this);
+
+    unsigned char param[2];
+    param[0] = addr;
+    param[1] = length;
+
+    for(int attempt = 0;;attempt++)
+    {
+        if(sendPacket(id,DX_INST_READ_DATA,param,2) == false)
+            return false;
+
+        if(readStatus(id,data,length))
+            break;
+
+        endTransaction(id,false);
+        if(retry(id,attempt) == false)
+            return false;
+    }
+
+    updateState(id,addr,length,data);
+    return endTransaction(id,true);
+}
+
+bool DxBus::writeData(int id,int addr,const unsigned char* data,int length,bool regWrite)
+{
+    DxTransactionLock lock(*this);
+
+    if(length + 1 > DX_MAX_PARAM_LENGTH)
+    {
+        _error = DX_ERROR_RANGE;
+        return false;
+    }
+
+    _param[0] = addr;
+    memcpy(_param + 1,data,length);
+
+    for(int attempt = 0;;attempt++)
+    {
+        if(sendPacket(id,regWrite ? DX_INST_REG_WRITE : DX_INST_WRITE_DATA,_param,length + 1) == false)
+            return false;
+
+        if(id == DX_BROADCAST_ID || _statusReturnLevel < 2)
+            return endTransaction(id,true);
+        if(readStatus(id,NULL,0))
+            return endTransaction(id,true);
+
+        endTransaction(id,false);
+        if(retry(id,attempt) == false)
+            return false;
+    }
+}
+
+bool DxBus::syncWrite(int addr,int length,const int* idList,int idCount,const unsigned char* dataList)
+{
+    DxTransactionLock lock(*this);
+
+    // one value for the whole bus, 7 + length bytes instead of one entry per servo
+    if(reachesAll(length,idList,idCount,dataList))
+    {
+        _param[0] = addr;
+        memcpy(_param + 1,dataList,length);
+        if(sendPacket(DX_BROADCAST_ID,DX_INST_WRITE_DATA,_param,length + 1) == false)
+            return false;
+        return endTransaction(DX_BROADCAST_ID,true);
+    }
+
+    int capacity = syncWriteCapacity(length);
+    if(capacity == 0)
+    {
+        _error = DX_ERROR_RANGE;
+        return false;
+    }
+    if(idCount > capacity && _syncSplitAction)
+        return regWriteAction(addr,length,idList,idCount,dataList);
+
+    // no return because of broadcast sending
+    for(int start=0;start < idCount;start += capacity)
+    {
+        int count = std::min(capacity,idCount - start);
+        int size = encodeSyncWrite(addr,length,idList + start,count,dataList + start * length,_packet);
+        if(sendEncoded(DX_BROADCAST_ID,DX_INST_SYNC_WRITE,size) == false)
+            return false;
+        if(endTransaction(DX_BROADCAST_ID,true) == false)
+            return false;
+    }
+    return true;
+}
+
+bool DxBus::regWriteAction(int addr,int length,const int* idList,int idCount,const unsigned char* dataList)
+{
+    // the servos which missed their data don't keep the others from moving
+    int error = DX_ERROR_NO;
+    bool sent = true;
+    _param[0] = addr;
+    for(int i=0;i < idCount && sent;i++)
+    {
+        memcpy(_param + 1,dataList + i * length,length);
+        for(int attempt = 0;;attempt++)
+        {
+            if(sendPacket(idList[i],DX_INST_REG_WRITE,_param,length + 1) == false)
+            {
+                sent = false;
+                break;
+            }
+            if(_statusReturnLevel < 2 || readStatus(idList[i],NULL,0))
+            {
+                endTransaction(idList[i],true);
+                break;
+            }
+
+            endTransaction(idList[i],false);
+            if(retry(idList[i],attempt) == false)
+            {
+                error |= _error;
+                break;
+            }
+        }
+    }
+    if(sent == false)
+        error |= _error;
+
+    // also after a failed send, the servos which got their REG_WRITE
+    // already would otherwise move on the next ACTION of anyone
+    if(sendPacket(DX_BROADCAST_ID,DX_INST_ACTION,NULL,0) == false)
+        return false;
+    endTransaction(DX_BROADCAST_ID,true);
+
+    _error |= error;
+    return sent && error == DX_ERROR_NO;
+}
+
+// all servos of setServoIds() are in the list and get the same data
+bool DxBus::reachesAll(int length,const int* idList,int idCount,const unsigned char* dataList)
+{
+    if(_servoIdCount == 0 || idCount < _servoIdCount || length <= 0 || length + 1 > DX_MAX_PARAM_LENGTH)
+        return false;
+
+    for(int i=1;i < idCount;i++)
+    {
+        if(memcmp(dataList,dataList + i * length,length) != 0)
+            return false;
+    }
+
+    bool seen[DX_BROADCAST_ID];
+    int  count = 0;
+    memset(seen,0,sizeof(seen));
+    for(int i=0;i < idCount;i++)
+    {
+        int id = idList[i];
+        if(id >= 0 && id < DX_BROADCAST_ID && _servoId[id] && !seen[id])
+        {
+            seen[id] = true;
+            count++;
+        }
+    }
+    return count == _servoIdCount;
+}
+
+int DxBus::bulkRead(const int* idList,const int* addrList,const int* lengthList,int count,unsigned char* data)
+{
+    DxTransactionLock lock(*this);
+
+    int paramLength = 1 + 3 * count;
+    if(count <= 0 || paramLength > DX_MAX_PARAM_LENGTH)
+    {
+        _error = DX_ERROR_RANGE;
+        return 0;
+    }
+
+    _param[0] = 0;
+    for(int i=0;i < count;i++)
+    {
+        _param[1 + i * 3] = lengthList[i];
+        _param[2 + i * 3] = idList[i];
+        _param[3 + i * 3] = addrList[i];
+    }
+
+    if(sendPacket(DX_BROADCAST_ID,DX_INST_BULK_READ,_param,paramLength) == false)
+        return 0;
+
+    // every servo waits for the reply of the one in front of it
+    int read = 0;
+    for(;read < count;read++)
+    {
+        if(readStatus(idList[read],data,lengthList[read]) == false)
+            break;
+        updateState(idList[read],addrList[read],lengthList[read],data);
+        data += lengthList[read];
+    }
+
+    endTransaction(DX_BROADCAST_ID,read == count);
+    return read;
+}
+
+int DxBus::readByte(int id,int addr)
+{
+    unsigned char data;
+    if(readData(id,addr,1,&data) == false)
+        return -1;
+    return data;
+}
+
+int DxBus::readWord(int id,int addr)
+{
+    unsigned char data[2];
+    if(readData(id,addr,2,data) == false)
+        return -1;
+    return (data[1] << 8) + data[0];
+}
+
+bool DxBus::writeByte(int id,int addr,int data)
+{
+    unsigned char d = data & 0xFF;
+    return writeData(id,addr,&d,1);
+}
+
+bool DxBus::writeWord(int id,int addr,int data)
+{
+    unsigned char d[2];
+    d[0] = data & 0x00FF;
+    d[1] = (data & 0xFF00) >> 8;
+    return writeData(id,addr,d,2);
+}
+
+bool DxBus::sendPacket(int id,int inst,const unsigned char* param,int paramLength)
+{
+    return sendEncoded(id,inst,encodePacket(id,inst,param,paramLength,_packet));
+}
+
+bool DxBus::sendEncoded(int id,int inst,int size)
+{
+    _error = DX_ERROR_NO;
+
+    if(_serial == NULL || _serial->isOpen() == false)
+    {
+        _error = DX_ERROR_USR_READSTATUS;
+        return false;
+    }
+
+    // drop old replies, otherwise they get mixed with the next status packet
+    _serial->clear();
+
+    if(_tracer)
+        _tracer->begin("transaction","id",id,"inst",inst);
+
+    _startTime = dxMicros();
+    _txBytes = size;
+    _rxBytes = 0;
+
+    DX_PROBE3(transaction_submit,id,inst,size);
+
+    _serial->write(_packet,size);
+
+    return true;
+}
+
+bool DxBus::endTransaction(int id,bool ret)
+{
+    int latency = (int)(dxMicros() - _startTime);
+
+    DX_PROBE3(transaction_done,id,_error,latency);
+    if(_error & (DX_ERROR_USR_NO_BEGIN | DX_ERROR_USR_DATA_TIMEOUT))
+        DX_PROBE2(reply_timeout,id,_error);
+
+    if(_tracer)
+    {
+        _tracer->end("transaction","error",_error,"tx",_txBytes,"rx",_rxBytes);
+        _tracer->counter("bus bytes","tx",_txBytes,"rx",_rxBytes);
+    }
+
+    if(_metrics)
+    {
+        _metrics->addTransaction(id,_error,latency,_txBytes,_rxBytes);
+        _metrics->setQueueDepth(_pending - 1,_serial->available());
+    }
+
+    if(_health && id != DX_BROADCAST_ID)
+        _health->addTransaction(id,_error,latency);
+
+    return ret;
+}
+
+// only line errors get repeated, the servo would answer the same error again
+bool DxBus::retry(int id,int attempt)
+{
+    if(attempt >= _retries || (_error & DX_ERROR_USR_LINK) == 0 || (_error & 0xFF) != 0)
+        return false;
+
+    DX_PROBE2(transaction_retry,id,_error);
+    if(_health)
+        _health->addRetry(id);
+    return true;
+}
+
+static bool overlaps(int addr,int length,int reg,int regLength)
+{
+    return addr <= reg && addr + length >= reg + regLength;
+}
+
+void DxBus::updateState(int id,int addr,int length,const unsigned char* data)
+{
+    if(id < 0 || id >= DX_BROADCAST_ID)
+        return;
+
+    DxServoState& state = _state[id];
+    bool          updated = false;
+
+    if(overlaps(addr,length,DX_CMD_PRESENT_POS,2))
+    {
+        const unsigned char* p = data + DX_CMD_PRESENT_POS - addr;
+        state.pos = (p[1] << 8) + p[0];
+        updated = true;
+    }
+    if(overlaps(addr,length,DX_CMD_PRESENT_SPEED,2))
+    {
+        const unsigned char* p = data + DX_CMD_PRESENT_SPEED - addr;
+        state.speed = (p[1] << 8) + p[0];
+        updated = true;
+    }
+    if(overlaps(addr,length,DX_CMD_PRESENT_LOAD,2))
+    {
+        const unsigned char* p = data + DX_CMD_PRESENT_LOAD - addr;
+        state.load = (p[1] << 8) + p[0];
+        updated = true;
+    }
+    if(overlaps(addr,length,DX_CMD_PRESENT_VOLT,1))
+    {
+        state.volt = data[DX_CMD_PRESENT_VOLT - addr];
+        updated = true;
+    }
+    if(overlaps(addr,length,DX_CMD_PRESENT_TEMP,1))
+    {
+        state.temp = data[DX_CMD_PRESENT_TEMP - addr];
+        updated = true;
+    }
+
+    if(!updated)
+        return;
+
+    dx::uint64_t now = dxMicros();
+    state.time = now;
+
+    if(_history)
+    {
+        if(overlaps(addr,length,DX_CMD_PRESENT_POS,2))
+            _history->add(id,DX_HISTORY_POS,state.pos,now);
+        if(overlaps(addr,length,DX_CMD_PRESENT_SPEED,2))
+            _history->add(id,DX_HISTORY_SPEED,state.speed,now);
+        if(overlaps(addr,length,DX_CMD_PRESENT_LOAD,2))
+            _history->add(id,DX_HISTORY_LOAD,state.load,now);
+        if(overlaps(addr,length,DX_CMD_PRESENT_VOLT,1))
+            _history->add(id,DX_HISTORY_VOLT,state.volt,now);
+        if(overlaps(addr,length,DX_CMD_PRESENT_TEMP,1))
+            _history->add(id,DX_HISTORY_TEMP,state.temp,now);
+    }
+}
+
+int DxBus::lastPosition(int id)
+{
+    if(id < 0 || id >= DX_BROADCAST_ID)
+        return -1;
+    return _state[id].pos;
+}
+
+int DxBus::lastSpeed(int id)
+{
+    if(id < 0 || id >= DX_BROADCAST_ID)
+        return -1;
+    return _state[id].speed;
+}
+
+int DxBus::lastLoad(int id)
+{
+    if(id < 0 || id >= DX_BROADCAST_ID)
+        return -1;
+    return _state[id].load;
+}
+
+int DxBus::lastVolt(int id)
+{
+    if(id < 0 || id >= DX_BROADCAST_ID)
+        return -1;
+    return _state[id].volt;
+}
+
+int DxBus::lastTemp(int id)
+{
+    if(id < 0 || id >= DX_BROADCAST_ID)
+        return -1;
+    return _state[id].temp;
+}
+
+dx::uint64_t DxBus::lastUpdate(int id)
+{
+    if(id < 0 || id >= DX_BROADCAST_ID)
+        return 0;
+    return _state[id].time;
+}
+
+bool DxBus::readStatus(int id,unsigned char* param,int paramLength)
+{
+    unsigned char data;
+    int failCount = 100;
+
+    // read all the data till the first 0xff
+    for(;;)
+    {
+        if(_serial->read(&data,1,_timeout) != 1)
+        {
+            _error |= DX_ERROR_USR_NO_BEGIN;
+            return false;
+        }
+
+        if(_rxBytes++ == 0)
+        {
+            dx::uint64_t wait = dxMicros() - _startTime;
+            DX_PROBE2(reply_first_byte,id,wait);
+            if(_tracer)
+                _tracer->complete("reply wait",_startTime,wait);
+        }
+
+        if(data == DX_BEGIN)
+            break;
+        else if(--failCount <= 0)
+        {
+            _error |= DX_ERROR_USR_NO_BEGIN;
+            return false;
+        }
+    }
+
+    // second begin, skip additional 0xff
+    do
+    {
+        if(_serial->read(&data,1,_timeout) != 1)
+        {
+            _error |= DX_ERROR_USR_DATA_TIMEOUT;
+            return false;
+        }
+        _rxBytes++;
+    }
+    while(data == DX_BEGIN);
+
+    // id, length, error
+    unsigned char* reply = _packet;
+    reply[0] = DX_BEGIN;
+    reply[1] = DX_BEGIN;
+    reply[2] = data;
+    if(_serial->read(reply + 3,2,_timeout) != 2)
+    {
+        _error |= DX_ERROR_USR_DATA_TIMEOUT;
+        return false;
+    }
+
+    _rxBytes += 2;
+
+    int retLength = reply[3];
+    if(retLength < 2)
+    {
+        _error |= DX_ERROR_USR_READSTATUS;
+        return false;
+    }
+
+    // param + checksum
+    if(_serial->read(reply + 5,retLength - 1,_timeout) != retLength - 1)
+    {
+        _error |= DX_ERROR_USR_DATA_TIMEOUT;
+        return false;
+    }
+
+    _rxBytes += retLength - 1;
+
+    DxStatusPacket status;
+    decodeStatus(reply,retLength + 4,status);
+    if(status.checksumOk == false)
+    {
+        DX_PROBE3(checksum_fail,status.id,calcChecksum(reply + 2,retLength + 1),reply[retLength + 3]);
+        _error |= DX_ERROR_USR_READSTATUS | DX_ERROR_USR_CHECKSUM;
+        return false;
+    }
+
+    _error |= status.error;
+    if(status.id != id || status.error != 0)
+    {
+        _error |= DX_ERROR_USR_ID;
+        return false;
+    }
+
+    if(status.paramLength != paramLength)
+    {
+        _error |= DX_ERROR_USR_READSTATUS;
+        return false;
+    }
+
+    if(param)
+        memcpy(param,status.param,paramLength);
+    return true;
+}
+
+int DxBus::decodeStatus(const unsigned char* data,int size,DxStatusPacket& status)
+{
+    status.id = -1;
+    status.error = 0;
+    status.paramLength = 0;
+    status.param = NULL;
+    status.checksumOk = false;
+
+    // framing, find the begin
+    int i = 0;
+    while(i + 1 < size && (data[i] != DX_BEGIN || data[i + 1] != DX_BEGIN))
+        i++;
+    if(i + 1 >= size)
+        return 0;
+
+    i += 2;
+    while(i < size && data[i] == DX_BEGIN)
+        i++;
+
+    // id, length, error
+    if(i + 3 > size)
+        return 0;
+
+    int length = data[i + 1];
+    if(length < 2)
+        return i + 2;   // not a valid packet, skip the header
+    if(i + length + 2 > size)
+        return 0;
+
+    status.id = data[i];
+    status.error = data[i + 2];
+    status.paramLength = length - 2;
+    status.param = data + i + 3;
+    status.checksumOk = calcChecksum(data + i,length + 1) == data[i + length + 1];
+
+    return i + length + 2;
+}
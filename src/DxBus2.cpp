@@ -0,0 +1,398 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "DxBus2.h"
+
+#include <cstring>
+
+DxBus2::DxBus2(SerialBase* serial):
+    _serial(serial),
+    _timeout(DX_DEFAULT_TIMEOUT),
+    _error(DX_ERROR_NO),
+    _servoError(DX_ERROR_NO),
+    _txBytes(0),
+    _rxBytes(0)
+{}
+
+DxBus2::~DxBus2()
+{}
+
+// crc-16 (polynomial 0x8005, msb first) of the protocol 2.0 packets
+unsigned short DxBus2::crc16(const unsigned char* data,int length,unsigned short crc)
+{
+    for(int i=0;i < length;i++)
+    {
+        crc ^= data[i] << 8;
+        for(int bit=0;bit < 8;bit++)
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x8005 : crc << 1;
+    }
+    return crc;
+}
+
+int DxBus2::encodePacket(int id,int inst,const unsigned char* param,int paramLength,unsigned char* packet)
+{
+    if(paramLength > DX2_MAX_PARAM_LENGTH)
+        return 0;
+
+    packet[0] = DX_BEGIN;
+    packet[1] = DX_BEGIN;
+    packet[2] = DX2_HEADER;
+    packet[3] = 0x00;
+    packet[4] = id;
+    packet[7] = inst;
+
+    // a header in the param gets an extra 0xfd
+    int p = 8;
+    for(int i=0;i < paramLength;i++)
+    {
+        packet[p++] = param[i];
+        if(p - 8 >= 3 && packet[p - 3] == DX_BEGIN && packet[p - 2] == DX_BEGIN && packet[p - 1] == DX2_HEADER)
+            packet[p++] = DX2_HEADER;
+    }
+
+    int length = p - 8 + 3;     // instruction, param and crc
+    packet[5] = length & 0xFF;
+    packet[6] = length >> 8;
+
+    unsigned short crc = crc16(packet,p);
+    packet[p++] = crc & 0xFF;
+    packet[p++] = crc >> 8;
+    return p;
+}
+
+bool DxBus2::sendPacket(int id,int inst,const unsigned char* param,int paramLength)
+{
+    _error = DX_ERROR_NO;
+    _servoError = DX_ERROR_NO;
+
+    if(_serial == NULL || _serial->isOpen() == false)
+    {
+        _error = DX_ERROR_USR_READSTATUS;
+        return false;
+    }
+
+    int size = encodePacket(id,inst,param,paramLength,_packet);
+    if(size == 0)
+    {
+        _error = DX_ERROR_USR_READSTATUS;
+        return false;
+    }
+
+    // drop old replies, otherwise they get mixed with the next status packet
+    _serial->clear();
+    _serial->write(_packet,size);
+    _txBytes += size;
+    return true;
+}
+
+bool DxBus2::readStatus(int& id,unsigned char* param,int paramLength)
+{
+    unsigned char data;
+    int failCount = 100;
+    int match = 0;
+
+    // ff ff fd, skip everything in front
+    while(match < 3)
+    {
+        if(_serial->read(&data,1,_timeout) != 1)
+        {
+            _error |= DX_ERROR_USR_NO_BEGIN;
+            return false;
+        }
+        _rxBytes++;
+
+        if(data == DX_BEGIN)
+            match = match == 2 ? 2 : match + 1;
+        else if(data == DX2_HEADER && match == 2)
+            match = 3;
+        else
+            match = 0;
+
+        if(match == 0 && --failCount <= 0)
+        {
+            _error |= DX_ERROR_USR_NO_BEGIN;
+            return false;
+        }
+    }
+
+    // reserved, id, length
+    unsigned char* reply = _packet;
+    reply[0] = DX_BEGIN;
+    reply[1] = DX_BEGIN;
+    reply[2] = DX2_HEADER;
+    if(_serial->read(reply + 3,4,_timeout) != 4)
+    {
+        _error |= DX_ERROR_USR_DATA_TIMEOUT;
+        return false;
+    }
+    _rxBytes += 4;
+
+    int length = reply[5] + (reply[6] << 8);
+    if(length < 4 || length > DX2_MAX_PACKET_SIZE - 7)
+    {
+        _error |= DX_ERROR_USR_READSTATUS;
+        return false;
+    }
+
+    // instruction, error, param, crc
+    if(_serial->read(reply + 7,length,_timeout) != length)
+    {
+        _error |= DX_ERROR_USR_DATA_TIMEOUT;
+        return false;
+    }
+    _rxBytes += length;
+
+    unsigned short crc = crc16(reply,length + 5);
+    if(reply[length + 5] != (crc & 0xFF) || reply[length + 6] != (crc >> 8))
+    {
+        _error |= DX_ERROR_USR_READSTATUS | DX_ERROR_USR_CHECKSUM;
+        return false;
+    }
+
+    id = reply[4];
+    if(reply[7] != DX2_INST_STATUS)
+    {
+        _error |= DX_ERROR_USR_READSTATUS;
+        return false;
+    }
+
+    // the alert bit alone still has valid data
+    _servoError = reply[8];
+    if(_servoError & DX2_ERROR_NUMBER_MASK)
+    {
+        _error |= DX2_ERROR_USR_SERVO;
+        return false;
+    }
+
+    // remove the byte stuffing
+    const unsigned char* raw = reply + 9;
+    int rawLength = length - 4;
+    int count = 0;
+    for(int i=0;i < rawLength;i++)
+    {
+        if(i >= 3 && raw[i] == DX2_HEADER && raw[i - 1] == DX2_HEADER && raw[i - 2] == DX_BEGIN && raw[i - 3] == DX_BEGIN)
+            continue;
+        if(count < paramLength && param)
+            param[count] = raw[i];
+        count++;
+    }
+
+    if(count != paramLength)
+    {
+        _error |= DX_ERROR_USR_READSTATUS;
+        return false;
+    }
+    return true;
+}
+
+bool DxBus2::ping(int id,int* modelNr)
+{
+    dx::scoped_lock l(_busMutex);
+
+    if(sendPacket(id,DX2_INST_PING,NULL,0) == false)
+        return false;
+
+    // model number and firmware version
+    unsigned char param[3];
+    int           statusId;
+    if(readStatus(statusId,param,3) == false)
+        return false;
+    if(statusId != id)
+    {
+        _error |= DX_ERROR_USR_ID;
+        return false;
+    }
+
+    if(modelNr)
+        *modelNr = param[0] + (param[1] << 8);
+    return true;
+}
+
+bool DxBus2::readData(int id,int addr,int length,unsigned char* data)
+{
+    dx::scoped_lock l(_busMutex);
+
+    unsigned char param[4];
+    param[0] = addr & 0xFF;
+    param[1] = addr >> 8;
+    param[2] = length & 0xFF;
+    param[3] = length >> 8;
+
+    if(sendPacket(id,DX2_INST_READ,param,4) == false)
+        return false;
+
+    int statusId;
+    if(readStatus(statusId,data,length) == false)
+        return false;
+    if(statusId != id)
+    {
+        _error |= DX_ERROR_USR_ID;
+        return false;
+    }
+    return true;
+}
+
+bool DxBus2::writeData(int id,int addr,const unsigned char* data,int length)
+{
+    dx::scoped_lock l(_busMutex);
+
+    if(length + 2 > DX2_MAX_PARAM_LENGTH)
+    {
+        _error = DX_ERROR_USR_READSTATUS;
+        return false;
+    }
+
+    _param[0] = addr & 0xFF;
+    _param[1] = addr >> 8;
+    memcpy(_param + 2,data,length);
+
+    if(sendPacket(id,DX2_INST_WRITE,_param,length + 2) == false)
+        return false;
+    if(id == DX_BROADCAST_ID)
+        return true;
+
+    int statusId;
+    if(readStatus(statusId,NULL,0) == false)
+        return false;
+    if(statusId != id)
+    {
+        _error |= DX_ERROR_USR_ID;
+        return false;
+    }
+    return true;
+}
+
+int DxBus2::syncRead(int addr,int length,const int* idList,int idCount,unsigned char* dataList,bool* okList)
+{
+    dx::scoped_lock l(_busMutex);
+
+    if(okList)
+    {
+        for(int i=0;i < idCount;i++)
+            okList[i] = false;
+    }
+
+    if(idCount <= 0 || 4 + idCount > DX2_MAX_PARAM_LENGTH)
+    {
+        _error = DX_ERROR_USR_READSTATUS;
+        return 0;
+    }
+
+    _param[0] = addr & 0xFF;
+    _param[1] = addr >> 8;
+    _param[2] = length & 0xFF;
+    _param[3] = length >> 8;
+    for(int i=0;i < idCount;i++)
+        _param[4 + i] = idList[i];
+
+    if(sendPacket(DX_BROADCAST_ID,DX2_INST_SYNC_READ,_param,4 + idCount) == false)
+        return 0;
+
+    // the servos answer one after another, a missing one only costs the timeout
+    int read = 0;
+    int lastError = DX_ERROR_NO;
+    for(int i=0;i < idCount;i++)
+    {
+        int statusId;
+        _error = DX_ERROR_NO;
+        if(readStatus(statusId,_param,length) == false)
+        {
+            lastError = _error;
+            if(_error & DX_ERROR_USR_NO_BEGIN)
+                break;
+            continue;
+        }
+
+        for(int j=0;j < idCount;j++)
+        {
+            if(idList[j] == statusId)
+            {
+                memcpy(dataList + j * length,_param,length);
+                if(okList)
+                    okList[j] = true;
+                read++;
+                break;
+            }
+        }
+    }
+
+    _error = read == idCount ? DX_ERROR_NO : lastError;
+    return read;
+}
+
+bool DxBus2::syncWrite(int addr,int length,const int* idList,int idCount,const unsigned char* dataList)
+{
+    dx::scoped_lock l(_busMutex);
+
+    int paramLength = 4 + (length + 1) * idCount;
+    if(paramLength > DX2_MAX_PARAM_LENGTH)
+    {
+        _error = DX_ERROR_USR_READSTATUS;
+        return false;
+    }
+
+    _param[0] = addr & 0xFF;
+    _param[1] = addr >> 8;
+    _param[2] = length & 0xFF;
+    _param[3] = length >> 8;
+    unsigned char* p = _param + 4;
+    for(int i=0;i < idCount;i++)
+    {
+        *p++ = idList[i];
+        memcpy(p,dataList + i * length,length);
+        p += length;
+    }
+
+    // no reply, broadcast
+    return sendPacket(DX_BROADCAST_ID,DX2_INST_SYNC_WRITE,_param,paramLength);
+}
+
+int DxBus2::readByte(int id,int addr)
+{
+    unsigned char data;
+    if(readData(id,addr,1,&data) == false)
+        return -1;
+    return data;
+}
+
+int DxBus2::readWord(int id,int addr)
+{
+    unsigned char data[2];
+    if(readData(id,addr,2,data) == false)
+        return -1;
+    return (data[1] << 8) + data[0];
+}
+
+bool DxBus2::writeByte(int id,int addr,int data)
+{
+    unsigned char d = data & 0xFF;
+    return writeData(id,addr,&d,1);
+}
+
+bool DxBus2::writeWord(int id,int addr,int data)
+{
+    unsigned char d[2];
+    d[0] = data & 0x00FF;
+    d[1] = (data & 0xFF00) >> 8;
+    return writeData(id,addr,d,2);
+}
@@ -0,0 +1,516 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "DxPlanner.h"
+
+#include <sstream>
+#include <cstring>
+#include <algorithm>
+
+#define  DX_PLAN_TABLE_SIZE         (256)
+#define  DX_PLAN_MAX_SYNC_LENGTH    (DX_MAX_PARAM_LENGTH - 3)   // one servo in a sync write
+#define  DX_PLAN_MAX_BULK_COUNT     ((DX_MAX_PARAM_LENGTH - 1) / 3)
+
+// sort orders of the request indices
+struct DxPlanById
+{
+    DxPlanById(const std::vector<DxPlanItem>& items): _items(items) {}
+    bool operator()(int a,int b) const
+    {
+        return _items[a].id < _items[b].id;
+    }
+    const std::vector<DxPlanItem>& _items;
+};
+
+struct DxPlanByIdAddr
+{
+    DxPlanByIdAddr(const std::vector<DxPlanItem>& items): _items(items) {}
+    bool operator()(int a,int b) const
+    {
+        if(_items[a].id != _items[b].id)
+            return _items[a].id < _items[b].id;
+        return _items[a].addr < _items[b].addr;
+    }
+    const std::vector<DxPlanItem>& _items;
+};
+
+struct DxPlanByAddrLength
+{
+    DxPlanByAddrLength(const std::vector<DxPlanItem>& items): _items(items) {}
+    bool operator()(int a,int b) const
+    {
+        if(_items[a].addr != _items[b].addr)
+            return _items[a].addr < _items[b].addr;
+        if(_items[a].length != _items[b].length)
+            return _items[a].length < _items[b].length;
+        return _items[a].id < _items[b].id;
+    }
+    const std::vector<DxPlanItem>& _items;
+};
+
+DxPlanner::DxPlanner(int baudRate,int returnDelay):
+    _baudRate(baudRate),
+    _returnDelay(returnDelay),
+    _bulkRead(false),
+    _errorCount(0)
+{}
+
+void DxPlanner::clear()
+{
+    _reads.clear();
+    _writes.clear();
+    _writeData.clear();
+    _blocks.clear();
+    _readData.clear();
+    _packetData.clear();
+    _packets.clear();
+    _errorCount = 0;
+}
+
+int DxPlanner::read(int id,int addr,int length)
+{
+    if(addr < 0 || length < 1 || addr + length > DX_PLAN_TABLE_SIZE || length > DX_MAX_PARAM_LENGTH)
+        length = 0;
+
+    DxPlanItem request;
+    request.id     = id;
+    request.addr   = addr;
+    request.length = length;
+    request.offset = -1;
+    _reads.push_back(request);
+    return _reads.size() - 1;
+}
+
+void DxPlanner::write(int id,int addr,const unsigned char* data,int length)
+{
+    if(addr < 0 || length < 1 || addr + length > DX_PLAN_TABLE_SIZE)
+        return;
+
+    DxPlanItem request;
+    request.id     = id;
+    request.addr   = addr;
+    request.length = length;
+    request.offset = _writeData.size();
+    _writes.push_back(request);
+    _writeData.insert(_writeData.end(),data,data + length);
+}
+
+void DxPlanner::writeByte(int id,int addr,int data)
+{
+    unsigned char d = data & 0xFF;
+    write(id,addr,&d,1);
+}
+
+void DxPlanner::writeWord(int id,int addr,int data)
+{
+    unsigned char d[2];
+    d[0] = data & 0x00FF;
+    d[1] = (data & 0xFF00) >> 8;
+    write(id,addr,d,2);
+}
+
+int DxPlanner::compile()
+{
+    _blocks.clear();
+    _readData.clear();
+    _packetData.clear();
+    _packets.clear();
+
+    compileWrites();
+    compileReads();
+    return _packets.size();
+}
+
+void DxPlanner::compileWrites()
+{
+    // last value of every written register, per servo
+    std::vector<DxPlanItem> runs;
+    std::vector<unsigned char> runData;
+
+    std::vector<int> order(_writes.size());
+    for(size_t i=0;i < order.size();i++)
+        order[i] = i;
+    // stable, the later write of a register wins
+    std::stable_sort(order.begin(),order.end(),DxPlanById(_writes));
+
+    unsigned char image[DX_PLAN_TABLE_SIZE];
+    bool          set[DX_PLAN_TABLE_SIZE];
+    for(size_t i=0;i < order.size();)
+    {
+        int id = _writes[order[i]].id;
+        memset(set,0,sizeof(set));
+        for(;i < order.size() && _writes[order[i]].id == id;i++)
+        {
+            const DxPlanItem& w = _writes[order[i]];
+            memcpy(image + w.addr,&_writeData[w.offset],w.length);
+            memset(set + w.addr,1,w.length);
+        }
+
+        // the adjacent registers become one write
+        for(int addr = 0;addr < DX_PLAN_TABLE_SIZE;)
+        {
+            if(!set[addr])
+            {
+                addr++;
+                continue;
+            }
+
+            DxPlanItem run;
+            run.id     = id;
+            run.addr   = addr;
+            run.length = 0;
+            run.offset = runData.size();
+            while(addr < DX_PLAN_TABLE_SIZE && set[addr] && run.length < DX_PLAN_MAX_SYNC_LENGTH)
+            {
+                runData.push_back(image[addr++]);
+                run.length++;
+            }
+            runs.push_back(run);
+        }
+    }
+
+    // the same address and length on several servos is one sync write
+    order.resize(runs.size());
+    for(size_t i=0;i < order.size();i++)
+        order[i] = i;
+    std::sort(order.begin(),order.end(),DxPlanByAddrLength(runs));
+
+    for(size_t i=0;i < order.size();)
+    {
+        size_t end = i + 1;
+        while(end < order.size() &&
+              runs[order[end]].addr == runs[order[i]].addr &&
+              runs[order[end]].length == runs[order[i]].length)
+            end++;
+
+        if(end - i == 1)
+        {
+            DxPlanPacket packet;
+            packet.inst = DX_INST_WRITE_DATA;
+
+            DxPlanItem item = runs[order[i]];
+            item.offset = _packetData.size();
+            _packetData.insert(_packetData.end(),runData.begin() + runs[order[i]].offset,runData.begin() + runs[order[i]].offset + item.length);
+            packet.items.push_back(item);
+            addPacket(packet);
+        }
+        else
+        {
+            int perPacket = DxBus::syncWriteCapacity(runs[order[i]].length);
+            for(size_t start = i;start < end;start += perPacket)
+            {
+                DxPlanPacket packet;
+                packet.inst = DX_INST_SYNC_WRITE;
+                for(size_t j = start;j < end && j < start + perPacket;j++)
+                {
+                    DxPlanItem item = runs[order[j]];
+                    item.offset = _packetData.size();
+                    _packetData.insert(_packetData.end(),runData.begin() + runs[order[j]].offset,runData.begin() + runs[order[j]].offset + item.length);
+                    packet.items.push_back(item);
+                }
+                addPacket(packet);
+            }
+        }
+        i = end;
+    }
+}
+
+void DxPlanner::compileReads()
+{
+    std::vector<int> order;
+    for(size_t i=0;i < _reads.size();i++)
+    {
+        _reads[i].offset = -1;
+        if(_reads[i].length > 0)
+            order.push_back(i);
+    }
+    std::sort(order.begin(),order.end(),DxPlanByIdAddr(_reads));
+
+    // a few unused bytes in between are cheaper than another status packet
+    int gap = readGap();
+    for(size_t i=0;i < order.size();i++)
+    {
+        DxPlanItem& r = _reads[order[i]];
+        if(!_blocks.empty())
+        {
+            Block& b = _blocks.back();
+            int end = std::max(b.addr + b.length,r.addr + r.length);
+            if(b.id == r.id && r.addr <= b.addr + b.length + gap && end - b.addr <= DX_MAX_PARAM_LENGTH)
+            {
+                b.length = end - b.addr;
+                r.offset = _blocks.size() - 1;
+                continue;
+            }
+        }
+
+        Block b;
+        b.id     = r.id;
+        b.addr   = r.addr;
+        b.length = r.length;
+        b.offset = 0;
+        b.ok     = false;
+        _blocks.push_back(b);
+        r.offset = _blocks.size() - 1;
+    }
+
+    // a bulk read holds every servo once, the next block of a servo goes into the next one
+    std::vector<bool> planned(_blocks.size(),false);
+    size_t left = _blocks.size();
+    while(left > 0)
+    {
+        DxPlanPacket packet;
+        packet.inst = DX_INST_BULK_READ;
+
+        int lastId = -1;
+        for(size_t i=0;i < _blocks.size() && (int)packet.items.size() < DX_PLAN_MAX_BULK_COUNT;i++)
+        {
+            if(planned[i] || _blocks[i].id == lastId)
+                continue;
+
+            Block& b = _blocks[i];
+            b.offset = _readData.size();
+            _readData.resize(_readData.size() + b.length);
+
+            DxPlanItem item;
+            item.id     = b.id;
+            item.addr   = b.addr;
+            item.length = b.length;
+            item.offset = i;
+            packet.items.push_back(item);
+
+            planned[i] = true;
+            left--;
+            lastId = b.id;
+
+            if(!_bulkRead)
+                break;
+        }
+
+        if(packet.items.size() == 1)
+            packet.inst = DX_INST_READ_DATA;
+        addPacket(packet);
+    }
+}
+
+void DxPlanner::addPacket(DxPlanPacket& packet)
+{
+    int count = packet.items.size();
+    switch(packet.inst)
+    {
+    case DX_INST_WRITE_DATA:
+        packet.txBytes = packet.items[0].length + 7;
+        packet.rxBytes = 6;
+        packet.replies = 1;
+        break;
+    case DX_INST_SYNC_WRITE:
+        packet.txBytes = 8 + count * (packet.items[0].length + 1);
+        packet.rxBytes = 0;
+        packet.replies = 0;
+        break;
+    case DX_INST_READ_DATA:
+        packet.txBytes = 8;
+        packet.rxBytes = 6 + packet.items[0].length;
+        packet.replies = 1;
+        break;
+    case DX_INST_BULK_READ:
+        packet.txBytes = 7 + 3 * count;
+        packet.rxBytes = 0;
+        for(int i=0;i < count;i++)
+            packet.rxBytes += 6 + packet.items[i].length;
+        packet.replies = count;
+        break;
+    }
+    packet.wireTime = packetTime(packet.txBytes,packet.rxBytes,packet.replies);
+    _packets.push_back(packet);
+}
+
+// 10 bits per byte, 8N1
+int DxPlanner::packetTime(int txBytes,int rxBytes,int replies)
+{
+    if(_baudRate <= 0)
+        return 0;
+    return (int)((txBytes + rxBytes) * 10000000.0 / _baudRate + 0.5) + replies * _returnDelay;
+}
+
+// the unused bytes which take less time than one more status packet
+int DxPlanner::readGap()
+{
+    if(_baudRate <= 0)
+        return 0;
+    int packetBytes = _bulkRead ? 3 + 6 : 8 + 6;
+    return packetBytes + (int)(_returnDelay * (double)_baudRate / 10000000.0);
+}
+
+int DxPlanner::wireTime()
+{
+    int time = 0;
+    for(size_t i=0;i < _packets.size();i++)
+        time += _packets[i].wireTime;
+    return time;
+}
+
+int DxPlanner::requestWireTime()
+{
+    int time = 0;
+    for(size_t i=0;i < _reads.size();i++)
+    {
+        if(_reads[i].length > 0)
+            time += packetTime(8,6 + _reads[i].length,1);
+    }
+    for(size_t i=0;i < _writes.size();i++)
+        time += packetTime(_writes[i].length + 7,6,1);
+    return time;
+}
+
+std::string DxPlanner::schedule()
+{
+    std::ostringstream out;
+    for(size_t i=0;i < _packets.size();i++)
+    {
+        const DxPlanPacket& packet = _packets[i];
+        switch(packet.inst)
+        {
+        case DX_INST_WRITE_DATA:
+            out << "WRITE_DATA id " << packet.items[0].id;
+            break;
+        case DX_INST_SYNC_WRITE:
+            out << "SYNC_WRITE ids";
+            for(size_t j=0;j < packet.items.size();j++)
+                out << " " << packet.items[j].id;
+            break;
+        case DX_INST_READ_DATA:
+            out << "READ_DATA id " << packet.items[0].id;
+            break;
+        case DX_INST_BULK_READ:
+            out << "BULK_READ";
+            break;
+        }
+
+        if(packet.inst == DX_INST_BULK_READ)
+        {
+            for(size_t j=0;j < packet.items.size();j++)
+                out << " " << packet.items[j].id << ":" << packet.items[j].addr << "/" << packet.items[j].length;
+        }
+        else
+            out << " addr " << packet.items[0].addr << " length " << packet.items[0].length;
+
+        out << ", tx " << packet.txBytes << " rx " << packet.rxBytes << ", " << packet.wireTime << "us\n";
+    }
+    out << _packets.size() << " packets, " << wireTime() << "us, as single requests "
+        << _reads.size() + _writes.size() << " packets, " << requestWireTime() << "us\n";
+    return out.str();
+}
+
+bool DxPlanner::execute(DxBus* bus)
+{
+    _errorCount = 0;
+    for(size_t i=0;i < _blocks.size();i++)
+        _blocks[i].ok = false;
+
+    for(size_t i=0;i < _packets.size();i++)
+    {
+        const DxPlanPacket& packet = _packets[i];
+        int count = packet.items.size();
+
+        switch(packet.inst)
+        {
+        case DX_INST_WRITE_DATA:
+            {
+                const DxPlanItem& item = packet.items[0];
+                if(!bus->writeData(item.id,item.addr,&_packetData[item.offset],item.length))
+                    _errorCount++;
+            }
+            break;
+        case DX_INST_SYNC_WRITE:
+            _idList.resize(count);
+            for(int j=0;j < count;j++)
+                _idList[j] = packet.items[j].id;
+            if(!bus->syncWrite(packet.items[0].addr,packet.items[0].length,&_idList[0],count,&_packetData[packet.items[0].offset]))
+                _errorCount++;
+            break;
+        case DX_INST_READ_DATA:
+        case DX_INST_BULK_READ:
+            {
+                int read = 0;
+                if(packet.inst == DX_INST_BULK_READ)
+                {
+                    _idList.resize(count);
+                    _addrList.resize(count);
+                    _lengthList.resize(count);
+                    for(int j=0;j < count;j++)
+                    {
+                        _idList[j]     = packet.items[j].id;
+                        _addrList[j]   = packet.items[j].addr;
+                        _lengthList[j] = packet.items[j].length;
+                    }
+                    read = bus->bulkRead(&_idList[0],&_addrList[0],&_lengthList[0],count,&_readData[_blocks[packet.items[0].offset].offset]);
+                    for(int j=0;j < read;j++)
+                        _blocks[packet.items[j].offset].ok = true;
+                }
+
+                // single reads, or the rest of a broken bulk read chain
+                for(int j=read;j < count;j++)
+                {
+                    Block& b = _blocks[packet.items[j].offset];
+                    b.ok = bus->readData(b.id,b.addr,b.length,&_readData[b.offset]);
+                    if(!b.ok)
+                        _errorCount++;
+                }
+            }
+            break;
+        }
+    }
+    return _errorCount == 0;
+}
+
+bool DxPlanner::readOk(int read)
+{
+    if(read < 0 || read >= (int)_reads.size() || _reads[read].offset < 0)
+        return false;
+    return _blocks[_reads[read].offset].ok;
+}
+
+const unsigned char* DxPlanner::readData(int read)
+{
+    if(!readOk(read))
+        return NULL;
+    const DxPlanItem& r = _reads[read];
+    const Block&   b = _blocks[r.offset];
+    return &_readData[b.offset + r.addr - b.addr];
+}
+
+int DxPlanner::readByte(int read)
+{
+    const unsigned char* data = readData(read);
+    if(data == NULL)
+        return -1;
+    return data[0];
+}
+
+int DxPlanner::readWord(int read)
+{
+    const unsigned char* data = readData(read);
+    if(data == NULL || _reads[read].length < 2)
+        return -1;
+    return (data[1] << 8) + data[0];
+}
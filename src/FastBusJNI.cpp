@@ -0,0 +1,265 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// hand written jni of FastBus.java, the hot Servo operations skip the swig
+// proxies. the ids get cached and the natives registered in JNI_OnLoad.
+// arrays are copied out of the critical sections, the bus io runs outside
+
+#include <jni.h>
+#include <cstring>
+
+#include "DxBus.h"
+
+#define  FASTBUS_CLASS              "SimpleDynamixel/FastBus"
+
+static jfieldID _busField   = NULL;
+static jfieldID _errorField = NULL;
+
+static DxBus* getBus(JNIEnv* env,jobject self)
+{
+    return reinterpret_cast<DxBus*>(env->GetLongField(self,_busField));
+}
+
+// DxBus::error() is kept per thread, so reading it after the transaction
+// released the bus still gives the error of this call
+static void setError(JNIEnv* env,jobject self,int error)
+{
+    env->SetIntField(self,_errorField,error);
+}
+
+// copies count ints of array, false if the array is too short
+static bool copyIntArray(JNIEnv* env,jintArray array,int count,int* dest)
+{
+    if(array == NULL || count < 0 || env->GetArrayLength(array) < count)
+        return false;
+
+    jint* src = static_cast<jint*>(env->GetPrimitiveArrayCritical(array,NULL));
+    if(src == NULL)
+        return false;
+    for(int i=0;i < count;i++)
+        dest[i] = src[i];
+    env->ReleasePrimitiveArrayCritical(array,src,JNI_ABORT);
+    return true;
+}
+
+static bool copyByteArray(JNIEnv* env,jbyteArray array,int count,unsigned char* dest)
+{
+    if(array == NULL || count < 0 || env->GetArrayLength(array) < count)
+        return false;
+
+    jbyte* src = static_cast<jbyte*>(env->GetPrimitiveArrayCritical(array,NULL));
+    if(src == NULL)
+        return false;
+    memcpy(dest,src,count);
+    env->ReleasePrimitiveArrayCritical(array,src,JNI_ABORT);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// natives
+
+static jboolean JNICALL fastPing(JNIEnv* env,jobject self,jint id)
+{
+    DxBus* bus = getBus(env,self);
+    if(bus == NULL)
+        return JNI_FALSE;
+
+    bool ret = bus->ping(id);
+    setError(env,self,bus->error());
+    return ret;
+}
+
+static jboolean JNICALL fastAction(JNIEnv* env,jobject self,jint id)
+{
+    DxBus* bus = getBus(env,self);
+    if(bus == NULL)
+        return JNI_FALSE;
+
+    bool ret = bus->action(id);
+    setError(env,self,bus->error());
+    return ret;
+}
+
+static jint JNICALL fastReadByte(JNIEnv* env,jobject self,jint id,jint addr)
+{
+    DxBus* bus = getBus(env,self);
+    if(bus == NULL)
+        return -1;
+
+    int ret = bus->readByte(id,addr);
+    setError(env,self,bus->error());
+    return ret;
+}
+
+static jint JNICALL fastReadWord(JNIEnv* env,jobject self,jint id,jint addr)
+{
+    DxBus* bus = getBus(env,self);
+    if(bus == NULL)
+        return -1;
+
+    int ret = bus->readWord(id,addr);
+    setError(env,self,bus->error());
+    return ret;
+}
+
+static jint JNICALL fastReadData(JNIEnv* env,jobject self,jint id,jint addr,jbyteArray data,jint length)
+{
+    DxBus* bus = getBus(env,self);
+    if(bus == NULL)
+        return -1;
+
+    if(data == NULL || length < 0 || length > DX_MAX_PARAM_LENGTH || env->GetArrayLength(data) < length)
+    {
+        setError(env,self,DX_ERROR_RANGE);
+        return -1;
+    }
+
+    unsigned char buffer[DX_MAX_PARAM_LENGTH];
+    bool ret = bus->readData(id,addr,length,buffer);
+    setError(env,self,bus->error());
+    if(ret == false)
+        return -1;
+
+    env->SetByteArrayRegion(data,0,length,reinterpret_cast<jbyte*>(buffer));
+    return length;
+}
+
+static jboolean JNICALL fastWriteByte(JNIEnv* env,jobject self,jint id,jint addr,jint data,jboolean regWrite)
+{
+    DxBus* bus = getBus(env,self);
+    if(bus == NULL)
+        return JNI_FALSE;
+
+    unsigned char d = data & 0xFF;
+    bool ret = bus->writeData(id,addr,&d,1,regWrite == JNI_TRUE);
+    setError(env,self,bus->error());
+    return ret;
+}
+
+static jboolean JNICALL fastWriteWord(JNIEnv* env,jobject self,jint id,jint addr,jint data,jboolean regWrite)
+{
+    DxBus* bus = getBus(env,self);
+    if(bus == NULL)
+        return JNI_FALSE;
+
+    unsigned char d[2];
+    d[0] = data & 0x00FF;
+    d[1] = (data & 0xFF00) >> 8;
+    bool ret = bus->writeData(id,addr,d,2,regWrite == JNI_TRUE);
+    setError(env,self,bus->error());
+    return ret;
+}
+
+static jboolean JNICALL fastSyncWrite(JNIEnv* env,jobject self,jint addr,jint length,jintArray idList,jint idCount,jbyteArray dataList)
+{
+    DxBus* bus = getBus(env,self);
+    if(bus == NULL)
+        return JNI_FALSE;
+
+    // DxBus splits what doesn't fit into one packet
+    int           ids[DX_BROADCAST_ID];
+    unsigned char data[DX_BROADCAST_ID * 8];
+    if(idCount < 0 || idCount > DX_BROADCAST_ID || length < 0 || length * idCount > (int)sizeof(data) ||
+       copyIntArray(env,idList,idCount,ids) == false ||
+       copyByteArray(env,dataList,length * idCount,data) == false)
+    {
+        setError(env,self,DX_ERROR_RANGE);
+        return JNI_FALSE;
+    }
+
+    bool ret = bus->syncWrite(addr,length,ids,idCount,data);
+    setError(env,self,bus->error());
+    return ret;
+}
+
+static jboolean JNICALL fastSyncWriteWord(JNIEnv* env,jobject self,jint addr,jintArray idList,jintArray valueList,jint idCount)
+{
+    DxBus* bus = getBus(env,self);
+    if(bus == NULL)
+        return JNI_FALSE;
+
+    int           ids[DX_BROADCAST_ID];
+    int           values[DX_BROADCAST_ID];
+    unsigned char data[DX_BROADCAST_ID * 2];
+    if(idCount < 0 || idCount > DX_BROADCAST_ID ||
+       copyIntArray(env,idList,idCount,ids) == false ||
+       copyIntArray(env,valueList,idCount,values) == false)
+    {
+        setError(env,self,DX_ERROR_RANGE);
+        return JNI_FALSE;
+    }
+
+    for(int i=0;i < idCount;i++)
+    {
+        data[i * 2]     = values[i] & 0x00FF;
+        data[i * 2 + 1] = (values[i] & 0xFF00) >> 8;
+    }
+
+    bool ret = bus->syncWrite(addr,2,ids,idCount,data);
+    setError(env,self,bus->error());
+    return ret;
+}
+
+static JNINativeMethod _fastBusMethods[] =
+{
+    { (char*)"ping",            (char*)"(I)Z",          (void*)&fastPing },
+    { (char*)"action",          (char*)"(I)Z",          (void*)&fastAction },
+    { (char*)"readByte",        (char*)"(II)I",         (void*)&fastReadByte },
+    { (char*)"readWord",        (char*)"(II)I",         (void*)&fastReadWord },
+    { (char*)"readData",        (char*)"(II[BI)I",      (void*)&fastReadData },
+    { (char*)"writeByte",       (char*)"(IIIZ)Z",       (void*)&fastWriteByte },
+    { (char*)"writeWord",       (char*)"(IIIZ)Z",       (void*)&fastWriteWord },
+    { (char*)"syncWrite",       (char*)"(II[II[B)Z",    (void*)&fastSyncWrite },
+    { (char*)"syncWriteWord",   (char*)"(I[I[II)Z",     (void*)&fastSyncWriteWord },
+};
+
+// the swig part works without the fast path, errors are only reported
+JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm,void* reserved)
+{
+    JNIEnv* env = NULL;
+    if(vm->GetEnv(reinterpret_cast<void**>(&env),JNI_VERSION_1_4) != JNI_OK)
+        return JNI_ERR;
+
+    jclass cls = env->FindClass(FASTBUS_CLASS);
+    if(cls == NULL)
+    {
+        env->ExceptionClear();
+        return JNI_VERSION_1_4;
+    }
+
+    _busField   = env->GetFieldID(cls,"_bus","J");
+    _errorField = env->GetFieldID(cls,"_error","I");
+    jfieldID registeredField = env->GetStaticFieldID(cls,"_registered","Z");
+
+    if(_busField == NULL || _errorField == NULL || registeredField == NULL ||
+       env->RegisterNatives(cls,_fastBusMethods,sizeof(_fastBusMethods) / sizeof(_fastBusMethods[0])) != 0)
+    {
+        env->ExceptionClear();
+        env->DeleteLocalRef(cls);
+        return JNI_VERSION_1_4;
+    }
+
+    env->SetStaticBooleanField(cls,registeredField,JNI_TRUE);
+    env->DeleteLocalRef(cls);
+    return JNI_VERSION_1_4;
+}
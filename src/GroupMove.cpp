@@ -0,0 +1,186 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "GroupMove.h"
+#include "DxTime.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+bool dxModelUnits(int modelNr,DxModelUnits& units)
+{
+    switch(modelNr)
+    {
+    case DX_TYPE_DX_113:
+    case DX_TYPE_DX_116:
+    case DX_TYPE_DX_117:
+    case DX_TYPE_AX_12W:
+    case DX_TYPE_AX_12:
+    case DX_TYPE_AX_18:
+    case DX_TYPE_RX_10:
+    case DX_TYPE_RX_24F:
+    case DX_TYPE_RX_28:
+    case DX_TYPE_RX_64:
+        units.range      = 0x3FF;
+        units.degrees    = 300.0;
+        units.rpmPerUnit = 0.111;
+        return true;
+    case DX_TYPE_EX_104:
+        units.range      = 0xFFF;
+        units.degrees    = 251.0;
+        units.rpmPerUnit = 0.111;
+        return true;
+    case DX_TYPE_MX_28:
+    case DX_TYPE_MX_64:
+    case DX_TYPE_MX_106:
+        units.range      = 0xFFF;
+        units.degrees    = 360.0;
+        units.rpmPerUnit = 0.114;
+        return true;
+    default:
+        return false;
+    }
+}
+
+GroupMove::GroupMove(DxBus* bus):
+    _bus(bus),
+    _readCount(0)
+{
+    for(int id=0;id < DX_BROADCAST_ID;id++)
+        _model[id] = -1;
+    reset();
+}
+
+void GroupMove::reset()
+{
+    for(int id=0;id < DX_BROADCAST_ID;id++)
+    {
+        _start[id] = -1;
+        _goal[id] = -1;
+        _speed[id] = -1;
+        _time[id] = 0;
+        _duration[id] = 0;
+    }
+}
+
+void GroupMove::setModel(int id,int modelNr)
+{
+    if(id >= 0 && id < DX_BROADCAST_ID)
+        _model[id] = modelNr;
+}
+
+int GroupMove::model(int id)
+{
+    if(id < 0 || id >= DX_BROADCAST_ID)
+        return -1;
+    if(_model[id] < 0)
+    {
+        _readCount++;
+        _model[id] = _bus->readWord(id,DX_CMD_MODELNR);
+    }
+    return _model[id];
+}
+
+int GroupMove::speed(int id)
+{
+    return id >= 0 && id < DX_BROADCAST_ID ? _speed[id] : -1;
+}
+
+int GroupMove::startPosition(int id)
+{
+    return id >= 0 && id < DX_BROADCAST_ID ? _start[id] : -1;
+}
+
+int GroupMove::knownPosition(int id,dx::uint64_t now)
+{
+    // a read after the last move knows better than the plan
+    int          pos = _bus->lastPosition(id);
+    dx::uint64_t readTime = _bus->lastUpdate(id);
+    if(_goal[id] < 0 || (pos >= 0 && readTime >= _time[id]))
+        return pos;
+
+    // where the last move should be by now
+    if(now >= _time[id] + _duration[id])
+        return _goal[id];
+    double t = (double)(now - _time[id]) / _duration[id];
+    return _start[id] + (int)std::floor((_goal[id] - _start[id]) * t + .5);
+}
+
+bool GroupMove::move(const int* idList,int idCount,const int* goalList,int duration)
+{
+    if(idCount <= 0 || duration <= 0)
+        return false;
+
+    dx::uint64_t               now = dxMicros();
+    std::vector<unsigned char> data(idCount * 4);
+    for(int i=0;i < idCount;i++)
+    {
+        int id = idList[i];
+        if(id < 0 || id >= DX_BROADCAST_ID)
+            return false;
+
+        DxModelUnits units;
+        if(!dxModelUnits(model(id),units))
+            return false;
+
+        int goal = std::max(0,std::min(units.range,goalList[i]));
+        int pos = knownPosition(id,now);
+        if(pos < 0)
+        {
+            _readCount++;
+            pos = _bus->readWord(id,DX_CMD_PRESENT_POS);
+            if(pos < 0)
+                return false;
+        }
+
+        // ticks -> turns per minute -> speed units, rounded up so nobody is
+        // late. 0 would be full speed
+        double turns = std::abs(goal - pos) * units.degrees / ((units.range + 1) * 360.0);
+        double rpm   = turns * 60000.0 / duration;
+        int    speed = (int)std::ceil(rpm / units.rpmPerUnit);
+        speed = std::max(1,std::min(0x3FF,speed));
+
+        _start[id] = pos;
+        _speed[id] = speed;
+
+        data[i * 4]     = goal & 0xFF;
+        data[i * 4 + 1] = (goal >> 8) & 0xFF;
+        data[i * 4 + 2] = speed & 0xFF;
+        data[i * 4 + 3] = (speed >> 8) & 0xFF;
+    }
+
+    if(!_bus->syncWrite(DX_CMD_GOAL_POS,4,idList,idCount,&data[0]))
+        return false;
+
+    // the move starts with the write, the position reads above are older
+    now = dxMicros();
+    for(int i=0;i < idCount;i++)
+    {
+        int id = idList[i];
+        _goal[id]     = data[i * 4] + (data[i * 4 + 1] << 8);
+        _time[id]     = now;
+        _duration[id] = (dx::uint64_t)duration * 1000;
+    }
+    return true;
+}
@@ -0,0 +1,195 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "IndirectTelemetry.h"
+
+#include <cstring>
+
+// register and size of the fields, in the order of the bits
+static const int fieldAddr[DX_TELEMETRY_FIELD_COUNT] =
+{
+    DX2_CMD_PRESENT_POS,
+    DX2_CMD_PRESENT_VELOCITY,
+    DX2_CMD_PRESENT_CURRENT,
+    DX2_CMD_PRESENT_INPUT_VOLT,
+    DX2_CMD_PRESENT_TEMP,
+    DX2_CMD_HARDWARE_ERROR
+};
+
+static const int fieldSize[DX_TELEMETRY_FIELD_COUNT] = { 4,4,2,2,1,1 };
+static const bool fieldSigned[DX_TELEMETRY_FIELD_COUNT] = { true,true,true,false,false,false };
+
+IndirectTelemetry::IndirectTelemetry(DxBus2* bus,int fields,int firstEntry):
+    _bus(bus),
+    _fields(fields & DX_TELEMETRY_ALL),
+    _firstEntry(firstEntry),
+    _windowLength(0),
+    _spanLength(0)
+{
+    int first = -1;
+    int last  = -1;
+    for(int i=0;i < DX_TELEMETRY_FIELD_COUNT;i++)
+    {
+        _offset[i] = -1;
+        if((_fields & (1 << i)) == 0)
+            continue;
+
+        _offset[i] = _windowLength;
+        _windowLength += fieldSize[i];
+
+        if(first < 0 || fieldAddr[i] < first)
+            first = fieldAddr[i];
+        if(fieldAddr[i] + fieldSize[i] > last)
+            last = fieldAddr[i] + fieldSize[i];
+    }
+    _spanLength = first < 0 ? 0 : last - first;
+
+    // the window has to fit into the indirect data
+    if(_firstEntry < 0 || _firstEntry + _windowLength > DX2_INDIRECT_COUNT)
+    {
+        _fields = 0;
+        _windowLength = 0;
+        for(int i=0;i < DX_TELEMETRY_FIELD_COUNT;i++)
+            _offset[i] = -1;
+    }
+
+    memset(_valid,0,sizeof(_valid));
+}
+
+bool IndirectTelemetry::setup(const int* idList,int idCount)
+{
+    if(idCount < 0)
+        return false;
+    if(idCount > DX_BROADCAST_ID)
+        idCount = DX_BROADCAST_ID;
+    _idList.assign(idList,idList + idCount);
+    _data.assign(_windowLength * idCount,0);
+    memset(_valid,0,sizeof(_valid));
+
+    if(_windowLength == 0)
+        return false;
+
+    // one indirect address per byte of the window
+    unsigned char table[DX2_INDIRECT_COUNT * 2];
+    int entry = 0;
+    for(int i=0;i < DX_TELEMETRY_FIELD_COUNT;i++)
+    {
+        if(_offset[i] < 0)
+            continue;
+        for(int b=0;b < fieldSize[i];b++,entry++)
+        {
+            table[entry * 2]     = (fieldAddr[i] + b) & 0xFF;
+            table[entry * 2 + 1] = (fieldAddr[i] + b) >> 8;
+        }
+    }
+
+    // one sync write, the servos don't answer it, so every table gets read back
+    int addr = DX2_CMD_INDIRECT_ADDR + _firstEntry * 2;
+    std::vector<unsigned char> dataList(idCount * _windowLength * 2);
+    for(int i=0;i < idCount;i++)
+        memcpy(&dataList[i * _windowLength * 2],table,_windowLength * 2);
+    if(idCount > 0 && _bus->syncWrite(addr,_windowLength * 2,&_idList[0],idCount,&dataList[0]) == false)
+        return false;
+
+    // the servos which refused it are left out, their window holds something else
+    std::vector<int> programmed;
+    unsigned char check[DX2_INDIRECT_COUNT * 2];
+    for(int i=0;i < idCount;i++)
+    {
+        if(_bus->readData(_idList[i],addr,_windowLength * 2,check) == false ||
+           memcmp(check,table,_windowLength * 2) != 0)
+        {   // sync write got ignored (torque on?), a single write reports why
+            if(_bus->writeData(_idList[i],addr,table,_windowLength * 2) == false)
+                continue;
+        }
+        programmed.push_back(_idList[i]);
+    }
+
+    _idList.swap(programmed);
+    _data.resize(_windowLength * _idList.size());
+    return (int)_idList.size() == idCount;
+}
+
+bool IndirectTelemetry::update()
+{
+    if(_idList.empty() || _windowLength == 0)
+        return false;
+
+    int read = _bus->syncRead(windowAddr(),_windowLength,&_idList[0],_idList.size(),&_data[0],_valid);
+    return read == (int)_idList.size();
+}
+
+bool IndirectTelemetry::update(int id)
+{
+    int i = index(id);
+    if(i < 0 || _windowLength == 0)
+        return false;
+
+    _valid[i] = _bus->readData(id,windowAddr(),_windowLength,&_data[i * _windowLength]);
+    return _valid[i];
+}
+
+int IndirectTelemetry::index(int id)
+{
+    for(size_t i=0;i < _idList.size();i++)
+    {
+        if(_idList[i] == id)
+            return i;
+    }
+    return -1;
+}
+
+bool IndirectTelemetry::valid(int id)
+{
+    int i = index(id);
+    return i >= 0 && _valid[i];
+}
+
+// little endian, sign extended, 0 if not read or not mapped
+int IndirectTelemetry::value(int id,int field)
+{
+    if(field < 0 || field >= DX_TELEMETRY_FIELD_COUNT)
+        return 0;
+
+    int i = index(id);
+    if(i < 0 || !_valid[i] || _offset[field] < 0)
+        return 0;
+
+    const unsigned char* p = &_data[i * _windowLength + _offset[field]];
+    int size = fieldSize[field];
+
+    dx::uint32_t v = 0;
+    for(int b=size - 1;b >= 0;b--)
+        v = (v << 8) | p[b];
+
+    if(fieldSigned[field] && size < 4 && (v & (1u << (size * 8 - 1))))
+        v |= ~0u << (size * 8);
+    return (dx::int32_t)v;
+}
+
+int IndirectTelemetry::position(int id) { return value(id,0); }
+int IndirectTelemetry::velocity(int id) { return value(id,1); }
+int IndirectTelemetry::current(int id) { return value(id,2); }
+int IndirectTelemetry::voltage(int id) { return value(id,3); }
+int IndirectTelemetry::temperature(int id) { return value(id,4); }
+int IndirectTelemetry::hardwareError(int id) { return value(id,5); }
@@ -0,0 +1,392 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "MemorySerial.h"
+#include "DxTime.h"
+
+#include <cmath>
+#include <cstring>
+
+MemorySerial::MemorySerial():
+    SerialBase(),
+    _requestPos(0),
+    _noise(0),
+    _noiseSeed(1),
+    _packetCount(0),
+    _wireTime(false)
+{
+    for(int i=0;i < DX_BROADCAST_ID;i++)
+    {
+        _table[i] = NULL;
+        _dropRate[i] = 0;
+        _corruptRate[i] = 0;
+    }
+
+    _reply.reserve(DX_MAX_PACKET_SIZE * 2);
+    open();
+}
+
+MemorySerial::~MemorySerial()
+{
+    close();
+    for(int i=0;i < DX_BROADCAST_ID;i++)
+        delete[] _table[i];
+}
+
+bool MemorySerial::open()
+{
+    _open = true;
+    _requestPos = 0;
+    _circularBuffer.clear();
+    return _open;
+}
+
+bool MemorySerial::setBaudRate(unsigned long baudRate)
+{
+    // same order as close(), the reads guard the buffer with _readMutex
+    dx::scoped_lock l1(_writeMutex);
+    dx::scoped_lock l2(_readMutex);
+
+    _baudRate = baudRate;
+    _requestPos = 0;
+    _circularBuffer.clear();
+    return true;
+}
+
+bool MemorySerial::listens(int id)
+{
+    if(!hasServo(id))
+        return false;
+    if(_baudRate == 0)
+        return true;
+
+    double rate = dxBaudRate(_table[id][DX_CMD_BAUDRATE]);
+    return std::fabs(rate - _baudRate) <= _baudRate * .03;
+}
+
+void MemorySerial::addServo(int id,int modelNr)
+{
+    if(id < 0 || id >= DX_BROADCAST_ID)
+        return;
+
+    dx::scoped_lock l(_writeMutex);
+
+    if(_table[id] == NULL)
+        _table[id] = new unsigned char[DX_CONTROL_TABLE_SIZE];
+    memset(_table[id],0,DX_CONTROL_TABLE_SIZE);
+
+    int range = (modelNr == DX_TYPE_MX_28 || modelNr == DX_TYPE_MX_64 ||
+                 modelNr == DX_TYPE_MX_106 || modelNr == DX_TYPE_EX_104) ? 0xFFF : 0x3FF;
+
+    // factory defaults
+    unsigned char* t = _table[id];
+    t[DX_CMD_MODELNR]             = modelNr & 0xFF;
+    t[DX_CMD_MODELNR + 1]         = (modelNr >> 8) & 0xFF;
+    t[DX_CMD_FIRMWARE]            = 1;
+    t[DX_CMD_ID]                  = id;
+    t[DX_CMD_BAUDRATE]            = 1;
+    t[DX_CMD_DELAYTIME]           = 250;
+    t[DX_CMD_CCW_ANGLE_LIMIT]     = range & 0xFF;
+    t[DX_CMD_CCW_ANGLE_LIMIT + 1] = range >> 8;
+    t[DX_CMD_HIGH_LIMIT_TEMP]     = 80;
+    t[DX_CMD_LOW_LIMIT_VOLT]      = 60;
+    t[DX_CMD_HIGH_LIMIT_VOLT]     = 140;
+    t[DX_CMD_MAX_TORQUE]          = 0xFF;
+    t[DX_CMD_MAX_TORQUE + 1]      = 0x03;
+    t[DX_CMD_STATUSRETURNLEVEL]   = 2;
+    t[DX_CMD_ALARM_LED]           = DX_ERROR_OVERHEAT | DX_ERROR_OVERLOAD;
+    t[DX_CMD_ALARM_SHUTDOWN]      = DX_ERROR_OVERHEAT | DX_ERROR_OVERLOAD;
+    t[DX_CMD_LIMIT_TORQUE]        = 0xFF;
+    t[DX_CMD_LIMIT_TORQUE + 1]    = 0x03;
+    t[DX_CMD_PRESENT_POS]         = (range / 2) & 0xFF;
+    t[DX_CMD_PRESENT_POS + 1]     = (range / 2) >> 8;
+    t[DX_CMD_GOAL_POS]            = t[DX_CMD_PRESENT_POS];
+    t[DX_CMD_GOAL_POS + 1]        = t[DX_CMD_PRESENT_POS + 1];
+    t[DX_CMD_PRESENT_VOLT]        = 120;
+    t[DX_CMD_PRESENT_TEMP]        = 30;
+}
+
+void MemorySerial::removeServo(int id)
+{
+    if(id < 0 || id >= DX_BROADCAST_ID)
+        return;
+
+    dx::scoped_lock l(_writeMutex);
+    delete[] _table[id];
+    _table[id] = NULL;
+}
+
+bool MemorySerial::hasServo(int id)
+{
+    return id >= 0 && id < DX_BROADCAST_ID && _table[id] != NULL;
+}
+
+int MemorySerial::reg(int id,int addr)
+{
+    if(!hasServo(id) || addr < 0 || addr >= DX_CONTROL_TABLE_SIZE)
+        return -1;
+    return _table[id][addr];
+}
+
+void MemorySerial::setReg(int id,int addr,int data)
+{
+    if(!hasServo(id) || addr < 0 || addr >= DX_CONTROL_TABLE_SIZE)
+        return;
+    _table[id][addr] = data & 0xFF;
+}
+
+int MemorySerial::regWord(int id,int addr)
+{
+    if(!hasServo(id) || addr < 0 || addr + 1 >= DX_CONTROL_TABLE_SIZE)
+        return -1;
+    return (_table[id][addr + 1] << 8) + _table[id][addr];
+}
+
+void MemorySerial::setRegWord(int id,int addr,int data)
+{
+    if(!hasServo(id) || addr < 0 || addr + 1 >= DX_CONTROL_TABLE_SIZE)
+        return;
+    _table[id][addr]     = data & 0xFF;
+    _table[id][addr + 1] = (data >> 8) & 0xFF;
+}
+
+void MemorySerial::setFaultRate(int id,double dropRate,double corruptRate)
+{
+    dx::scoped_lock l(_writeMutex);
+    for(int i=0;i < DX_BROADCAST_ID;i++)
+    {
+        if(id < 0 || id == i)
+        {
+            _dropRate[i] = dropRate;
+            _corruptRate[i] = corruptRate;
+        }
+    }
+}
+
+double MemorySerial::random()
+{
+    _noiseSeed = _noiseSeed * 1103515245 + 12345;
+    return ((_noiseSeed >> 8) & 0xFFFF) / 65536.0;
+}
+
+// spins, a sleep overshoots the few us of a byte
+void MemorySerial::wait(int bytes,int delay)
+{
+    if(!_wireTime || _baudRate == 0)
+        return;
+
+    dx::uint64_t until = dxMicros() + delay + (dx::uint64_t)bytes * 10 * 1000000 / _baudRate;
+    while(dxMicros() < until)
+        ;
+}
+
+void MemorySerial::send(const char* data,unsigned int len)
+{
+    wait(len,0);
+
+    // the java side writes byte by byte, so parse the stream
+    for(unsigned int i=0;i < len;i++)
+    {
+        unsigned char c = data[i];
+
+        if(_requestPos < 2)
+        {
+            _request[_requestPos] = c;
+            _requestPos = (c == DX_BEGIN) ? _requestPos + 1 : 0;
+            continue;
+        }
+
+        _request[_requestPos++] = c;
+        if(_requestPos < 4)
+            continue;
+
+        int length = _request[3];
+        if(length < 2)
+        {
+            _requestPos = 0;
+            continue;
+        }
+        if(_requestPos < length + 4)
+            continue;
+
+        // complete packet
+        _requestPos = 0;
+        if(DxBus::calcChecksum(_request + 2,length + 1) != _request[length + 3])
+            continue;
+
+        _packetCount++;
+        _reply.clear();
+        handlePacket(_request[2],_request[4],_request + 5,length - 2);
+        if(!_reply.empty())
+        {
+            // return delay register in 2us steps
+            int id = _request[2];
+            wait(_reply.size(),hasServo(id) ? _table[id][DX_CMD_DELAYTIME] * 2 : 0);
+            received((const char*)&_reply[0],_reply.size());
+        }
+    }
+}
+
+void MemorySerial::handlePacket(int id,int inst,const unsigned char* param,int paramLength)
+{
+    if(inst == DX_INST_SYNC_WRITE)
+    {
+        if(paramLength < 2)
+            return;
+
+        int addr   = param[0];
+        int length = param[1];
+        for(const unsigned char* p = param + 2;p + length < param + paramLength + 1;p += length + 1)
+        {
+            if(listens(*p) && addr + length <= DX_CONTROL_TABLE_SIZE)
+            {
+                memcpy(_table[*p] + addr,p + 1,length);
+                written(*p,addr,length);
+            }
+        }
+        return;
+    }
+
+    if(inst == DX_INST_BULK_READ)
+    {   // answers in the order of the list, a missing servo breaks the chain
+        for(const unsigned char* p = param + 1;p + 3 <= param + paramLength;p += 3)
+        {
+            if(!listens(p[1]))
+                break;
+            unsigned char read[2] = { p[2],p[0] };
+            handleServo(p[1],DX_INST_READ_DATA,read,2);
+        }
+        return;
+    }
+
+    if(id == DX_BROADCAST_ID)
+    {   // every servo executes, nobody answers
+        for(int i=0;i < DX_BROADCAST_ID;i++)
+        {
+            if(listens(i))
+            {
+                size_t replySize = _reply.size();
+                handleServo(i,inst,param,paramLength);
+                _reply.resize(replySize);
+            }
+        }
+        return;
+    }
+
+    if(listens(id))
+        handleServo(id,inst,param,paramLength);
+}
+
+void MemorySerial::handleServo(int id,int inst,const unsigned char* param,int paramLength)
+{
+    unsigned char* t = _table[id];
+    int statusLevel = t[DX_CMD_STATUSRETURNLEVEL];
+
+    switch(inst)
+    {
+    case DX_INST_PING:
+        reply(id,servoError(id),NULL,0);
+        break;
+    case DX_INST_READ_DATA:
+        if(paramLength != 2 || param[0] + param[1] > DX_CONTROL_TABLE_SIZE)
+        {
+            reply(id,DX_ERROR_INST,NULL,0);
+            break;
+        }
+        if(statusLevel >= 1)
+            reply(id,servoError(id),t + param[0],param[1]);
+        break;
+    case DX_INST_WRITE_DATA:
+    case DX_INST_REG_WRITE:
+        if(paramLength < 2 || param[0] + paramLength - 1 > DX_CONTROL_TABLE_SIZE)
+        {
+            reply(id,DX_ERROR_INST,NULL,0);
+            break;
+        }
+        if(inst == DX_INST_WRITE_DATA)
+        {
+            memcpy(t + param[0],param + 1,paramLength - 1);
+            written(id,param[0],paramLength - 1);
+        }
+        else
+        {
+            _regWrite[id].assign(param,param + paramLength);
+            t[DX_CMD_REGISTER] = 1;
+        }
+
+        if(statusLevel >= 2)
+            reply(id,servoError(id),NULL,0);
+
+        // new id
+        if(inst == DX_INST_WRITE_DATA && t[DX_CMD_ID] != id && t[DX_CMD_ID] < DX_BROADCAST_ID && _table[t[DX_CMD_ID]] == NULL)
+        {
+            _table[t[DX_CMD_ID]] = t;
+            _table[id] = NULL;
+            idChanged(id,t[DX_CMD_ID]);
+        }
+        break;
+    case DX_INST_ACTION:
+        if(!_regWrite[id].empty())
+        {
+            memcpy(t + _regWrite[id][0],&_regWrite[id][1],_regWrite[id].size() - 1);
+            written(id,_regWrite[id][0],_regWrite[id].size() - 1);
+            _regWrite[id].clear();
+            t[DX_CMD_REGISTER] = 0;
+        }
+        if(statusLevel >= 2)
+            reply(id,servoError(id),NULL,0);
+        break;
+    default:
+        reply(id,DX_ERROR_INST,NULL,0);
+        break;
+    }
+}
+
+void MemorySerial::reply(int id,int error,const unsigned char* param,int paramLength)
+{
+    if(_dropRate[id] > 0 && random() < _dropRate[id])
+        return;
+
+    // noise in front of the packet, never 0xff
+    for(int i=0;i < _noise;i++)
+    {
+        _noiseSeed = _noiseSeed * 1103515245 + 12345;
+        _reply.push_back((_noiseSeed >> 16) % 0xFF);
+    }
+
+    size_t start = _reply.size();
+    _reply.resize(start + paramLength + 6);
+
+    unsigned char* p = &_reply[start];
+    p[0] = DX_BEGIN;
+    p[1] = DX_BEGIN;
+    p[2] = id;
+    p[3] = paramLength + 2;
+    p[4] = error;
+    if(paramLength > 0)
+        memcpy(p + 5,param,paramLength);
+    p[5 + paramLength] = DxBus::calcChecksum(p + 2,paramLength + 3);
+
+    if(_corruptRate[id] > 0 && random() < _corruptRate[id])
+        p[5 + paramLength] ^= 0x5A;
+}
@@ -0,0 +1,174 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "MetricsServer.h"
+#include "DxTime.h"
+
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+
+using boost::asio::ip::tcp;
+
+MetricsServer::MetricsServer():
+    _acceptor(_io),
+    _running(false),
+    _port(0)
+{}
+
+MetricsServer::~MetricsServer()
+{
+    stop();
+}
+
+void MetricsServer::add(BusMetrics* metrics)
+{
+    boost::mutex::scoped_lock l(_listMutex);
+    if(std::find(_list.begin(),_list.end(),metrics) == _list.end())
+        _list.push_back(metrics);
+}
+
+void MetricsServer::remove(BusMetrics* metrics)
+{
+    boost::mutex::scoped_lock l(_listMutex);
+    _list.erase(std::remove(_list.begin(),_list.end(),metrics),_list.end());
+}
+
+bool MetricsServer::start(int port)
+{
+    if(_running)
+        return true;
+
+    try{
+        tcp::endpoint endpoint(boost::asio::ip::address_v4::loopback(),port);
+        _acceptor.open(endpoint.protocol());
+        _acceptor.set_option(tcp::acceptor::reuse_address(true));
+        _acceptor.bind(endpoint);
+        _acceptor.listen();
+    }
+    catch(std::exception& e)
+    {
+        std::cout << "MetricsServer Error: " << e.what() << std::endl;
+        boost::system::error_code ec;
+        _acceptor.close(ec);
+        return false;
+    }
+
+    _port = port;
+    _running = true;
+
+    boost::thread t(boost::bind(&MetricsServer::run,this));
+    _thread.swap(t);
+    return true;
+}
+
+void MetricsServer::stop()
+{
+    if(!_running)
+        return;
+
+    _running = false;
+
+    // wake up the blocking accept
+    boost::system::error_code ec;
+    tcp::socket socket(_io);
+    socket.connect(tcp::endpoint(boost::asio::ip::address_v4::loopback(),_port),ec);
+    socket.close(ec);
+
+    _thread.join();
+    _acceptor.close(ec);
+}
+
+void MetricsServer::run()
+{
+    while(_running)
+    {
+        tcp::socket socket(_io);
+        boost::system::error_code ec;
+
+        _acceptor.accept(socket,ec);
+        if(ec || !_running)
+            continue;
+
+        serve(socket);
+    }
+}
+
+void MetricsServer::serve(tcp::socket& socket)
+{
+    boost::system::error_code ec;
+
+    // the request itself doesn't matter, every path gets the metrics, but
+    // the headers are read up to the blank line. closing with unread bytes
+    // would reset the connection and the client could lose the response.
+    // polled without blocking, a silent client must neither stall the
+    // endpoint nor stop()
+    char        buffer[1024];
+    std::string request;
+    socket.non_blocking(true,ec);
+    if(ec)
+        return;
+
+    dx::uint64_t start = dxMicros();
+    while(request.find("\r\n\r\n") == std::string::npos &&
+          request.find("\n\n") == std::string::npos)
+    {
+        std::size_t len = socket.read_some(boost::asio::buffer(buffer,sizeof(buffer)),ec);
+        if(ec == boost::asio::error::would_block)
+        {
+            if(!_running || dxMicros() - start > DX_METRICS_READ_TIMEOUT * 1000)
+                return;
+            dx::sleep(5);
+            continue;
+        }
+        if(ec == boost::asio::error::eof)
+            break;      // the client is done sending, answer anyway
+        if(ec)
+            return;
+
+        request.append(buffer,len);
+        if(request.size() > DX_METRICS_MAX_REQUEST)
+            return;
+    }
+    socket.non_blocking(false,ec);
+
+    std::ostringstream body;
+    {
+        boost::mutex::scoped_lock l(_listMutex);
+        BusMetrics::write(body,_list);
+    }
+
+    std::string bodyStr = body.str();
+    std::ostringstream response;
+    response << "HTTP/1.0 200 OK\r\n"
+             << "Content-Type: text/plain; version=0.0.4\r\n"
+             << "Content-Length: " << bodyStr.size() << "\r\n"
+             << "Connection: close\r\n"
+             << "\r\n"
+             << bodyStr;
+
+    std::string responseStr = response.str();
+    boost::asio::write(socket,boost::asio::buffer(responseStr),ec);
+    socket.shutdown(tcp::socket::shutdown_both,ec);
+    socket.close(ec);
+}
@@ -0,0 +1,188 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "ReturnDelayOptimizer.h"
+#include "DxTime.h"
+
+#include <algorithm>
+
+static const int defaultCandidates[] = { 250,160,100,50,25,10,5,2,1,0 };
+
+ReturnDelayOptimizer::ReturnDelayOptimizer(DxBus* bus):
+    _bus(bus),
+    _samples(DX_DELAY_DEFAULT_SAMPLES),
+    _maxErrorRate(0),
+    _candidates(defaultCandidates,defaultCandidates + sizeof(defaultCandidates) / sizeof(int))
+{
+}
+
+void ReturnDelayOptimizer::setCandidates(const int* valueList,int count)
+{
+    _candidates.assign(valueList,valueList + count);
+    std::sort(_candidates.begin(),_candidates.end());
+    std::reverse(_candidates.begin(),_candidates.end());
+}
+
+double ReturnDelayOptimizer::measure(int id,double& latency)
+{
+    unsigned char data[2];
+    int           errors = 0;
+    dx::uint64_t  time = 0;
+    for(int i=0;i < _samples;i++)
+    {
+        dx::uint64_t start = dxMicros();
+        if(_bus->readData(id,DX_CMD_PRESENT_POS,2,data))
+            time += dxMicros() - start;
+        else
+            errors++;
+    }
+
+    latency = errors < _samples ? (double)time / (_samples - errors) : 0;
+    return (double)errors / _samples;
+}
+
+bool ReturnDelayOptimizer::setDelay(int id,int delay)
+{
+    // the status may get lost at a too short delay, the write happened anyway
+    _bus->writeByte(id,DX_CMD_DELAYTIME,delay);
+    return _bus->readByte(id,DX_CMD_DELAYTIME) == delay;
+}
+
+bool ReturnDelayOptimizer::optimize(const int* idList,int idCount,bool uniform)
+{
+    // every lost reply has to count
+    int retries = _bus->retries();
+    _bus->setRetries(0);
+
+    bool ret = true;
+    _results.clear();
+    for(int i=0;i < idCount;i++)
+    {
+        Result r;
+        r.id         = idList[i];
+        r.oldDelay   = _bus->readByte(r.id,DX_CMD_DELAYTIME);
+        r.newDelay   = r.oldDelay;
+        r.oldLatency = 0;
+        r.newLatency = 0;
+        if(r.oldDelay < 0 || measure(r.id,r.oldLatency) > _maxErrorRate)
+        {
+            ret = false;
+            _results.push_back(r);
+            continue;
+        }
+
+        // down till the replies get lost
+        for(size_t c=0;c < _candidates.size();c++)
+        {
+            int delay = _candidates[c];
+            if(delay >= r.oldDelay)
+                continue;
+
+            double latency;
+            if(!setDelay(r.id,delay) || measure(r.id,latency) > _maxErrorRate)
+                break;
+            r.newDelay = delay;
+        }
+        _results.push_back(r);
+    }
+
+    // the slowest servo sets the pace of the chain
+    if(uniform)
+    {
+        int delay = 0;
+        for(size_t i=0;i < _results.size();i++)
+            delay = std::max(delay,_results[i].newDelay);
+        for(size_t i=0;i < _results.size();i++)
+        {
+            if(_results[i].oldDelay >= 0)
+                _results[i].newDelay = delay;
+        }
+    }
+
+    for(size_t i=0;i < _results.size();i++)
+    {
+        Result& r = _results[i];
+        if(r.oldDelay < 0)
+            continue;
+        if(!setDelay(r.id,r.newDelay))
+        {
+            // back to the value it worked with before
+            setDelay(r.id,r.oldDelay);
+            r.newDelay = r.oldDelay;
+            ret = false;
+        }
+        measure(r.id,r.newLatency);
+    }
+
+    _bus->setRetries(retries);
+    return ret;
+}
+
+int ReturnDelayOptimizer::id(int index)
+{
+    return index >= 0 && index < (int)_results.size() ? _results[index].id : -1;
+}
+
+int ReturnDelayOptimizer::oldDelay(int index)
+{
+    return index >= 0 && index < (int)_results.size() ? _results[index].oldDelay : -1;
+}
+
+int ReturnDelayOptimizer::newDelay(int index)
+{
+    return index >= 0 && index < (int)_results.size() ? _results[index].newDelay : -1;
+}
+
+double ReturnDelayOptimizer::oldLatency(int index)
+{
+    return index >= 0 && index < (int)_results.size() ? _results[index].oldLatency : 0;
+}
+
+double ReturnDelayOptimizer::newLatency(int index)
+{
+    return index >= 0 && index < (int)_results.size() ? _results[index].newLatency : 0;
+}
+
+double ReturnDelayOptimizer::oldLatency()
+{
+    double sum = 0;
+    for(size_t i=0;i < _results.size();i++)
+        sum += _results[i].oldLatency;
+    return _results.empty() ? 0 : sum / _results.size();
+}
+
+double ReturnDelayOptimizer::newLatency()
+{
+    double sum = 0;
+    for(size_t i=0;i < _results.size();i++)
+        sum += _results[i].newLatency;
+    return _results.empty() ? 0 : sum / _results.size();
+}
+
+double ReturnDelayOptimizer::expectedSavedTime()
+{
+    double sum = 0;
+    for(size_t i=0;i < _results.size();i++)
+        sum += (_results[i].oldDelay - _results[i].newDelay) * DX_DELAY_UNIT;
+    return _results.empty() ? 0 : sum / _results.size();
+}
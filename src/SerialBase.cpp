@@ -22,13 +22,382 @@
  */
 
 #include "SerialBase.h"
+#include "DxProbes.h"
 
 #include <iostream>
 
-#ifndef USE_ASIO_SERIAL_LIB
+bool SerialBase::setBaudRate(unsigned long baudRate)
+{
+    if(!_open || _portName.empty())
+        return false;
+    if(baudRate == _baudRate)
+        return true;
+
+    // the port closes, the bytes on the way are lost
+    std::string portName = _portName;
+    close();
+    return open(portName.c_str(),baudRate);
+}
+
+// reads from the circular buffer, which gets filled by received()
+int SerialBase::readBuffered(unsigned char* data,int len,int timeout)
+{
+    dx::scoped_lock l(_readMutex);
+
+    dx::system_time deadline = dx::deadline(timeout);
+    int count = 0;
+    while(count < len)
+    {
+        // wait till the io thread delivers more data
+        while(_circularBuffer.empty())
+        {
+            if(dx::timed_wait(_readCond,l,deadline) == false && _circularBuffer.empty())
+                return count;
+        }
+
+        while(count < len && !_circularBuffer.empty())
+        {
+            data[count++] = (unsigned char)_circularBuffer.front();
+            _circularBuffer.pop_front();
+        }
+    }
+
+    return count;
+}
+
+#if defined(DX_LITE)
+
+// raw termios, no io thread and no exceptions, the reads poll the fd
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <cerrno>
+#include <cstring>
+
+static speed_t baudToSpeed(unsigned long baudRate)
+{
+    switch(baudRate)
+    {
+    case 9600:      return B9600;
+    case 19200:     return B19200;
+    case 38400:     return B38400;
+    case 57600:     return B57600;
+    case 115200:    return B115200;
+    case 230400:    return B230400;
+#ifdef B460800
+    case 460800:    return B460800;
+#endif
+#ifdef B500000
+    case 500000:    return B500000;
+#endif
+#ifdef B921600
+    case 921600:    return B921600;
+#endif
+#ifdef B1000000
+    case 1000000:   return B1000000;
+#endif
+#ifdef B2000000
+    case 2000000:   return B2000000;
+#endif
+#ifdef B3000000
+    case 3000000:   return B3000000;
+#endif
+#ifdef B4000000
+    case 4000000:   return B4000000;
+#endif
+    default:        return B0;
+    }
+}
+
+// ms till the deadline, 0 if it passed
+static int remaining(const dx::system_time& deadline)
+{
+    dx::system_time now = std::chrono::steady_clock::now();
+    if(now >= deadline)
+        return 0;
+    return (int)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count() + 1;
+}
 
 SerialBase::SerialBase():
     _open(false),
+    _baudRate(0),
+    _circularBuffer(MAX_BUFFER_SIZE),
+    _fd(-1),
+    _readBlock(false),
+    _readBlockCount(0)
+{}
+
+SerialBase::~SerialBase()
+{
+    close();
+}
+
+
+bool SerialBase::open(const char* serialPortName,unsigned long baudRate)
+{
+    if(_open)
+        return true;
+
+    speed_t speed = baudToSpeed(baudRate);
+    if(speed == B0)
+    {
+        std::cout << "SerialBase Error: baudrate " << baudRate << " is not supported" << std::endl;
+        return false;
+    }
+
+    int fd = ::open(serialPortName,O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if(fd < 0)
+    {
+        std::cout << "SerialBase Error: " << serialPortName << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct termios tio;
+    if(tcgetattr(fd,&tio) != 0)
+    {
+        std::cout << "SerialBase Error: " << serialPortName << ": " << strerror(errno) << std::endl;
+        ::close(fd);
+        return false;
+    }
+
+    // 8N1, no flow control, reads return at once
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~CSTOPB;
+#ifdef CRTSCTS
+    tio.c_cflag &= ~CRTSCTS;
+#endif
+    tio.c_cc[VMIN]  = 0;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio,speed);
+    cfsetospeed(&tio,speed);
+
+    if(tcsetattr(fd,TCSANOW,&tio) != 0)
+    {
+        std::cout << "SerialBase Error: " << serialPortName << ": " << strerror(errno) << std::endl;
+        ::close(fd);
+        return false;
+    }
+    tcflush(fd,TCIOFLUSH);
+
+    _fd = fd;
+    _open = true;
+    _portName = serialPortName;
+    _baudRate = baudRate;
+    _circularBuffer.clear();
+    return _open;
+}
+
+void SerialBase::close()
+{
+    // same order as send() in derived transports, which deliver the reply
+    dx::scoped_lock l1(_writeMutex);
+    dx::scoped_lock l2(_readMutex);
+
+    if(_fd >= 0)
+    {
+        ::close(_fd);
+        _fd = -1;
+    }
+
+    _circularBuffer.clear();
+    _open = false;
+}
+
+int SerialBase::available()
+{
+    dx::scoped_lock l(_readMutex);
+
+    if(_fd < 0)
+        return _circularBuffer.size();
+
+    int count = 0;
+    if(ioctl(_fd,FIONREAD,&count) != 0)
+        return 0;
+    return count;
+}
+
+void SerialBase::write(unsigned char byte)
+{
+    if(!_open)
+        return;
+
+    dx::scoped_lock l(_writeMutex);
+
+    send((const char*)&byte,1);
+}
+
+void SerialBase::write(int byte)
+{
+    write((unsigned char)byte);
+}
+
+void SerialBase::write(const std::string& str)
+{
+    if(!_open)
+        return;
+
+    dx::scoped_lock l(_writeMutex);
+
+    send(str.data(),str.size());
+}
+
+void SerialBase::write(const unsigned char* data,int len)
+{
+    if(!_open)
+        return;
+
+    dx::scoped_lock l(_writeMutex);
+
+    send((const char*)data,len);
+}
+
+void SerialBase::send(const char* data,unsigned int len)
+{
+    unsigned int count = 0;
+    int error = 0;
+    while(count < len)
+    {
+        ssize_t ret = ::write(_fd,data + count,len - count);
+        if(ret > 0)
+        {
+            count += ret;
+            continue;
+        }
+        if(ret < 0 && errno != EAGAIN && errno != EINTR)
+        {
+            error = errno;
+            break;
+        }
+
+        // tx queue of the driver is full
+        struct pollfd pfd = { _fd,POLLOUT,0 };
+        if(poll(&pfd,1,1000) <= 0)
+        {
+            error = ETIMEDOUT;
+            break;
+        }
+    }
+
+    DX_PROBE2(serial_write_end,count,error);
+}
+
+int SerialBase::read()
+{
+    if(!_open)
+        return 0;
+
+    unsigned char data = 0;
+    if(_fd < 0)
+    {   // derived in memory transports
+        readBuffered(&data,1,0);
+        return (int)data;
+    }
+
+    dx::scoped_lock l(_readMutex);
+
+    ssize_t ret = ::read(_fd,&data,1);
+    DX_PROBE2(serial_read_end,ret > 0 ? ret : 0,ret < 0 ? errno : 0);
+    if(ret != 1)
+        return 0;
+    return (int)data;
+}
+
+int SerialBase::read(unsigned char* data,int len,int timeout)
+{
+    if(!_open)
+        return 0;
+
+    if(_fd < 0)
+        return readBuffered(data,len,timeout);
+
+    dx::scoped_lock l(_readMutex);
+
+    dx::system_time deadline = dx::deadline(timeout);
+    int count = 0;
+    int error = 0;
+    while(count < len)
+    {
+        ssize_t ret = ::read(_fd,data + count,len - count);
+        if(ret > 0)
+        {
+            count += ret;
+            continue;
+        }
+        if(ret < 0 && errno != EAGAIN && errno != EINTR)
+        {
+            error = errno;
+            break;
+        }
+
+        struct pollfd pfd = { _fd,POLLIN,0 };
+        if(poll(&pfd,1,remaining(deadline)) <= 0)
+            break;
+    }
+
+    DX_PROBE2(serial_read_end,count,error);
+    return count;
+}
+
+
+void SerialBase::clear()
+{
+    dx::scoped_lock l(_readMutex);
+
+    if(_fd >= 0)
+        tcflush(_fd,TCIFLUSH);
+    _circularBuffer.clear();
+}
+
+void SerialBase::setReadBlock(bool enable)
+{
+    dx::scoped_lock l(_readMutex);
+    _readBlock = enable;
+}
+
+bool SerialBase::readBlock()
+{
+    dx::scoped_lock l(_readMutex);
+    return _readBlock;
+}
+
+void SerialBase::setReadBlockCount(int count)
+{
+    dx::scoped_lock l(_readMutex);
+    _readBlockCount = count;
+}
+
+void SerialBase::addReadBlockCount(int count)
+{
+    dx::scoped_lock l(_readMutex);
+    _readBlockCount += count;
+}
+
+int  SerialBase::readBlockCount()
+{
+    dx::scoped_lock l(_readMutex);
+    return _readBlockCount;
+}
+
+void SerialBase::received(const char *data, unsigned int len)
+{
+    dx::scoped_lock l(_readMutex);
+
+    for(int i=0;i < len;i++)
+        _circularBuffer.push_back(data[i]);
+
+    DX_PROBE2(serial_received,len,_circularBuffer.size());
+    _readCond.notify_all();
+}
+
+#elif !defined(USE_ASIO_SERIAL_LIB)
+
+SerialBase::SerialBase():
+    _open(false),
+    _baudRate(0),
     _serialPort(NULL),
     _serial(NULL),
     _circularBuffer(MAX_BUFFER_SIZE),
@@ -54,14 +423,17 @@ bool SerialBase::open(const char* serialPortName,unsigned long baudRate)
         return false;
 
     _open = true;
+    _portName = serialPortName;
+    _baudRate = baudRate;
     _circularBuffer.clear();
     return _open;
 }
 
 void SerialBase::close()
 {
-    boost::mutex::scoped_lock l1(_readMutex);
-    boost::mutex::scoped_lock l2(_writeMutex);
+    // same order as send() in derived transports, which deliver the reply
+    dx::scoped_lock l1(_writeMutex);
+    dx::scoped_lock l2(_readMutex);
 
     if(_serial)
     {
@@ -76,8 +448,10 @@ void SerialBase::close()
 
 int SerialBase::available()
 {
-    boost::mutex::scoped_lock l(_readMutex);
+    dx::scoped_lock l(_readMutex);
 
+    if(_serial == NULL)
+        return _circularBuffer.size();
     return _serial->available();
 }
 
@@ -86,15 +460,14 @@ void SerialBase::write(unsigned char byte)
     if(!_open)
         return;
 
-    boost::mutex::scoped_lock l(_writeMutex);
+    dx::scoped_lock l(_writeMutex);
 
-    _serial->write (&byte,1);
+    send((const char*)&byte,1);
 }
 
 void SerialBase::write(int byte)
 {
-    uint8_t data = byte;
-    _serial->write (&data,1);
+    write((unsigned char)byte);
 }
 
 void SerialBase::write(const std::string& str)
@@ -102,74 +475,128 @@ void SerialBase::write(const std::string& str)
     if(!_open)
         return;
 
-    boost::mutex::scoped_lock l(_writeMutex);
+    dx::scoped_lock l(_writeMutex);
 
   //  _serialPort->writeString(str);
 }
 
+void SerialBase::write(const unsigned char* data,int len)
+{
+    if(!_open)
+        return;
+
+    dx::scoped_lock l(_writeMutex);
+
+    send((const char*)data,len);
+}
+
+void SerialBase::send(const char* data,unsigned int len)
+{
+    size_t count = _serial->write((const uint8_t*)data,len);
+    DX_PROBE2(serial_write_end,count,0);
+}
+
 int SerialBase::read()
 {
     if(!_open)
         return 0;
 
-    boost::mutex::scoped_lock l(_readMutex);
+    if(_serial == NULL)
+    {   // derived in memory transports
+        unsigned char data = 0;
+        readBuffered(&data,1,0);
+        return (int)data;
+    }
+
+    dx::scoped_lock l(_readMutex);
 
     uint8_t data = 0;
-    _serial->read(&data,1);
+    size_t count = _serial->read(&data,1);
+    DX_PROBE2(serial_read_end,count,0);
 
     return (int)data;
 }
 
+int SerialBase::read(unsigned char* data,int len,int timeout)
+{
+    if(!_open)
+        return 0;
+
+    if(_serial == NULL)
+        return readBuffered(data,len,timeout);
+
+    dx::scoped_lock l(_readMutex);
+
+    // the serial lib blocks for its own timeout per call
+    dx::system_time deadline = dx::deadline(timeout);
+    int count = 0;
+    while(count < len)
+    {
+        count += _serial->read(data + count,len - count);
+        if(count < len && dx::expired(deadline))
+            break;
+    }
+
+    DX_PROBE2(serial_read_end,count,0);
+    return count;
+}
+
 
 void SerialBase::clear()
 {
-    boost::mutex::scoped_lock l(_readMutex);
+    dx::scoped_lock l(_readMutex);
 
-    _serial->flush();
+    if(_serial)
+        _serial->flush();
+    _circularBuffer.clear();
 }
 
 void SerialBase::setReadBlock(bool enable)
 {
-    boost::mutex::scoped_lock l(_readMutex);
+    dx::scoped_lock l(_readMutex);
     _readBlock = enable;
 }
 
 bool SerialBase::readBlock()
 {
-    boost::mutex::scoped_lock l(_readMutex);
+    dx::scoped_lock l(_readMutex);
     return _readBlock;
 }
 
 void SerialBase::setReadBlockCount(int count)
 {
-    boost::mutex::scoped_lock l(_readMutex);
+    dx::scoped_lock l(_readMutex);
     _readBlockCount = count;
 }
 
 void SerialBase::addReadBlockCount(int count)
 {
-    boost::mutex::scoped_lock l(_readMutex);
+    dx::scoped_lock l(_readMutex);
     _readBlockCount += count;
 }
 
 int  SerialBase::readBlockCount()
 {
-    boost::mutex::scoped_lock l(_readMutex);
+    dx::scoped_lock l(_readMutex);
     return _readBlockCount;
 }
 
 void SerialBase::received(const char *data, unsigned int len)
 {
-    boost::mutex::scoped_lock l(_readMutex);
+    dx::scoped_lock l(_readMutex);
 
     for(int i=0;i < len;i++)
         _circularBuffer.push_back(data[i]);
+
+    DX_PROBE2(serial_received,len,_circularBuffer.size());
+    _readCond.notify_all();
 }
 
 #else
 
 SerialBase::SerialBase():
     _open(false),
+    _baudRate(0),
     _serialPort(NULL),
     _circularBuffer(MAX_BUFFER_SIZE),
     _readBlock(false),
@@ -197,14 +624,17 @@ bool SerialBase::open(const char* serialPortName,unsigned long baudRate)
     }
 
     _open = true;
+    _portName = serialPortName;
+    _baudRate = baudRate;
     _circularBuffer.clear();
     return _open;
 }
 
 void SerialBase::close()
 {
-    boost::mutex::scoped_lock l1(_readMutex);
-    boost::mutex::scoped_lock l2(_writeMutex);
+    // same order as send() in derived transports, which deliver the reply
+    dx::scoped_lock l1(_writeMutex);
+    dx::scoped_lock l2(_readMutex);
 
     if(_serialPort)
     {
@@ -219,7 +649,7 @@ void SerialBase::close()
 
 int SerialBase::available()
 {
-    boost::mutex::scoped_lock l(_readMutex);
+    dx::scoped_lock l(_readMutex);
 
     return _circularBuffer.size();
 }
@@ -229,9 +659,9 @@ void SerialBase::write(unsigned char byte)
     if(!_open)
         return;
 
-    boost::mutex::scoped_lock l(_writeMutex);
+    dx::scoped_lock l(_writeMutex);
 
-    _serialPort->write((char*)&byte,1);
+    send((const char*)&byte,1);
 }
 
 void SerialBase::write(int byte)
@@ -244,9 +674,24 @@ void SerialBase::write(const std::string& str)
     if(!_open)
         return;
 
-    boost::mutex::scoped_lock l(_writeMutex);
+    dx::scoped_lock l(_writeMutex);
+
+    send(str.data(),str.size());
+}
+
+void SerialBase::write(const unsigned char* data,int len)
+{
+    if(!_open)
+        return;
+
+    dx::scoped_lock l(_writeMutex);
+
+    send((const char*)data,len);
+}
 
-    _serialPort->writeString(str);
+void SerialBase::send(const char* data,unsigned int len)
+{
+    _serialPort->write(data,len);
 }
 
 int SerialBase::read()
@@ -254,55 +699,63 @@ int SerialBase::read()
     if(!_open)
         return 0;
 
-    boost::mutex::scoped_lock l(_readMutex);
+    dx::scoped_lock l(_readMutex);
 
     unsigned char ret = _circularBuffer.front();
     _circularBuffer.pop_front();
     return (int)ret;
 }
 
+int SerialBase::read(unsigned char* data,int len,int timeout)
+{
+    if(!_open)
+        return 0;
+
+    return readBuffered(data,len,timeout);
+}
+
 
 void SerialBase::clear()
 {
-    boost::mutex::scoped_lock l(_readMutex);
+    dx::scoped_lock l(_readMutex);
 
     _circularBuffer.clear();
 }
 
 void SerialBase::setReadBlock(bool enable)
 {
-    boost::mutex::scoped_lock l(_readMutex);
+    dx::scoped_lock l(_readMutex);
     std::cout << "setReadBlock :"<< enable << std::endl;
     _readBlock = enable;
 }
 
 bool SerialBase::readBlock()
 {
-    boost::mutex::scoped_lock l(_readMutex);
+    dx::scoped_lock l(_readMutex);
     return _readBlock;
 }
 
 void SerialBase::setReadBlockCount(int count)
 {
-    boost::mutex::scoped_lock l(_readMutex);
+    dx::scoped_lock l(_readMutex);
     _readBlockCount = count;
 }
 
 void SerialBase::addReadBlockCount(int count)
 {
-    boost::mutex::scoped_lock l(_readMutex);
+    dx::scoped_lock l(_readMutex);
     _readBlockCount += count;
 }
 
 int  SerialBase::readBlockCount()
 {
-    boost::mutex::scoped_lock l(_readMutex);
+    dx::scoped_lock l(_readMutex);
     return _readBlockCount;
 }
 
 void SerialBase::received(const char *data, unsigned int len)
 {
-    boost::mutex::scoped_lock l(_readMutex);
+    dx::scoped_lock l(_readMutex);
 
 
 //    int startIndex = 0;
@@ -341,6 +794,8 @@ void SerialBase::received(const char *data, unsigned int len)
     for(int i=0;i < len;i++)
         _circularBuffer.push_back(data[i]);
 
+    DX_PROBE2(serial_received,len,_circularBuffer.size());
+    _readCond.notify_all();
 }
 
 #endif
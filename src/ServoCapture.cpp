@@ -0,0 +1,148 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "ServoCapture.h"
+#include "DxTime.h"
+
+#include <algorithm>
+
+ServoCapture::ServoCapture(DxBus* bus,int maxSamples):
+    _bus(bus),
+    _maxSamples(0),
+    _sampleCount(0),
+    _errorCount(0),
+    _duration(0.0f)
+{
+    setMaxSamples(maxSamples);
+}
+
+ServoCapture::~ServoCapture()
+{}
+
+bool ServoCapture::setMaxSamples(int maxSamples)
+{
+    if(maxSamples < 0)
+        return false;
+
+    // allocate everything before the capture, so the read loop never allocates
+    _maxSamples = maxSamples;
+    _time.resize(maxSamples);
+    _id.resize(maxSamples);
+    _pos.resize(maxSamples);
+    _speed.resize(maxSamples);
+    _load.resize(maxSamples);
+
+    _sampleCount = 0;
+    return true;
+}
+
+bool ServoCapture::capture(int* idList,int idCount,int* goalList,int duration)
+{
+    _sampleCount = 0;
+    _errorCount = 0;
+    _duration = 0.0f;
+
+    if(_bus == NULL || idCount <= 0 || _maxSamples <= 0)
+        return false;
+
+    // step
+    if(goalList)
+    {
+        std::vector<unsigned char> data(idCount * 2);
+        for(int i=0;i < idCount;i++)
+        {
+            data[i*2]     = goalList[i] & 0x00FF;
+            data[i*2 + 1] = (goalList[i] & 0xFF00) >> 8;
+        }
+
+        if(_bus->syncWrite(DX_CMD_GOAL_POS,2,idList,idCount,&data[0]) == false)
+            return false;
+    }
+
+    // pos, speed and load are in a row, so one read per sample
+    unsigned char          data[6];
+    dx::uint64_t           startTime = dxMicros();
+    dx::uint64_t           endTime = startTime + (dx::uint64_t)duration * 1000;
+    dx::uint64_t           curTime = startTime;
+    int                    index = 0;
+
+    while(_sampleCount < _maxSamples && curTime < endTime)
+    {
+        int id = idList[index];
+        index = (index + 1) % idCount;
+
+        dx::uint64_t requestTime = dxMicros();
+        bool ret = _bus->readData(id,DX_CMD_PRESENT_POS,6,data);
+        curTime = dxMicros();
+
+        if(ret == false)
+        {
+            _errorCount++;
+            continue;
+        }
+
+        // the servo samples somewhere in the transaction, the middle is
+        // closer than the end of the reply
+        _time[_sampleCount]  = ((requestTime + curTime) / 2 - startTime) * .001f;
+        _id[_sampleCount]    = id;
+        _pos[_sampleCount]   = (data[1] << 8) + data[0];
+        _speed[_sampleCount] = (data[3] << 8) + data[2];
+        _load[_sampleCount]  = (data[5] << 8) + data[4];
+        _sampleCount++;
+    }
+
+    _duration = (curTime - startTime) * .001f;
+    return _sampleCount > 0;
+}
+
+float ServoCapture::sampleRate()
+{
+    if(_duration <= 0.0f)
+        return 0.0f;
+    return _sampleCount / (_duration * .001f);
+}
+
+void ServoCapture::getTime(float* time)
+{
+    std::copy(_time.begin(),_time.begin() + _sampleCount,time);
+}
+
+void ServoCapture::getId(int* id)
+{
+    std::copy(_id.begin(),_id.begin() + _sampleCount,id);
+}
+
+void ServoCapture::getPosition(int* pos)
+{
+    std::copy(_pos.begin(),_pos.begin() + _sampleCount,pos);
+}
+
+void ServoCapture::getSpeed(int* speed)
+{
+    std::copy(_speed.begin(),_speed.begin() + _sampleCount,speed);
+}
+
+void ServoCapture::getLoad(int* load)
+{
+    std::copy(_load.begin(),_load.begin() + _sampleCount,load);
+}
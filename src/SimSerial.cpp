@@ -0,0 +1,405 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "SimSerial.h"
+#include "DxTime.h"
+
+#include <cmath>
+#include <algorithm>
+
+#define  SIM_MAX_STEP               (0.001)     // s
+#define  SIM_HEAT_RATE              (1.0)       // celsius/s at stall torque
+#define  SIM_COOL_TAU               (600.0)     // s
+#define  SIM_OVERHEAT_HYSTERESIS    (5.0)       // celsius
+
+static double clamp(double value,double minValue,double maxValue)
+{
+    return std::max(minValue,std::min(maxValue,value));
+}
+
+// true if the written range contains the register
+static bool covers(int addr,int length,int reg)
+{
+    return reg >= addr && reg < addr + length;
+}
+
+SimServoState::SimServoState():
+    pos(0),
+    vel(0),
+    temp(0),
+    extTorque(0),
+    load(0),
+    hwError(DX_ERROR_NO),
+    instError(DX_ERROR_NO),
+    ticksPerRev(4096),
+    noLoadRpm(55),
+    speedUnit(0.114),
+    range(0xFFF)
+{}
+
+SimSerial::SimSerial(double timeScale):
+    MemorySerial(),
+    _timeScale(timeScale),
+    _simTime(0),
+    _lastUpdate(dxMicros()),
+    _voltage(12.0),
+    _ambientTemp(30.0),
+    _tau(0.05)
+{
+    for(int i=0;i < DX_BROADCAST_ID;i++)
+        _sim[i] = NULL;
+}
+
+SimSerial::~SimSerial()
+{
+    for(int i=0;i < DX_BROADCAST_ID;i++)
+        delete _sim[i];
+}
+
+void SimSerial::addServo(int id,int modelNr)
+{
+    MemorySerial::addServo(id,modelNr);
+    if(!hasServo(id))
+        return;
+
+    dx::scoped_lock l(_writeMutex);
+
+    if(_sim[id] == NULL)
+        _sim[id] = new SimServoState();
+    SimServoState& s = *_sim[id];
+    s = SimServoState();
+
+    // no load speed at 12V
+    switch(modelNr)
+    {
+    case DX_TYPE_MX_28:
+        s.noLoadRpm = 55;
+        break;
+    case DX_TYPE_MX_64:
+        s.noLoadRpm = 63;
+        break;
+    case DX_TYPE_MX_106:
+        s.noLoadRpm = 45;
+        break;
+    case DX_TYPE_EX_104:
+        s.ticksPerRev = 4096 * 360 / 250.92;
+        s.noLoadRpm = 73;
+        s.speedUnit = 0.111;
+        break;
+    default:
+        // ax, rx, dx: 1024 ticks over 300 degrees
+        s.ticksPerRev = 1024 * 360 / 300.0;
+        s.noLoadRpm = modelNr == DX_TYPE_AX_18 ? 97 : 59;
+        s.speedUnit = 0.111;
+        s.range = 0x3FF;
+        break;
+    }
+
+    s.pos  = regWord(id,DX_CMD_PRESENT_POS);
+    s.temp = _ambientTemp;
+    updateRegisters(id,s);
+}
+
+void SimSerial::removeServo(int id)
+{
+    MemorySerial::removeServo(id);
+    if(id < 0 || id >= DX_BROADCAST_ID)
+        return;
+
+    dx::scoped_lock l(_writeMutex);
+    delete _sim[id];
+    _sim[id] = NULL;
+}
+
+void SimSerial::setTimeScale(double timeScale)
+{
+    dx::scoped_lock l(_writeMutex);
+    update();
+    _timeScale = timeScale;
+}
+
+void SimSerial::step(double seconds)
+{
+    dx::scoped_lock l(_writeMutex);
+    update();
+    simulate(seconds);
+}
+
+void SimSerial::setExternalTorque(int id,double torque)
+{
+    dx::scoped_lock l(_writeMutex);
+    if(id >= 0 && id < DX_BROADCAST_ID && _sim[id])
+    {
+        update();
+        _sim[id]->extTorque = clamp(torque,-1.0,1.0);
+    }
+}
+
+double SimSerial::externalTorque(int id)
+{
+    dx::scoped_lock l(_writeMutex);
+    return (id >= 0 && id < DX_BROADCAST_ID && _sim[id]) ? _sim[id]->extTorque : 0;
+}
+
+void SimSerial::setVoltage(double voltage)
+{
+    dx::scoped_lock l(_writeMutex);
+    update();
+    _voltage = voltage;
+}
+
+double SimSerial::position(int id)
+{
+    dx::scoped_lock l(_writeMutex);
+    update();
+    return (id >= 0 && id < DX_BROADCAST_ID && _sim[id]) ? _sim[id]->pos : -1;
+}
+
+double SimSerial::velocity(int id)
+{
+    dx::scoped_lock l(_writeMutex);
+    update();
+    return (id >= 0 && id < DX_BROADCAST_ID && _sim[id]) ? _sim[id]->vel : 0;
+}
+
+double SimSerial::temperature(int id)
+{
+    dx::scoped_lock l(_writeMutex);
+    update();
+    return (id >= 0 && id < DX_BROADCAST_ID && _sim[id]) ? _sim[id]->temp : 0;
+}
+
+double SimSerial::load(int id)
+{
+    dx::scoped_lock l(_writeMutex);
+    update();
+    return (id >= 0 && id < DX_BROADCAST_ID && _sim[id]) ? _sim[id]->load : 0;
+}
+
+void SimSerial::handlePacket(int id,int inst,const unsigned char* param,int paramLength)
+{
+    // bring the registers up to date before the servos see the request
+    update();
+    MemorySerial::handlePacket(id,inst,param,paramLength);
+}
+
+// advances the simulation to the current real time
+void SimSerial::update()
+{
+    dx::uint64_t now = dxMicros();
+    double dt = (now - _lastUpdate) / 1000000.0 * _timeScale;
+    _lastUpdate = now;
+
+    if(dt > 0)
+        simulate(dt);
+}
+
+void SimSerial::simulate(double dt)
+{
+    while(dt > 0)
+    {
+        double stepTime = std::min(dt,SIM_MAX_STEP);
+        for(int i=0;i < DX_BROADCAST_ID;i++)
+        {
+            if(_sim[i] && _table[i])
+                simulate(i,*_sim[i],stepTime);
+        }
+        _simTime += stepTime;
+        dt -= stepTime;
+    }
+
+    for(int i=0;i < DX_BROADCAST_ID;i++)
+    {
+        if(_sim[i] && _table[i])
+            updateRegisters(i,*_sim[i]);
+    }
+}
+
+void SimSerial::simulate(int id,SimServoState& s,double dt)
+{
+    unsigned char* t = _table[id];
+
+    double tickSpeed   = s.ticksPerRev / 60.0;                 // ticks/s per rpm
+    double noLoad      = s.noLoadRpm * tickSpeed * std::min(_voltage / 12.0,1.5);
+    double torqueLimit = std::min(regWord(id,DX_CMD_LIMIT_TORQUE),1023) / 1023.0;
+    int    speedReg    = regWord(id,DX_CMD_MOV_SPEED);
+    bool   wheelMode   = regWord(id,DX_CMD_CW_ANGLE_LIMIT) == 0 && regWord(id,DX_CMD_CCW_ANGLE_LIMIT) == 0;
+
+    double targetVel;
+    if(wheelMode)
+    {
+        targetVel = (speedReg & 0x3FF) * s.speedUnit * tickSpeed;
+        if(speedReg & 0x400)
+            targetVel = -targetVel;
+    }
+    else
+    {
+        double maxVel = (speedReg & 0x3FF) == 0 ? noLoad : std::min(noLoad,(speedReg & 0x3FF) * s.speedUnit * tickSpeed);
+        targetVel = clamp((regWord(id,DX_CMD_GOAL_POS) - s.pos) / _tau,-maxVel,maxVel);
+    }
+
+    if(t[DX_CMD_TORQUE_ENABLE] == 0)
+    {   // free running, the external torque turns the servo
+        s.vel  = s.extTorque * noLoad;
+        s.load = 0;
+    }
+    else if(std::fabs(s.extTorque) > torqueLimit)
+    {   // the motor saturates and gets back driven
+        double holdTorque = s.extTorque > 0 ? torqueLimit : -torqueLimit;
+        s.vel  = (s.extTorque - holdTorque) * noLoad;
+        s.load = -holdTorque;
+        s.hwError |= DX_ERROR_OVERLOAD;
+    }
+    else
+    {   // torque-speed line, the load reduces the top speed
+        double maxVel = noLoad * (1.0 - std::fabs(s.extTorque));
+        s.vel  = clamp(targetVel,-maxVel,maxVel);
+        s.load = -s.extTorque;
+    }
+
+    s.pos += s.vel * dt;
+    if(wheelMode)
+    {
+        s.pos = std::fmod(s.pos,s.range + 1.0);
+        if(s.pos < 0)
+            s.pos += s.range + 1.0;
+    }
+    else
+        s.pos = clamp(s.pos,0,s.range);
+
+    // copper losses heat, the housing cools down to the ambient temperature
+    s.temp += (SIM_HEAT_RATE * s.load * s.load - (s.temp - _ambientTemp) / SIM_COOL_TAU) * dt;
+
+    if(s.temp > t[DX_CMD_HIGH_LIMIT_TEMP])
+        s.hwError |= DX_ERROR_OVERHEAT;
+    else if(s.temp < t[DX_CMD_HIGH_LIMIT_TEMP] - SIM_OVERHEAT_HYSTERESIS)
+        s.hwError &= ~DX_ERROR_OVERHEAT;
+
+    int volt = (int)(_voltage * 10 + 0.5);
+    if(volt < t[DX_CMD_LOW_LIMIT_VOLT] || volt > t[DX_CMD_HIGH_LIMIT_VOLT])
+        s.hwError |= DX_ERROR_INVOLT;
+    else
+        s.hwError &= ~DX_ERROR_INVOLT;
+
+    // alarms
+    if(s.hwError & t[DX_CMD_ALARM_SHUTDOWN])
+        t[DX_CMD_TORQUE_ENABLE] = 0;
+    if(s.hwError & t[DX_CMD_ALARM_LED])
+        t[DX_CMD_LED_ENABLE] = 1;
+}
+
+void SimSerial::updateRegisters(int id,SimServoState& s)
+{
+    unsigned char* t = _table[id];
+
+    double tickSpeed = s.ticksPerRev / 60.0;
+    int speed = std::min((int)(std::fabs(s.vel) / tickSpeed / s.speedUnit + 0.5),0x3FF);
+    int load  = std::min((int)(std::fabs(s.load) * 1023 + 0.5),0x3FF);
+
+    setRegWord(id,DX_CMD_PRESENT_POS,(int)(s.pos + 0.5));
+    setRegWord(id,DX_CMD_PRESENT_SPEED,speed | (s.vel < 0 ? 0x400 : 0));
+    setRegWord(id,DX_CMD_PRESENT_LOAD,load | (s.load < 0 ? 0x400 : 0));
+    t[DX_CMD_PRESENT_VOLT] = std::min((int)(_voltage * 10 + 0.5),0xFF);
+    t[DX_CMD_PRESENT_TEMP] = std::min((int)(s.temp + 0.5),0xFF);
+
+    bool wheelMode = regWord(id,DX_CMD_CW_ANGLE_LIMIT) == 0 && regWord(id,DX_CMD_CCW_ANGLE_LIMIT) == 0;
+    if(wheelMode)
+        t[DX_CMD_MOVING] = speed > 0;
+    else
+        t[DX_CMD_MOVING] = speed > 0 || std::fabs(regWord(id,DX_CMD_GOAL_POS) - s.pos) > 1.0;
+}
+
+void SimSerial::written(int id,int addr,int length)
+{
+    if(_sim[id] == NULL)
+        return;
+
+    SimServoState& s = *_sim[id];
+    unsigned char* t = _table[id];
+
+    if(covers(addr,length,DX_CMD_GOAL_POS) || covers(addr,length,DX_CMD_GOAL_POS + 1))
+    {
+        int goal = regWord(id,DX_CMD_GOAL_POS);
+        int cw   = regWord(id,DX_CMD_CW_ANGLE_LIMIT);
+        int ccw  = regWord(id,DX_CMD_CCW_ANGLE_LIMIT);
+
+        if(goal > s.range)
+        {
+            s.instError |= DX_ERROR_RANGE;
+            goal = s.range;
+        }
+        if((cw != 0 || ccw != 0) && (goal < cw || goal > ccw))
+        {
+            s.instError |= DX_ERROR_ANGLELIMIT;
+            goal = (int)clamp(goal,cw,ccw);
+        }
+        setRegWord(id,DX_CMD_GOAL_POS,goal);
+
+        // a new goal switches the torque on, if no alarm keeps it off
+        if((s.hwError & t[DX_CMD_ALARM_SHUTDOWN]) == 0)
+            t[DX_CMD_TORQUE_ENABLE] = 1;
+    }
+
+    if(covers(addr,length,DX_CMD_MOV_SPEED) || covers(addr,length,DX_CMD_MOV_SPEED + 1))
+    {
+        if(regWord(id,DX_CMD_MOV_SPEED) > 0x7FF)
+        {
+            s.instError |= DX_ERROR_RANGE;
+            setRegWord(id,DX_CMD_MOV_SPEED,0x7FF);
+        }
+    }
+
+    if(covers(addr,length,DX_CMD_LIMIT_TORQUE) || covers(addr,length,DX_CMD_LIMIT_TORQUE + 1))
+    {
+        if(regWord(id,DX_CMD_LIMIT_TORQUE) > 0x3FF)
+        {
+            s.instError |= DX_ERROR_RANGE;
+            setRegWord(id,DX_CMD_LIMIT_TORQUE,0x3FF);
+        }
+    }
+
+    if(covers(addr,length,DX_CMD_TORQUE_ENABLE) && t[DX_CMD_TORQUE_ENABLE])
+    {
+        // re-enabling the torque clears the overload alarm
+        s.hwError &= ~DX_ERROR_OVERLOAD;
+        if(s.hwError & t[DX_CMD_ALARM_SHUTDOWN])
+            t[DX_CMD_TORQUE_ENABLE] = 0;
+    }
+}
+
+int SimSerial::servoError(int id)
+{
+    if(_sim[id] == NULL)
+        return DX_ERROR_NO;
+
+    // instruction errors are only reported once
+    int error = _sim[id]->hwError | _sim[id]->instError;
+    _sim[id]->instError = DX_ERROR_NO;
+    return error;
+}
+
+void SimSerial::idChanged(int id,int newId)
+{
+    _sim[newId] = _sim[id];
+    _sim[id] = NULL;
+}
@@ -31,6 +31,24 @@
 
 %{
 #include <SerialBase.h>
+#include <MemorySerial.h>
+#include <SimSerial.h>
+#include <DxBus.h>
+#include <ServoCapture.h>
+#include <BusMetrics.h>
+#include <BusHealth.h>
+#include <MetricsServer.h>
+#include <BusTracer.h>
+#include <BusRegistry.h>
+#include <DxPlanner.h>
+#include <DxBus2.h>
+#include <IndirectTelemetry.h>
+#include <TelemetryHistory.h>
+#include <TrajectoryGenerator.h>
+#include <GroupMove.h>
+#include <BusDiscovery.h>
+#include <BaudMigration.h>
+#include <ReturnDelayOptimizer.h>
 %}
 
 # ----------------------------------------------------------------------------
@@ -47,6 +65,10 @@ public:
 
     bool isOpen();
 
+    const char*   portName();
+    unsigned long baudRate();
+    bool setBaudRate(unsigned long baudRate);
+
     int available();
 
     void write(unsigned char byte);
@@ -66,3 +88,616 @@ public:
     //void received(const char *data, unsigned int len);
 
 };
+
+# ----------------------------------------------------------------------------
+# MemorySerial
+
+class MemorySerial : public SerialBase
+{
+public:
+    MemorySerial();
+    ~MemorySerial();
+
+    bool open();
+
+    void addServo(int id,int modelNr = DX_TYPE_MX_28);
+    void removeServo(int id);
+    bool hasServo(int id);
+
+    int  reg(int id,int addr);
+    void setReg(int id,int addr,int data);
+    int  regWord(int id,int addr);
+    void setRegWord(int id,int addr,int data);
+
+    void setNoise(int noise);
+    int  noise();
+
+    int  packetCount();
+};
+
+# ----------------------------------------------------------------------------
+# SimSerial
+
+class SimSerial : public MemorySerial
+{
+public:
+    SimSerial(double timeScale = 1.0);
+    ~SimSerial();
+
+    void addServo(int id,int modelNr = DX_TYPE_MX_28);
+    void removeServo(int id);
+
+    void   setTimeScale(double timeScale);
+    double timeScale();
+
+    void   step(double seconds);
+    double simTime();
+
+    void   setExternalTorque(int id,double torque);
+    double externalTorque(int id);
+
+    void   setVoltage(double voltage);
+    double voltage();
+
+    void   setAmbientTemp(double temp);
+    double ambientTemp();
+
+    void   setTau(double tau);
+    double tau();
+
+    double position(int id);
+    double velocity(int id);
+    double temperature(int id);
+    double load(int id);
+};
+
+# ----------------------------------------------------------------------------
+# DxBus
+
+class BusMetrics;
+class BusTracer;
+class BusHealth;
+class TelemetryHistory;
+
+class DxBus
+{
+public:
+    DxBus(SerialBase* serial);
+    ~DxBus();
+
+    SerialBase* serial();
+
+    void setTimeout(int timeout);
+    int  timeout();
+
+    bool setBaudRate(unsigned long baudRate);
+    unsigned long baudRate();
+
+    int  error();
+
+    void setMetrics(BusMetrics* metrics);
+    BusMetrics* metrics();
+
+    void setTracer(BusTracer* tracer);
+    BusTracer* tracer();
+
+    void setHealth(BusHealth* health);
+    BusHealth* health();
+
+    void setHistory(TelemetryHistory* history);
+    TelemetryHistory* history();
+
+    void setRetries(int retries);
+    int  retries();
+
+    void setStatusReturnLevel(int level);
+    int  statusReturnLevel();
+
+    void setSyncSplitAction(bool enable);
+    bool syncSplitAction();
+    static int syncWriteCapacity(int length);
+
+    void lock();
+    void unlock();
+
+    void setServoIds(int* idList,int idCount);
+    int  servoIdCount();
+
+    int  pending();
+
+    int  lastPosition(int id);
+    int  lastSpeed(int id);
+    int  lastLoad(int id);
+    int  lastVolt(int id);
+    int  lastTemp(int id);
+
+    bool ping(int id);
+    bool action(int id);
+
+    int  readByte(int id,int addr);
+    int  readWord(int id,int addr);
+    bool writeByte(int id,int addr,int data);
+    bool writeWord(int id,int addr,int data);
+};
+
+# ----------------------------------------------------------------------------
+# DxPlanner
+
+class DxPlanner
+{
+public:
+    DxPlanner(int baudRate = 1000000,int returnDelay = 500);
+
+    void setBaudRate(int baudRate);
+    int  baudRate();
+
+    void setReturnDelay(int returnDelay);
+    int  returnDelay();
+
+    void setBulkRead(bool enable);
+    bool bulkRead();
+
+    void clear();
+    int  read(int id,int addr,int length);
+    void writeByte(int id,int addr,int data);
+    void writeWord(int id,int addr,int data);
+
+    int  readCount();
+    int  writeCount();
+
+    int  compile();
+    int  packetCount();
+
+    int  wireTime();
+    int  requestWireTime();
+    std::string schedule();
+
+    bool execute(DxBus* bus);
+    int  errorCount();
+
+    bool readOk(int read);
+    int  readByte(int read);
+    int  readWord(int read);
+};
+
+# ----------------------------------------------------------------------------
+# DxBus2, protocol 2.0
+
+#define  DX2_ERROR_USR_SERVO        (1 << 15)
+
+class DxBus2
+{
+public:
+    DxBus2(SerialBase* serial);
+    ~DxBus2();
+
+    SerialBase* serial();
+
+    void setTimeout(int timeout);
+    int  timeout();
+
+    int  error();
+    int  servoError();
+
+    bool ping(int id);
+
+    int  readByte(int id,int addr);
+    int  readWord(int id,int addr);
+    bool writeByte(int id,int addr,int data);
+    bool writeWord(int id,int addr,int data);
+};
+
+# ----------------------------------------------------------------------------
+# IndirectTelemetry
+
+class IndirectTelemetry
+{
+public:
+    IndirectTelemetry(DxBus2* bus,int fields = 0x3F,int firstEntry = 0);
+
+    DxBus2* bus();
+    int  fields();
+
+    int  windowLength();
+    int  spanLength();
+    int  windowAddr();
+
+    bool setup(int* idList,int idCount);
+
+    int  idCount();
+    int  id(int index);
+
+    bool update();
+    bool update(int id);
+
+    bool valid(int id);
+    int  position(int id);
+    int  velocity(int id);
+    int  current(int id);
+    int  voltage(int id);
+    int  temperature(int id);
+    int  hardwareError(int id);
+};
+
+# ----------------------------------------------------------------------------
+# ServoCapture
+
+class ServoCapture
+{
+public:
+    ServoCapture(DxBus* bus,int maxSamples = 10000);
+    ~ServoCapture();
+
+    bool setMaxSamples(int maxSamples);
+    int  maxSamples();
+
+    bool capture(int* idList,int idCount,int* goalList,int duration);
+
+    int   sampleCount();
+    int   errorCount();
+    float duration();
+    float sampleRate();
+
+    void getTime(float* time);
+    void getId(int* id);
+    void getPosition(int* pos);
+    void getSpeed(int* speed);
+    void getLoad(int* load);
+};
+
+# ----------------------------------------------------------------------------
+# BusMetrics
+
+class BusMetrics
+{
+public:
+    BusMetrics(DxBus* bus,const char* name = "");
+    ~BusMetrics();
+
+    DxBus* bus();
+    std::string name();
+
+    void addTransaction(int id,int error,int latency,int txBytes,int rxBytes);
+
+    void setCyclePeriod(int period);
+    int  cyclePeriod();
+    void beginCycle();
+    void endCycle();
+
+    void reset();
+
+    std::string text();
+};
+
+# ----------------------------------------------------------------------------
+# BusHealth
+
+enum DxHealthCause
+{
+    DX_HEALTH_IDLE = 0,
+    DX_HEALTH_OK,
+    DX_HEALTH_BUS,
+    DX_HEALTH_SERVO,
+    DX_HEALTH_SERVO_ALARM,
+    DX_HEALTH_LATENCY_DRIFT
+};
+
+class BusHealth
+{
+public:
+    BusHealth(DxBus* bus,int window = 10000);
+    ~BusHealth();
+
+    DxBus* bus();
+    int    window();
+
+    void reset();
+
+    int    transactions(int id = -1);
+    double errorRate(int id = -1);
+    double lineErrorRate(int id = -1);
+    double retryRate(int id = -1);
+    double errorTypeRate(int type,int id = -1);
+
+    int    alarm(int id);
+
+    double latencyDrift(int id = -1);
+    double latency(int id = -1);
+
+    int    cause();
+    int    causeId();
+    static const char* causeName(int cause);
+
+    std::string summary();
+
+    void   setErrorThreshold(double rate);
+    double errorThreshold();
+    void   setDriftThreshold(double drift);
+    double driftThreshold();
+};
+
+# ----------------------------------------------------------------------------
+# TelemetryHistory
+
+#define  DX_HISTORY_POS                 (0)
+#define  DX_HISTORY_SPEED               (1)
+#define  DX_HISTORY_LOAD                (2)
+#define  DX_HISTORY_VOLT                (3)
+#define  DX_HISTORY_TEMP                (4)
+
+class TelemetryHistory
+{
+public:
+    TelemetryHistory(int capacity = 512,int levels = 4,int factor = 8);
+    ~TelemetryHistory();
+
+    int  capacity();
+    int  levels();
+    int  factor();
+    double span();
+
+    void add(int id,int channel,int value);
+    void clear(int id = -1);
+
+    bool hasServo(int id);
+    double sampleCount(int id,int channel);
+
+    int  get(int id,int channel,float window,int maxPoints,
+             float* time,float* minList,float* maxList,float* meanList);
+    int  lastLevel();
+};
+
+# ----------------------------------------------------------------------------
+# TrajectoryGenerator
+
+class DxTrajectory
+{
+public:
+    DxTrajectory(double velocity = 1000.0,double acceleration = 4000.0,double jerk = 40000.0);
+
+    void setLimits(double velocity,double acceleration,double jerk);
+    double maxVelocity();
+    double maxAcceleration();
+    double maxJerk();
+
+    void reset(double pos);
+
+    void setTarget(double target);
+    double target();
+
+    bool step(double dt);
+
+    double position();
+    double velocity();
+    double acceleration();
+
+    bool isDone();
+};
+
+class TrajectoryGenerator
+{
+public:
+    TrajectoryGenerator(DxBus* bus,int period = 10);
+    ~TrajectoryGenerator();
+
+    DxBus* bus();
+    int  period();
+
+    bool add(int id,int pos,double speedScale = DX_TRAJ_SPEED_SCALE_MX);
+    bool add(int id,double speedScale = DX_TRAJ_SPEED_SCALE_MX);
+    void remove(int id);
+    bool hasServo(int id);
+
+    bool setLimits(int id,double velocity,double acceleration,double jerk);
+    bool setTarget(int id,int pos);
+
+    void setMinSpeed(int minSpeed);
+    int  minSpeed();
+
+    int    target(int id);
+    double position(int id);
+    double velocity(int id);
+    bool   isDone(int id);
+    bool   isDone();
+
+    bool step(double dt);
+
+    void start();
+    void stop();
+    bool isRunning();
+};
+
+# ----------------------------------------------------------------------------
+# GroupMove
+
+class GroupMove
+{
+public:
+    GroupMove(DxBus* bus);
+
+    DxBus* bus();
+
+    void setModel(int id,int modelNr);
+    int  model(int id);
+
+    bool move(int* idList,int idCount,int* goalList,int duration);
+
+    int  speed(int id);
+    int  startPosition(int id);
+    int  readCount();
+
+    void reset();
+};
+
+# ----------------------------------------------------------------------------
+# BusRegistry
+
+#define  DX_REGISTRY_OK             (0)
+#define  DX_REGISTRY_OPEN_FAILED    (1)
+#define  DX_REGISTRY_BAUDRATE       (2)
+
+class BusRegistry
+{
+public:
+    static DxBus* acquire(const char* portName,unsigned long baudRate);
+    static bool release(DxBus* bus);
+
+    static DxBus* find(const char* portName);
+    static int    refCount(const char* portName);
+    static int    count();
+};
+
+# ----------------------------------------------------------------------------
+# BusDiscovery
+
+struct DxDiscoveredServo
+{
+    int     port;
+    int     id;
+    int     modelNr;
+    int     firmware;
+    int     returnDelay;
+    int     statusReturnLevel;
+    bool    verified;
+};
+
+class BusDiscovery
+{
+public:
+    BusDiscovery();
+    ~BusDiscovery();
+
+    int  addPort(const char* portName,unsigned long baudRate);
+    int  addBus(DxBus* bus);
+
+    void setIdRange(int first,int last);
+    void setTimeout(int timeout);
+    int  timeout();
+
+    void setExpectedReturnDelay(int delay);
+    void setExpectedStatusReturnLevel(int level);
+
+    void setAssignServoIds(bool enable);
+    bool assignServoIds();
+
+    bool run();
+
+    double duration();
+
+    int         portCount();
+    const char* portName(int port);
+    bool        isOpen(int port);
+    DxBus*      bus(int port);
+    double      portDuration(int port);
+    int         portServoCount(int port);
+    bool        portComplete(int port);
+
+    int  servoCount();
+    const DxDiscoveredServo* servo(int index);
+    int  find(int id);
+    int  unverifiedCount();
+
+    void detach();
+};
+
+# ----------------------------------------------------------------------------
+# BaudMigration
+
+#define  DX_MIGRATION_OK            (0)
+#define  DX_MIGRATION_UNSUPPORTED   (1)
+#define  DX_MIGRATION_MISSING       (2)
+#define  DX_MIGRATION_ROLLED_BACK   (3)
+#define  DX_MIGRATION_FAILED        (4)
+
+class BaudMigration
+{
+public:
+    BaudMigration(DxBus* bus);
+
+    DxBus* bus();
+
+    bool migrate(int* idList,int idCount,unsigned long baudRate);
+
+    int  result();
+    static const char* resultName(int result);
+
+    int  failedCount();
+    int  failedId(int index);
+
+    unsigned long oldBaudRate();
+    unsigned long newBaudRate();
+
+    void setSettleTime(int settleTime);
+    int  settleTime();
+};
+
+# ----------------------------------------------------------------------------
+# ReturnDelayOptimizer
+
+class ReturnDelayOptimizer
+{
+public:
+    ReturnDelayOptimizer(DxBus* bus);
+
+    DxBus* bus();
+
+    void setSamples(int samples);
+    int  samples();
+
+    void   setMaxErrorRate(double rate);
+    double maxErrorRate();
+
+    void setCandidates(int* valueList,int count);
+
+    bool optimize(int* idList,int idCount,bool uniform = false);
+
+    int    servoCount();
+    int    id(int index);
+    int    oldDelay(int index);
+    int    newDelay(int index);
+    double oldLatency(int index);
+    double newLatency(int index);
+
+    double oldLatency();
+    double newLatency();
+    double savedTime();
+    double expectedSavedTime();
+};
+
+# ----------------------------------------------------------------------------
+# MetricsServer
+
+class MetricsServer
+{
+public:
+    MetricsServer();
+    ~MetricsServer();
+
+    void add(BusMetrics* metrics);
+    void remove(BusMetrics* metrics);
+
+    bool start(int port = 9464);
+    void stop();
+
+    bool isRunning();
+    int  port();
+};
+
+# ----------------------------------------------------------------------------
+# BusTracer
+
+class BusTracer
+{
+public:
+    BusTracer(int capacity = 8192);
+    ~BusTracer();
+
+    void setEnabled(bool enable);
+    bool isEnabled();
+
+    void instant(const char* name);
+    void clear();
+
+    std::string json();
+    bool exportJson(const char* path);
+};
@@ -0,0 +1,260 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "TelemetryHistory.h"
+#include "DxTime.h"
+
+#include <algorithm>
+#include <cmath>
+
+///////////////////////////////////////////////////////////////////////////////
+// DxHistoryRing
+
+DxHistoryRing::DxHistoryRing(int capacity,int levels,int factor):
+    _capacity(capacity),
+    _factor(factor),
+    _levels(levels)
+{
+    for(size_t i=0;i < _levels.size();i++)
+        _levels[i].points.resize(_capacity);
+    clear();
+}
+
+void DxHistoryRing::clear()
+{
+    for(size_t i=0;i < _levels.size();i++)
+    {
+        _levels[i].count = 0;
+        _levels[i].sum = 0;
+        _levels[i].partialCount = 0;
+    }
+}
+
+void DxHistoryRing::add(dx::uint64_t time,float value)
+{
+    DxHistoryPoint p;
+    p.min  = value;
+    p.max  = value;
+    p.mean = value;
+    p.time = time;
+    p.end  = time;
+    commit(0,p);
+}
+
+void DxHistoryRing::commit(int level,const DxHistoryPoint& point)
+{
+    Level& l = _levels[level];
+    l.points[l.count % _capacity] = point;
+    l.count++;
+
+    if(level + 1 >= (int)_levels.size())
+        return;
+
+    // fold into the point in the making of the next level
+    Level& next = _levels[level + 1];
+    if(next.partialCount == 0)
+    {
+        next.partial = point;
+        next.sum = point.mean;
+    }
+    else
+    {
+        next.partial.min = std::min(next.partial.min,point.min);
+        next.partial.max = std::max(next.partial.max,point.max);
+        next.partial.end = point.end;
+        next.sum += point.mean;
+    }
+
+    if(++next.partialCount == _factor)
+    {
+        next.partial.mean = (float)(next.sum / _factor);
+        next.partialCount = 0;
+        commit(level + 1,next.partial);
+    }
+}
+
+const DxHistoryPoint& DxHistoryRing::point(int level,dx::uint64_t index)
+{
+    return _levels[level].points[index % _capacity];
+}
+
+int DxHistoryRing::get(dx::uint64_t now,dx::uint64_t window,int maxPoints,int& level,
+                       float* time,float* minList,float* maxList,float* meanList)
+{
+    dx::uint64_t start = window >= now ? 0 : now - window;
+    int          levelCount = _levels.size();
+
+    level = levelCount - 1;
+    int count = 0;
+    for(int l=0;l < levelCount;l++)
+    {
+        Level&       lv = _levels[l];
+        dx::uint64_t stored = std::min(lv.count,(dx::uint64_t)_capacity);
+        bool         partial = l > 0 && lv.partialCount > 0;
+
+        // points in the window, newest first, stop when there are too many.
+        // the oldest may begin before the start, most of it can be inside
+        count = partial && lv.partial.end >= start ? 1 : 0;
+        dx::uint64_t i = 0;
+        for(;i < stored && count <= maxPoints;i++)
+        {
+            if(point(l,lv.count - 1 - i).end < start)
+                break;
+            count++;
+        }
+
+        // the ring reaches back to the start, or there is nothing older
+        bool covered = lv.count <= (dx::uint64_t)_capacity || i < stored;
+        if((covered && count <= maxPoints) || l == levelCount - 1)
+        {
+            level = l;
+            break;
+        }
+    }
+
+    Level&       lv = _levels[level];
+    bool         partial = level > 0 && lv.partialCount > 0 && lv.partial.end >= start;
+    dx::uint64_t stored = std::min(lv.count,(dx::uint64_t)_capacity);
+    if(count > maxPoints)
+        count = maxPoints;
+
+    // oldest first, the point in the making is the newest
+    int n = 0;
+    int fromRing = count - (partial ? 1 : 0);
+    if(fromRing > (int)stored)
+        fromRing = stored;
+    for(int i=fromRing - 1;i >= 0;i--,n++)
+    {
+        const DxHistoryPoint& p = point(level,lv.count - 1 - i);
+        time[n]     = (float)((double)(now - std::min(now,p.time)) / 1000.0);
+        minList[n]  = p.min;
+        maxList[n]  = p.max;
+        meanList[n] = p.mean;
+    }
+    if(partial && n < maxPoints)
+    {
+        time[n]     = (float)((double)(now - std::min(now,lv.partial.time)) / 1000.0);
+        minList[n]  = lv.partial.min;
+        maxList[n]  = lv.partial.max;
+        meanList[n] = (float)(lv.sum / lv.partialCount);
+        n++;
+    }
+    return n;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// TelemetryHistory
+
+TelemetryHistory::TelemetryHistory(int capacity,int levels,int factor):
+    _capacity(capacity < 2 ? 2 : capacity),
+    _levelCount(levels < 1 ? 1 : levels),
+    _factor(factor < 2 ? 2 : factor),
+    _lastLevel(0)
+{
+    for(int id=0;id < DX_BROADCAST_ID;id++)
+        for(int c=0;c < DX_HISTORY_CHANNEL_COUNT;c++)
+            _rings[id][c] = NULL;
+}
+
+TelemetryHistory::~TelemetryHistory()
+{
+    for(int id=0;id < DX_BROADCAST_ID;id++)
+        for(int c=0;c < DX_HISTORY_CHANNEL_COUNT;c++)
+            delete _rings[id][c];
+}
+
+double TelemetryHistory::span()
+{
+    return _capacity * std::pow((double)_factor,_levelCount - 1);
+}
+
+DxHistoryRing* TelemetryHistory::ring(int id,int channel,bool create)
+{
+    if(id < 0 || id >= DX_BROADCAST_ID || channel < 0 || channel >= DX_HISTORY_CHANNEL_COUNT)
+        return NULL;
+
+    // all channels of a servo at once
+    if(_rings[id][0] == NULL && create)
+    {
+        for(int c=0;c < DX_HISTORY_CHANNEL_COUNT;c++)
+            _rings[id][c] = new DxHistoryRing(_capacity,_levelCount,_factor);
+    }
+    return _rings[id][channel];
+}
+
+void TelemetryHistory::add(int id,int channel,int value,dx::uint64_t time)
+{
+    dx::scoped_lock l(_mutex);
+
+    DxHistoryRing* r = ring(id,channel,true);
+    if(r)
+        r->add(time,value);
+}
+
+void TelemetryHistory::add(int id,int channel,int value)
+{
+    add(id,channel,value,dxMicros());
+}
+
+void TelemetryHistory::clear(int id)
+{
+    dx::scoped_lock l(_mutex);
+
+    for(int i=0;i < DX_BROADCAST_ID;i++)
+    {
+        if(id >= 0 && i != id)
+            continue;
+        for(int c=0;c < DX_HISTORY_CHANNEL_COUNT;c++)
+        {
+            if(_rings[i][c])
+                _rings[i][c]->clear();
+        }
+    }
+}
+
+bool TelemetryHistory::hasServo(int id)
+{
+    dx::scoped_lock l(_mutex);
+    return ring(id,0,false) != NULL;
+}
+
+double TelemetryHistory::sampleCount(int id,int channel)
+{
+    dx::scoped_lock l(_mutex);
+
+    DxHistoryRing* r = ring(id,channel,false);
+    return r ? (double)r->sampleCount() : 0;
+}
+
+int TelemetryHistory::get(int id,int channel,float window,int maxPoints,
+                          float* time,float* minList,float* maxList,float* meanList)
+{
+    dx::scoped_lock l(_mutex);
+
+    DxHistoryRing* r = ring(id,channel,false);
+    if(r == NULL || maxPoints <= 0 || window <= 0)
+        return 0;
+
+    return r->get(dxMicros(),(dx::uint64_t)(window * 1000.0),maxPoints,_lastLevel,
+                  time,minList,maxList,meanList);
+}
@@ -0,0 +1,421 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#include "TrajectoryGenerator.h"
+#include "DxTime.h"
+
+#include <algorithm>
+#include <cmath>
+
+///////////////////////////////////////////////////////////////////////////////
+// DxTrajectory
+
+// constant jerk j for t seconds
+static void advance(double& pos,double& vel,double& acc,double j,double t)
+{
+    pos += vel * t + acc * t * t * .5 + j * t * t * t / 6.0;
+    vel += acc * t + j * t * t * .5;
+    acc += j * t;
+}
+
+DxTrajectory::DxTrajectory(double velocity,double acceleration,double jerk):
+    _target(0),
+    _pos(0),
+    _vel(0),
+    _acc(0)
+{
+    setLimits(velocity,acceleration,jerk);
+}
+
+void DxTrajectory::setLimits(double velocity,double acceleration,double jerk)
+{
+    _vMax = velocity > 0 ? velocity : DX_TRAJ_DEFAULT_VELOCITY;
+    _aMax = acceleration > 0 ? acceleration : DX_TRAJ_DEFAULT_ACCELERATION;
+    _jMax = jerk > 0 ? jerk : DX_TRAJ_DEFAULT_JERK;
+}
+
+void DxTrajectory::reset(double pos)
+{
+    _target = pos;
+    _pos = pos;
+    _vel = 0;
+    _acc = 0;
+}
+
+double DxTrajectory::stopDistance(double vel,double acc)
+{
+    double pos = 0;
+    double j = _jMax;
+
+    // moving away, the braking never gets past the start
+    double peak2 = j * vel + acc * acc * .5;
+    if(peak2 < 0)
+    {
+        advance(pos,vel,acc,acc > 0 ? -j : j,std::fabs(acc) / j);
+        return pos;
+    }
+
+    double peak = std::sqrt(peak2);
+    if(peak < -acc)
+    {   // brakes harder than needed, stops while the acceleration ramps back
+        double t = -acc / j;
+        double disc = acc * acc - 2.0 * j * vel;
+        if(disc >= 0)
+            t = std::min(t,(-acc - std::sqrt(disc)) / j);
+        advance(pos,vel,acc,j,t);
+        return pos;
+    }
+
+    // ramp down to -peak, hold it, ramp back to 0 at rest
+    double hold = 0;
+    if(peak > _aMax)
+    {
+        peak = _aMax;
+        hold = std::max(0.0,(vel + (acc * acc - 2.0 * peak * peak) / (2.0 * j)) / peak);
+    }
+    advance(pos,vel,acc,-j,(acc + peak) / j);
+    advance(pos,vel,acc,0,hold);
+    advance(pos,vel,acc,j,peak / j);
+    return pos;
+}
+
+bool DxTrajectory::feasible(double dist,double vel,double acc)
+{
+    // the acceleration can't drop to 0 at once, the velocity grows meanwhile
+    double coast = acc > 0 ? acc * acc / (2.0 * _jMax) : 0;
+    if(vel + coast > _vMax * (1.0 + 1e-9))
+        return false;
+    return stopDistance(vel,acc) <= dist + 1e-9;
+}
+
+bool DxTrajectory::step(double dt)
+{
+    if(isDone())
+        return false;
+    if(dt <= 0)
+        return true;
+
+    // everything along the direction of the target, the axis overshot if
+    // there is none left
+    double dist = _target - _pos;
+    double dir;
+    if(dist != 0)
+        dir = dist > 0 ? 1.0 : -1.0;
+    else if(_vel != 0)
+        dir = _vel > 0 ? -1.0 : 1.0;
+    else
+        dir = _acc > 0 ? -1.0 : 1.0;
+
+    double x = dir * dist;
+    double u = dir * _vel;
+    double b = dir * _acc;
+
+    // the largest jerk from which the axis can still brake in time,
+    // the smallest one if even that overshoots
+    double lo = -_jMax;
+    double hi = _jMax;
+    double jerk = lo;
+    for(int i=0;i < 32;i++)
+    {
+        double j = i == 0 ? hi : (i == 1 ? lo : (lo + hi) * .5);
+
+        // the acceleration limit cuts the jerk short
+        double acc = std::max(-_aMax,std::min(_aMax,b + j * dt));
+        double jEff = (acc - b) / dt;
+        double pos = 0;
+        double vel = u;
+        acc = b;
+        advance(pos,vel,acc,jEff,dt);
+
+        bool ok = feasible(x - pos,vel,acc);
+        if(i == 0)
+        {
+            if(ok)
+            {
+                jerk = hi;
+                break;
+            }
+        }
+        else if(i == 1)
+        {
+            if(!ok)
+                break;
+        }
+        else if(ok)
+        {
+            lo = j;
+            jerk = j;
+        }
+        else
+            hi = j;
+    }
+
+    double acc = std::max(-_aMax,std::min(_aMax,b + jerk * dt));
+    double pos = 0;
+    double vel = u;
+    double jEff = (acc - b) / dt;
+    acc = b;
+    advance(pos,vel,acc,jEff,dt);
+
+    _pos += dir * pos;
+    _vel = dir * vel;
+    _acc = dir * acc;
+
+    // the last step lands on the target, what remains is below one jerk step
+    double jdt = _jMax * dt;
+    if(std::fabs(_target - _pos) <= jdt * dt * dt &&
+       std::fabs(_vel) <= jdt * dt &&
+       std::fabs(_acc) <= jdt)
+        reset(_target);
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// TrajectoryGenerator
+
+TrajectoryGenerator::TrajectoryGenerator(DxBus* bus,int period):
+    _bus(bus),
+    _period(period > 0 ? period : 1),
+    _minSpeed(DX_TRAJ_DEFAULT_MIN_SPEED),
+    _running(false),
+    _cycleCount(0),
+    _errorCount(0),
+    _lateCount(0)
+{
+}
+
+TrajectoryGenerator::~TrajectoryGenerator()
+{
+    stop();
+}
+
+TrajectoryGenerator::Axis* TrajectoryGenerator::axis(int id)
+{
+    for(size_t i=0;i < _axes.size();i++)
+    {
+        if(_axes[i].id == id)
+            return &_axes[i];
+    }
+    return NULL;
+}
+
+bool TrajectoryGenerator::add(int id,int pos,double speedScale)
+{
+    if(id < 0 || id >= DX_BROADCAST_ID || pos < 0)
+        return false;
+
+    dx::scoped_lock l(_mutex);
+
+    Axis* a = axis(id);
+    if(a == NULL)
+    {
+        _axes.push_back(Axis());
+        a = &_axes.back();
+        a->id = id;
+    }
+    a->speedScale = speedScale;
+    a->moving = false;
+    a->trajectory.reset(pos);
+    return true;
+}
+
+bool TrajectoryGenerator::add(int id,double speedScale)
+{
+    int pos = _bus->readWord(id,DX_CMD_PRESENT_POS);
+    if(pos < 0)
+        return false;
+    return add(id,pos,speedScale);
+}
+
+void TrajectoryGenerator::remove(int id)
+{
+    dx::scoped_lock l(_mutex);
+
+    for(size_t i=0;i < _axes.size();i++)
+    {
+        if(_axes[i].id == id)
+        {
+            _axes.erase(_axes.begin() + i);
+            return;
+        }
+    }
+}
+
+bool TrajectoryGenerator::hasServo(int id)
+{
+    dx::scoped_lock l(_mutex);
+    return axis(id) != NULL;
+}
+
+bool TrajectoryGenerator::setLimits(int id,double velocity,double acceleration,double jerk)
+{
+    dx::scoped_lock l(_mutex);
+
+    Axis* a = axis(id);
+    if(a == NULL)
+        return false;
+    a->trajectory.setLimits(velocity,acceleration,jerk);
+    return true;
+}
+
+bool TrajectoryGenerator::setTarget(int id,int pos)
+{
+    dx::scoped_lock l(_mutex);
+
+    Axis* a = axis(id);
+    if(a == NULL || pos < 0)
+        return false;
+    a->trajectory.setTarget(pos);
+    return true;
+}
+
+int TrajectoryGenerator::target(int id)
+{
+    dx::scoped_lock l(_mutex);
+
+    Axis* a = axis(id);
+    return a ? (int)a->trajectory.target() : -1;
+}
+
+double TrajectoryGenerator::position(int id)
+{
+    dx::scoped_lock l(_mutex);
+
+    Axis* a = axis(id);
+    return a ? a->trajectory.position() : -1;
+}
+
+double TrajectoryGenerator::velocity(int id)
+{
+    dx::scoped_lock l(_mutex);
+
+    Axis* a = axis(id);
+    return a ? a->trajectory.velocity() : 0;
+}
+
+bool TrajectoryGenerator::isDone(int id)
+{
+    dx::scoped_lock l(_mutex);
+
+    Axis* a = axis(id);
+    return a == NULL || a->trajectory.isDone();
+}
+
+bool TrajectoryGenerator::isDone()
+{
+    dx::scoped_lock l(_mutex);
+
+    for(size_t i=0;i < _axes.size();i++)
+    {
+        if(!_axes[i].trajectory.isDone())
+            return false;
+    }
+    return true;
+}
+
+bool TrajectoryGenerator::step(double dt)
+{
+    dx::scoped_lock l(_mutex);
+
+    // goal position and moving speed are neighbours, 4 bytes per servo
+    _idList.clear();
+    _data.clear();
+    int minSpeed = std::max(1,_minSpeed);
+    for(size_t i=0;i < _axes.size();i++)
+    {
+        Axis& a = _axes[i];
+        if(!a.trajectory.step(dt))
+            continue;
+
+        int pos   = (int)std::floor(a.trajectory.position() + .5);
+        int speed = (int)std::floor(std::fabs(a.trajectory.velocity()) * a.speedScale + .5);
+        speed = std::min(1023,std::max(minSpeed,speed));
+
+        _idList.push_back(a.id);
+        _data.push_back(pos & 0xFF);
+        _data.push_back((pos >> 8) & 0xFF);
+        _data.push_back(speed & 0xFF);
+        _data.push_back((speed >> 8) & 0xFF);
+    }
+    _cycleCount++;
+
+    if(_idList.empty())
+        return true;
+
+    bool ret = _bus->syncWrite(DX_CMD_GOAL_POS,4,&_idList[0],_idList.size(),&_data[0]);
+    if(!ret)
+        _errorCount++;
+    return ret;
+}
+
+void TrajectoryGenerator::start()
+{
+    if(_running.exchange(true))
+        return;
+
+    dx::thread t(&TrajectoryGenerator::run,this);
+    _thread.swap(t);
+}
+
+void TrajectoryGenerator::stop()
+{
+    {
+        dx::scoped_lock l(_mutex);
+        if(!_running.exchange(false))
+            return;
+    }
+    _cond.notify_all();
+    _thread.join();
+}
+
+void TrajectoryGenerator::run()
+{
+    dx::uint64_t period = (dx::uint64_t)_period * 1000;
+    dx::uint64_t last = dxMicros();
+    dx::uint64_t next = last + period;
+
+    while(_running)
+    {
+        {
+            // fixed rate, the waits don't add up
+            dx::scoped_lock l(_mutex);
+            dx::uint64_t now;
+            while(_running && (now = dxMicros()) < next)
+                dx::timed_wait(_cond,l,dx::deadline(std::max(1,(int)((next - now) / 1000))));
+        }
+        if(!_running)
+            break;
+
+        // the step covers the real time since the last one
+        dx::uint64_t now = dxMicros();
+        if(now - last > 2 * period)
+            _lateCount++;
+        step((now - last) / 1000000.0);
+
+        last = now;
+        next += period;
+        if(next < now)
+            next = now + period;
+    }
+}
@@ -0,0 +1,68 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+package SimpleDynamixel;
+
+/**
+ * Direct native path of the hot Servo operations. The methods get
+ * registered by JNI_OnLoad (FastBusJNI.cpp) and call the DxBus without
+ * the swig proxies, the results come back as primitives.
+ */
+public class FastBus
+{
+    // set by JNI_OnLoad, false if the native lib has no fast path
+    protected static boolean    _registered = false;
+
+    protected long              _bus;       // DxBus*, read by the natives
+    protected int               _error;     // written by the natives
+    protected DxBus             _busRef;    // keeps the proxy alive
+
+    public FastBus(DxBus bus)
+    {
+        _busRef = bus;
+        _bus = DxBus.getCPtr(bus);
+        _error = 0;
+    }
+
+    public static boolean isAvailable() { return _registered; }
+
+    // error of the last call
+    public int error() { return _error; }
+
+    public native boolean ping(int id);
+    public native boolean action(int id);
+
+    // -1 on error
+    public native int readByte(int id,int addr);
+    public native int readWord(int id,int addr);
+    // returns the read count, -1 on error
+    public native int readData(int id,int addr,byte[] data,int length);
+
+    public native boolean writeByte(int id,int addr,int data,boolean regWrite);
+    public native boolean writeWord(int id,int addr,int data,boolean regWrite);
+
+    // dataList holds length bytes for each id
+    public native boolean syncWrite(int addr,int length,int[] idList,int idCount,byte[] dataList);
+    // one word for each id
+    public native boolean syncWriteWord(int addr,int[] idList,int[] valueList,int idCount);
+}
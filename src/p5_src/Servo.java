@@ -29,6 +29,7 @@ import processing.serial.*;
 import java.lang.Thread;
 import java.util.ArrayList;
 import java.util.Arrays;
+import java.util.HashMap;
 import java.lang.Math;
 import java.text.DecimalFormat;
 
@@ -44,7 +45,7 @@ public class Servo
 
   protected static int _loadExtLib = 0;
 
-  protected static void loadExtLib()
+  public static void loadExtLib()
   {
     if(_loadExtLib >= 1)
         return;
@@ -95,6 +96,8 @@ public class Servo
 
     public final static int DX_LAST_ID                  = 0xFD;
 
+    public final static int DX_MAX_PARAM_LENGTH         = 253;  // length byte = param + 2
+
     // return values
     public final static int DX_RET_OK			= 0;
     public final static int DX_RET_ERROR_LEN		= 1;  // return package has wrong size
@@ -115,6 +118,7 @@ public class Servo
     public final static int DX_ERROR_USR_READSTATUS     = 1 << 11;
     public final static int DX_ERROR_USR_NO_BEGIN       = 1 << 12;
     public final static int DX_ERROR_USR_DATA_TIMEOUT   = 1 << 13;
+    public final static int DX_ERROR_USR_CHECKSUM       = 1 << 14;
 
     // Instructions
     public final static int DX_INST_PING		= 0x01;
@@ -124,6 +128,7 @@ public class Servo
     public final static int DX_INST_ACTION		= 0x05;
     public final static int DX_INST_RESET		= 0x06;
     public final static int DX_INST_SYNC_WRITE		= 0x83;
+    public final static int DX_INST_BULK_READ		= 0x92;
 
     // commands
     public final static int DX_CMD_MODELNR		= 0x00;
@@ -235,18 +240,132 @@ public class Servo
     {
         protected Serial        _p5Serial;
         protected SerialBase    _nativeSerial;
+        protected DxBus         _bus;
+        protected SharedBus     _shared = null;
+        protected Object        _lock = new Object();
+        protected boolean       _busLocked = false;
+        protected int           _txBytes = 0;
 
         public SerialWrapper(PApplet parent,String devStr,int baudrate)
         {
             _nativeSerial = null;
+            _bus = null;
             _p5Serial = new Serial(parent,devStr, baudrate);
         }
 
+        // the port is shared with all other Servo objects on it
         public SerialWrapper(String devStr,int baudrate)
         {
             _p5Serial = null;
-            _nativeSerial = new SerialBase();
-            _nativeSerial.open(devStr, baudrate);
+            _bus = BusRegistry.acquire(devStr, baudrate);
+            if(_bus != null)
+            {
+                _nativeSerial = _bus.serial();
+                synchronized(Servo.class)
+                {
+                    // the registry name, a symlink of the device gets the same
+                    String portName = _nativeSerial.portName();
+                    _shared = _sharedBuses.get(portName);
+                    if(_shared == null)
+                    {
+                        _shared = new SharedBus();
+                        _shared.devStr = portName;
+                        _sharedBuses.put(portName, _shared);
+                    }
+                    _shared.refCount++;
+                }
+                _lock = _shared.lock;
+            }
+            else
+            {   // not open, all writes get ignored
+                if(BusRegistry.find(devStr) != null)
+                    System.out.println("Servo Error: " + devStr + " is already open with another baudrate");
+                else
+                    System.out.println("Servo Error: can't open " + devStr);
+                _nativeSerial = new SerialBase();
+                _bus = new DxBus(_nativeSerial);
+            }
+        }
+
+        // already opened native transport, e.g. MemorySerial
+        public SerialWrapper(SerialBase serial)
+        {
+            _p5Serial = null;
+            _nativeSerial = serial;
+            _bus = new DxBus(_nativeSerial);
+        }
+
+        public DxBus bus() { return _bus; }
+
+        public boolean isOpen()
+        {
+            if(_nativeSerial != null)
+                return _nativeSerial.isOpen();
+            return _p5Serial != null;
+        }
+
+        // lock of the transactions, the same for all wrappers on one port
+        public Object lock() { return _lock; }
+
+        public SharedBus shared() { return _shared; }
+
+        // the bytes of a java transaction go out under the lock of the native
+        // bus, otherwise they could mix with the packets of native threads
+        // (TrajectoryGenerator, DxAsyncBus). called with the java lock
+        public void beginTransaction()
+        {
+            _txBytes = 0;
+            if(_bus != null && !_busLocked)
+            {
+                _bus.lock();
+                _busLocked = true;
+            }
+        }
+
+        public void endTransaction()
+        {
+            if(_busLocked)
+            {
+                _busLocked = false;
+                _bus.unlock();
+            }
+        }
+
+        public void close()
+        {
+            endTransaction();
+            if(_shared != null)
+            {
+                synchronized(Servo.class)
+                {
+                    if(--_shared.refCount == 0)
+                    {   // last one on the port, the bus gets deleted
+                        if(_shared.metrics != null)
+                        {
+                            if(_metricsServer != null)
+                                _metricsServer.remove(_shared.metrics);
+                            // before the bus, the finalizer would touch it afterwards
+                            _shared.metrics.delete();
+                        }
+                        if(_shared.history != null)
+                        {
+                            _bus.setHistory(null);
+                            _shared.history.delete();
+                        }
+                        _sharedBuses.remove(_shared.devStr);
+                    }
+                    BusRegistry.release(_bus);
+                }
+            }
+            else if(_nativeSerial != null)
+                _nativeSerial.close();
+            else if(_p5Serial != null)
+                _p5Serial.stop();
+
+            _shared = null;
+            _bus = null;
+            _nativeSerial = null;
+            _p5Serial = null;
         }
 
         public void clear()
@@ -257,8 +376,12 @@ public class Servo
                 _p5Serial.clear();
         }
 
+        // bytes written since beginTransaction, for the metrics
+        public int txBytes() { return _txBytes; }
+
         public void write(int data)
         {
+            _txBytes++;
             if(_nativeSerial != null)
                 _nativeSerial.write(data);
             else
@@ -314,6 +437,25 @@ public class Servo
     protected boolean                                   _regWriteFlag = false;
     protected int 					_regWriteDelay = 2;
     protected Object					_lock = new Object();
+    protected BusMetrics                                _metrics = null;
+    protected TelemetryHistory                          _history = null;
+    protected GroupMove                                 _groupMove = null;
+    protected FastBus                                   _fast = null;     // jni path of the hot ops, native serial only
+    protected byte[]                                    _fastData = new byte[DX_BROADCAST_ID * 8];
+
+    protected static MetricsServer                      _metricsServer = null;
+
+    // java side of a port in the BusRegistry, shared by all Servo objects on it
+    static class SharedBus
+    {
+        public String       devStr;
+        public Object       lock = new Object();
+        public BusMetrics   metrics = null;
+        public TelemetryHistory history = null;
+        public int          refCount = 0;
+    }
+
+    protected static HashMap<String,SharedBus>          _sharedBuses = new HashMap<String,SharedBus>();
 
     PApplet						_parent;
 	
@@ -336,13 +478,83 @@ public class Servo
         _serial.clear();
     }
 
-    public void init(String serialDev,int baudRate)
+    // false if the port can't be opened or is already open with another
+    // baudrate, the Servo then ignores all writes
+    public boolean init(String serialDev,int baudRate)
     {
         loadExtLib();
 
         _serial = new SerialWrapper(serialDev, baudRate);
+        _lock = _serial.lock();
+        _parent = null;
+        _serial.clear();
+
+        if(FastBus.isAvailable())
+            _fast = new FastBus(_serial.bus());
+        return _serial.isOpen();
+    }
+
+    public boolean isOpen()
+    {
+        return _serial != null && _serial.isOpen();
+    }
+
+    public void init(SerialBase serial)
+    {
+        loadExtLib();
+
+        _serial = new SerialWrapper(serial);
         _parent = null;
         _serial.clear();
+
+        if(FastBus.isAvailable())
+            _fast = new FastBus(_serial.bus());
+    }
+
+    // the hot ops go through FastBus (jni) when the native lib has it,
+    // false keeps them on the byte wise SerialWrapper path
+    public void setFastPath(boolean enable)
+    {
+        synchronized(_lock)
+        {
+            if(enable && _serial != null && _serial.bus() != null && FastBus.isAvailable())
+                _fast = new FastBus(_serial.bus());
+            else
+                _fast = null;
+        }
+    }
+
+    public boolean fastPath() { return _fast != null; }
+
+    // releases the port, the last Servo on a shared port closes it
+    public void close()
+    {
+        if(_serial == null)
+            return;
+
+        synchronized(_lock)
+        {
+            if(_serial.shared() == null && _metrics != null)
+            {
+                if(_metricsServer != null)
+                    _metricsServer.remove(_metrics);
+                _metrics.delete();
+            }
+            if(_serial.shared() == null && _history != null)
+            {
+                bus().setHistory(null);
+                _history.delete();
+            }
+            if(_groupMove != null)
+                _groupMove.delete();
+            _metrics = null;
+            _history = null;
+            _groupMove = null;
+            _fast = null;
+
+            _serial.close();
+            _serial = null;
+        }
     }
 
     public void setSerialType(int type)
@@ -367,6 +579,73 @@ public class Servo
 
     public SerialWrapper serial() { return _serial; }
 
+    // native packet layer, only available with the c++ serial
+    public DxBus bus() { return _serial.bus(); }
+
+    // serves the bus counters in the prometheus text format on http://localhost:port/
+    public boolean startMetrics(String name,int port)
+    {
+        if(bus() == null)
+            return false;
+
+        synchronized(Servo.class)
+        {
+            // one metrics object per bus, the shared one lives as long as the port
+            SharedBus shared = _serial.shared();
+            if(_metrics == null && shared != null)
+                _metrics = shared.metrics;
+            if(_metrics == null)
+                _metrics = new BusMetrics(bus(),name);
+            if(shared != null)
+                shared.metrics = _metrics;
+
+            if(_metricsServer == null)
+                _metricsServer = new MetricsServer();
+            _metricsServer.add(_metrics);
+            return _metricsServer.start(port);
+        }
+    }
+
+    public BusMetrics metrics() { return _metrics; }
+
+    // keeps the telemetry of every read in decimated rings, capacity points
+    // per level (see TelemetryHistory). native serial only
+    public TelemetryHistory startHistory(int capacity)
+    {
+        if(bus() == null)
+            return null;
+
+        synchronized(Servo.class)
+        {
+            // like the metrics, one history per bus
+            SharedBus shared = _serial.shared();
+            if(_history == null && shared != null)
+                _history = shared.history;
+            if(_history == null)
+            {
+                _history = new TelemetryHistory(capacity);
+                bus().setHistory(_history);
+            }
+            if(shared != null)
+                shared.history = _history;
+            return _history;
+        }
+    }
+
+    public TelemetryHistory startHistory() { return startHistory(512); }
+
+    public TelemetryHistory history() { return _history; }
+
+    // the ids of all servos on the bus, uniform sync writes to all of them
+    // become one broadcast WRITE_DATA. native serial only
+    public boolean setBusServos(int[] idList)
+    {
+        if(bus() == null)
+            return false;
+        bus().setServoIds(idList,idList.length);
+        return true;
+    }
+
 
     public final static int getMotorSerie(int modelNr)
     {
@@ -524,6 +803,21 @@ public class Servo
         }
     }
 
+    // moves all servos of the list and the port to baudRate (in bits/s), back
+    // to the old rate if one of them gets lost. returns the BaudMigration
+    // result, -1 without the native serial
+    public int migrateBaudrate(int[] idList,int baudRate)
+    {
+        if(bus() == null)
+            return -1;
+
+        BaudMigration migration = new BaudMigration(bus());
+        migration.migrate(idList,idList.length,baudRate);
+        int ret = migration.result();
+        migration.delete();
+        return ret;
+    }
+
     public int baudrate(int id)
     {
         synchronized(_lock)
@@ -540,6 +834,20 @@ public class Servo
         }
     }
 
+    // sets the smallest return delay each servo still answers reliably with on
+    // this adapter, or the largest of them for all if uniform. returns the
+    // mean round trip saved per read in us, -1 on failure. native serial only
+    public double optimizeDelayTime(int[] idList,boolean uniform)
+    {
+        if(bus() == null)
+            return -1;
+
+        ReturnDelayOptimizer optimizer = new ReturnDelayOptimizer(bus());
+        double ret = optimizer.optimize(idList,idList.length,uniform) ? optimizer.savedTime() : -1;
+        optimizer.delete();
+        return ret;
+    }
+
     public boolean setDelayTime(int id,int delayTime)
     {
         synchronized(_lock)
@@ -769,6 +1077,7 @@ public class Servo
     {
         synchronized(_lock)
         {
+            _serial.beginTransaction();
             if(_serialType == DX_SERIALTYPE_SYNC)
                 // block next few bytes for receiving
                 _serial.addReadBlockCount(6);
@@ -806,6 +1115,14 @@ public class Servo
     {
         synchronized(_lock)
         {
+            if(_fast != null)
+            {
+                boolean ret = _fast.ping(id);
+                _error = _fast.error();
+                return ret;
+            }
+
+            _serial.beginTransaction();
             if(_serialType == DX_SERIALTYPE_SYNC)
                 // block next few bytes for receiving
                 _serial.addReadBlockCount(6);
@@ -883,6 +1200,14 @@ public class Servo
     {
         synchronized(_lock)
         {
+            if(_fast != null)
+            {
+                boolean ret = _fast.action(id);
+                _error = _fast.error();
+                return ret;
+            }
+
+            _serial.beginTransaction();
             if(_serialType == DX_SERIALTYPE_SYNC)
                 // block next few bytes for receiving
                 _serial.addReadBlockCount(6);
@@ -912,8 +1237,9 @@ public class Servo
             if(id != DX_BROADCAST_ID)
                 // handle reply
                 return handleReturnStatus(id);
-            else
-                return true;
+
+            _serial.endTransaction();
+            return true;
         }
     }
 
@@ -936,10 +1262,37 @@ public class Servo
     }
 
 
+    // true once the packets are sent, the servos don't answer a broadcast.
+    // the same on the fast and the byte path
     public boolean syncWrite(int addr,int length,int[] idList,int[][] dataList)
     {
         synchronized(_lock)
         {
+            if(_fast != null && idList.length * length <= _fastData.length)
+            {
+                for(int i=0;i < idList.length;i++)
+                    for(int j=0;j < length;j++)
+                        _fastData[i * length + j] = (byte)dataList[i][j];
+
+                boolean ret = _fast.syncWrite(addr,length,idList,idList.length,_fastData);
+                _error = _fast.error();
+                return ret;
+            }
+
+            // the length byte can't take more, the rest goes into further packets
+            int capacity = (DX_MAX_PARAM_LENGTH - 2) / (length + 1);
+            if(idList.length > capacity)
+            {
+                boolean ret = true;
+                for(int start=0;start < idList.length && ret;start += capacity)
+                {
+                    int end = Math.min(idList.length,start + capacity);
+                    ret = syncWrite(addr,length,Arrays.copyOfRange(idList,start,end),Arrays.copyOfRange(dataList,start,end));
+                }
+                return ret;
+            }
+
+            _serial.beginTransaction();
             if(_serialType == DX_SERIALTYPE_SYNC)
                 // block next few bytes for receiving
                 _serial.addReadBlockCount(8 + idList.length + idList.length * length);
@@ -988,14 +1341,19 @@ public class Servo
 
             // checksum
             _serial.write(calcChecksum(_curChecksum));
+            _serial.endTransaction();
 
-            // no return because of broadcast sending
-            return false;
+            // no return because of broadcast sending, true once it's out
+            // like DxBus::syncWrite of the fast path
+            return true;
         }
     }
 
     public boolean syncWriteGoalPosition(int[] idList,int[] posList)
     {
+        if(_fast != null)
+            return fastSyncWriteWord(DX_CMD_GOAL_POS,idList,posList);
+
         int[][] dataList = new int[idList.length][2];
         for(int i=0;i < idList.length;i++)
         {
@@ -1007,8 +1365,26 @@ public class Servo
         return syncWrite(DX_CMD_GOAL_POS,2,idList,dataList);
     }
 
+    // all servos arrive at their goal after duration ms, goal and speed in one
+    // sync write, the start positions come from the last reads. native serial only
+    public boolean groupMove(int[] idList,int[] goalList,int duration)
+    {
+        if(bus() == null)
+            return false;
+
+        synchronized(_lock)
+        {
+            if(_groupMove == null)
+                _groupMove = new GroupMove(bus());
+            return _groupMove.move(idList,idList.length,goalList,duration);
+        }
+    }
+
     public boolean syncWriteMovingSpeed(int[] idList,int[] speedList)
     {
+        if(_fast != null)
+            return fastSyncWriteWord(DX_CMD_MOV_SPEED,idList,speedList);
+
         int[][] dataList = new int[idList.length][2];
         for(int i=0;i < idList.length;i++)
         {
@@ -1022,6 +1398,9 @@ public class Servo
 
     public boolean syncWriteMovingSpeed(int[] idList,int speed)
     {
+        if(_fast != null && idList.length * 2 <= _fastData.length)
+            return fastSyncWriteUniform(DX_CMD_MOV_SPEED,2,idList,speed);
+
         int[][] dataList = new int[idList.length][2];
         for(int i=0;i < idList.length;i++)
         {
@@ -1047,6 +1426,9 @@ public class Servo
 
     public boolean syncWriteTorqueEnable(int[] idList,boolean torque)
     {
+        if(_fast != null && idList.length <= _fastData.length)
+            return fastSyncWriteUniform(DX_CMD_TORQUE_ENABLE,1,idList,torque ? 1:0);
+
         int[][] dataList = new int[idList.length][1];
         for(int i=0;i < idList.length;i++)
         {
@@ -1142,6 +1524,9 @@ public class Servo
     {
         synchronized(_lock)
         {
+            if(_fast != null)
+                return fastWriteWord(id,DX_CMD_MOV_SPEED,speed);
+
             writeData2Bytes(id,DX_CMD_MOV_SPEED,speed,_regWriteFlag);
 
             // handle reply
@@ -1388,6 +1773,9 @@ public class Servo
     {
         synchronized(_lock)
         {
+            if(_fast != null)
+                return fastWriteWord(id,DX_CMD_GOAL_POS,pos);
+
             writeData2Bytes(id,DX_CMD_GOAL_POS,pos,_regWriteFlag);
 
             // handle reply
@@ -1399,6 +1787,9 @@ public class Servo
     {
         synchronized(_lock)
         {
+            if(_fast != null)
+                return fastReadWord(id,DX_CMD_GOAL_POS);
+
             readData(id,DX_CMD_GOAL_POS,2);
             if(handleReturnStatus(id))
             {
@@ -1429,6 +1820,9 @@ System.out.println("xxx readtime:" + (System.currentTimeMillis()- startTime));
 */
         synchronized(_lock)
         {
+            if(_fast != null)
+                return fastReadWord(id,DX_CMD_PRESENT_POS);
+
             readData(id,DX_CMD_PRESENT_POS,2);
             if(handleReturnStatus(id))
             {
@@ -1451,6 +1845,9 @@ System.out.println("xxx readtime:" + (System.currentTimeMillis()- startTime));
     {
         synchronized(_lock)
         {
+            if(_fast != null)
+                return fastReadWord(id,DX_CMD_PRESENT_SPEED);
+
             readData(id,DX_CMD_PRESENT_SPEED,2);
             if(handleReturnStatus(id))
             {
@@ -1467,6 +1864,9 @@ System.out.println("xxx readtime:" + (System.currentTimeMillis()- startTime));
     {
         synchronized(_lock)
         {
+            if(_fast != null)
+                return fastReadWord(id,DX_CMD_PRESENT_LOAD);
+
             readData(id,DX_CMD_PRESENT_LOAD,2);
             if(handleReturnStatus(id))
             {
@@ -1483,6 +1883,9 @@ System.out.println("xxx readtime:" + (System.currentTimeMillis()- startTime));
     {
         synchronized(_lock)
         {
+            if(_fast != null)
+                return fastReadWord(id,DX_CMD_PRESENT_VOLT);
+
             readData(id,DX_CMD_PRESENT_VOLT,2);
             if(handleReturnStatus(id))
             {
@@ -1499,6 +1902,9 @@ System.out.println("xxx readtime:" + (System.currentTimeMillis()- startTime));
     {
         synchronized(_lock)
         {
+            if(_fast != null)
+                return fastReadWord(id,DX_CMD_PRESENT_TEMP);
+
             readData(id,DX_CMD_PRESENT_TEMP,2);
             if(handleReturnStatus(id))
             {
@@ -1670,6 +2076,7 @@ System.out.println("xxx readtime:" + (System.currentTimeMillis()- startTime));
   
     protected synchronized boolean writeData2Bytes(int id,int addr,int data,boolean regWrite)
     {
+        _serial.beginTransaction();
         if(_serialType == DX_SERIALTYPE_SYNC)
             // block next few bytes for receiving
             _serial.addReadBlockCount(9);
@@ -1723,6 +2130,7 @@ System.out.println("xxx readtime:" + (System.currentTimeMillis()- startTime));
 
     protected synchronized boolean writeDataByte(int id,int addr,int data,boolean regWrite)
     {
+        _serial.beginTransaction();
         if(_serialType == DX_SERIALTYPE_SYNC)
             // block next few bytes for receiving
             _serial.addReadBlockCount(8);
@@ -1765,8 +2173,49 @@ System.out.println("xxx readtime:" + (System.currentTimeMillis()- startTime));
         return true;
     }
 
+    protected int fastReadWord(int id,int addr)
+    {
+        int ret = _fast.readWord(id,addr);
+        _error = _fast.error();
+        return ret;
+    }
+
+    protected boolean fastWriteWord(int id,int addr,int data)
+    {
+        boolean ret = _fast.writeWord(id,addr,data,_regWriteFlag);
+        _error = _fast.error();
+        return ret;
+    }
+
+    protected boolean fastSyncWriteWord(int addr,int[] idList,int[] valueList)
+    {
+        synchronized(_lock)
+        {
+            boolean ret = _fast.syncWriteWord(addr,idList,valueList,idList.length);
+            _error = _fast.error();
+            return ret;
+        }
+    }
+
+    // the same value for every servo, the native bus sends it as one
+    // broadcast if the list covers the whole bus (see setBusServos())
+    protected boolean fastSyncWriteUniform(int addr,int length,int[] idList,int value)
+    {
+        synchronized(_lock)
+        {
+            for(int i=0;i < idList.length;i++)
+                for(int j=0;j < length;j++)
+                    _fastData[i * length + j] = (byte)(value >> (8 * j));
+
+            boolean ret = _fast.syncWrite(addr,length,idList,idList.length,_fastData);
+            _error = _fast.error();
+            return ret;
+        }
+    }
+
     protected  boolean readData(int id,int addr,int readLength)
     {
+        _serial.beginTransaction();
         if(_serialType == DX_SERIALTYPE_SYNC)
             // block next few bytes for receiving
             _serial.addReadBlockCount(8);
@@ -1807,22 +2256,46 @@ System.out.println("xxx readtime:" + (System.currentTimeMillis()- startTime));
 
     protected boolean handleReturnStatus(int id)
     {
-        if(readStatus(_returnPacket) == false)
-            return false;
+        long startTime = System.nanoTime();
+        boolean ret;
+        try
+        {
+            ret = readStatus(_returnPacket);
+        }
+        finally
+        {
+            _serial.endTransaction();
+        }
 
-        _error = _returnPacket.error;
-        if(_returnPacket.id != id || _error != 0)
+        if(ret)
         {
-            _error |= DX_ERROR_USR_ID;
-            return false;
+            _error = _returnPacket.error;
+            if(_returnPacket.id != id || _error != 0)
+            {
+                _error |= DX_ERROR_USR_ID;
+                ret = false;
+            }
         }
-        else
-            return true;
+
+        if(_metrics != null)
+            _metrics.addTransaction(id,_error,(int)((System.nanoTime() - startTime) / 1000),_serial.txBytes(),ret ? _returnPacket.length + 4 : 0);
+
+        return ret;
     }
 
     protected boolean handleReturnStatus()
     {
-        if(readStatus(_returnPacket) == false)
+        boolean ret;
+        try
+        {
+            ret = readStatus(_returnPacket);
+        }
+        finally
+        {
+            _serial.endTransaction();
+        }
+
+        if(ret == false)
         {
             _error = DX_ERROR_USR_READSTATUS;
             return false;
@@ -1869,7 +2342,12 @@ System.out.println("xxx readtime:" + (System.currentTimeMillis()- startTime));
         for(int i=0; i < returnPacket.length-2; i++)
             returnPacket.param.add(_serial.read());
 
-        return(returnPacket.checksum() == _serial.read());
+        if(returnPacket.checksum() != _serial.read())
+        {
+            _error |= DX_ERROR_USR_READSTATUS | DX_ERROR_USR_CHECKSUM;
+            return false;
+        }
+        return true;
     }
 
     protected boolean readStart(int timeout)
@@ -1981,6 +2459,9 @@ System.out.println("xxx readtime:" + (System.currentTimeMillis()- startTime));
         if((error & DX_ERROR_USR_DATA_TIMEOUT) > 0)
             retStr += "Status Packet - Data timeout\n";
 
+        if((error & DX_ERROR_USR_CHECKSUM) > 0)
+            retStr += "Status Packet - Checksum error\n";
+
         return retStr;
     }
 
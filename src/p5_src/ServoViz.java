@@ -55,6 +55,23 @@ public class ServoViz
   protected int         _error = Servo.DX_ERROR_NO;
 
   protected PVector     _bknColor = new PVector(255,255,255);
+
+  // cached static layer of the dial, see updateDial()
+  protected static final int DIAL_MARGIN = 2;
+
+  protected PGraphics   _dial = null;
+  protected float       _dialR = 0;
+  protected int         _dialLimitCW = -1;
+  protected int         _dialLimitCCW = -1;
+  protected PVector     _dialColor = new PVector();
+
+  protected DecimalFormat _angleFormat = new DecimalFormat("0.00");
+
+  // history plot, one point per pixel column at most
+  protected float[]     _histTime = new float[0];
+  protected float[]     _histMin = new float[0];
+  protected float[]     _histMax = new float[0];
+  protected float[]     _histMean = new float[0];
   
   public ServoViz(Servo servo,int id,int range,int deadAngle)
   {
@@ -119,10 +136,10 @@ public class ServoViz
 	_updateCounter++;
   }
 
-    public void draw(PGraphics g,float r)
-    {	
-        g.pushStyle();
-
+    // the dial without the needle, it only changes with the limits, the size
+    // and the error color
+    protected void drawDial(PGraphics g,float r)
+    {
         // range
         g.fill(_bknColor.x,_bknColor.y,_bknColor.z,40);
         g.noStroke();
@@ -150,17 +167,6 @@ public class ServoViz
 		}		
         g.popMatrix();
 
-        // draw pos
-        float angle = _resQ * (_range - _pos) + (float)Math.toRadians(_deadAngle) * .5f;
-
-        // draw the current pos
-        g.strokeWeight(3.0f);
-        g.stroke(240,10,3,150);
-        g.pushMatrix();
-        g.rotate(angle);
-        g.line(0,r,0,0);
-        g.popMatrix();
-
         // limits
         float limitCWAngle = _resQ * (_range - _limitCW);
         float limitCCWAngle = _resQ * (_range - _limitCCW);
@@ -177,18 +183,74 @@ public class ServoViz
         g.rotate(limitCCWAngle);
         g.line(0,r * .9f,0,r * .4f);
         g.popMatrix();
+    }
+
+    protected boolean dialChanged(float r)
+    {
+        return _dial == null || r != _dialR ||
+               _limitCW != _dialLimitCW || _limitCCW != _dialLimitCCW ||
+               _bknColor.x != _dialColor.x || _bknColor.y != _dialColor.y || _bknColor.z != _dialColor.z;
+    }
+
+    protected void updateDial(PGraphics g,float r)
+    {
+        int size = (int)Math.ceil(r * 2) + DIAL_MARGIN * 2;
+        if(_dial == null || _dial.width != size)
+        {
+            _dial = g.parent.createGraphics(size,size);
+            if(_dial == null)
+                return;
+            _dial.smooth();
+        }
+
+        _dial.beginDraw();
+        _dial.background(0,0);
+        _dial.translate(size * .5f,size * .5f);
+        drawDial(_dial,r);
+        _dial.endDraw();
+
+        _dialR = r;
+        _dialLimitCW = _limitCW;
+        _dialLimitCCW = _limitCCW;
+        _dialColor.set(_bknColor);
+    }
+
+    public void draw(PGraphics g,float r)
+    {	
+        g.pushStyle();
+
+        // the static layer comes from the cache, only needle and text get drawn
+        if(g.parent != null && dialChanged(r))
+            updateDial(g,r);
+
+        if(g.parent != null && _dial != null)
+        {
+            g.imageMode(PConstants.CORNER);
+            g.image(_dial,-_dial.width * .5f,-_dial.height * .5f);
+        }
+        else
+            drawDial(g,r);
+
+        // draw pos
+        float angle = _resQ * (_range - _pos) + (float)Math.toRadians(_deadAngle) * .5f;
+
+        // draw the current pos
+        g.strokeWeight(3.0f);
+        g.stroke(240,10,3,150);
+        g.pushMatrix();
+        g.rotate(angle);
+        g.line(0,r,0,0);
+        g.popMatrix();
 
         int posX = (int)-r;
         int posY = (int)r + 20;
 
-        DecimalFormat df = new DecimalFormat("0.00");
-		
 		g.stroke(255);
 		g.fill(255);
         g.text("id: " + _id, posX,posY);
 
 		posY += 20;
-                g.text("angle: " + df.format(Math.toDegrees(_resQ * _pos)), posX,posY);
+                g.text("angle: " + _angleFormat.format(Math.toDegrees(_resQ * _pos)), posX,posY);
 
 		posY += 20;
         g.text("pos: " + _pos, posX, posY);
@@ -212,5 +274,72 @@ public class ServoViz
 
 	}
 
+    // min/max band and mean of a TelemetryHistory channel over the last
+    // window ms, newest at the right. needs servo.startHistory()
+    public void drawHistory(PGraphics g,float w,float h,int channel,float window)
+    {
+        TelemetryHistory history = _servo.history();
+        if(history == null || w < 2)
+            return;
+
+        int maxPoints = (int)w;
+        if(_histTime.length != maxPoints)
+        {
+            _histTime = new float[maxPoints];
+            _histMin = new float[maxPoints];
+            _histMax = new float[maxPoints];
+            _histMean = new float[maxPoints];
+        }
+
+        int count = history.get(_id,channel,window,maxPoints,_histTime,_histMin,_histMax,_histMean);
+
+        g.pushStyle();
+
+        g.noFill();
+        g.strokeWeight(1.0f);
+        g.stroke(255,255,255,170);
+        g.rect(0,0,w,h);
+
+        if(count > 0)
+        {
+            float minValue = _histMin[0];
+            float maxValue = _histMax[0];
+            for(int i=1;i < count;i++)
+            {
+                minValue = Math.min(minValue,_histMin[i]);
+                maxValue = Math.max(maxValue,_histMax[i]);
+            }
+            float range = Math.max(maxValue - minValue,1.0f);
+            float scaleX = w / window;
+            float scaleY = h / range;
+
+            // band
+            g.noStroke();
+            g.fill(240,10,3,60);
+            g.beginShape(PConstants.QUAD_STRIP);
+            for(int i=0;i < count;i++)
+            {
+                float x = w - _histTime[i] * scaleX;
+                g.vertex(x,h - (_histMax[i] - minValue) * scaleY);
+                g.vertex(x,h - (_histMin[i] - minValue) * scaleY);
+            }
+            g.endShape();
+
+            // mean
+            g.noFill();
+            g.stroke(240,10,3,200);
+            g.beginShape();
+            for(int i=0;i < count;i++)
+                g.vertex(w - _histTime[i] * scaleX,h - (_histMean[i] - minValue) * scaleY);
+            g.endShape();
+
+            g.fill(255);
+            g.text((int)maxValue,2,12);
+            g.text((int)minValue,2,h - 2);
+        }
+
+        g.popStyle();
+    }
+
 
 }
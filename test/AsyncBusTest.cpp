@@ -0,0 +1,213 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// DxAsyncBus request pool: a full pool, the capacity coming back, cancel()
+// with stale handles and submits racing stop()
+
+#include "DxTest.h"
+#include "MemorySerial.h"
+#include "DxAsyncBus.h"
+
+struct Completion
+{
+    Completion(): done(false), ok(false), error(0) {}
+
+    dx::atomic<bool> done;
+    bool             ok;
+    int              error;
+
+    bool wait()
+    {
+        for(int i=0;i < 1000 && !done;i++)
+            dx::sleep(1);
+        return done;
+    }
+};
+
+static void completed(void* context,const DxResult& result)
+{
+    Completion* completion = static_cast<Completion*>(context);
+    completion->ok    = result.ok;
+    completion->error = result.error;
+    completion->done  = true;
+}
+
+static void setup(MemorySerial& serial)
+{
+    for(int id=1;id <= 3;id++)
+        serial.addServo(id);
+}
+
+// the test holds the bus, the io thread hangs in the first request
+static void testPool()
+{
+    MemorySerial serial;
+    setup(serial);
+    DxBus bus(&serial);
+    DxAsyncBus async(&bus,2);
+    DX_CHECK_EQUAL(async.available(),2);
+
+    Completion c[2];
+    bus.lock();
+    DX_CHECK(async.ping(1,&completed,&c[0]) > 0);
+    dx::sleep(10);
+    DX_CHECK(async.ping(2,&completed,&c[1]) > 0);
+    DX_CHECK_EQUAL(async.available(),0);
+    DX_CHECK_EQUAL(async.queued(),1);
+
+    Completion refused;
+    DX_CHECK_EQUAL(async.ping(3,&completed,&refused),DX_ASYNC_BUSY);
+    DX_CHECK_EQUAL(async.read(3,DX_CMD_PRESENT_POS,2,&completed,&refused),DX_ASYNC_BUSY);
+    DX_CHECK_EQUAL(async.rejected(),2);
+    bus.unlock();
+
+    DX_CHECK(c[0].wait() && c[0].ok);
+    DX_CHECK(c[1].wait() && c[1].ok);
+    DX_CHECK(!refused.done);
+    DX_CHECK_EQUAL(async.available(),2);
+    DX_CHECK_EQUAL(async.queued(),0);
+
+    // room again
+    Completion again;
+    DX_CHECK(async.ping(3,&completed,&again) > 0);
+    DX_CHECK(again.wait() && again.ok);
+    DX_CHECK_EQUAL(async.rejected(),2);
+}
+
+static void testCancel()
+{
+    MemorySerial serial;
+    setup(serial);
+    DxBus bus(&serial);
+    DxAsyncBus async(&bus,2);
+
+    Completion running,queued;
+    bus.lock();
+    int runningHandle = async.ping(1,&completed,&running);
+    dx::sleep(10);
+    int queuedHandle = async.ping(2,&completed,&queued);
+
+    // the queued one completes at once on this thread, the running one can't
+    DX_CHECK(!async.cancel(runningHandle));
+    DX_CHECK(async.cancel(queuedHandle));
+    DX_CHECK(queued.done);
+    DX_CHECK_EQUAL(queued.error,DX_ERROR_USR_CANCELED);
+    DX_CHECK(!async.cancel(queuedHandle));
+    DX_CHECK(!async.cancel(0));
+    DX_CHECK(!async.cancel(-1));
+    bus.unlock();
+
+    DX_CHECK(running.wait() && running.ok);
+    for(int i=0;i < 100 && async.available() < 2;i++)
+        dx::sleep(1);
+    DX_CHECK_EQUAL(async.available(),2);
+}
+
+// a handle of a finished request doesn't cancel the next one in its slot
+static void testStaleHandle()
+{
+    MemorySerial serial;
+    setup(serial);
+    DxBus bus(&serial);
+    DxAsyncBus async(&bus,2);
+
+    Completion first;
+    int stale = async.ping(1,&completed,&first);
+    DX_CHECK(first.wait());
+
+    // the other slot runs, the one of the first request gets queued
+    Completion running,queued;
+    bus.lock();
+    DX_CHECK(async.ping(2,&completed,&running) > 0);
+    dx::sleep(10);
+    int handle = async.ping(3,&completed,&queued);
+    DX_CHECK_EQUAL((handle - 1) % async.capacity(),(stale - 1) % async.capacity());
+    DX_CHECK(handle != stale);
+
+    DX_CHECK(!async.cancel(stale));
+    DX_CHECK(!queued.done);
+    bus.unlock();
+
+    DX_CHECK(running.wait() && running.ok);
+    DX_CHECK(queued.wait() && queued.ok);
+    DX_CHECK_EQUAL(queued.error,DX_ERROR_NO);
+}
+
+struct Submitter
+{
+    DxAsyncBus*      async;
+    dx::atomic<bool> stop;
+    dx::atomic<int>  stopped;
+};
+
+static void noCompletion(void*,const DxResult&)
+{}
+
+static void submit(Submitter* s)
+{
+    while(!s->stop)
+    {
+        if(s->async->ping(1,&noCompletion,NULL) == DX_ASYNC_STOPPED)
+            s->stopped++;
+    }
+}
+
+// submits which lose the race with stop() give their request back
+static void testStopRace()
+{
+    MemorySerial serial;
+    setup(serial);
+    DxBus bus(&serial);
+
+    for(int i=0;i < 50;i++)
+    {
+        DxAsyncBus async(&bus,4);
+        Submitter  s;
+        s.async   = &async;
+        s.stop    = false;
+        s.stopped = 0;
+
+        dx::thread a(&submit,&s);
+        dx::thread b(&submit,&s);
+        dx::sleep(1);
+        async.stop();
+        dx::sleep(2);
+        s.stop = true;
+        a.join();
+        b.join();
+
+        DX_CHECK(!async.isRunning());
+        DX_CHECK(s.stopped > 0);
+        DX_CHECK_EQUAL(async.queued(),0);
+        DX_CHECK_EQUAL(async.available(),async.capacity());
+    }
+}
+
+int main()
+{
+    DX_RUN(testPool);
+    DX_RUN(testCancel);
+    DX_RUN(testStaleHandle);
+    DX_RUN(testStopRace);
+    return DX_TEST_RESULT();
+}
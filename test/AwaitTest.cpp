@@ -0,0 +1,238 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// DxAwait coroutines on fake servos: results, dxWhenAll, timeouts,
+// cancellation and the executor. needs -DDX_COROUTINES=1 (c++20)
+
+#include "DxTest.h"
+#include "MemorySerial.h"
+#include "DxAwait.h"
+
+#include <deque>
+#include <thread>
+
+#define  SERVO_COUNT    (3)
+
+struct Fixture
+{
+    Fixture():
+        bus(&serial),
+        asyncBus(&bus)
+    {
+        for(int id=1;id <= SERVO_COUNT;id++)
+        {
+            serial.addServo(id);
+            serial.setRegWord(id,DX_CMD_PRESENT_POS,100 * id);
+        }
+        bus.setTimeout(1);
+    }
+
+    MemorySerial serial;
+    DxBus        bus;
+    DxAsyncBus   asyncBus;
+};
+
+struct Outcome
+{
+    std::atomic<bool> done{false};
+    DxResult          result;
+    std::thread::id   thread;       // resumed on
+
+    bool wait()
+    {
+        for(int i=0;i < 1000 && !done;i++)
+            dx::sleep(1);
+        return done;
+    }
+};
+
+static DxTask<int> readPosition(DxAwaitBus& bus,int id)
+{
+    DxResult result = co_await bus.read(id,DX_CMD_PRESENT_POS,2);
+    co_return result.word();
+}
+
+static DxTask<void> readInto(DxAwaitBus& bus,int id,int timeout,Outcome& outcome)
+{
+    outcome.result = co_await bus.read(id,DX_CMD_PRESENT_POS,2,timeout);
+    outcome.thread = std::this_thread::get_id();
+    outcome.done = true;
+}
+
+static void testRead()
+{
+    Fixture f;
+    DxAwaitBus bus(f.asyncBus);
+    DX_CHECK_EQUAL(dxSyncWait(readPosition(bus,2)),200);
+    DX_CHECK_EQUAL(dxSyncWait(readPosition(bus,7)),-1);
+}
+
+static void testWhenAll()
+{
+    Fixture f;
+    DxAwaitBus bus(f.asyncBus);
+
+    std::vector<int> ids = { 3, 7, 1, 2 };
+    std::vector<DxResult> results = dxSyncWait(dxReadAll(bus,ids,DX_CMD_PRESENT_POS,2));
+    DX_CHECK_EQUAL(results.size(),4);
+    DX_CHECK_EQUAL(results[0].word(),300);
+    DX_CHECK(!results[1].ok);
+    DX_CHECK_EQUAL(results[2].word(),100);
+    DX_CHECK_EQUAL(results[3].word(),200);
+
+    std::vector<DxTask<int> > tasks;
+    dxSyncWait(dxWhenAll(std::move(tasks)));
+}
+
+// the bus is held by the test, a request behind it waits too long
+static void testTimeout()
+{
+    Fixture f;
+    DxAwaitBus bus(f.asyncBus);
+
+    Outcome first,late;
+    f.bus.lock();
+    dxSpawn(readInto(bus,1,0,first));
+    dx::sleep(10);
+    dxSpawn(readInto(bus,2,10,late));
+    dx::sleep(50);
+    f.bus.unlock();
+
+    DX_CHECK(first.wait());
+    DX_CHECK(late.wait());
+    DX_CHECK(first.result.ok);
+    // without an executor on the io thread
+    DX_CHECK(first.thread != std::this_thread::get_id());
+    DX_CHECK(!late.result.ok);
+    DX_CHECK_EQUAL(late.result.error,DX_ERROR_USR_EXPIRED);
+}
+
+static void testCancel()
+{
+    Fixture f;
+    DxCancelToken token;
+    DxAwaitBus bus(f.asyncBus,DxExecutor(),&token);
+    DxAwaitBus plain(f.asyncBus);
+
+    // one on the bus, two queued behind it
+    Outcome running,queued[2];
+    f.bus.lock();
+    dxSpawn(readInto(plain,1,0,running));
+    dx::sleep(10);
+    dxSpawn(readInto(bus,2,0,queued[0]));
+    dxSpawn(readInto(bus,3,0,queued[1]));
+    DX_CHECK_EQUAL(token.requestCount(),2);
+
+    token.cancel();
+    DX_CHECK(token.isCanceled());
+    for(int i=0;i < 2;i++)
+    {
+        DX_CHECK(queued[i].wait());
+        DX_CHECK_EQUAL(queued[i].result.error,DX_ERROR_USR_CANCELED);
+    }
+    DX_CHECK_EQUAL(token.requestCount(),0);
+    f.bus.unlock();
+    DX_CHECK(running.wait());
+    DX_CHECK(running.result.ok);
+
+    // later awaits don't get queued
+    Outcome after;
+    dxSpawn(readInto(bus,1,0,after));
+    DX_CHECK(after.done);
+    DX_CHECK_EQUAL(after.result.error,DX_ERROR_USR_CANCELED);
+}
+
+// requests which complete before their await adds them don't stay in the token
+static void testTokenRequests()
+{
+    Fixture f;
+    DxCancelToken token;
+    DxAwaitBus bus(f.asyncBus,DxExecutor(),&token);
+
+    for(int i=0;i < 500;i++)
+        DX_CHECK_EQUAL(dxSyncWait(readPosition(bus,1 + i % SERVO_COUNT)),100 * (1 + i % SERVO_COUNT));
+    DX_CHECK_EQUAL(token.requestCount(),0);
+}
+
+// the executor resumes the coroutines on the test thread
+static void testExecutor()
+{
+    Fixture f;
+
+    std::mutex                            mutex;
+    std::deque<std::coroutine_handle<> >  handles;
+    DxExecutor executor = [&](std::coroutine_handle<> h)
+    {
+        std::lock_guard<std::mutex> l(mutex);
+        handles.push_back(h);
+    };
+    DxAwaitBus bus(f.asyncBus,executor);
+
+    Outcome outcome[SERVO_COUNT];
+    for(int i=0;i < SERVO_COUNT;i++)
+        dxSpawn(readInto(bus,1 + i,0,outcome[i]));
+
+    std::thread::id self = std::this_thread::get_id();
+    int resumed = 0;
+    for(int i=0;i < 1000 && resumed < SERVO_COUNT;i++)
+    {
+        std::coroutine_handle<> h;
+        {
+            std::lock_guard<std::mutex> l(mutex);
+            if(!handles.empty())
+            {
+                h = handles.front();
+                handles.pop_front();
+            }
+        }
+        if(!h)
+        {
+            dx::sleep(1);
+            continue;
+        }
+        h.resume();
+        resumed++;
+    }
+
+    DX_CHECK_EQUAL(resumed,SERVO_COUNT);
+    for(int i=0;i < SERVO_COUNT;i++)
+    {
+        DX_CHECK(outcome[i].done);
+        DX_CHECK(outcome[i].thread == self);
+        DX_CHECK_EQUAL(outcome[i].result.word(),100 * (1 + i));
+    }
+}
+
+int main()
+{
+    DX_RUN(testRead);
+    DX_RUN(testWhenAll);
+    DX_RUN(testTimeout);
+    DX_RUN(testCancel);
+    DX_RUN(testTokenRequests);
+    DX_RUN(testExecutor);
+
+    // every frame is gone
+    DX_CHECK_EQUAL(dxTaskFrameBytes().load(),0);
+    return DX_TEST_RESULT();
+}
@@ -0,0 +1,163 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// BaudMigration against fake servos which only hear their own baudrate:
+// the switch, the rollback and a rollback which loses servos
+
+#include "DxTest.h"
+#include "MemorySerial.h"
+#include "BaudMigration.h"
+
+#define  OLD_RATE   (57600)
+#define  NEW_RATE   (1000000)
+
+// servos which keep their baudrate register after the first changes
+class StuckSerial: public MemorySerial
+{
+public:
+    StuckSerial()
+    {
+        for(int i=0;i < DX_BROADCAST_ID;i++)
+        {
+            changes[i] = 1000;
+            _baud[i] = 0;
+        }
+    }
+
+    void add(int id)
+    {
+        addServo(id);
+        setReg(id,DX_CMD_BAUDRATE,dxBaudRegister(OLD_RATE));
+        _baud[id] = reg(id,DX_CMD_BAUDRATE);
+    }
+
+    // changes of the baudrate register the servo still takes
+    int changes[DX_BROADCAST_ID];
+
+protected:
+    void written(int id,int addr,int length)
+    {
+        if(addr > DX_CMD_BAUDRATE || addr + length <= DX_CMD_BAUDRATE)
+            return;
+        if(changes[id] > 0)
+        {
+            changes[id]--;
+            _baud[id] = reg(id,DX_CMD_BAUDRATE);
+        }
+        else
+            setReg(id,DX_CMD_BAUDRATE,_baud[id]);
+    }
+
+    int _baud[DX_BROADCAST_ID];
+};
+
+static const int ids[] = { 1,2,3 };
+
+static void setup(StuckSerial& serial,DxBus& bus,BaudMigration& migration)
+{
+    for(int i=0;i < 3;i++)
+        serial.add(ids[i]);
+    serial.setBaudRate(OLD_RATE);
+    bus.setTimeout(1);
+    migration.setSettleTime(0);
+}
+
+static void testMigrate()
+{
+    StuckSerial   serial;
+    DxBus         bus(&serial);
+    BaudMigration migration(&bus);
+    setup(serial,bus,migration);
+
+    DX_CHECK(migration.migrate(ids,3,NEW_RATE));
+    DX_CHECK_EQUAL(migration.result(),DX_MIGRATION_OK);
+    DX_CHECK_EQUAL(serial.baudRate(),NEW_RATE);
+    for(int i=0;i < 3;i++)
+        DX_CHECK_EQUAL(serial.reg(ids[i],DX_CMD_BAUDRATE),dxBaudRegister(NEW_RATE));
+
+    DX_CHECK(!migration.migrate(ids,3,3000));
+    DX_CHECK_EQUAL(migration.result(),DX_MIGRATION_UNSUPPORTED);
+}
+
+static void testMissing()
+{
+    StuckSerial   serial;
+    DxBus         bus(&serial);
+    BaudMigration migration(&bus);
+    setup(serial,bus,migration);
+
+    const int more[] = { 1,2,3,4 };
+    DX_CHECK(!migration.migrate(more,4,NEW_RATE));
+    DX_CHECK_EQUAL(migration.result(),DX_MIGRATION_MISSING);
+    DX_CHECK_EQUAL(migration.failedCount(),1);
+    DX_CHECK_EQUAL(migration.failedId(0),4);
+    DX_CHECK_EQUAL(serial.baudRate(),OLD_RATE);
+    DX_CHECK_EQUAL(serial.reg(1,DX_CMD_BAUDRATE),dxBaudRegister(OLD_RATE));
+}
+
+// one servo doesn't switch, the others come back
+static void testRollback()
+{
+    StuckSerial   serial;
+    DxBus         bus(&serial);
+    BaudMigration migration(&bus);
+    setup(serial,bus,migration);
+    serial.changes[2] = 0;
+
+    DX_CHECK(!migration.migrate(ids,3,NEW_RATE));
+    DX_CHECK_EQUAL(migration.result(),DX_MIGRATION_ROLLED_BACK);
+    DX_CHECK_EQUAL(serial.baudRate(),OLD_RATE);
+    for(int i=0;i < 3;i++)
+    {
+        DX_CHECK_EQUAL(serial.reg(ids[i],DX_CMD_BAUDRATE),dxBaudRegister(OLD_RATE));
+        DX_CHECK(bus.ping(ids[i]));
+    }
+}
+
+// servo 3 switches but ignores the way back
+static void testRollbackFailed()
+{
+    StuckSerial   serial;
+    DxBus         bus(&serial);
+    BaudMigration migration(&bus);
+    setup(serial,bus,migration);
+    serial.changes[2] = 0;
+    serial.changes[3] = 1;
+
+    DX_CHECK(!migration.migrate(ids,3,NEW_RATE));
+    DX_CHECK_EQUAL(migration.result(),DX_MIGRATION_FAILED);
+    DX_CHECK_EQUAL(migration.failedCount(),1);
+    DX_CHECK_EQUAL(migration.failedId(0),3);
+    DX_CHECK_EQUAL(serial.baudRate(),OLD_RATE);
+    DX_CHECK_EQUAL(serial.reg(1,DX_CMD_BAUDRATE),dxBaudRegister(OLD_RATE));
+    DX_CHECK_EQUAL(serial.reg(3,DX_CMD_BAUDRATE),dxBaudRegister(NEW_RATE));
+}
+
+int main()
+{
+    DX_RUN(testMigrate);
+    DX_RUN(testMissing);
+    DX_RUN(testRollback);
+    DX_RUN(testRollbackFailed);
+    return DX_TEST_RESULT();
+}
@@ -0,0 +1,115 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// protocol 2.0 packet layer against canned status packets: the error
+// numbers of the servos and the ids of the replies
+
+#include "DxTest.h"
+#include "MemorySerial.h"
+#include "DxBus2.h"
+
+// answers every request with the same status packet
+class StatusSerial: public MemorySerial
+{
+public:
+    StatusSerial():
+        id(1),
+        error(0),
+        paramLength(0)
+    {
+        open();
+    }
+
+    int           id;
+    int           error;
+    unsigned char param[8];
+    int           paramLength;
+
+protected:
+    void send(const char* data,unsigned int len)
+    {
+        unsigned char status[1 + 8];
+        status[0] = error;
+        for(int i=0;i < paramLength;i++)
+            status[1 + i] = param[i];
+
+        unsigned char packet[DX2_MAX_PACKET_SIZE];
+        int size = DxBus2::encodePacket(id,DX2_INST_STATUS,status,1 + paramLength,packet);
+        received(reinterpret_cast<const char*>(packet),size);
+    }
+};
+
+static void testStatus()
+{
+    StatusSerial serial;
+    serial.param[0] = 0x06;
+    serial.param[1] = 0x04;
+    serial.param[2] = 0x26;
+    serial.paramLength = 3;
+    DxBus2 bus(&serial);
+    bus.setTimeout(1);
+
+    int modelNr = 0;
+    DX_CHECK(bus.ping(1,&modelNr));
+    DX_CHECK_EQUAL(modelNr,0x0406);
+    DX_CHECK_EQUAL(bus.error(),DX_ERROR_NO);
+
+    // the reply of another servo
+    DX_CHECK(!bus.ping(2));
+    DX_CHECK_EQUAL(bus.error(),DX_ERROR_USR_ID);
+}
+
+// error numbers don't turn into the bits of protocol 1.0
+static void testServoError()
+{
+    StatusSerial serial;
+    serial.error = DX2_ERROR_RANGE;
+    serial.paramLength = 2;
+    DxBus2 bus(&serial);
+    bus.setTimeout(1);
+
+    DX_CHECK_EQUAL(bus.readWord(1,DX2_CMD_PRESENT_CURRENT),-1);
+    DX_CHECK_EQUAL(bus.error(),DX2_ERROR_USR_SERVO);
+    DX_CHECK_EQUAL(bus.servoError(),DX2_ERROR_RANGE);
+    DX_CHECK((bus.error() & (DX_ERROR_OVERHEAT | DX_ERROR_USR_ID)) == 0);
+
+    // the alert bit alone still delivers the data
+    serial.error = DX2_ERROR_ALERT;
+    serial.param[0] = 0x34;
+    serial.param[1] = 0x12;
+    DX_CHECK_EQUAL(bus.readWord(1,DX2_CMD_PRESENT_CURRENT),0x1234);
+    DX_CHECK_EQUAL(bus.error(),DX_ERROR_NO);
+    DX_CHECK_EQUAL(bus.servoError(),DX2_ERROR_ALERT);
+
+    // the next transaction starts clean
+    serial.error = 0;
+    DX_CHECK_EQUAL(bus.readWord(1,DX2_CMD_PRESENT_CURRENT),0x1234);
+    DX_CHECK_EQUAL(bus.servoError(),DX_ERROR_NO);
+}
+
+int main()
+{
+    DX_RUN(testStatus);
+    DX_RUN(testServoError);
+    return DX_TEST_RESULT();
+}
@@ -0,0 +1,255 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// packet layer: encoding, status decoding and the transactions of DxBus
+// against the fake servos of MemorySerial
+
+#include "DxTest.h"
+#include "MemorySerial.h"
+
+#include <cstring>
+
+static void testEncodePacket()
+{
+    unsigned char packet[DX_MAX_PACKET_SIZE];
+
+    // ping of id 1, the example of the manual
+    DX_CHECK_EQUAL(DxBus::encodePacket(1,DX_INST_PING,NULL,0,packet),6);
+    const unsigned char ping[] = { 0xFF,0xFF,0x01,0x02,0x01,0xFB };
+    DX_CHECK(memcmp(packet,ping,sizeof(ping)) == 0);
+
+    // write goal position 0x200 of id 1
+    const unsigned char param[] = { DX_CMD_GOAL_POS,0x00,0x02 };
+    DX_CHECK_EQUAL(DxBus::encodePacket(1,DX_INST_WRITE_DATA,param,3,packet),9);
+    DX_CHECK_EQUAL(packet[3],5);
+    DX_CHECK_EQUAL(packet[8],DxBus::calcChecksum(packet + 2,6));
+    DX_CHECK_EQUAL(DxBus::calcChecksum(0x1FF),0);
+}
+
+static void testEncodeSyncWrite()
+{
+    unsigned char packet[DX_MAX_PACKET_SIZE];
+    int           ids[2] = { 1,2 };
+    unsigned char data[4] = { 0x10,0x01,0x20,0x02 };
+
+    DX_CHECK_EQUAL(DxBus::encodeSyncWrite(DX_CMD_GOAL_POS,2,ids,2,data,packet),14);
+    const unsigned char sync[] = { 0xFF,0xFF,DX_BROADCAST_ID,10,DX_INST_SYNC_WRITE,DX_CMD_GOAL_POS,2,
+                                   1,0x10,0x01,2,0x20,0x02 };
+    DX_CHECK(memcmp(packet,sync,sizeof(sync)) == 0);
+    DX_CHECK_EQUAL(packet[13],DxBus::calcChecksum(packet + 2,11));
+
+    // the length byte limits a packet
+    int           manyIds[DX_BROADCAST_ID];
+    unsigned char manyData[DX_BROADCAST_ID * 2];
+    for(int i=0;i < DX_BROADCAST_ID;i++)
+        manyIds[i] = i;
+    memset(manyData,0,sizeof(manyData));
+
+    int capacity = DxBus::syncWriteCapacity(2);
+    DX_CHECK_EQUAL(capacity,83);
+    DX_CHECK(DxBus::encodeSyncWrite(DX_CMD_GOAL_POS,2,manyIds,capacity,manyData,packet) > 0);
+    DX_CHECK_EQUAL(DxBus::encodeSyncWrite(DX_CMD_GOAL_POS,2,manyIds,capacity + 1,manyData,packet),0);
+    DX_CHECK_EQUAL(DxBus::syncWriteCapacity(0),0);
+}
+
+static void testDecodeStatus()
+{
+    DxStatusPacket status;
+
+    // noise and an additional 0xff in front
+    const unsigned char reply[] = { 0x12,0x34,0xFF,0xFF,0xFF,0x01,0x03,0x00,0x20,0xDB };
+    DX_CHECK_EQUAL(DxBus::decodeStatus(reply,sizeof(reply),status),sizeof(reply));
+    DX_CHECK_EQUAL(status.id,1);
+    DX_CHECK_EQUAL(status.error,0);
+    DX_CHECK_EQUAL(status.paramLength,1);
+    DX_CHECK_EQUAL(status.param[0],0x20);
+    DX_CHECK(status.checksumOk);
+
+    // incomplete, more data needed
+    for(int size=0;size < (int)sizeof(reply);size++)
+        DX_CHECK_EQUAL(DxBus::decodeStatus(reply,size,status),0);
+
+    // broken checksum
+    unsigned char broken[sizeof(reply)];
+    memcpy(broken,reply,sizeof(reply));
+    broken[sizeof(broken) - 1] ^= 0x5A;
+    DX_CHECK_EQUAL(DxBus::decodeStatus(broken,sizeof(broken),status),sizeof(broken));
+    DX_CHECK(!status.checksumOk);
+
+    // invalid length, only the header gets skipped
+    const unsigned char invalid[] = { 0xFF,0xFF,0x01,0x01,0x00,0x00 };
+    DX_CHECK_EQUAL(DxBus::decodeStatus(invalid,sizeof(invalid),status),4);
+    DX_CHECK_EQUAL(status.id,-1);
+}
+
+static void testReadWrite()
+{
+    MemorySerial serial;
+    serial.addServo(1,DX_TYPE_MX_28);
+    serial.setNoise(3);
+    DxBus bus(&serial);
+
+    DX_CHECK(bus.ping(1));
+    DX_CHECK_EQUAL(bus.readWord(1,DX_CMD_MODELNR),DX_TYPE_MX_28);
+    DX_CHECK(bus.writeWord(1,DX_CMD_GOAL_POS,1234));
+    DX_CHECK_EQUAL(serial.regWord(1,DX_CMD_GOAL_POS),1234);
+    DX_CHECK_EQUAL(bus.readWord(1,DX_CMD_GOAL_POS),1234);
+    DX_CHECK_EQUAL(bus.error(),DX_ERROR_NO);
+
+    // the reads fill the telemetry cache
+    serial.setRegWord(1,DX_CMD_PRESENT_POS,2000);
+    unsigned char data[8];
+    DX_CHECK(bus.readData(1,DX_CMD_PRESENT_POS,8,data));
+    DX_CHECK_EQUAL(bus.lastPosition(1),2000);
+    DX_CHECK_EQUAL(bus.lastVolt(1),120);
+
+    // reg write waits for the action
+    unsigned char goal[2] = { 0x00,0x01 };
+    DX_CHECK(bus.writeData(1,DX_CMD_GOAL_POS,goal,2,true));
+    DX_CHECK_EQUAL(serial.regWord(1,DX_CMD_GOAL_POS),1234);
+    DX_CHECK(bus.action(DX_BROADCAST_ID));
+    DX_CHECK_EQUAL(serial.regWord(1,DX_CMD_GOAL_POS),0x100);
+}
+
+static void testErrors()
+{
+    MemorySerial serial;
+    serial.addServo(1);
+    DxBus bus(&serial);
+    bus.setTimeout(5);
+
+    // nobody answers
+    DX_CHECK(!bus.ping(2));
+    DX_CHECK(bus.error() & DX_ERROR_USR_NO_BEGIN);
+
+    // broken checksum of the reply
+    serial.setFaultRate(1,0,1);
+    DX_CHECK_EQUAL(bus.readByte(1,DX_CMD_ID),-1);
+    DX_CHECK_EQUAL(bus.error(),DX_ERROR_USR_READSTATUS | DX_ERROR_USR_CHECKSUM);
+
+    // line errors get retried, every second reply is lost
+    serial.setFaultRate(1,.5,0);
+    bus.setRetries(10);
+    for(int i=0;i < 20;i++)
+        DX_CHECK_EQUAL(bus.readByte(1,DX_CMD_ID),1);
+
+    // an error of the servo is not retried
+    serial.setFaultRate(1,0,0);
+    unsigned char data = 0;
+    DX_CHECK(!bus.writeData(1,DX_CONTROL_TABLE_SIZE - 1,&data,2));
+    DX_CHECK(bus.error() & DX_ERROR_INST);
+}
+
+static void testBulkRead()
+{
+    MemorySerial serial;
+    serial.addServo(1);
+    serial.addServo(2);
+    serial.addServo(4);
+    DxBus bus(&serial);
+    bus.setTimeout(5);
+
+    int           ids[3]     = { 1,2,3 };
+    int           addrs[3]   = { DX_CMD_ID,DX_CMD_ID,DX_CMD_ID };
+    int           lengths[3] = { 1,1,1 };
+    unsigned char data[3]    = { 0,0,0 };
+
+    // the chain stops at the missing servo
+    DX_CHECK_EQUAL(bus.bulkRead(ids,addrs,lengths,3,data),2);
+    DX_CHECK_EQUAL(data[0],1);
+    DX_CHECK_EQUAL(data[1],2);
+
+    ids[2] = 4;
+    DX_CHECK_EQUAL(bus.bulkRead(ids,addrs,lengths,3,data),3);
+    DX_CHECK_EQUAL(data[2],4);
+}
+
+// two threads on one bus, each sees the error of its own transactions
+static void pingMissing(DxBus* bus,int* wrong)
+{
+    for(int i=0;i < 200;i++)
+    {
+        if(bus->ping(9) || bus->error() != DX_ERROR_USR_NO_BEGIN)
+            (*wrong)++;
+    }
+}
+
+static void testThreadError()
+{
+    MemorySerial serial;
+    serial.addServo(1);
+    DxBus bus(&serial);
+    bus.setTimeout(1);
+
+    int wrongMissing = 0;
+    int wrongPresent = 0;
+    dx::thread thread(&pingMissing,&bus,&wrongMissing);
+    for(int i=0;i < 2000;i++)
+    {
+        if(!bus.ping(1) || bus.error() != DX_ERROR_NO)
+            wrongPresent++;
+    }
+    thread.join();
+
+    DX_CHECK_EQUAL(wrongMissing,0);
+    DX_CHECK_EQUAL(wrongPresent,0);
+}
+
+static void pingOnce(DxBus* bus,dx::atomic<bool>* done)
+{
+    bus->ping(1);
+    *done = true;
+}
+
+// a caller which holds the bus keeps the other threads out, but not itself
+static void testExternalLock()
+{
+    MemorySerial serial;
+    serial.addServo(1);
+    DxBus bus(&serial);
+
+    dx::atomic<bool> done(false);
+    bus.lock();
+    dx::thread thread(&pingOnce,&bus,&done);
+    DX_CHECK(bus.ping(1));
+    dx::sleep(20);
+    DX_CHECK(!done);
+    DX_CHECK_EQUAL(bus.pending(),2);
+    bus.unlock();
+    thread.join();
+    DX_CHECK(done);
+    DX_CHECK_EQUAL(bus.pending(),0);
+}
+
+int main()
+{
+    DX_RUN(testEncodePacket);
+    DX_RUN(testEncodeSyncWrite);
+    DX_RUN(testDecodeStatus);
+    DX_RUN(testReadWrite);
+    DX_RUN(testErrors);
+    DX_RUN(testBulkRead);
+    DX_RUN(testThreadError);
+    DX_RUN(testExternalLock);
+    return DX_TEST_RESULT();
+}
@@ -0,0 +1,155 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// ServoCapture against fake servos: the step, reads in turns, time stamps,
+// the sample cap and failed reads
+
+#include "DxTest.h"
+#include "MemorySerial.h"
+#include "ServoCapture.h"
+
+#include <vector>
+
+static void setup(MemorySerial& serial)
+{
+    for(int id=1;id <= 3;id++)
+    {
+        serial.addServo(id);
+        serial.setRegWord(id,DX_CMD_PRESENT_POS,100 * id);
+        serial.setRegWord(id,DX_CMD_PRESENT_SPEED,10 * id);
+        serial.setRegWord(id,DX_CMD_PRESENT_LOAD,id);
+    }
+}
+
+static void testCapture()
+{
+    MemorySerial serial;
+    setup(serial);
+    DxBus bus(&serial);
+    bus.setTimeout(1);
+
+    ServoCapture capture(&bus,30);
+    int ids[]   = { 1, 2, 3 };
+    int goals[] = { 1000, 2000, 3000 };
+    DX_CHECK(capture.capture(ids,3,goals,10000));
+
+    // the step reached every servo
+    for(int i=0;i < 3;i++)
+        DX_CHECK_EQUAL(serial.regWord(ids[i],DX_CMD_GOAL_POS),goals[i]);
+
+    // capped by the samples long before the duration
+    DX_CHECK_EQUAL(capture.sampleCount(),30);
+    DX_CHECK_EQUAL(capture.errorCount(),0);
+    DX_CHECK(capture.duration() < 10000);
+    DX_CHECK(capture.sampleRate() > 0);
+
+    std::vector<float> time(30);
+    std::vector<int>   id(30),pos(30),speed(30),load(30);
+    capture.getTime(&time[0]);
+    capture.getId(&id[0]);
+    capture.getPosition(&pos[0]);
+    capture.getSpeed(&speed[0]);
+    capture.getLoad(&load[0]);
+    for(int i=0;i < 30;i++)
+    {
+        DX_CHECK_EQUAL(id[i],ids[i % 3]);
+        DX_CHECK_EQUAL(pos[i],100 * id[i]);
+        DX_CHECK_EQUAL(speed[i],10 * id[i]);
+        DX_CHECK_EQUAL(load[i],id[i]);
+        DX_CHECK(time[i] >= 0 && time[i] <= capture.duration());
+        if(i > 0)
+            DX_CHECK(time[i] >= time[i - 1]);
+    }
+}
+
+// the duration ends it when there are samples left, no step without goals
+static void testDuration()
+{
+    MemorySerial serial;
+    setup(serial);
+    DxBus bus(&serial);
+    bus.setTimeout(1);
+
+    int goal = serial.regWord(2,DX_CMD_GOAL_POS);
+    ServoCapture capture(&bus,1000000);
+    int ids[] = { 2 };
+    DX_CHECK(capture.capture(ids,1,NULL,20));
+    DX_CHECK(capture.sampleCount() > 0);
+    DX_CHECK(capture.sampleCount() < 1000000);
+    DX_CHECK(capture.duration() >= 20);
+    DX_CHECK_EQUAL(serial.regWord(2,DX_CMD_GOAL_POS),goal);
+}
+
+// a servo which doesn't answer only counts errors
+static void testErrors()
+{
+    MemorySerial serial;
+    setup(serial);
+    DxBus bus(&serial);
+    bus.setTimeout(1);
+
+    ServoCapture capture(&bus,20);
+    int ids[] = { 1, 9, 3 };
+    DX_CHECK(capture.capture(ids,3,NULL,10000));
+    DX_CHECK_EQUAL(capture.sampleCount(),20);
+    DX_CHECK(capture.errorCount() >= 9);
+
+    std::vector<int> id(20);
+    capture.getId(&id[0]);
+    for(int i=0;i < 20;i++)
+        DX_CHECK_EQUAL(id[i],i % 2 ? 3 : 1);
+
+    // nobody there
+    int missing[] = { 9 };
+    DX_CHECK(!capture.capture(missing,1,NULL,20));
+    DX_CHECK_EQUAL(capture.sampleCount(),0);
+    DX_CHECK(capture.errorCount() > 0);
+}
+
+static void testMaxSamples()
+{
+    MemorySerial serial;
+    setup(serial);
+    DxBus bus(&serial);
+
+    ServoCapture capture(&bus,5);
+    DX_CHECK(!capture.setMaxSamples(-1));
+    DX_CHECK_EQUAL(capture.maxSamples(),5);
+
+    int ids[] = { 1 };
+    DX_CHECK(capture.capture(ids,1,NULL,10000));
+    DX_CHECK_EQUAL(capture.sampleCount(),5);
+
+    DX_CHECK(capture.setMaxSamples(0));
+    DX_CHECK(!capture.capture(ids,1,NULL,10000));
+    DX_CHECK(!capture.capture(ids,0,NULL,10000));
+}
+
+int main()
+{
+    DX_RUN(testCapture);
+    DX_RUN(testDuration);
+    DX_RUN(testErrors);
+    DX_RUN(testMaxSamples);
+    return DX_TEST_RESULT();
+}
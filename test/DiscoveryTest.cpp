@@ -0,0 +1,171 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// BusDiscovery on fake buses: the merged topology and when the found ids
+// may become the servo list of the bus (broadcasts)
+
+#include "DxTest.h"
+#include "MemorySerial.h"
+#include "BusDiscovery.h"
+
+// counts the instructions on the bus
+class CountingSerial: public MemorySerial
+{
+public:
+    CountingSerial():
+        syncWrites(0),
+        broadcasts(0)
+    {}
+
+    int syncWrites;
+    int broadcasts;
+
+protected:
+    void handlePacket(int id,int inst,const unsigned char* param,int paramLength)
+    {
+        if(inst == DX_INST_SYNC_WRITE)
+            syncWrites++;
+        else if(id == DX_BROADCAST_ID)
+            broadcasts++;
+        MemorySerial::handlePacket(id,inst,param,paramLength);
+    }
+};
+
+static void testTopology()
+{
+    MemorySerial serial1;
+    serial1.addServo(1,DX_TYPE_MX_28);
+    serial1.addServo(3,DX_TYPE_AX_12);
+    serial1.setReg(3,DX_CMD_DELAYTIME,0);
+    DxBus bus1(&serial1);
+
+    MemorySerial serial2;
+    serial2.addServo(2,DX_TYPE_MX_64);
+    DxBus bus2(&serial2);
+
+    BusDiscovery discovery;
+    discovery.addBus(&bus1);
+    discovery.addBus(&bus2);
+    discovery.setIdRange(0,10);
+    discovery.setTimeout(1);
+    discovery.setExpectedReturnDelay(250);
+    DX_CHECK(discovery.run());
+
+    DX_CHECK_EQUAL(discovery.servoCount(),3);
+    DX_CHECK_EQUAL(discovery.portServoCount(0),2);
+    DX_CHECK_EQUAL(discovery.portServoCount(1),1);
+    DX_CHECK_EQUAL(discovery.servo(0)->id,1);
+    DX_CHECK_EQUAL(discovery.servo(1)->modelNr,DX_TYPE_AX_12);
+    DX_CHECK(!discovery.servo(1)->verified);
+    DX_CHECK_EQUAL(discovery.servo(2)->port,1);
+    DX_CHECK_EQUAL(discovery.find(2),2);
+    DX_CHECK_EQUAL(discovery.unverifiedCount(),1);
+
+    // the short ping timeout is only for the scan
+    DX_CHECK_EQUAL(bus1.timeout(),DX_DEFAULT_TIMEOUT);
+}
+
+// a part of the id range doesn't tell which servos a broadcast reaches
+static void testPartialRangeNoBroadcast()
+{
+    CountingSerial serial;
+    serial.addServo(1);
+    serial.addServo(2);
+    serial.addServo(50);
+    DxBus bus(&serial);
+
+    BusDiscovery discovery;
+    discovery.addBus(&bus);
+    discovery.setIdRange(0,10);
+    discovery.setTimeout(1);
+    discovery.setAssignServoIds(true);
+    DX_CHECK(discovery.run());
+    DX_CHECK(!discovery.portComplete(0));
+    DX_CHECK_EQUAL(bus.servoIdCount(),0);
+
+    // the same goal for the found servos, 50 stays where it is
+    int           ids[2] = { 1,2 };
+    unsigned char data[4] = { 0x00,0x01,0x00,0x01 };
+    DX_CHECK(bus.syncWrite(DX_CMD_GOAL_POS,2,ids,2,data));
+    DX_CHECK_EQUAL(serial.syncWrites,1);
+    DX_CHECK_EQUAL(serial.broadcasts,0);
+    DX_CHECK_EQUAL(serial.regWord(1,DX_CMD_GOAL_POS),0x100);
+    DX_CHECK(serial.regWord(50,DX_CMD_GOAL_POS) != 0x100);
+}
+
+static void testFullRange()
+{
+    CountingSerial serial;
+    serial.addServo(1);
+    serial.addServo(2);
+    DxBus bus(&serial);
+
+    // off by default
+    BusDiscovery discovery;
+    discovery.addBus(&bus);
+    discovery.setTimeout(1);
+    DX_CHECK(discovery.run());
+    DX_CHECK(discovery.portComplete(0));
+    DX_CHECK_EQUAL(bus.servoIdCount(),0);
+
+    discovery.setAssignServoIds(true);
+    DX_CHECK(discovery.run());
+    DX_CHECK_EQUAL(bus.servoIdCount(),2);
+
+    // now the whole bus is known, one broadcast
+    int           ids[2] = { 2,1 };
+    unsigned char data[2] = { 1,1 };
+    DX_CHECK(bus.syncWrite(DX_CMD_LED_ENABLE,1,ids,2,data));
+    DX_CHECK_EQUAL(serial.broadcasts,1);
+    DX_CHECK_EQUAL(serial.syncWrites,0);
+    DX_CHECK_EQUAL(serial.reg(1,DX_CMD_LED_ENABLE),1);
+    DX_CHECK_EQUAL(serial.reg(2,DX_CMD_LED_ENABLE),1);
+}
+
+// a servo with broken replies is there, but not in the list
+static void testMissedIdNoBroadcast()
+{
+    MemorySerial serial;
+    serial.addServo(1);
+    serial.addServo(7);
+    serial.setFaultRate(7,0,1);
+    DxBus bus(&serial);
+
+    BusDiscovery discovery;
+    discovery.addBus(&bus);
+    discovery.setTimeout(1);
+    discovery.setAssignServoIds(true);
+    DX_CHECK(discovery.run());
+    DX_CHECK_EQUAL(discovery.servoCount(),1);
+    DX_CHECK(!discovery.portComplete(0));
+    DX_CHECK_EQUAL(bus.servoIdCount(),0);
+}
+
+int main()
+{
+    DX_RUN(testTopology);
+    DX_RUN(testPartialRangeNoBroadcast);
+    DX_RUN(testFullRange);
+    DX_RUN(testMissedIdNoBroadcast);
+    return DX_TEST_RESULT();
+}
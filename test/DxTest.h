@@ -0,0 +1,48 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+#ifndef DXTEST_H
+#define	DXTEST_H
+
+#include <cstdio>
+
+// minimal checks for the behaviour tests, no framework needed. every
+// failed check prints its line, main() returns DX_TEST_RESULT()
+
+static int dxTestFailures = 0;
+
+#define  DX_CHECK(cond) \
+    do { if(!(cond)) { dxTestFailures++; \
+         std::printf("%s:%d: check failed: %s\n",__FILE__,__LINE__,#cond); } } while(0)
+
+#define  DX_CHECK_EQUAL(a,b) \
+    do { long long dxA = (long long)(a),dxB = (long long)(b); if(dxA != dxB) { dxTestFailures++; \
+         std::printf("%s:%d: check failed: %s == %s (%lld != %lld)\n",__FILE__,__LINE__,#a,#b,dxA,dxB); } } while(0)
+
+#define  DX_RUN(test) \
+    do { int dxBefore = dxTestFailures; test(); \
+         std::printf("%-40s %s\n",#test,dxBefore == dxTestFailures ? "ok" : "FAILED"); } while(0)
+
+#define  DX_TEST_RESULT() (dxTestFailures == 0 ? 0 : 1)
+
+#endif  // DXTEST_H
@@ -0,0 +1,137 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// GroupMove: moving speeds so a group of servos arrives together, and the
+// reads it can save between moves
+
+#include "DxTest.h"
+#include "MemorySerial.h"
+#include "GroupMove.h"
+
+#include <cmath>
+
+static void testUnits()
+{
+    DxModelUnits units;
+    DX_CHECK(dxModelUnits(DX_TYPE_AX_12,units));
+    DX_CHECK_EQUAL(units.range,0x3FF);
+    DX_CHECK(dxModelUnits(DX_TYPE_MX_28,units));
+    DX_CHECK_EQUAL(units.range,0xFFF);
+    DX_CHECK(!dxModelUnits(0x7777,units));
+}
+
+// the servo with twice the way gets twice the speed, both fast enough
+static void testSpeeds()
+{
+    MemorySerial serial;
+    serial.addServo(1);
+    serial.addServo(2);
+    serial.setRegWord(1,DX_CMD_PRESENT_POS,1000);
+    serial.setRegWord(2,DX_CMD_PRESENT_POS,2000);
+    DxBus bus(&serial);
+    bus.setTimeout(1);
+
+    GroupMove group(&bus);
+    int ids[]   = { 1, 2 };
+    int goals[] = { 3000, 3000 };
+    DX_CHECK(group.move(ids,2,goals,1000));
+
+    // models and positions were unknown
+    DX_CHECK_EQUAL(group.readCount(),4);
+    DX_CHECK_EQUAL(group.startPosition(1),1000);
+    DX_CHECK_EQUAL(group.startPosition(2),2000);
+    DX_CHECK_EQUAL(serial.regWord(1,DX_CMD_GOAL_POS),3000);
+    DX_CHECK_EQUAL(serial.regWord(2,DX_CMD_GOAL_POS),3000);
+    DX_CHECK_EQUAL(serial.regWord(1,DX_CMD_MOV_SPEED),group.speed(1));
+    DX_CHECK_EQUAL(serial.regWord(2,DX_CMD_MOV_SPEED),group.speed(2));
+    DX_CHECK(std::abs(group.speed(1) - 2 * group.speed(2)) <= 1);
+
+    // 2000 ticks of 4096 in a second at 0.114 rpm per unit
+    double rpm = 2000.0 / 4096 * 60;
+    DX_CHECK(group.speed(1) * 0.114 >= rpm);
+    DX_CHECK((group.speed(1) - 1) * 0.114 < rpm);
+    DX_CHECK_EQUAL(group.speed(3),-1);
+}
+
+// the next move starts where the last one should be, without a read
+static void testKnownPosition()
+{
+    MemorySerial serial;
+    serial.addServo(1);
+    DxBus bus(&serial);
+    bus.setTimeout(1);
+
+    GroupMove group(&bus);
+    group.setModel(1,DX_TYPE_MX_28);
+    int ids[]   = { 1 };
+    int goals[] = { 4000 };
+    DX_CHECK(group.move(ids,1,goals,1));
+    DX_CHECK_EQUAL(group.readCount(),1);
+    dx::sleep(5);
+
+    goals[0] = 100;
+    DX_CHECK(group.move(ids,1,goals,1000));
+    DX_CHECK_EQUAL(group.readCount(),1);
+    DX_CHECK_EQUAL(group.startPosition(1),4000);
+
+    // a read after the move knows better
+    serial.setRegWord(1,DX_CMD_PRESENT_POS,2000);
+    DX_CHECK_EQUAL(bus.readWord(1,DX_CMD_PRESENT_POS),2000);
+    goals[0] = 3000;
+    DX_CHECK(group.move(ids,1,goals,1000));
+    DX_CHECK_EQUAL(group.readCount(),1);
+    DX_CHECK_EQUAL(group.startPosition(1),2000);
+
+    group.reset();
+    DX_CHECK_EQUAL(group.speed(1),-1);
+}
+
+static void testRefused()
+{
+    MemorySerial serial;
+    serial.addServo(1);
+    DxBus bus(&serial);
+    bus.setTimeout(1);
+
+    GroupMove group(&bus);
+    int ids[]   = { 1 };
+    int goals[] = { 100 };
+    DX_CHECK(!group.move(ids,1,goals,0));
+    DX_CHECK(!group.move(ids,0,goals,100));
+
+    group.setModel(1,0x7777);
+    DX_CHECK(!group.move(ids,1,goals,100));
+
+    // no servo 5 to read the model of
+    ids[0] = 5;
+    DX_CHECK(!group.move(ids,1,goals,100));
+}
+
+int main()
+{
+    DX_RUN(testUnits);
+    DX_RUN(testSpeeds);
+    DX_RUN(testKnownPosition);
+    DX_RUN(testRefused);
+    return DX_TEST_RESULT();
+}
@@ -0,0 +1,130 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// BusHealth classification, fed directly and through a DxBus with faults
+// on one fake servo
+
+#include "DxTest.h"
+#include "MemorySerial.h"
+#include "BusHealth.h"
+
+// 100 good transactions for each of the ids 1-8
+static void addGood(BusHealth& health,int latency = 200)
+{
+    for(int i=0;i < 100;i++)
+    {
+        for(int id=1;id <= 8;id++)
+            health.addTransaction(id,DX_ERROR_NO,latency);
+    }
+}
+
+static void testIdleOk()
+{
+    BusHealth health(NULL);
+    DX_CHECK_EQUAL(health.cause(),DX_HEALTH_IDLE);
+
+    addGood(health);
+    DX_CHECK_EQUAL(health.cause(),DX_HEALTH_OK);
+    DX_CHECK_EQUAL(health.causeId(),-1);
+    DX_CHECK_EQUAL(health.transactions(),800);
+    DX_CHECK_EQUAL(health.transactions(3),100);
+    DX_CHECK(health.errorRate() == 0.0);
+}
+
+// line errors on one id point at the servo, spread over all at the bus
+static void testLineErrors()
+{
+    BusHealth servo(NULL);
+    addGood(servo);
+    for(int i=0;i < 20;i++)
+        servo.addTransaction(3,DX_ERROR_USR_NO_BEGIN,0);
+    DX_CHECK_EQUAL(servo.cause(),DX_HEALTH_SERVO);
+    DX_CHECK_EQUAL(servo.causeId(),3);
+    DX_CHECK(servo.lineErrorRate(3) > servo.lineErrorRate());
+
+    BusHealth bus(NULL);
+    addGood(bus);
+    for(int i=0;i < 5;i++)
+    {
+        for(int id=1;id <= 8;id++)
+            bus.addTransaction(id,DX_ERROR_USR_READSTATUS | DX_ERROR_USR_CHECKSUM,200);
+    }
+    DX_CHECK_EQUAL(bus.cause(),DX_HEALTH_BUS);
+    DX_CHECK_EQUAL(bus.causeId(),-1);
+    DX_CHECK(bus.errorTypeRate(DX_ERRORTYPE_CHECKSUM) > 0.0);
+}
+
+static void testAlarm()
+{
+    BusHealth health(NULL);
+    addGood(health);
+    health.addTransaction(5,DX_ERROR_OVERHEAT,200);
+    DX_CHECK_EQUAL(health.cause(),DX_HEALTH_SERVO_ALARM);
+    DX_CHECK_EQUAL(health.causeId(),5);
+    DX_CHECK_EQUAL(health.alarm(5),DX_ERROR_OVERHEAT);
+}
+
+static void testLatencyDrift()
+{
+    BusHealth health(NULL);
+    addGood(health,200);
+    DX_CHECK(health.latencyDrift() < 0.1);
+
+    for(int i=0;i < 100;i++)
+        health.addTransaction(1 + i % 8,DX_ERROR_NO,600);
+    DX_CHECK_EQUAL(health.cause(),DX_HEALTH_LATENCY_DRIFT);
+    DX_CHECK(health.latencyDrift() >= health.driftThreshold());
+}
+
+// the DxBus feeds it, lost replies of one servo
+static void testBus()
+{
+    MemorySerial serial;
+    for(int id=1;id <= 4;id++)
+        serial.addServo(id);
+    serial.setFaultRate(2,0.5,0.0);
+
+    DxBus     bus(&serial);
+    BusHealth health(&bus);
+    bus.setTimeout(1);
+
+    for(int i=0;i < 50;i++)
+    {
+        for(int id=1;id <= 4;id++)
+            bus.readWord(id,DX_CMD_PRESENT_POS);
+    }
+    DX_CHECK_EQUAL(health.transactions(),200);
+    DX_CHECK_EQUAL(health.cause(),DX_HEALTH_SERVO);
+    DX_CHECK_EQUAL(health.causeId(),2);
+    DX_CHECK(health.errorRate(1) == 0.0);
+}
+
+int main()
+{
+    DX_RUN(testIdleOk);
+    DX_RUN(testLineErrors);
+    DX_RUN(testAlarm);
+    DX_RUN(testLatencyDrift);
+    DX_RUN(testBus);
+    return DX_TEST_RESULT();
+}
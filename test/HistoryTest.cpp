@@ -0,0 +1,178 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// TelemetryHistory decimation: min/max/mean folding, the level a window
+// gets, the point across the window start and the ring wrap
+
+#include "DxTest.h"
+#include "TelemetryHistory.h"
+#include "DxTime.h"
+
+#define  MAX_POINTS     (16)
+
+struct Points
+{
+    int     count;
+    int     level;
+    float   time[MAX_POINTS];
+    float   min[MAX_POINTS];
+    float   max[MAX_POINTS];
+    float   mean[MAX_POINTS];
+};
+
+// one sample per ms, the value is the index
+static void fill(DxHistoryRing& ring,int count)
+{
+    for(int i=0;i < count;i++)
+        ring.add((dx::uint64_t)i * 1000,(float)i);
+}
+
+static Points get(DxHistoryRing& ring,dx::uint64_t now,dx::uint64_t window,int maxPoints)
+{
+    Points p;
+    p.count = ring.get(now,window,maxPoints,p.level,p.time,p.min,p.max,p.mean);
+    return p;
+}
+
+static void testFold()
+{
+    DxHistoryRing ring(8,3,4);
+    fill(ring,8);
+    DX_CHECK(ring.sampleCount() == 8);
+
+    // all samples fit
+    Points p = get(ring,7000,100000,8);
+    DX_CHECK_EQUAL(p.level,0);
+    DX_CHECK_EQUAL(p.count,8);
+    DX_CHECK(p.mean[0] == 0.0f && p.time[0] == 7.0f);
+    DX_CHECK(p.mean[7] == 7.0f && p.time[7] == 0.0f);
+
+    // 4 samples in a point
+    p = get(ring,7000,100000,4);
+    DX_CHECK_EQUAL(p.level,1);
+    DX_CHECK_EQUAL(p.count,2);
+    DX_CHECK(p.min[0] == 0.0f && p.max[0] == 3.0f && p.mean[0] == 1.5f);
+    DX_CHECK(p.min[1] == 4.0f && p.max[1] == 7.0f && p.mean[1] == 5.5f);
+    DX_CHECK(p.time[0] == 7.0f && p.time[1] == 3.0f);
+}
+
+// 40 samples: level 0 keeps 32-39, level 1 8-39, level 2 0-31 and 32-39 in the making
+static void testLevel()
+{
+    DxHistoryRing ring(8,3,4);
+    fill(ring,40);
+
+    // short window, the samples
+    Points p = get(ring,39000,5000,8);
+    DX_CHECK_EQUAL(p.level,0);
+    DX_CHECK_EQUAL(p.count,6);
+    DX_CHECK(p.mean[0] == 34.0f && p.mean[5] == 39.0f);
+
+    // level 0 doesn't reach back far enough
+    p = get(ring,39000,20000,8);
+    DX_CHECK_EQUAL(p.level,1);
+    DX_CHECK_EQUAL(p.count,6);
+    DX_CHECK(p.min[0] == 16.0f && p.max[0] == 19.0f);
+    DX_CHECK(p.min[5] == 36.0f && p.max[5] == 39.0f);
+
+    // the window starts at 18ms, in the middle of the point of 16-19ms
+    p = get(ring,39000,21000,8);
+    DX_CHECK_EQUAL(p.level,1);
+    DX_CHECK_EQUAL(p.count,6);
+    DX_CHECK(p.min[0] == 16.0f && p.max[0] == 19.0f && p.mean[0] == 17.5f);
+    DX_CHECK(p.time[0] == 23.0f);
+
+    // a window right after that point leaves it out
+    p = get(ring,39000,19000,8);
+    DX_CHECK_EQUAL(p.count,5);
+    DX_CHECK(p.min[0] == 20.0f);
+
+    // the last level, with the point in the making
+    p = get(ring,39000,100000,8);
+    DX_CHECK_EQUAL(p.level,2);
+    DX_CHECK_EQUAL(p.count,3);
+    DX_CHECK(p.min[0] == 0.0f && p.max[0] == 15.0f && p.mean[0] == 7.5f);
+    DX_CHECK(p.min[1] == 16.0f && p.max[1] == 31.0f && p.mean[1] == 23.5f);
+    DX_CHECK(p.min[2] == 32.0f && p.max[2] == 39.0f && p.mean[2] == 35.5f);
+    DX_CHECK(p.time[0] == 39.0f && p.time[2] == 7.0f);
+}
+
+static void testWrap()
+{
+    DxHistoryRing ring(8,1,4);
+    fill(ring,20);
+    DX_CHECK(ring.sampleCount() == 20);
+
+    // the last 8, oldest first
+    Points p = get(ring,19000,100000,8);
+    DX_CHECK_EQUAL(p.level,0);
+    DX_CHECK_EQUAL(p.count,8);
+    for(int i=0;i < p.count;i++)
+        DX_CHECK(p.mean[i] == (float)(12 + i));
+
+    // too many for maxPoints, the newest
+    p = get(ring,19000,100000,4);
+    DX_CHECK_EQUAL(p.count,4);
+    DX_CHECK(p.mean[0] == 16.0f && p.mean[3] == 19.0f);
+
+    ring.clear();
+    DX_CHECK(ring.sampleCount() == 0);
+    DX_CHECK_EQUAL(get(ring,19000,100000,8).count,0);
+}
+
+static void testHistory()
+{
+    TelemetryHistory history(8,3,4);
+    DX_CHECK(history.span() == 8 * 4 * 4);
+    DX_CHECK(!history.hasServo(1));
+
+    Points p;
+    DX_CHECK_EQUAL(history.get(1,DX_HISTORY_POS,1000.0f,MAX_POINTS,p.time,p.min,p.max,p.mean),0);
+
+    dx::uint64_t now = dxMicros();
+    for(int i=0;i < 6;i++)
+        history.add(1,DX_HISTORY_POS,100 + i,now - (5 - i) * 1000);
+    history.add(1,DX_HISTORY_CHANNEL_COUNT,1,now);
+    history.add(DX_BROADCAST_ID,DX_HISTORY_POS,1,now);
+    DX_CHECK(history.hasServo(1));
+    DX_CHECK(!history.hasServo(DX_BROADCAST_ID));
+    DX_CHECK(history.sampleCount(1,DX_HISTORY_POS) == 6);
+    DX_CHECK(history.sampleCount(1,DX_HISTORY_TEMP) == 0);
+
+    p.count = history.get(1,DX_HISTORY_POS,1000.0f,MAX_POINTS,p.time,p.min,p.max,p.mean);
+    DX_CHECK_EQUAL(p.count,6);
+    DX_CHECK_EQUAL(history.lastLevel(),0);
+    DX_CHECK(p.mean[0] == 100.0f && p.mean[5] == 105.0f);
+
+    history.clear(1);
+    DX_CHECK(history.sampleCount(1,DX_HISTORY_POS) == 0);
+}
+
+int main()
+{
+    DX_RUN(testFold);
+    DX_RUN(testLevel);
+    DX_RUN(testWrap);
+    DX_RUN(testHistory);
+    return DX_TEST_RESULT();
+}
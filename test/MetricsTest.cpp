@@ -0,0 +1,219 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// prometheus text of BusMetrics, and the http endpoint of the full build
+
+#include "DxTest.h"
+#include "MemorySerial.h"
+#include "BusMetrics.h"
+
+#include <string>
+#include <sstream>
+
+#ifndef DX_LITE
+#include "MetricsServer.h"
+#endif
+
+static bool contains(const std::string& text,const std::string& line)
+{
+    return text.find(line + "\n") != std::string::npos;
+}
+
+static int countOf(const std::string& text,const std::string& str)
+{
+    int count = 0;
+    for(std::string::size_type pos = text.find(str);pos != std::string::npos;pos = text.find(str,pos + 1))
+        count++;
+    return count;
+}
+
+static void testCounters()
+{
+    BusMetrics metrics(NULL,"test");
+    metrics.addTransaction(1,DX_ERROR_NO,300,8,8);
+    metrics.addTransaction(1,DX_ERROR_USR_READSTATUS | DX_ERROR_USR_CHECKSUM,700,8,3);
+    metrics.addTransaction(3,DX_ERROR_OVERHEAT,100,6,6);
+
+    std::string text = metrics.text();
+    DX_CHECK(contains(text,"# TYPE dx_transactions_total counter"));
+    DX_CHECK(contains(text,"dx_transactions_total{bus=\"test\"} 3"));
+    DX_CHECK(contains(text,"dx_errors_total{bus=\"test\",type=\"servo\"} 1"));
+    DX_CHECK(contains(text,"dx_errors_total{bus=\"test\",type=\"status\"} 1"));
+    DX_CHECK(contains(text,"dx_errors_total{bus=\"test\",type=\"checksum\"} 1"));
+    DX_CHECK(contains(text,"dx_errors_total{bus=\"test\",type=\"id\"} 0"));
+    DX_CHECK(contains(text,"dx_tx_bytes_total{bus=\"test\"} 22"));
+    DX_CHECK(contains(text,"dx_rx_bytes_total{bus=\"test\"} 17"));
+
+    // cumulative buckets in seconds
+    DX_CHECK(contains(text,"dx_transaction_seconds_bucket{bus=\"test\",le=\"0.00025\"} 1"));
+    DX_CHECK(contains(text,"dx_transaction_seconds_bucket{bus=\"test\",le=\"0.0005\"} 2"));
+    DX_CHECK(contains(text,"dx_transaction_seconds_bucket{bus=\"test\",le=\"0.001\"} 3"));
+    DX_CHECK(contains(text,"dx_transaction_seconds_bucket{bus=\"test\",le=\"+Inf\"} 3"));
+    DX_CHECK(contains(text,"dx_transaction_seconds_sum{bus=\"test\"} 0.0011"));
+    DX_CHECK(contains(text,"dx_transaction_seconds_count{bus=\"test\"} 3"));
+
+    // only ids with transactions
+    DX_CHECK(contains(text,"dx_servo_transactions_total{bus=\"test\",id=\"1\"} 2"));
+    DX_CHECK(contains(text,"dx_servo_errors_total{bus=\"test\",id=\"1\"} 1"));
+    DX_CHECK(contains(text,"dx_servo_last_transaction_seconds{bus=\"test\",id=\"3\"} 0.0001"));
+    DX_CHECK_EQUAL(countOf(text,"id=\"2\""),0);
+
+    metrics.reset();
+    text = metrics.text();
+    DX_CHECK(contains(text,"dx_transactions_total{bus=\"test\"} 0"));
+    DX_CHECK_EQUAL(countOf(text,"dx_servo_transactions_total{"),0);
+}
+
+// one header per metric, the samples of all buses below it
+static void testList()
+{
+    BusMetrics a(NULL,"a");
+    BusMetrics b(NULL,"quote\"back\\slash");
+    a.addTransaction(1,DX_ERROR_NO,300,8,8);
+    b.addTransaction(2,DX_ERROR_NO,300,8,8);
+
+    std::vector<BusMetrics*> list;
+    list.push_back(&a);
+    list.push_back(&b);
+    std::ostringstream out;
+    BusMetrics::write(out,list);
+    std::string text = out.str();
+
+    DX_CHECK_EQUAL(countOf(text,"# TYPE dx_transactions_total "),1);
+    DX_CHECK_EQUAL(countOf(text,"# TYPE dx_servo_transactions_total "),1);
+    DX_CHECK(contains(text,"dx_transactions_total{bus=\"a\"} 1"));
+    DX_CHECK(contains(text,"dx_transactions_total{bus=\"quote\\\"back\\\\slash\"} 1"));
+    DX_CHECK(text.find("dx_transactions_total{bus=\"a\"}") < text.find("# TYPE dx_errors_total"));
+}
+
+// the DxBus feeds the packet sizes and the telemetry of read servos
+static void testBus()
+{
+    MemorySerial serial;
+    serial.addServo(1);
+    serial.setRegWord(1,DX_CMD_PRESENT_POS,512);
+
+    DxBus      bus(&serial);
+    BusMetrics metrics(&bus,"test");
+    bus.setTimeout(1);
+
+    DX_CHECK_EQUAL(bus.readWord(1,DX_CMD_PRESENT_POS),512);
+    DX_CHECK(!bus.ping(9));
+
+    std::string text = metrics.text();
+    DX_CHECK(contains(text,"dx_transactions_total{bus=\"test\"} 2"));
+    // read: 8 bytes out, 8 back. ping: 6 bytes out, nothing back
+    DX_CHECK(contains(text,"dx_tx_bytes_total{bus=\"test\"} 14"));
+    DX_CHECK(contains(text,"dx_rx_bytes_total{bus=\"test\"} 8"));
+    DX_CHECK(contains(text,"dx_servo_errors_total{bus=\"test\",id=\"9\"} 1"));
+    DX_CHECK(contains(text,"dx_errors_total{bus=\"test\",type=\"no_begin\"} 1"));
+}
+
+#ifndef DX_LITE
+using boost::asio::ip::tcp;
+
+static std::string get(int port,const std::string& first,const std::string& second)
+{
+    boost::asio::io_service   io;
+    tcp::socket               socket(io);
+    boost::system::error_code ec;
+    socket.connect(tcp::endpoint(boost::asio::ip::address_v4::loopback(),port),ec);
+    if(ec)
+        return "";
+
+    boost::asio::write(socket,boost::asio::buffer(first),ec);
+    if(!second.empty())
+    {   // the rest of the headers comes later, no answer before it
+        dx::sleep(50);
+        if(socket.available(ec) != 0)
+            return "";
+        boost::asio::write(socket,boost::asio::buffer(second),ec);
+    }
+
+    std::string response;
+    char        buffer[1024];
+    for(;;)
+    {
+        std::size_t len = socket.read_some(boost::asio::buffer(buffer,sizeof(buffer)),ec);
+        response.append(buffer,len);
+        if(ec)
+            break;
+    }
+    return ec == boost::asio::error::eof ? response : "";
+}
+
+static void testServer()
+{
+    BusMetrics metrics(NULL,"test");
+    metrics.addTransaction(1,DX_ERROR_NO,300,8,8);
+
+    MetricsServer server;
+    server.add(&metrics);
+    int port = DX_METRICS_DEFAULT_PORT + 1000;
+    while(!server.start(port) && port < DX_METRICS_DEFAULT_PORT + 1010)
+        port++;
+    DX_CHECK(server.isRunning());
+
+    std::string response = get(port,"GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n","");
+    DX_CHECK(response.find("HTTP/1.0 200 OK\r\n") == 0);
+    DX_CHECK(contains(response,"dx_transactions_total{bus=\"test\"} 1"));
+
+    std::string body = response.substr(response.find("\r\n\r\n") + 4);
+    std::ostringstream length;
+    length << "Content-Length: " << body.size() << "\r\n";
+    DX_CHECK(response.find(length.str()) != std::string::npos);
+
+    // headers in two segments, answered after the blank line
+    response = get(port,"GET /metrics HTTP/1.1\r\nHost: loc","alhost\r\nAccept: */*\r\n\r\n");
+    DX_CHECK(response.find("HTTP/1.0 200 OK\r\n") == 0);
+    DX_CHECK(contains(response,"dx_transactions_total{bus=\"test\"} 1"));
+
+    // more than one read of headers, all read before the close
+    std::string cookie = "Cookie: " + std::string(4000,'x') + "\r\n";
+    response = get(port,"GET /metrics HTTP/1.1\r\n" + cookie + "\r\n","");
+    DX_CHECK(contains(response,"dx_transactions_total{bus=\"test\"} 1"));
+
+    // oversized headers are dropped
+    cookie = "Cookie: " + std::string(DX_METRICS_MAX_REQUEST,'x') + "\r\n";
+    response = get(port,"GET /metrics HTTP/1.1\r\n" + cookie + "\r\n","");
+    DX_CHECK_EQUAL(countOf(response,"dx_transactions_total{"),0);
+
+    server.remove(&metrics);
+    response = get(port,"GET / HTTP/1.0\r\n\r\n","");
+    DX_CHECK_EQUAL(countOf(response,"dx_transactions_total{"),0);
+
+    server.stop();
+    DX_CHECK(!server.isRunning());
+}
+#endif
+
+int main()
+{
+    DX_RUN(testCounters);
+    DX_RUN(testList);
+    DX_RUN(testBus);
+#ifndef DX_LITE
+    DX_RUN(testServer);
+#endif
+    return DX_TEST_RESULT();
+}
@@ -0,0 +1,140 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// DxPlanner: which packets a cycle compiles to and that the schedule
+// writes and reads the right registers of the fake servos
+
+#include "DxTest.h"
+#include "MemorySerial.h"
+#include "DxPlanner.h"
+
+static int countInst(DxPlanner& planner,int inst)
+{
+    int count = 0;
+    for(int i=0;i < planner.packetCount();i++)
+    {
+        if(planner.packet(i).inst == inst)
+            count++;
+    }
+    return count;
+}
+
+// goal and speed of every servo are adjacent, one sync write of 4 bytes
+static void testWrites()
+{
+    DxPlanner planner;
+    for(int id=1;id <= 4;id++)
+    {
+        planner.writeWord(id,DX_CMD_MOV_SPEED,100);
+        planner.writeWord(id,DX_CMD_GOAL_POS,0);
+        planner.writeWord(id,DX_CMD_GOAL_POS,500 + id);
+    }
+    // only one servo gets its led
+    planner.writeByte(2,DX_CMD_LED_ENABLE,1);
+
+    DX_CHECK_EQUAL(planner.compile(),2);
+    DX_CHECK_EQUAL(countInst(planner,DX_INST_SYNC_WRITE),1);
+    DX_CHECK_EQUAL(countInst(planner,DX_INST_WRITE_DATA),1);
+    for(int i=0;i < planner.packetCount();i++)
+    {
+        const DxPlanPacket& packet = planner.packet(i);
+        if(packet.inst != DX_INST_SYNC_WRITE)
+            continue;
+        DX_CHECK_EQUAL(packet.items.size(),4);
+        DX_CHECK_EQUAL(packet.items[0].addr,DX_CMD_GOAL_POS);
+        DX_CHECK_EQUAL(packet.items[0].length,4);
+        DX_CHECK_EQUAL(packet.replies,0);
+    }
+    DX_CHECK(planner.wireTime() < planner.requestWireTime());
+}
+
+// the reads of a servo merge into one block, bulk read or one read per servo
+static void testReads()
+{
+    DxPlanner planner;
+    for(int id=1;id <= 3;id++)
+    {
+        planner.read(id,DX_CMD_PRESENT_POS,2);
+        planner.read(id,DX_CMD_PRESENT_SPEED,2);
+    }
+
+    DX_CHECK_EQUAL(planner.compile(),3);
+    DX_CHECK_EQUAL(countInst(planner,DX_INST_READ_DATA),3);
+    DX_CHECK_EQUAL(planner.packet(0).items[0].length,4);
+
+    planner.setBulkRead(true);
+    DX_CHECK_EQUAL(planner.compile(),1);
+    DX_CHECK_EQUAL(planner.packet(0).inst,DX_INST_BULK_READ);
+    DX_CHECK_EQUAL(planner.packet(0).replies,3);
+}
+
+static void testExecute(bool bulkRead)
+{
+    MemorySerial serial;
+    for(int id=1;id <= 3;id++)
+    {
+        serial.addServo(id);
+        serial.setRegWord(id,DX_CMD_PRESENT_POS,100 * id);
+        serial.setRegWord(id,DX_CMD_PRESENT_SPEED,id);
+    }
+    DxBus bus(&serial);
+    bus.setTimeout(1);
+
+    DxPlanner planner;
+    planner.setBulkRead(bulkRead);
+    int pos[4];
+    int speed[4];
+    for(int id=1;id <= 3;id++)
+    {
+        planner.writeWord(id,DX_CMD_GOAL_POS,200 + id);
+        pos[id]   = planner.read(id,DX_CMD_PRESENT_POS,2);
+        speed[id] = planner.read(id,DX_CMD_PRESENT_SPEED,2);
+    }
+    // no servo 4, its read fails alone
+    pos[0] = planner.read(4,DX_CMD_PRESENT_POS,2);
+    planner.compile();
+
+    DX_CHECK(!planner.execute(&bus));
+    DX_CHECK(planner.errorCount() >= 1);
+    for(int id=1;id <= 3;id++)
+    {
+        DX_CHECK_EQUAL(serial.regWord(id,DX_CMD_GOAL_POS),200 + id);
+        DX_CHECK(planner.readOk(pos[id]));
+        DX_CHECK_EQUAL(planner.readWord(pos[id]),100 * id);
+        DX_CHECK_EQUAL(planner.readWord(speed[id]),id);
+    }
+    DX_CHECK(!planner.readOk(pos[0]));
+    DX_CHECK_EQUAL(planner.readWord(pos[0]),-1);
+}
+
+static void testExecuteRead() { testExecute(false); }
+static void testExecuteBulkRead() { testExecute(true); }
+
+int main()
+{
+    DX_RUN(testWrites);
+    DX_RUN(testReads);
+    DX_RUN(testExecuteRead);
+    DX_RUN(testExecuteBulkRead);
+    return DX_TEST_RESULT();
+}
@@ -0,0 +1,144 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// BusRegistry on a pseudo terminal: sharing, symlinks and the reported
+// errors
+
+#include "DxTest.h"
+#include "BusRegistry.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <string>
+
+static void testRegistry()
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    DX_CHECK(master >= 0);
+    if(master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+        return;
+
+    std::string device = ptsname(master);
+    std::string link = "/tmp/dxRegistryTest" + device.substr(device.rfind('/') + 1);
+    unlink(link.c_str());
+    DX_CHECK(symlink(device.c_str(),link.c_str()) == 0);
+
+    int    result = -1;
+    DxBus* bus = BusRegistry::acquire(device.c_str(),57600,&result);
+    DX_CHECK(bus != NULL);
+    DX_CHECK_EQUAL(result,DX_REGISTRY_OK);
+
+    // the symlink is the same port
+    DxBus* linked = BusRegistry::acquire(link.c_str(),57600,&result);
+    DX_CHECK(linked == bus);
+    DX_CHECK_EQUAL(BusRegistry::refCount(device.c_str()),2);
+    DX_CHECK_EQUAL(BusRegistry::count(),1);
+    DX_CHECK(BusRegistry::find(link.c_str()) == bus);
+
+    // another baudrate can't share it
+    DX_CHECK(BusRegistry::acquire(link.c_str(),115200,&result) == NULL);
+    DX_CHECK_EQUAL(result,DX_REGISTRY_BAUDRATE);
+
+    DX_CHECK(BusRegistry::acquire("/dev/dxRegistryTestMissing",57600,&result) == NULL);
+    DX_CHECK_EQUAL(result,DX_REGISTRY_OPEN_FAILED);
+
+    DX_CHECK(BusRegistry::release(linked));
+    DX_CHECK(BusRegistry::release(bus));
+    DX_CHECK(!BusRegistry::release(bus));
+    DX_CHECK_EQUAL(BusRegistry::count(),0);
+
+    unlink(link.c_str());
+    close(master);
+}
+
+struct Reacquire
+{
+    std::string device;
+    bool        ping;
+    int         errorBefore;
+    int         errorAfter;
+};
+
+// a new bus starts without errors, even at the address of the old one
+static void reacquire(Reacquire* r)
+{
+    DxBus* bus = BusRegistry::acquire(r->device.c_str(),57600);
+    if(bus == NULL)
+        return;
+    r->errorBefore = bus->error();
+    if(r->ping)
+        bus->ping(1);
+    r->errorAfter = bus->error();
+    BusRegistry::release(bus);
+}
+
+// the error of a released bus doesn't reach the next one
+static void testReacquire()
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    DX_CHECK(master >= 0);
+    if(master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+        return;
+    std::string device = ptsname(master);
+
+    for(int i=0;i < 20;i++)
+    {
+        DxBus* bus = BusRegistry::acquire(device.c_str(),57600);
+        DX_CHECK(bus != NULL);
+        if(bus == NULL)
+            break;
+        bus->setTimeout(1);
+        DX_CHECK(!bus->ping(1));
+        DX_CHECK(bus->error() != DX_ERROR_NO);
+        DX_CHECK(BusRegistry::release(bus));
+
+        Reacquire r[2];
+        for(int j=0;j < 2;j++)
+        {
+            r[j].device = device;
+            r[j].ping = j == 0;
+            r[j].errorBefore = -1;
+            r[j].errorAfter = -1;
+        }
+        dx::thread a(&reacquire,&r[0]);
+        dx::thread b(&reacquire,&r[1]);
+        a.join();
+        b.join();
+
+        DX_CHECK_EQUAL(r[0].errorBefore,DX_ERROR_NO);
+        DX_CHECK_EQUAL(r[1].errorBefore,DX_ERROR_NO);
+        DX_CHECK(r[0].errorAfter != DX_ERROR_NO);
+        DX_CHECK_EQUAL(r[1].errorAfter,DX_ERROR_NO);
+        DX_CHECK_EQUAL(BusRegistry::count(),0);
+    }
+
+    close(master);
+}
+
+int main()
+{
+    DX_RUN(testRegistry);
+    DX_RUN(testReacquire);
+    return DX_TEST_RESULT();
+}
@@ -0,0 +1,134 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// ReturnDelayOptimizer against fake servos which lose their replies below
+// a return delay of their own
+
+#include "DxTest.h"
+#include "MemorySerial.h"
+#include "ReturnDelayOptimizer.h"
+
+// no reply to reads below the smallest working return delay of a servo
+class DelaySerial: public MemorySerial
+{
+public:
+    DelaySerial()
+    {
+        for(int id=0;id < DX_BROADCAST_ID;id++)
+            minDelay[id] = 0;
+    }
+
+    int minDelay[DX_BROADCAST_ID];
+
+protected:
+    void handlePacket(int id,int inst,const unsigned char* param,int paramLength)
+    {
+        if(inst == DX_INST_READ_DATA && id < DX_BROADCAST_ID &&
+           hasServo(id) && reg(id,DX_CMD_DELAYTIME) < minDelay[id])
+            return;
+        MemorySerial::handlePacket(id,inst,param,paramLength);
+    }
+};
+
+static void setup(DelaySerial& serial)
+{
+    serial.addServo(1);
+    serial.addServo(2);
+    serial.setReg(1,DX_CMD_DELAYTIME,250);
+    serial.setReg(2,DX_CMD_DELAYTIME,250);
+    serial.minDelay[1] = 10;
+    serial.minDelay[2] = 50;
+}
+
+static void testOptimize()
+{
+    DelaySerial serial;
+    setup(serial);
+    DxBus bus(&serial);
+    bus.setTimeout(1);
+    bus.setRetries(2);
+
+    ReturnDelayOptimizer optimizer(&bus);
+    optimizer.setSamples(5);
+    int ids[] = { 1, 2 };
+    DX_CHECK(optimizer.optimize(ids,2));
+    DX_CHECK_EQUAL(optimizer.servoCount(),2);
+    DX_CHECK_EQUAL(optimizer.id(0),1);
+    DX_CHECK_EQUAL(optimizer.oldDelay(0),250);
+    DX_CHECK_EQUAL(optimizer.newDelay(0),10);
+    DX_CHECK_EQUAL(optimizer.newDelay(1),50);
+    DX_CHECK_EQUAL(serial.reg(1,DX_CMD_DELAYTIME),10);
+    DX_CHECK_EQUAL(serial.reg(2,DX_CMD_DELAYTIME),50);
+    DX_CHECK(optimizer.expectedSavedTime() == (240 + 200) * DX_DELAY_UNIT / 2.0);
+    DX_CHECK(optimizer.newLatency(1) > 0);
+
+    // the retries are back
+    DX_CHECK_EQUAL(bus.retries(),2);
+}
+
+// the slowest servo sets the value of the chain
+static void testUniform()
+{
+    DelaySerial serial;
+    setup(serial);
+    DxBus bus(&serial);
+    bus.setTimeout(1);
+
+    ReturnDelayOptimizer optimizer(&bus);
+    optimizer.setSamples(5);
+    int candidates[] = { 5, 100, 50 };
+    optimizer.setCandidates(candidates,3);
+    int ids[] = { 1, 2 };
+    DX_CHECK(optimizer.optimize(ids,2,true));
+    DX_CHECK_EQUAL(optimizer.newDelay(0),50);
+    DX_CHECK_EQUAL(optimizer.newDelay(1),50);
+    DX_CHECK_EQUAL(serial.reg(1,DX_CMD_DELAYTIME),50);
+    DX_CHECK_EQUAL(serial.reg(2,DX_CMD_DELAYTIME),50);
+}
+
+// a servo which doesn't answer keeps what it has
+static void testMissing()
+{
+    DelaySerial serial;
+    setup(serial);
+    DxBus bus(&serial);
+    bus.setTimeout(1);
+
+    ReturnDelayOptimizer optimizer(&bus);
+    optimizer.setSamples(5);
+    int ids[] = { 1, 3 };
+    DX_CHECK(!optimizer.optimize(ids,2));
+    DX_CHECK_EQUAL(optimizer.servoCount(),2);
+    DX_CHECK_EQUAL(optimizer.newDelay(0),10);
+    DX_CHECK_EQUAL(optimizer.oldDelay(1),-1);
+    DX_CHECK_EQUAL(optimizer.newDelay(1),-1);
+    DX_CHECK_EQUAL(optimizer.id(2),-1);
+}
+
+int main()
+{
+    DX_RUN(testOptimize);
+    DX_RUN(testUniform);
+    DX_RUN(testMissing);
+    return DX_TEST_RESULT();
+}
@@ -0,0 +1,191 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// SimSerial physics, stepped by hand: the position follows the goal
+// at the moving speed, external torque, overload, heat and the time scale
+
+#include "DxTest.h"
+#include "SimSerial.h"
+#include "DxTime.h"
+
+#include <cmath>
+
+// ticks/s of a MX servo at a moving speed register value
+static double tickSpeed(int speed)
+{
+    return speed * 0.114 * 4096 / 60.0;
+}
+
+static bool near(double value,double expected,double tolerance)
+{
+    return std::fabs(value - expected) <= tolerance;
+}
+
+static void testFollow()
+{
+    SimSerial sim(0);
+    sim.addServo(1);
+    DxBus bus(&sim);
+    bus.setTimeout(1);
+
+    double start = sim.position(1);
+    DX_CHECK(bus.writeWord(1,DX_CMD_MOV_SPEED,100));
+    DX_CHECK(bus.writeWord(1,DX_CMD_GOAL_POS,(int)start + 2000));
+
+    // far from the goal it moves at the moving speed
+    sim.step(0.1);
+    DX_CHECK(near(sim.velocity(1),tickSpeed(100),1.0));
+    DX_CHECK(near(sim.position(1) - start,tickSpeed(100) * 0.1,2.0));
+    DX_CHECK_EQUAL(bus.readByte(1,DX_CMD_MOVING),1);
+
+    sim.step(5.0);
+    DX_CHECK(near(sim.position(1),start + 2000,1.0));
+    DX_CHECK_EQUAL(bus.readWord(1,DX_CMD_PRESENT_POS),(int)start + 2000);
+    DX_CHECK_EQUAL(bus.readByte(1,DX_CMD_MOVING),0);
+}
+
+// the load shows up in the register and lowers the top speed
+static void testExternalTorque()
+{
+    SimSerial sim(0);
+    sim.addServo(1);
+    DxBus bus(&sim);
+    bus.setTimeout(1);
+
+    DX_CHECK(bus.writeWord(1,DX_CMD_MOV_SPEED,0));
+    DX_CHECK(bus.writeWord(1,DX_CMD_GOAL_POS,0));
+    sim.step(0.5);
+    DX_CHECK(bus.writeWord(1,DX_CMD_GOAL_POS,4000));
+    sim.step(0.05);
+    double free = sim.velocity(1);
+    DX_CHECK(free > 0);
+
+    sim.setExternalTorque(1,0.5);
+    DX_CHECK(near(sim.externalTorque(1),0.5,1e-9));
+    sim.step(0.05);
+    DX_CHECK(near(sim.velocity(1),free * 0.5,1.0));
+    DX_CHECK(near(sim.load(1),-0.5,1e-9));
+    DX_CHECK_EQUAL(bus.readWord(1,DX_CMD_PRESENT_LOAD),512 | 0x400);
+    DX_CHECK_EQUAL(bus.error(),DX_ERROR_NO);
+}
+
+// more than the torque limit: overload, the alarm shutdown turns the torque off
+static void testOverload()
+{
+    SimSerial sim(0);
+    sim.addServo(1);
+    DxBus bus(&sim);
+    bus.setTimeout(1);
+
+    DX_CHECK(bus.writeWord(1,DX_CMD_LIMIT_TORQUE,300));
+    DX_CHECK(bus.writeWord(1,DX_CMD_GOAL_POS,2000));
+    DX_CHECK_EQUAL(bus.readByte(1,DX_CMD_TORQUE_ENABLE),1);
+
+    sim.setExternalTorque(1,0.5);
+    sim.step(0.01);
+    DX_CHECK_EQUAL(bus.readByte(1,DX_CMD_TORQUE_ENABLE),-1);
+    DX_CHECK(bus.error() & DX_ERROR_OVERLOAD);
+    DX_CHECK_EQUAL(sim.reg(1,DX_CMD_TORQUE_ENABLE),0);
+
+    // torque off, the servo gets turned
+    sim.step(0.01);
+    DX_CHECK(sim.velocity(1) > 0);
+    DX_CHECK(near(sim.load(1),0,1e-9));
+
+    // switching it back on clears the alarm
+    sim.setExternalTorque(1,0);
+    DX_CHECK(bus.writeByte(1,DX_CMD_TORQUE_ENABLE,1));
+    sim.step(0.01);
+    DX_CHECK_EQUAL(bus.readByte(1,DX_CMD_TORQUE_ENABLE),1);
+    DX_CHECK_EQUAL(bus.error() & DX_ERROR_OVERLOAD,0);
+}
+
+// a loaded servo heats up, the overheat error clears 5 degrees below the limit
+static void testOverheat()
+{
+    SimSerial sim(0);
+    sim.setAmbientTemp(79);
+    sim.addServo(1);
+    DxBus bus(&sim);
+    bus.setTimeout(1);
+
+    DX_CHECK(bus.writeWord(1,DX_CMD_GOAL_POS,2000));
+    sim.setExternalTorque(1,0.9);
+    double temp = sim.temperature(1);
+    sim.step(0.5);
+    DX_CHECK(sim.temperature(1) > temp);
+    DX_CHECK(bus.readByte(1,DX_CMD_PRESENT_TEMP) >= 79);
+
+    // over the limit, the alarm shutdown takes the load off
+    sim.step(2.0);
+    DX_CHECK_EQUAL(sim.reg(1,DX_CMD_TORQUE_ENABLE),0);
+    DX_CHECK(near(sim.load(1),0,1e-9));
+
+    // cooling down below the limit, still too hot
+    sim.setExternalTorque(1,0);
+    sim.setAmbientTemp(30);
+    sim.step(1.0);
+    DX_CHECK(sim.temperature(1) < 80);
+    bus.readByte(1,DX_CMD_PRESENT_TEMP);
+    DX_CHECK(bus.error() & DX_ERROR_OVERHEAT);
+    while(sim.temperature(1) > 75.5)
+        sim.step(1.0);
+    bus.readByte(1,DX_CMD_PRESENT_TEMP);
+    DX_CHECK(bus.error() & DX_ERROR_OVERHEAT);
+
+    while(sim.temperature(1) > 74.5)
+        sim.step(1.0);
+    bus.readByte(1,DX_CMD_PRESENT_TEMP);
+    DX_CHECK_EQUAL(bus.error() & DX_ERROR_OVERHEAT,0);
+    DX_CHECK_EQUAL(bus.readByte(1,DX_CMD_PRESENT_TEMP),(int)(sim.temperature(1) + 0.5));
+}
+
+static void testTimeScale()
+{
+    SimSerial stopped(0);
+    stopped.addServo(1);
+    stopped.position(1);
+    dx::sleep(20);
+    stopped.position(1);
+    DX_CHECK(stopped.simTime() == 0);
+    stopped.step(0.5);
+    DX_CHECK(near(stopped.simTime(),0.5,1e-9));
+
+    SimSerial fast(100);
+    fast.addServo(1);
+    dx::uint64_t start = dxMicros();
+    dx::sleep(20);
+    fast.position(1);
+    double real = (dxMicros() - start) / 1000000.0;
+    DX_CHECK(fast.simTime() > 10 * real);
+}
+
+int main()
+{
+    DX_RUN(testFollow);
+    DX_RUN(testExternalTorque);
+    DX_RUN(testOverload);
+    DX_RUN(testOverheat);
+    DX_RUN(testTimeScale);
+    return DX_TEST_RESULT();
+}
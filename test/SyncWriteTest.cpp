@@ -0,0 +1,216 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// sync writes with more servos than fit into one packet: plain split into
+// several sync writes or REG_WRITE per servo and one ACTION
+
+#include "DxTest.h"
+#include "MemorySerial.h"
+#include "DxAsyncBus.h"
+
+#define  SERVO_COUNT    (100)
+
+// counts the instructions on the bus
+class CountingSerial: public MemorySerial
+{
+public:
+    CountingSerial():
+        syncWrites(0),
+        regWrites(0),
+        actions(0)
+    {}
+
+    int syncWrites;
+    int regWrites;
+    int actions;
+
+protected:
+    void handlePacket(int id,int inst,const unsigned char* param,int paramLength)
+    {
+        if(inst == DX_INST_SYNC_WRITE)
+            syncWrites++;
+        else if(inst == DX_INST_REG_WRITE)
+            regWrites++;
+        else if(inst == DX_INST_ACTION)
+            actions++;
+        MemorySerial::handlePacket(id,inst,param,paramLength);
+    }
+};
+
+static void fill(CountingSerial& serial,int* ids,unsigned char* data,int statusLevel)
+{
+    for(int i=0;i < SERVO_COUNT;i++)
+    {
+        ids[i] = i;
+        serial.addServo(i);
+        serial.setReg(i,DX_CMD_STATUSRETURNLEVEL,statusLevel);
+        data[i * 2]     = (100 + i) & 0xFF;
+        data[i * 2 + 1] = (100 + i) >> 8;
+    }
+}
+
+static bool allWritten(CountingSerial& serial)
+{
+    for(int i=0;i < SERVO_COUNT;i++)
+    {
+        if(serial.regWord(i,DX_CMD_GOAL_POS) != 100 + i)
+            return false;
+    }
+    return true;
+}
+
+static void testSplit()
+{
+    CountingSerial serial;
+    int            ids[SERVO_COUNT];
+    unsigned char  data[SERVO_COUNT * 2];
+    fill(serial,ids,data,2);
+    DxBus bus(&serial);
+
+    DX_CHECK_EQUAL(DxBus::syncWriteCapacity(2),83);
+    DX_CHECK(bus.syncWrite(DX_CMD_GOAL_POS,2,ids,SERVO_COUNT,data));
+    DX_CHECK_EQUAL(serial.syncWrites,2);
+    DX_CHECK(allWritten(serial));
+
+    // a single entry longer than a packet can't go out at all
+    unsigned char big[DX_MAX_PARAM_LENGTH];
+    DX_CHECK(!bus.syncWrite(0,DX_MAX_PARAM_LENGTH - 1,ids,1,big));
+    DX_CHECK_EQUAL(bus.error(),DX_ERROR_RANGE);
+    DX_CHECK_EQUAL(serial.syncWrites,2);
+}
+
+static void testRegWriteAction(int statusLevel)
+{
+    CountingSerial serial;
+    int            ids[SERVO_COUNT];
+    unsigned char  data[SERVO_COUNT * 2];
+    fill(serial,ids,data,statusLevel);
+    DxBus bus(&serial);
+    bus.setSyncSplitAction(true);
+    bus.setStatusReturnLevel(statusLevel);
+    bus.setTimeout(1);
+
+    DX_CHECK(bus.syncWrite(DX_CMD_GOAL_POS,2,ids,SERVO_COUNT,data));
+    DX_CHECK_EQUAL(bus.error(),DX_ERROR_NO);
+    DX_CHECK_EQUAL(serial.syncWrites,0);
+    DX_CHECK_EQUAL(serial.regWrites,SERVO_COUNT);
+    DX_CHECK_EQUAL(serial.actions,1);
+    DX_CHECK(allWritten(serial));
+    DX_CHECK_EQUAL(serial.reg(0,DX_CMD_REGISTER),0);
+}
+
+static void testRegWriteActionLevels()
+{
+    testRegWriteAction(0);
+    testRegWriteAction(1);
+    testRegWriteAction(2);
+}
+
+// lost status packets get the REG_WRITE repeated, a servo which misses
+// all attempts doesn't keep the others from moving
+static void testRegWriteRetry()
+{
+    CountingSerial serial;
+    int            ids[SERVO_COUNT];
+    unsigned char  data[SERVO_COUNT * 2];
+    fill(serial,ids,data,2);
+    serial.setFaultRate(-1,0.2,0.0);
+    DxBus bus(&serial);
+    bus.setSyncSplitAction(true);
+    bus.setTimeout(1);
+    bus.setRetries(10);
+
+    DX_CHECK(bus.syncWrite(DX_CMD_GOAL_POS,2,ids,SERVO_COUNT,data));
+    DX_CHECK(serial.regWrites > SERVO_COUNT);
+    DX_CHECK_EQUAL(serial.actions,1);
+    DX_CHECK(allWritten(serial));
+
+    serial.setFaultRate(-1,0.0,0.0);
+    serial.setFaultRate(5,1.0,0.0);
+    bus.setRetries(1);
+    data[0] = 0;
+    DX_CHECK(!bus.syncWrite(DX_CMD_GOAL_POS,2,ids,SERVO_COUNT,data));
+    DX_CHECK(bus.error() & DX_ERROR_USR_NO_BEGIN);
+    DX_CHECK_EQUAL(serial.actions,2);
+    DX_CHECK_EQUAL(serial.regWord(0,DX_CMD_GOAL_POS),0);
+    DX_CHECK_EQUAL(serial.regWord(SERVO_COUNT - 1,DX_CMD_GOAL_POS),100 + SERVO_COUNT - 1);
+}
+
+struct Completion
+{
+    Completion(): done(false), ok(false), error(0) {}
+
+    dx::atomic<bool> done;
+    bool             ok;
+    int              error;
+
+    bool wait()
+    {
+        for(int i=0;i < 1000 && !done;i++)
+            dx::sleep(1);
+        return done;
+    }
+};
+
+static void syncWritten(void* context,const DxResult& result)
+{
+    Completion* completion = static_cast<Completion*>(context);
+    completion->ok    = result.ok;
+    completion->error = result.error;
+    completion->done  = true;
+}
+
+// the async requests carry the data of a split write, too large ones fail
+static void testAsyncSplit()
+{
+    CountingSerial serial;
+    int            ids[SERVO_COUNT];
+    unsigned char  data[SERVO_COUNT * 2];
+    fill(serial,ids,data,2);
+    DxBus bus(&serial);
+    DxAsyncBus async(&bus);
+
+    Completion split;
+    DX_CHECK(async.syncWrite(DX_CMD_GOAL_POS,2,ids,SERVO_COUNT,data,&syncWritten,&split) > 0);
+    DX_CHECK(split.wait());
+    DX_CHECK(split.ok);
+    DX_CHECK_EQUAL(serial.syncWrites,2);
+    DX_CHECK(allWritten(serial));
+
+    Completion tooLarge;
+    unsigned char big[SERVO_COUNT * 20] = { 0 };
+    DX_CHECK(async.syncWrite(DX_CMD_GOAL_POS,20,ids,SERVO_COUNT,big,&syncWritten,&tooLarge) > 0);
+    DX_CHECK(tooLarge.wait());
+    DX_CHECK(!tooLarge.ok);
+    DX_CHECK_EQUAL(tooLarge.error,DX_ERROR_RANGE);
+    DX_CHECK_EQUAL(serial.syncWrites,2);
+}
+
+int main()
+{
+    DX_RUN(testSplit);
+    DX_RUN(testRegWriteActionLevels);
+    DX_RUN(testRegWriteRetry);
+    DX_RUN(testAsyncSplit);
+    return DX_TEST_RESULT();
+}
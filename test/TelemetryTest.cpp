@@ -0,0 +1,293 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// IndirectTelemetry against a protocol 2.0 fake with a control table: the
+// indirect address table, the fallback for refused sync writes and the
+// decoding of the SYNC_READ
+
+#include "DxTest.h"
+#include "MemorySerial.h"
+#include "IndirectTelemetry.h"
+
+#include <cstring>
+#include <vector>
+
+#define  TABLE_SIZE     (256)
+
+// x series servos which know READ, WRITE, SYNC_READ and SYNC_WRITE. with
+// the torque on the indirect addresses are read only, a WRITE reports it,
+// a SYNC_WRITE gets silently ignored
+class Table2Serial: public MemorySerial
+{
+public:
+    Table2Serial():
+        syncReads(0)
+    {
+        memset(table,0,sizeof(table));
+        memset(present,0,sizeof(present));
+        memset(ignoreSyncWrite,0,sizeof(ignoreSyncWrite));
+        open();
+    }
+
+    unsigned char table[DX_BROADCAST_ID][TABLE_SIZE];
+    bool          present[DX_BROADCAST_ID];
+    bool          ignoreSyncWrite[DX_BROADCAST_ID];
+    int           syncReads;
+
+    void setLong(int id,int addr,int value,int size)
+    {
+        for(int b=0;b < size;b++)
+            table[id][addr + b] = (value >> (b * 8)) & 0xFF;
+    }
+
+    int indirectAddr(int id,int entry)
+    {
+        int addr = DX2_CMD_INDIRECT_ADDR + entry * 2;
+        return table[id][addr] + (table[id][addr + 1] << 8);
+    }
+
+protected:
+    int byte(int id,int addr)
+    {
+        if(addr >= DX2_CMD_INDIRECT_DATA && addr < DX2_CMD_INDIRECT_DATA + DX2_INDIRECT_COUNT)
+            addr = indirectAddr(id,addr - DX2_CMD_INDIRECT_DATA);
+        return addr >= 0 && addr < TABLE_SIZE ? table[id][addr] : 0;
+    }
+
+    // error number of a write
+    int write(int id,int addr,const unsigned char* data,int length)
+    {
+        if(addr < 0 || addr + length > TABLE_SIZE)
+            return DX2_ERROR_RANGE;
+        if(table[id][DX2_CMD_TORQUE_ENABLE] && addr < DX2_CMD_INDIRECT_DATA &&
+           addr + length > DX2_CMD_INDIRECT_ADDR)
+            return DX2_ERROR_ACCESS;
+        memcpy(&table[id][addr],data,length);
+        return DX_ERROR_NO;
+    }
+
+    void status(int id,int error,const unsigned char* data,int length)
+    {
+        unsigned char param[1 + TABLE_SIZE];
+        param[0] = error;
+        if(length > 0)
+            memcpy(param + 1,data,length);
+        unsigned char packet[DX2_MAX_PACKET_SIZE];
+        int size = DxBus2::encodePacket(id,DX2_INST_STATUS,param,1 + length,packet);
+        received(reinterpret_cast<const char*>(packet),size);
+    }
+
+    void read(int id,int addr,int length)
+    {
+        unsigned char data[TABLE_SIZE];
+        for(int i=0;i < length && i < TABLE_SIZE;i++)
+            data[i] = byte(id,addr + i);
+        status(id,DX_ERROR_NO,data,length);
+    }
+
+    void send(const char* data,unsigned int len)
+    {
+        const unsigned char* packet = reinterpret_cast<const unsigned char*>(data);
+        if(len < 10 || packet[2] != DX2_HEADER)
+            return;
+
+        // without the byte stuffing
+        std::vector<unsigned char> p;
+        bool stuffed = false;
+        for(unsigned int i=8;i < len - 2;i++)
+        {
+            int n = p.size();
+            if(!stuffed && packet[i] == DX2_HEADER && n >= 3 &&
+               p[n - 3] == DX_BEGIN && p[n - 2] == DX_BEGIN && p[n - 1] == DX2_HEADER)
+            {
+                stuffed = true;
+                continue;
+            }
+            stuffed = false;
+            p.push_back(packet[i]);
+        }
+        if(p.size() < 4)
+            return;
+
+        int id     = packet[4];
+        int inst   = packet[7];
+        int addr   = p[0] + (p[1] << 8);
+        int length = p[2] + (p[3] << 8);
+
+        switch(inst)
+        {
+        case DX2_INST_READ:
+            if(id < DX_BROADCAST_ID && present[id])
+                read(id,addr,length);
+            break;
+        case DX2_INST_WRITE:
+            if(id < DX_BROADCAST_ID && present[id])
+                status(id,write(id,addr,&p[2],p.size() - 2),NULL,0);
+            break;
+        case DX2_INST_SYNC_READ:
+            syncReads++;
+            for(size_t i=4;i < p.size();i++)
+            {
+                if(p[i] < DX_BROADCAST_ID && present[p[i]])
+                    read(p[i],addr,length);
+            }
+            break;
+        case DX2_INST_SYNC_WRITE:
+            for(size_t i=4;i + 1 + length <= p.size();i += 1 + length)
+            {
+                int servo = p[i];
+                if(servo < DX_BROADCAST_ID && present[servo] && !ignoreSyncWrite[servo])
+                    write(servo,addr,&p[i + 1],length);
+            }
+            break;
+        }
+    }
+};
+
+// the registers of the fields in the order of the window
+static const int windowRegs[] =
+{
+    DX2_CMD_PRESENT_POS,DX2_CMD_PRESENT_POS + 1,DX2_CMD_PRESENT_POS + 2,DX2_CMD_PRESENT_POS + 3,
+    DX2_CMD_PRESENT_VELOCITY,DX2_CMD_PRESENT_VELOCITY + 1,DX2_CMD_PRESENT_VELOCITY + 2,DX2_CMD_PRESENT_VELOCITY + 3,
+    DX2_CMD_PRESENT_CURRENT,DX2_CMD_PRESENT_CURRENT + 1,
+    DX2_CMD_PRESENT_INPUT_VOLT,DX2_CMD_PRESENT_INPUT_VOLT + 1,
+    DX2_CMD_PRESENT_TEMP,
+    DX2_CMD_HARDWARE_ERROR
+};
+
+static void testWindow()
+{
+    Table2Serial serial;
+    serial.present[1] = true;
+    serial.present[2] = true;
+    DxBus2 bus(&serial);
+    bus.setTimeout(1);
+
+    IndirectTelemetry telemetry(&bus,DX_TELEMETRY_ALL,4);
+    DX_CHECK_EQUAL(telemetry.windowLength(),14);
+    DX_CHECK_EQUAL(telemetry.spanLength(),DX2_CMD_PRESENT_TEMP + 1 - DX2_CMD_HARDWARE_ERROR);
+    DX_CHECK(telemetry.windowLength() < telemetry.spanLength() / 2);
+    DX_CHECK_EQUAL(telemetry.windowAddr(),DX2_CMD_INDIRECT_DATA + 4);
+
+    int ids[] = { 1, 2 };
+    DX_CHECK(telemetry.setup(ids,2));
+    DX_CHECK_EQUAL(telemetry.idCount(),2);
+    for(int id=1;id <= 2;id++)
+    {
+        for(int e=0;e < 14;e++)
+            DX_CHECK_EQUAL(serial.indirectAddr(id,4 + e),windowRegs[e]);
+        // the entries before the window stay free
+        DX_CHECK_EQUAL(serial.indirectAddr(id,3),0);
+    }
+
+    // a window which doesn't fit
+    IndirectTelemetry tooLate(&bus,DX_TELEMETRY_ALL,20);
+    DX_CHECK_EQUAL(tooLate.windowLength(),0);
+    DX_CHECK(!tooLate.setup(ids,2));
+
+    // a negative count leaves the servos as they are
+    DX_CHECK(!telemetry.setup(ids,-1));
+    DX_CHECK_EQUAL(telemetry.idCount(),2);
+}
+
+// the torque on keeps the table, a lost sync write gets repeated
+static void testFallback()
+{
+    Table2Serial serial;
+    for(int id=1;id <= 3;id++)
+        serial.present[id] = true;
+    serial.table[2][DX2_CMD_TORQUE_ENABLE] = 1;
+    serial.ignoreSyncWrite[3] = true;
+    DxBus2 bus(&serial);
+    bus.setTimeout(1);
+
+    IndirectTelemetry telemetry(&bus,DX_TELEMETRY_POSITION | DX_TELEMETRY_TEMPERATURE);
+    DX_CHECK_EQUAL(telemetry.windowLength(),5);
+
+    int ids[] = { 1, 2, 3 };
+    DX_CHECK(!telemetry.setup(ids,3));
+    DX_CHECK_EQUAL(telemetry.idCount(),2);
+    DX_CHECK_EQUAL(telemetry.id(0),1);
+    DX_CHECK_EQUAL(telemetry.id(1),3);
+    DX_CHECK_EQUAL(serial.indirectAddr(2,0),0);
+    DX_CHECK_EQUAL(serial.indirectAddr(3,0),DX2_CMD_PRESENT_POS);
+    DX_CHECK_EQUAL(serial.indirectAddr(3,4),DX2_CMD_PRESENT_TEMP);
+}
+
+static void testDecode()
+{
+    Table2Serial serial;
+    for(int id=1;id <= 2;id++)
+    {
+        serial.present[id] = true;
+        serial.setLong(id,DX2_CMD_PRESENT_POS,-1000 * id,4);
+        serial.setLong(id,DX2_CMD_PRESENT_VELOCITY,-5 * id,4);
+        serial.setLong(id,DX2_CMD_PRESENT_CURRENT,-3 * id,2);
+        serial.setLong(id,DX2_CMD_PRESENT_INPUT_VOLT,120 + id,2);
+        serial.setLong(id,DX2_CMD_PRESENT_TEMP,40 + id,1);
+        serial.setLong(id,DX2_CMD_HARDWARE_ERROR,0x20,1);
+    }
+    DxBus2 bus(&serial);
+    bus.setTimeout(1);
+
+    IndirectTelemetry telemetry(&bus);
+    int ids[] = { 1, 2 };
+    DX_CHECK(telemetry.setup(ids,2));
+    DX_CHECK(!telemetry.valid(1));
+    DX_CHECK_EQUAL(telemetry.position(1),0);
+
+    DX_CHECK(telemetry.update());
+    DX_CHECK_EQUAL(serial.syncReads,1);
+    for(int id=1;id <= 2;id++)
+    {
+        DX_CHECK(telemetry.valid(id));
+        DX_CHECK_EQUAL(telemetry.position(id),-1000 * id);
+        DX_CHECK_EQUAL(telemetry.velocity(id),-5 * id);
+        DX_CHECK_EQUAL(telemetry.current(id),-3 * id);
+        DX_CHECK_EQUAL(telemetry.voltage(id),120 + id);
+        DX_CHECK_EQUAL(telemetry.temperature(id),40 + id);
+        DX_CHECK_EQUAL(telemetry.hardwareError(id),0x20);
+    }
+
+    // one servo by itself, the positive current stays positive
+    serial.setLong(2,DX2_CMD_PRESENT_CURRENT,0x7FFF,2);
+    DX_CHECK(telemetry.update(2));
+    DX_CHECK_EQUAL(serial.syncReads,1);
+    DX_CHECK_EQUAL(telemetry.current(2),0x7FFF);
+    DX_CHECK(!telemetry.update(7));
+
+    // a missing servo fails the sync read, the other one is still there
+    serial.present[1] = false;
+    DX_CHECK(!telemetry.update());
+    DX_CHECK(!telemetry.valid(1));
+    DX_CHECK(telemetry.valid(2));
+    DX_CHECK_EQUAL(telemetry.position(2),-2000);
+}
+
+int main()
+{
+    DX_RUN(testWindow);
+    DX_RUN(testFallback);
+    DX_RUN(testDecode);
+    return DX_TEST_RESULT();
+}
@@ -0,0 +1,255 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// BusTracer rings and their chrome trace json: all events of every thread
+// in order, the ring wrap, clear() and a tracer in the place of an old one
+
+#include "DxTest.h"
+#include "BusTracer.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////////
+// just enough json to check the syntax
+
+static void skipSpace(const char*& p)
+{
+    while(*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')
+        p++;
+}
+
+static bool parseValue(const char*& p);
+
+static bool parseString(const char*& p)
+{
+    if(*p != '"')
+        return false;
+    for(p++;*p != '"';p++)
+    {
+        if(*p == 0 || (unsigned char)*p < 0x20)
+            return false;
+        if(*p == '\\' && *++p == 0)
+            return false;
+    }
+    p++;
+    return true;
+}
+
+static bool parseNumber(const char*& p)
+{
+    const char* start = p;
+    strtod(p,(char**)&p);
+    return p != start;
+}
+
+static bool parseList(const char*& p,char close,bool members)
+{
+    p++;
+    skipSpace(p);
+    if(*p == close)
+    {
+        p++;
+        return true;
+    }
+    for(;;)
+    {
+        skipSpace(p);
+        if(members)
+        {
+            if(!parseString(p))
+                return false;
+            skipSpace(p);
+            if(*p++ != ':')
+                return false;
+            skipSpace(p);
+        }
+        if(!parseValue(p))
+            return false;
+        skipSpace(p);
+        if(*p == close)
+        {
+            p++;
+            return true;
+        }
+        if(*p++ != ',')
+            return false;
+    }
+}
+
+static bool parseValue(const char*& p)
+{
+    switch(*p)
+    {
+    case '{':
+        return parseList(p,'}',true);
+    case '[':
+        return parseList(p,']',false);
+    case '"':
+        return parseString(p);
+    case 't':
+        return strncmp(p,"true",4) == 0 && (p += 4);
+    case 'f':
+        return strncmp(p,"false",5) == 0 && (p += 5);
+    case 'n':
+        return strncmp(p,"null",4) == 0 && (p += 4);
+    default:
+        return parseNumber(p);
+    }
+}
+
+static bool parses(const std::string& json)
+{
+    const char* p = json.c_str();
+    skipSpace(p);
+    if(!parseValue(p))
+        return false;
+    skipSpace(p);
+    return *p == 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+static int count(const std::string& json,const char* what)
+{
+    int n = 0;
+    for(size_t pos = json.find(what);pos != std::string::npos;pos = json.find(what,pos + 1))
+        n++;
+    return n;
+}
+
+// the values of the "n" args in the order of the json
+static std::vector<int> values(const std::string& json)
+{
+    std::vector<int> list;
+    for(size_t pos = json.find("\"n\":");pos != std::string::npos;pos = json.find("\"n\":",pos + 1))
+        list.push_back(atoi(json.c_str() + pos + 4));
+    return list;
+}
+
+static void addEvents(BusTracer* tracer,int first,int count)
+{
+    for(int i=first;i < first + count;i++)
+        tracer->instant("event","n",i);
+}
+
+static void otherThread(BusTracer* tracer)
+{
+    tracer->begin("other","n",1000);
+    tracer->end("other","n",1001);
+}
+
+static void testEvents()
+{
+    BusTracer tracer(64);
+    addEvents(&tracer,0,5);
+    DX_CHECK_EQUAL(count(tracer.json(),"\"cat\":\"dx\""),0);
+
+    tracer.setEnabled(true);
+    addEvents(&tracer,0,10);
+    dx::thread other(&otherThread,&tracer);
+    other.join();
+
+    std::string json = tracer.json();
+    DX_CHECK(parses(json));
+    DX_CHECK(!parses(json.substr(0,json.size() - 3)));
+    DX_CHECK_EQUAL(count(json,"\"thread_name\""),2);
+    DX_CHECK_EQUAL(count(json,"\"cat\":\"dx\""),12);
+    DX_CHECK_EQUAL(count(json,"\"ph\":\"B\""),1);
+    DX_CHECK_EQUAL(count(json,"\"ph\":\"E\""),1);
+
+    // the first event of a thread is there, all in order
+    std::vector<int> list = values(json);
+    DX_CHECK_EQUAL(list.size(),12);
+    for(int i=0;i < 10 && i < (int)list.size();i++)
+        DX_CHECK_EQUAL(list[i],i);
+}
+
+// a full ring keeps the newest, all but the slot the writer could be in
+static void testWrap()
+{
+    BusTracer tracer(8);
+    tracer.setEnabled(true);
+    addEvents(&tracer,0,20);
+
+    std::string json = tracer.json();
+    DX_CHECK(parses(json));
+    std::vector<int> list = values(json);
+    DX_CHECK_EQUAL(list.size(),7);
+    for(size_t i=0;i < list.size();i++)
+        DX_CHECK_EQUAL(list[i],13 + (int)i);
+}
+
+static void testClear()
+{
+    BusTracer tracer(8);
+    tracer.setEnabled(true);
+    addEvents(&tracer,0,5);
+    tracer.clear();
+    DX_CHECK_EQUAL(values(tracer.json()).size(),0);
+
+    addEvents(&tracer,100,3);
+    std::vector<int> list = values(tracer.json());
+    DX_CHECK_EQUAL(list.size(),3);
+    DX_CHECK(!list.empty() && list[0] == 100);
+
+    // across the wrap of the ring too
+    addEvents(&tracer,103,10);
+    list = values(tracer.json());
+    DX_CHECK_EQUAL(list.size(),7);
+    DX_CHECK(!list.empty() && list.back() == 112);
+}
+
+// a tracer at the address of a deleted one starts with its own buffers
+static void testReplace()
+{
+    void* memory = malloc(sizeof(BusTracer));
+
+    BusTracer* tracer = new(memory) BusTracer(16);
+    tracer->setEnabled(true);
+    addEvents(tracer,0,5);
+    tracer->~BusTracer();
+
+    tracer = new(memory) BusTracer(16);
+    tracer->setEnabled(true);
+    addEvents(tracer,50,2);
+    std::vector<int> list = values(tracer->json());
+    DX_CHECK_EQUAL(list.size(),2);
+    DX_CHECK(!list.empty() && list[0] == 50);
+    DX_CHECK_EQUAL(count(tracer->json(),"\"thread_name\""),1);
+    tracer->~BusTracer();
+
+    free(memory);
+}
+
+int main()
+{
+    DX_RUN(testEvents);
+    DX_RUN(testWrap);
+    DX_RUN(testClear);
+    DX_RUN(testReplace);
+    return DX_TEST_RESULT();
+}
@@ -0,0 +1,147 @@
+/* ----------------------------------------------------------------------------
+ * SimpleDynamixel
+ * ----------------------------------------------------------------------------
+ * Copyright (C) 2012 Max Rheiner / Interaction Design Zhdk
+ *
+ * This file is part of SimpleDynamixel.
+ *
+ * SimpleDynamixel is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version (subject to the "Classpath" exception
+ * as provided in the LICENSE.txt file that accompanied this code).
+ *
+ * SimpleDynamixel is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with SimpleDynamixel.  If not, see <http://www.gnu.org/licenses/>.
+ * ----------------------------------------------------------------------------
+ */
+
+// DxTrajectory limits and retargeting, TrajectoryGenerator streaming the
+// profile into fake servos
+
+#include "DxTest.h"
+#include "MemorySerial.h"
+#include "TrajectoryGenerator.h"
+
+#include <cmath>
+
+#define  DT     (0.001)
+#define  EPS    (1e-6)
+
+// runs the profile to its target, false if a limit broke or it never got there
+static bool runLimited(DxTrajectory& traj,int maxSteps)
+{
+    double lastAcc = traj.acceleration();
+    for(int i=0;i < maxSteps;i++)
+    {
+        if(!traj.step(DT))
+            return traj.isDone();
+        // the step landing on the target drops what is left of one more
+        double jerkStep = traj.maxJerk() * DT * (traj.isDone() ? 2 : 1);
+        if(std::fabs(traj.velocity()) > traj.maxVelocity() + EPS ||
+           std::fabs(traj.acceleration()) > traj.maxAcceleration() + EPS ||
+           std::fabs(traj.acceleration() - lastAcc) > jerkStep + EPS)
+            return false;
+        lastAcc = traj.acceleration();
+    }
+    return false;
+}
+
+static void testLimits()
+{
+    DxTrajectory traj;
+    traj.reset(0);
+    DX_CHECK(traj.isDone());
+    DX_CHECK(!traj.step(DT));
+
+    traj.setTarget(2000);
+    DX_CHECK(runLimited(traj,10000));
+    DX_CHECK(traj.position() == 2000);
+
+    // short moves too, they never reach full speed
+    traj.setTarget(1990);
+    DX_CHECK(runLimited(traj,10000));
+    DX_CHECK(traj.position() == 1990);
+}
+
+// a new target in the middle of the move, the velocity doesn't jump
+static void testRetarget()
+{
+    DxTrajectory traj;
+    traj.reset(0);
+    traj.setTarget(3000);
+    for(int i=0;i < 800;i++)
+        traj.step(DT);
+    DX_CHECK(traj.velocity() > 0);
+
+    double vel = traj.velocity();
+    double acc = traj.acceleration();
+    traj.setTarget(-1000);
+    traj.step(DT);
+    DX_CHECK(std::fabs(traj.velocity() - vel) <= traj.maxAcceleration() * DT + EPS);
+    DX_CHECK(std::fabs(traj.acceleration() - acc) <= traj.maxJerk() * DT + EPS);
+
+    DX_CHECK(runLimited(traj,20000));
+    DX_CHECK(traj.position() == -1000);
+}
+
+static void testGenerator()
+{
+    MemorySerial serial;
+    serial.addServo(1);
+    serial.addServo(2);
+    serial.setRegWord(2,DX_CMD_PRESENT_POS,3000);
+    DxBus bus(&serial);
+    bus.setTimeout(1);
+
+    TrajectoryGenerator gen(&bus);
+    DX_CHECK(gen.add(1,1000));
+    DX_CHECK(gen.add(2));
+    DX_CHECK(!gen.add(3));
+    DX_CHECK(gen.hasServo(2));
+    DX_CHECK_EQUAL(gen.target(2),3000);
+    DX_CHECK_EQUAL(gen.target(3),-1);
+    DX_CHECK(!gen.setTarget(3,100));
+
+    // nothing moves, nothing to write
+    int packets = serial.packetCount();
+    DX_CHECK(gen.step(0.01));
+    DX_CHECK_EQUAL(serial.packetCount(),packets);
+
+    DX_CHECK(gen.setTarget(1,1500));
+    DX_CHECK(gen.setTarget(2,2500));
+    DX_CHECK(gen.step(0.01));
+    DX_CHECK(!gen.isDone());
+    DX_CHECK(serial.regWord(1,DX_CMD_MOV_SPEED) >= gen.minSpeed());
+
+    int cycles = 0;
+    while(!gen.isDone() && cycles < 1000)
+    {
+        DX_CHECK(gen.step(0.01));
+        int pos = serial.regWord(1,DX_CMD_GOAL_POS);
+        DX_CHECK(pos >= 1000 && pos <= 1500);
+        cycles++;
+    }
+    DX_CHECK(gen.isDone());
+    DX_CHECK_EQUAL(serial.regWord(1,DX_CMD_GOAL_POS),1500);
+    DX_CHECK_EQUAL(serial.regWord(2,DX_CMD_GOAL_POS),2500);
+    DX_CHECK(gen.cycleCount() > 0);
+    DX_CHECK_EQUAL(gen.errorCount(),0);
+
+    gen.remove(1);
+    DX_CHECK(!gen.hasServo(1));
+    DX_CHECK_EQUAL(gen.target(1),-1);
+}
+
+int main()
+{
+    DX_RUN(testLimits);
+    DX_RUN(testRetarget);
+    DX_RUN(testGenerator);
+    return DX_TEST_RESULT();
+}